@@ -2,9 +2,11 @@
 
 #include <stdio.h>
 
-AudioFileSourceVFS::AudioFileSourceVFS() : f_(nullptr) {}
+#include "fs/fs.h"
 
-AudioFileSourceVFS::AudioFileSourceVFS(const char* filename) : f_(nullptr)
+AudioFileSourceVFS::AudioFileSourceVFS() : size_(0) {}
+
+AudioFileSourceVFS::AudioFileSourceVFS(const char* filename) : size_(0)
 {
     open(filename);
 }
@@ -20,69 +22,69 @@ bool AudioFileSourceVFS::open(const char* filename)
     if (!filename || !*filename) {
         return false;
     }
-    f_ = fopen(filename, "rb");
-    return f_ != nullptr;
+    VfsPath p;
+    fs_resolve(filename, p);
+    if (!vfs_open(p, VFS_OPEN_READ, file_)) {
+        return false;
+    }
+    int32_t end = vfs_seek(file_, 0, SEEK_END);
+    size_ = end > 0 ? (uint32_t)end : 0;
+    vfs_seek(file_, 0, SEEK_SET);
+    if (!reader_.begin(file_)) {
+        vfs_close(file_);
+        return false;
+    }
+    return true;
 }
 
 uint32_t AudioFileSourceVFS::read(void* data, uint32_t len)
 {
-    if (!f_ || !data || len == 0) {
+    if (!file_.handle || !data || len == 0) {
         return 0;
     }
-    return (uint32_t)fread(data, 1, len, f_);
+    int n = reader_.read(data, len);
+    return n > 0 ? (uint32_t)n : 0;
 }
 
 bool AudioFileSourceVFS::seek(int32_t pos, int dir)
 {
-    if (!f_) {
+    if (!file_.handle) {
         return false;
     }
-    return fseek(f_, pos, dir) == 0;
+    int64_t target = pos;
+    if (dir == SEEK_CUR) {
+        target += reader_.tell();
+    } else if (dir == SEEK_END) {
+        target += size_;
+    }
+    if (target < 0) {
+        return false;
+    }
+    return reader_.seek((uint32_t)target);
 }
 
 bool AudioFileSourceVFS::close()
 {
-    if (!f_) {
+    if (!file_.handle) {
         return false;
     }
-    fclose(f_);
-    f_ = nullptr;
+    reader_.end();
+    vfs_close(file_);
+    size_ = 0;
     return true;
 }
 
 bool AudioFileSourceVFS::isOpen()
 {
-    return f_ != nullptr;
+    return file_.handle != nullptr;
 }
 
 uint32_t AudioFileSourceVFS::getSize()
 {
-    if (!f_) {
-        return 0;
-    }
-    long pos = ftell(f_);
-    if (pos < 0) {
-        return 0;
-    }
-    if (fseek(f_, 0, SEEK_END) != 0) {
-        return 0;
-    }
-    long size = ftell(f_);
-    fseek(f_, pos, SEEK_SET);
-    if (size < 0) {
-        return 0;
-    }
-    return (uint32_t)size;
+    return file_.handle ? size_ : 0;
 }
 
 uint32_t AudioFileSourceVFS::getPos()
 {
-    if (!f_) {
-        return 0;
-    }
-    long pos = ftell(f_);
-    if (pos < 0) {
-        return 0;
-    }
-    return (uint32_t)pos;
+    return file_.handle ? reader_.tell() : 0;
 }
@@ -2,6 +2,11 @@
 
 #include <AudioFileSource.h>
 
+#include "fs/vfs.h"
+#include "fs/io_service.h"
+
+// Source audio lue par le service d'E/S : le bloc suivant arrive
+// pendant que le décodeur travaille sur le courant.
 class AudioFileSourceVFS : public AudioFileSource
 {
 public:
@@ -18,5 +23,7 @@ public:
     uint32_t getPos() override;
 
 private:
-    FILE* f_;
+    VfsFile file_;
+    IoReader reader_;
+    uint32_t size_;
 };
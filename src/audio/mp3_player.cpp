@@ -131,14 +131,14 @@ static void wait_for_key_release(uint32_t timeout_ms)
     }
 }
 
-bool play_mp3_file(const char* real_path)
+bool play_mp3_file(const char* path)
 {
-    if (!real_path || !*real_path) {
+    if (!path || !*path) {
         return false;
     }
 
     AudioFileSourceVFS file;
-    if (!file.open(real_path)) {
+    if (!file.open(path)) {
         return false;
     }
 
@@ -1,3 +1,3 @@
 #pragma once
 
-bool play_mp3_file(const char* real_path);
+bool play_mp3_file(const char* path);
@@ -0,0 +1,404 @@
+#include "checksum.h"
+
+#include <string.h>
+#include <new>
+
+#if defined(ESP_PLATFORM) && !defined(CHECKSUM_SOFTWARE)
+#define CHECKSUM_HW 1
+#include "esp_rom_crc.h"
+#include "mbedtls/version.h"
+#include "mbedtls/sha256.h"
+#else
+#define CHECKSUM_HW 0
+#endif
+
+// ------------------------------------------------------------
+// CRC32 (IEEE 802.3, compatible zlib)
+// ------------------------------------------------------------
+
+#if !CHECKSUM_HW
+static uint32_t crc_table[256];
+static bool crc_table_ready = false;
+
+static void crc_table_init()
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+        }
+        crc_table[i] = c;
+    }
+    crc_table_ready = true;
+}
+#endif
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* p, size_t len)
+{
+#if CHECKSUM_HW
+    return esp_rom_crc32_le(crc, p, (uint32_t)len);
+#else
+    if (!crc_table_ready) {
+        crc_table_init();
+    }
+    crc = ~crc;
+    while (len--) {
+        crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+#endif
+}
+
+// ------------------------------------------------------------
+// MD5 (RFC 1321) : pas d'accélérateur sur l'ESP32-S3
+// ------------------------------------------------------------
+
+static inline uint32_t rotl(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t rotr(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+static const uint32_t k_md5[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a,
+    0xa8304613, 0xfd469501, 0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+    0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 0xf61e2562, 0xc040b340,
+    0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8,
+    0x676f02d9, 0x8d2a4c8a, 0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+    0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70, 0x289b7ec6, 0xeaa127fa,
+    0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92,
+    0xffeff47d, 0x85845dd1, 0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+    0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const uint8_t k_md5_shift[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void md5_block(ChecksumMd5State& s, const uint8_t* p)
+{
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = (uint32_t)p[i * 4] | ((uint32_t)p[i * 4 + 1] << 8)
+            | ((uint32_t)p[i * 4 + 2] << 16) | ((uint32_t)p[i * 4 + 3] << 24);
+    }
+    uint32_t a = s.h[0];
+    uint32_t b = s.h[1];
+    uint32_t c = s.h[2];
+    uint32_t d = s.h[3];
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) & 15;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) & 15;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) & 15;
+        }
+        uint32_t t = d;
+        d = c;
+        c = b;
+        b = b + rotl(a + f + k_md5[i] + m[g], k_md5_shift[i]);
+        a = t;
+    }
+    s.h[0] += a;
+    s.h[1] += b;
+    s.h[2] += c;
+    s.h[3] += d;
+}
+
+// ------------------------------------------------------------
+// SHA-256 (FIPS 180-4), version logicielle
+// ------------------------------------------------------------
+
+static const uint32_t k_sha256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+    0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+    0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+    0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+    0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+    0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void sha256_block(ChecksumSha256State& s, const uint8_t* p)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16)
+            | ((uint32_t)p[i * 4 + 2] << 8) | (uint32_t)p[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = s.h[0];
+    uint32_t b = s.h[1];
+    uint32_t c = s.h[2];
+    uint32_t d = s.h[3];
+    uint32_t e = s.h[4];
+    uint32_t f = s.h[5];
+    uint32_t g = s.h[6];
+    uint32_t h = s.h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25))
+            + ((e & f) ^ (~e & g)) + k_sha256[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22))
+            + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    s.h[0] += a;
+    s.h[1] += b;
+    s.h[2] += c;
+    s.h[3] += d;
+    s.h[4] += e;
+    s.h[5] += f;
+    s.h[6] += g;
+    s.h[7] += h;
+}
+
+// ------------------------------------------------------------
+// Découpage en blocs de 64 octets (MD5 et SHA-256)
+// ------------------------------------------------------------
+
+typedef void (*BlockFn)(void* state, const uint8_t* p);
+
+static void md5_block_fn(void* s, const uint8_t* p)
+{
+    md5_block(*static_cast<ChecksumMd5State*>(s), p);
+}
+
+static void sha256_block_fn(void* s, const uint8_t* p)
+{
+    sha256_block(*static_cast<ChecksumSha256State*>(s), p);
+}
+
+static void blocks_update(void* state, uint64_t& total, uint8_t* block,
+    BlockFn fn, const uint8_t* p, size_t len)
+{
+    size_t fill = (size_t)(total & 63);
+    total += len;
+    if (fill > 0) {
+        size_t n = 64 - fill;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(block + fill, p, n);
+        p += n;
+        len -= n;
+        if (fill + n < 64) {
+            return;
+        }
+        fn(state, block);
+    }
+    while (len >= 64) {
+        fn(state, p);
+        p += 64;
+        len -= 64;
+    }
+    memcpy(block, p, len);
+}
+
+// 0x80, zéros, longueur en bits sur 64 bits (ordre selon l'algorithme)
+static void blocks_pad(void* state, uint64_t total, uint8_t* block,
+    BlockFn fn, bool big_endian)
+{
+    size_t fill = (size_t)(total & 63);
+    block[fill++] = 0x80;
+    if (fill > 56) {
+        memset(block + fill, 0, 64 - fill);
+        fn(state, block);
+        fill = 0;
+    }
+    memset(block + fill, 0, 56 - fill);
+    uint64_t bits = total * 8;
+    for (int i = 0; i < 8; i++) {
+        int shift = big_endian ? (56 - i * 8) : (i * 8);
+        block[56 + i] = (uint8_t)(bits >> shift);
+    }
+    fn(state, block);
+}
+
+// ------------------------------------------------------------
+// Checksum
+// ------------------------------------------------------------
+
+Checksum::Checksum(ChecksumAlgo algo)
+    : algo_(algo), crc_(0), hw_(nullptr)
+{
+    if (algo_ == CHECKSUM_MD5) {
+        md5_.h[0] = 0x67452301;
+        md5_.h[1] = 0xefcdab89;
+        md5_.h[2] = 0x98badcfe;
+        md5_.h[3] = 0x10325476;
+        md5_.len = 0;
+    } else if (algo_ == CHECKSUM_SHA256) {
+#if CHECKSUM_HW
+        mbedtls_sha256_context* ctx = new (std::nothrow) mbedtls_sha256_context;
+        if (ctx) {
+            mbedtls_sha256_init(ctx);
+#if MBEDTLS_VERSION_MAJOR < 3
+            mbedtls_sha256_starts_ret(ctx, 0);
+#else
+            mbedtls_sha256_starts(ctx, 0);
+#endif
+            hw_ = ctx;
+            return;
+        }
+#endif
+        static const uint32_t iv[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        memcpy(sha_.h, iv, sizeof(iv));
+        sha_.len = 0;
+    }
+}
+
+Checksum::~Checksum()
+{
+#if CHECKSUM_HW
+    if (hw_) {
+        mbedtls_sha256_context* ctx = static_cast<mbedtls_sha256_context*>(hw_);
+        mbedtls_sha256_free(ctx);
+        delete ctx;
+    }
+#endif
+}
+
+size_t Checksum::digest_size() const
+{
+    switch (algo_) {
+    case CHECKSUM_CRC32:
+        return 4;
+    case CHECKSUM_MD5:
+        return 16;
+    default:
+        return 32;
+    }
+}
+
+void Checksum::update(const void* data, size_t len)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    switch (algo_) {
+    case CHECKSUM_CRC32:
+        crc_ = crc32_update(crc_, p, len);
+        break;
+    case CHECKSUM_MD5:
+        blocks_update(&md5_, md5_.len, md5_.block, md5_block_fn, p, len);
+        break;
+    default:
+#if CHECKSUM_HW
+        if (hw_) {
+#if MBEDTLS_VERSION_MAJOR < 3
+            mbedtls_sha256_update_ret(
+                static_cast<mbedtls_sha256_context*>(hw_), p, len);
+#else
+            mbedtls_sha256_update(
+                static_cast<mbedtls_sha256_context*>(hw_), p, len);
+#endif
+            break;
+        }
+#endif
+        blocks_update(&sha_, sha_.len, sha_.block, sha256_block_fn, p, len);
+        break;
+    }
+}
+
+void Checksum::finish(uint8_t* digest)
+{
+    switch (algo_) {
+    case CHECKSUM_CRC32:
+        // affiché comme cksum -a crc32b : poids fort d'abord
+        for (int i = 0; i < 4; i++) {
+            digest[i] = (uint8_t)(crc_ >> (24 - i * 8));
+        }
+        break;
+    case CHECKSUM_MD5:
+        blocks_pad(&md5_, md5_.len, md5_.block, md5_block_fn, false);
+        for (int i = 0; i < 16; i++) {
+            digest[i] = (uint8_t)(md5_.h[i / 4] >> ((i % 4) * 8));
+        }
+        break;
+    default:
+#if CHECKSUM_HW
+        if (hw_) {
+#if MBEDTLS_VERSION_MAJOR < 3
+            mbedtls_sha256_finish_ret(
+                static_cast<mbedtls_sha256_context*>(hw_), digest);
+#else
+            mbedtls_sha256_finish(
+                static_cast<mbedtls_sha256_context*>(hw_), digest);
+#endif
+            break;
+        }
+#endif
+        blocks_pad(&sha_, sha_.len, sha_.block, sha256_block_fn, true);
+        for (int i = 0; i < 32; i++) {
+            digest[i] = (uint8_t)(sha_.h[i / 4] >> (24 - (i % 4) * 8));
+        }
+        break;
+    }
+}
+
+// ------------------------------------------------------------
+// Utilitaires
+// ------------------------------------------------------------
+
+uint32_t checksum_crc32(uint32_t crc, const void* data, size_t len)
+{
+    return crc32_update(crc, static_cast<const uint8_t*>(data), len);
+}
+
+bool checksum_algo_from_name(const char* name, ChecksumAlgo& out)
+{
+    if (strcmp(name, "crc32") == 0) {
+        out = CHECKSUM_CRC32;
+    } else if (strcmp(name, "md5sum") == 0) {
+        out = CHECKSUM_MD5;
+    } else if (strcmp(name, "sha256sum") == 0) {
+        out = CHECKSUM_SHA256;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void checksum_to_hex(const uint8_t* digest, size_t len, char* out)
+{
+    static const char hex[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[i * 2] = hex[digest[i] >> 4];
+        out[i * 2 + 1] = hex[digest[i] & 15];
+    }
+    out[len * 2] = 0;
+}
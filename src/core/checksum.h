@@ -0,0 +1,66 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// ------------------------------------------------------------
+// Sommes de contrôle incrémentales (crc32, md5sum, sha256sum)
+// ------------------------------------------------------------
+//
+// Sur la cible, SHA-256 passe par mbedTLS (périphérique SHA de
+// l'ESP32-S3) et CRC32 par la routine de la ROM. Les versions
+// logicielles servent sur l'hôte, ou partout avec CHECKSUM_SOFTWARE.
+
+enum ChecksumAlgo : uint8_t {
+    CHECKSUM_CRC32 = 0,
+    CHECKSUM_MD5,
+    CHECKSUM_SHA256
+};
+
+static constexpr size_t kChecksumMaxDigest = 32;
+
+struct ChecksumMd5State {
+    uint32_t h[4];
+    uint64_t len;
+    uint8_t block[64];
+};
+
+struct ChecksumSha256State {
+    uint32_t h[8];
+    uint64_t len;
+    uint8_t block[64];
+};
+
+class Checksum {
+public:
+    explicit Checksum(ChecksumAlgo algo);
+    ~Checksum();
+
+    void update(const void* data, size_t len);
+    // écrit digest_size() octets ; le calcul est terminé ensuite
+    void finish(uint8_t* digest);
+
+    ChecksumAlgo algo() const { return algo_; }
+    size_t digest_size() const;
+
+private:
+    Checksum(const Checksum&) = delete;
+    Checksum& operator=(const Checksum&) = delete;
+
+    ChecksumAlgo algo_;
+    uint32_t crc_;
+    void* hw_;                  // contexte mbedTLS, nullptr = logiciel
+    union {
+        ChecksumMd5State md5_;
+        ChecksumSha256State sha_;
+    };
+};
+
+// CRC32 brut (gzip, zlib) : crc = 0 au départ, chaînable
+uint32_t checksum_crc32(uint32_t crc, const void* data, size_t len);
+
+// nom de commande (crc32, md5sum, sha256sum) -> algorithme
+bool checksum_algo_from_name(const char* name, ChecksumAlgo& out);
+
+// digest -> hexadécimal minuscule (out : 2 * len + 1 octets)
+void checksum_to_hex(const uint8_t* digest, size_t len, char* out);
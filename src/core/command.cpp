@@ -5,12 +5,19 @@
 #include "ui/screen.h"
 #include "ui/screensaver.h"
 #include "fs/fs.h"
+#include "fs/vfs.h"
+#include "fs/io_service.h"
+#include "fs/tar.h"
+#include "hal/flashfs.h"
+#include "hal/sdcard.h"
+#include "hal/sd_cache.h"
 #include "editor/editor.h"
 #include "lx_runner.h"
 #include "lxsh_exec_bridge.h"
 #include "audio/mp3_player.h"
 #include "audio/wav_player.h"
 #include "core/settings.h"
+#include "core/checksum.h"
 
 #include <string.h>
 #include <string>
@@ -58,6 +65,36 @@ static void format_human_size(uint64_t bytes, char* out, size_t out_sz)
     snprintf(out, out_sz, "%.1f%s", value, units[unit]);
 }
 
+static void du_print_line(uint64_t bytes, bool human, const char* path)
+{
+    char size_str[16];
+    if (human) {
+        format_human_size(bytes, size_str, sizeof(size_str));
+    } else {
+        snprintf(size_str, sizeof(size_str), "%llu",
+            (unsigned long long)((bytes + 1023) / 1024));
+    }
+    char line[160];
+    snprintf(line, sizeof(line), "%6s  %s\n", size_str, path);
+    term_puts(line);
+}
+
+static void df_print_line(const char* label, uint64_t total, uint64_t used,
+    const char* mount)
+{
+    char size_str[16];
+    char used_str[16];
+    char avail_str[16];
+    format_human_size(total, size_str, sizeof(size_str));
+    format_human_size(used, used_str, sizeof(used_str));
+    format_human_size(total - used, avail_str, sizeof(avail_str));
+
+    char line[128];
+    snprintf(line, sizeof(line), "%-10s %5s %5s %5s  %s\n",
+        label, size_str, used_str, avail_str, mount);
+    term_puts(line);
+}
+
 static bool ctrl_c_pressed()
 {
     auto &st = M5Cardputer.Keyboard.keysState();
@@ -377,19 +414,70 @@ static void view_wait_for_char_release(char target)
 
 static bool has_ext(const char* path, const char* ext);
 
-static bool view_render_image(const char* real_path)
+// Image lue par le service d'E/S : le décodeur travaille sur un bloc
+// pendant que le suivant arrive de la carte.
+class ViewImageSource : public lgfx::DataWrapper {
+public:
+    bool open(const char* path)
+    {
+        VfsPath p;
+        fs_resolve(path, p);
+        if (!vfs_open(p, VFS_OPEN_READ, file_)) {
+            return false;
+        }
+        if (!reader_.begin(file_)) {
+            vfs_close(file_);
+            return false;
+        }
+        return true;
+    }
+    int read(uint8_t* buf, uint32_t len) override
+    {
+        return reader_.read(buf, len);
+    }
+    void skip(int32_t offset) override
+    {
+        int64_t pos = (int64_t)reader_.tell() + offset;
+        reader_.seek(pos > 0 ? (uint32_t)pos : 0);
+    }
+    bool seek(uint32_t offset) override
+    {
+        return reader_.seek(offset);
+    }
+    void close() override
+    {
+        if (file_.handle) {
+            reader_.end();
+            vfs_close(file_);
+        }
+    }
+    int32_t tell() override
+    {
+        return (int32_t)reader_.tell();
+    }
+
+private:
+    VfsFile file_;
+    IoReader reader_;
+};
+
+static bool view_render_image(const char* path)
 {
+    ViewImageSource src;
+    if (!src.open(path)) {
+        return false;
+    }
     int16_t w = M5.Display.width();
     int16_t h = M5.Display.height();
     M5.Display.setTextDatum(lgfx::datum_t::middle_center);
-    const bool is_png = has_ext(real_path, ".png");
-    const bool is_jpg = has_ext(real_path, ".jpg") || has_ext(real_path, ".jpeg");
+    const bool is_png = has_ext(path, ".png");
     bool ok = is_png
-        ? M5.Display.drawPngFile(real_path, 0, 0, w, h, 0, 0, 0.0f, 0.0f,
+        ? M5.Display.drawPng(&src, 0, 0, w, h, 0, 0, 0.0f, 0.0f,
             lgfx::datum_t::middle_center)
-        : M5.Display.drawJpgFile(real_path, 0, 0, w, h, 0, 0, 0.0f, 0.0f,
+        : M5.Display.drawJpg(&src, 0, 0, w, h, 0, 0, 0.0f, 0.0f,
             lgfx::datum_t::middle_center);
     M5.Display.setTextDatum(lgfx::datum_t::top_left);
+    src.close();
     return ok;
 }
 
@@ -539,7 +627,35 @@ static std::string man_entry(const char* name)
          "  df -h\n"
          "\n"
          "NOTES\n"
-         "  Reports size, used, available, and mount point.\n"},
+         "  Reports size, used, available, and mount point.\n"
+         "  /tmp is the RAM filesystem, sized by lxprofile.\n"
+         "  /flash is LittleFS on the internal flash.\n"
+         "  SD free space is counted in the\n"
+         "  background after mount; until then\n"
+         "  df shows ? and \"updating\".\n"},
+        {"sdinfo",
+         "NAME\n"
+         "  sdinfo - SD card details\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  sdinfo\n"
+         "\n"
+         "NOTES\n"
+         "  Shows card name, size, the SPI clock\n"
+         "  negotiated at mount, sector cache\n"
+         "  counters and a raw read throughput\n"
+         "  measured over 256 KB.\n"},
+        {"sync",
+         "NAME\n"
+         "  sync - write cached data to disk\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  sync\n"
+         "\n"
+         "NOTES\n"
+         "  SD writes are cached and flushed\n"
+         "  after 1 s idle or on umount. Run\n"
+         "  sync before removing the card.\n"},
         {"mkdir",
          "NAME\n"
          "  mkdir - create directory\n"
@@ -554,22 +670,159 @@ static std::string man_entry(const char* name)
          "  rmdir <path>\n"},
         {"cp",
          "NAME\n"
-         "  cp - copy file\n"
+         "  cp - copy files\n"
          "\n"
          "SYNOPSIS\n"
-         "  cp <src> <dst>\n"},
+         "  cp <src> <dst>\n"
+         "  cp -r <src> <dst>\n"
+         "\n"
+         "OPTIONS\n"
+         "  -r   copy a directory and its contents\n"
+         "\n"
+         "NOTES\n"
+         "  If <dst> is a directory, <src> is\n"
+         "  copied into it. Long copies show\n"
+         "  progress; the size and MB/s are\n"
+         "  printed at the end.\n"},
         {"mv",
          "NAME\n"
-         "  mv - move/rename file\n"
+         "  mv - move/rename file or directory\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  mv <src> <dst>\n"
+         "\n"
+         "NOTES\n"
+         "  Across filesystems the source is\n"
+         "  copied, then removed.\n"},
+        {"dd",
+         "NAME\n"
+         "  dd - copy blocks, measure speed\n"
          "\n"
          "SYNOPSIS\n"
-         "  mv <src> <dst>\n"},
+         "  dd [if=<src>] [of=<dst>]\n"
+         "     [bs=<n>] [count=<n>]\n"
+         "\n"
+         "OPTIONS\n"
+         "  if=    input (/dev/zero)\n"
+         "  of=    output (/dev/null)\n"
+         "  bs=    block size, k/m suffix\n"
+         "         (512, max 64k)\n"
+         "  count= number of blocks\n"
+         "\n"
+         "NOTES\n"
+         "  count= is required when reading\n"
+         "  /dev/zero or /dev/urandom.\n"
+         "  Prints records and KB/s.\n"},
+        {"crc32",
+         "NAME\n"
+         "  crc32 - CRC-32 checksum\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  crc32 <path>...\n"
+         "  <cmd> | crc32\n"
+         "\n"
+         "NOTES\n"
+         "  Reads files in 16 KB blocks.\n"
+         "  \"cat f | crc32\" hashes f\n"
+         "  byte for byte.\n"},
+        {"md5sum",
+         "NAME\n"
+         "  md5sum - MD5 checksum\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  md5sum <path>...\n"
+         "  <cmd> | md5sum\n"
+         "\n"
+         "NOTES\n"
+         "  Reads files in 16 KB blocks.\n"
+         "  \"cat f | md5sum\" hashes f\n"
+         "  byte for byte.\n"},
+        {"sha256sum",
+         "NAME\n"
+         "  sha256sum - SHA-256 checksum\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  sha256sum <path>...\n"
+         "  <cmd> | sha256sum\n"
+         "\n"
+         "NOTES\n"
+         "  Reads files in 16 KB blocks.\n"
+         "  \"cat f | sha256sum\" hashes f\n"
+         "  byte for byte.\n"},
+        {"gzip",
+         "NAME\n"
+         "  gzip - compress files (.gz)\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  gzip [-d] [-k] <path>...\n"
+         "\n"
+         "OPTIONS\n"
+         "  -d   decompress (gunzip)\n"
+         "  -k   keep the original file\n"
+         "\n"
+         "NOTES\n"
+         "  cat, more and lx read .gz\n"
+         "  files directly.\n"},
+        {"gunzip",
+         "NAME\n"
+         "  gunzip - decompress .gz files\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  gunzip [-k] <path>...\n"
+         "\n"
+         "OPTIONS\n"
+         "  -k   keep the .gz file\n"},
+        {"tar",
+         "NAME\n"
+         "  tar - pack files into an archive\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  tar -c [-zv] -f <ar> <path>...\n"
+         "  tar -x [-v] -f <ar> [-C <dir>]\n"
+         "  tar -t [-v] -f <ar>\n"
+         "\n"
+         "OPTIONS\n"
+         "  -c   create\n"
+         "  -x   extract (into cwd or -C)\n"
+         "  -t   list contents\n"
+         "  -z   gzip the archive (.tgz and\n"
+         "       .tar.gz imply it)\n"
+         "  -v   print each entry\n"
+         "\n"
+         "NOTES\n"
+         "  Compressed archives are detected\n"
+         "  when reading.\n"},
+        {"du",
+         "NAME\n"
+         "  du - disk usage of a tree\n"
+         "\n"
+         "SYNOPSIS\n"
+         "  du [-sh] [-d n] [-n n] [path]\n"
+         "\n"
+         "OPTIONS\n"
+         "  -s   total only\n"
+         "  -h   human-readable sizes\n"
+         "  -d   list entries n levels down\n"
+         "       (default 1)\n"
+         "  -n   only the n largest entries\n"
+         "\n"
+         "NOTES\n"
+         "  Entries are sorted largest first;\n"
+         "  directories end with '/'. Sizes\n"
+         "  are in KB without -h.\n"
+         "  Directory totals are cached: a\n"
+         "  second run only rereads what\n"
+         "  changed since.\n"},
         {"rm",
          "NAME\n"
          "  rm - remove file (asks confirmation)\n"
          "\n"
          "SYNOPSIS\n"
-         "  rm <path>\n"},
+         "  rm <path>\n"
+         "  rm -r <path>\n"
+         "\n"
+         "OPTIONS\n"
+         "  -r   remove a directory and its contents\n"},
         {"touch",
          "NAME\n"
          "  touch - create empty file or update timestamp\n"
@@ -597,7 +850,7 @@ static std::string man_entry(const char* name)
          "  power    - lowest reserve, maximum capacity (higher OOM risk)\n"
          "\n"
          "NOTES\n"
-         "  The default profile is loaded from /media/0/.lxscriptrc when available.\n"
+         "  The default profile is loaded from /flash/.lxscriptrc when available.\n"
          "  It defaults to power when no profile is configured.\n"
          "  Using --profile changes the profile for that run only.\n"},
         {"lxprofile",
@@ -613,7 +866,7 @@ static std::string man_entry(const char* name)
          "  power    - lowest reserve, maximum capacity (higher OOM risk)\n"
          "\n"
          "NOTES\n"
-         "  When an SD card is mounted, the value is saved to /media/0/.lxscriptrc.\n"},
+         "  The value is saved to /flash/.lxscriptrc (or the SD card).\n"},
         {"led",
          "NAME\n"
          "  led - control the RGB LED\n"
@@ -664,9 +917,14 @@ static std::string man_entry(const char* name)
          "  find - search files\n"
          "\n"
          "SYNOPSIS\n"
-         "  find <path>\n"
-         "  find <path> -name <pattern>\n"
-         "  find <path> -iname <pattern>\n"},
+         "  find [path] [options]\n"
+         "\n"
+         "OPTIONS\n"
+         "  -name <pattern>    match name (* and ?)\n"
+         "  -iname <pattern>   same, case-insensitive\n"
+         "  -type f|d          files or directories only\n"
+         "  -maxdepth <n>      descend at most n levels\n"
+         "  -size [+|-]n[ckMG] size equal, above (+) or below (-)\n"},
         {"vi",
          "NAME\n"
          "  vi - minimal editor\n"
@@ -675,7 +933,8 @@ static std::string man_entry(const char* name)
          "  vi [path]\n"
          "\n"
          "NOTES\n"
-         "  Modes: NORMAL/INSERT/COMMAND/Search\n"},
+         "  Modes: NORMAL/INSERT/COMMAND/Search\n"
+         "  u undo, ^R redo (16 KB journal)\n"},
         {"view",
          "NAME\n"
          "  view - display a PNG or JPEG image\n"
@@ -718,7 +977,7 @@ static std::string man_entry(const char* name)
          "  brightness <7-255>\n"
          "\n"
          "NOTES\n"
-         "  When an SD card is mounted, the value is saved to /media/0/.lxshellrc.\n"},
+         "  The value is saved to /flash/.lxshellrc (or the SD card).\n"},
         {"nano",
          "NAME\n"
          "  nano - minimal editor (nano-style)\n"
@@ -727,7 +986,8 @@ static std::string man_entry(const char* name)
          "  nano [path]\n"
          "\n"
          "KEYS\n"
-         "  ^O write  ^X exit  ^W search  ^K cut line  ^U paste\n"},
+         "  ^O write  ^X exit  ^W search  ^K cut line  ^U paste\n"
+         "  M-U undo  M-E redo\n"},
         {"uptime",
          "NAME\n"
          "  uptime - show time since boot\n"
@@ -893,6 +1153,105 @@ static void parse_tokens(const char* line, std::vector<std::string>& out)
     }
 }
 
+// ------------------------------------------------------------
+// Sommes de contrôle
+// ------------------------------------------------------------
+
+static void checksum_feed(const uint8_t* data, size_t len, void* user)
+{
+    static_cast<Checksum*>(user)->update(data, len);
+}
+
+static void checksum_print(Checksum& ck, const char* label)
+{
+    uint8_t digest[kChecksumMaxDigest];
+    char hex[kChecksumMaxDigest * 2 + 1];
+    ck.finish(digest);
+    checksum_to_hex(digest, ck.digest_size(), hex);
+    term_puts(hex);
+    term_puts("  ");
+    term_puts(label);
+    term_puts("\n");
+}
+
+// une somme par fichier, lu en blocs de 16 Ko sans filtrage
+static bool checksum_files(ChecksumAlgo algo,
+    const std::vector<std::string>& paths, size_t first)
+{
+    bool ok = true;
+    for (size_t i = first; i < paths.size(); i++) {
+        Checksum ck(algo);
+        if (!fs_read_blocks(paths[i].c_str(), checksum_feed, &ck)) {
+            term_error(("cannot read " + paths[i]).c_str());
+            ok = false;
+            continue;
+        }
+        checksum_print(ck, paths[i].c_str());
+    }
+    return ok;
+}
+
+// <cmd> | sum : "cat f..." est lu directement (octets exacts, sans
+// capture) ; sinon la sortie capturée est hachée
+static bool command_exec_line(const char* line, bool allow_pipe);
+
+static bool checksum_pipe(ChecksumAlgo algo, const std::string& left)
+{
+    Checksum ck(algo);
+    std::vector<std::string> tokens;
+    parse_tokens(left.c_str(), tokens);
+    if (tokens.size() > 1 && tokens[0] == "cat") {
+        for (size_t i = 1; i < tokens.size(); i++) {
+            if (!fs_read_blocks(tokens[i].c_str(), checksum_feed, &ck)) {
+                term_error(("cannot read " + tokens[i]).c_str());
+                return false;
+            }
+        }
+        checksum_print(ck, "-");
+        return true;
+    }
+
+    term_capture_start();
+    bool ok = command_exec_line(left.c_str(), false);
+    std::string out = term_capture_buffer();
+    term_capture_stop();
+    if (!ok) {
+        if (!out.empty()) {
+            term_puts(out.c_str());
+        }
+        return false;
+    }
+    ck.update(out.data(), out.size());
+    checksum_print(ck, "-");
+    return true;
+}
+
+// ------------------------------------------------------------
+// tar
+// ------------------------------------------------------------
+
+static void tar_print_name(const char* name, uint64_t, void*)
+{
+    term_puts(name);
+    term_puts("\n");
+}
+
+static void tar_print_long(const char* name, uint64_t size, void*)
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%8lu ", (unsigned long)size);
+    term_puts(buf);
+    term_puts(name);
+    term_puts("\n");
+}
+
+static bool has_gz_suffix(const std::string& name)
+{
+    size_t n = name.size();
+    return (n > 3 && strcasecmp(name.c_str() + n - 3, ".gz") == 0)
+        || (n > 4 && strcasecmp(name.c_str() + n - 4, ".tgz") == 0);
+}
+
 // ------------------------------------------------------------
 // Exécution commande
 // ------------------------------------------------------------
@@ -902,6 +1261,7 @@ static int last_status = 0;
 static bool command_exec_line(const char* line, bool allow_pipe)
 {
     static bool rm_pending = false;
+    static bool rm_recursive = false;
     static char rm_target[64];
 
     if (!line || !*line) {
@@ -911,11 +1271,14 @@ static bool command_exec_line(const char* line, bool allow_pipe)
     if (rm_pending) {
         rm_pending = false;
         if (strcmp(line, "y") == 0 || strcmp(line, "Y") == 0) {
-            if (fs_rm(rm_target)) {
+            bool deep = false;
+            bool removed = rm_recursive ? fs_rm_recursive(rm_target, &deep)
+                                        : fs_rm(rm_target);
+            if (removed) {
                 term_puts("removed\n");
                 return true;
             }
-            term_error("cannot remove");
+            term_error(deep ? "depth limit reached" : "cannot remove");
             return false;
         }
         term_puts("cancelled\n");
@@ -984,6 +1347,11 @@ static bool command_exec_line(const char* line, bool allow_pipe)
                 return ok;
             }
 
+            ChecksumAlgo algo;
+            if (checksum_algo_from_name(pcmd, algo)) {
+                return checksum_pipe(algo, left);
+            }
+
             if (strcmp(pcmd, "tee") == 0) {
                 const char* out_path = nullptr;
                 bool append = false;
@@ -1083,7 +1451,7 @@ static bool command_exec_line(const char* line, bool allow_pipe)
         }
 
         if (fs_mount()) {
-            term_puts("SDCard 0 mounted at /media/0\n");
+            term_puts("SDCard 0 mounted at " FS_SD_MOUNT_POINT "\n");
             settings_load_if_available();
             M5.Display.setBrightness(settings_get_brightness());
         } else {
@@ -1102,16 +1470,7 @@ static bool command_exec_line(const char* line, bool allow_pipe)
             return false;
         }
 
-        const char* cwd = fs_pwd();
-        if (cwd) {
-            const char* mount_root = "/media/0";
-            size_t mount_len = strlen(mount_root);
-            if (strncmp(cwd, mount_root, mount_len) == 0 &&
-                (cwd[mount_len] == '\0' || cwd[mount_len] == '/')) {
-                fs_cd("/");
-            }
-        }
-
+        // fs_umount() ramène cwd à "/" s'il était sur la carte
         fs_umount();
         term_puts("SDCard unmounted\n");
         return true;
@@ -1127,40 +1486,95 @@ static bool command_exec_line(const char* line, bool allow_pipe)
         }
 
         term_puts("Filesystem  Size  Used  Avail  Mounted\n");
+        FsSpace space;
+        if (fs_space(FS_TMP_MOUNT_POINT, space)) {
+            df_print_line("tmpfs", space.total, space.total - space.free,
+                FS_TMP_MOUNT_POINT);
+        }
+        if (fs_flash_mounted() && fs_space(FS_FLASH_MOUNT_POINT, space)) {
+            df_print_line("flash", space.total, space.total - space.free,
+                FS_FLASH_MOUNT_POINT);
+        }
         if (!fs_sd_mounted()) {
-            term_puts("(none)\n");
             return true;
         }
-
-        FATFS* fs = nullptr;
-        DWORD free_clust = 0;
-        FRESULT res = f_getfree("0:", &free_clust, &fs);
-        if (res != FR_OK || !fs) {
-            term_error("cannot stat /media/0");
+        if (!fs_space(FS_SD_MOUNT_POINT, space)) {
+            term_error("cannot stat " FS_SD_MOUNT_POINT);
             return false;
         }
+        if (space.known) {
+            df_print_line("SDCard0", space.total, space.total - space.free,
+                FS_SD_MOUNT_POINT);
+            return true;
+        }
+        // comptage de la FAT en tâche de fond : taille seule
+        char size_str[16];
+        format_human_size(space.total, size_str, sizeof(size_str));
+        char line[128];
+        snprintf(line, sizeof(line), "%-10s %5s %5s %5s  %s\n", "SDCard0",
+            size_str, "?", "?", FS_SD_MOUNT_POINT);
+        term_puts(line);
+        term_puts(space.updating ? "(SD free space: updating)\n"
+                                 : "(SD free space: unknown)\n");
+        return true;
+    }
 
-#if FF_MAX_SS != FF_MIN_SS
-        uint32_t sector_size = fs->ssize;
-#else
-        uint32_t sector_size = FF_MAX_SS;
-#endif
+    // --------------------------------------------------------
+    // sync
+    // --------------------------------------------------------
+    if (strcmp(cmd, "sync") == 0) {
+        if (!fs_sync()) {
+            term_error("sync failed");
+            return false;
+        }
+        return true;
+    }
 
-        uint64_t total = (uint64_t)(fs->n_fatent - 2) * fs->csize * sector_size;
-        uint64_t avail = (uint64_t)free_clust * fs->csize * sector_size;
-        uint64_t used = total - avail;
+    // --------------------------------------------------------
+    // sdinfo
+    // --------------------------------------------------------
+    if (strcmp(cmd, "sdinfo") == 0) {
+        SdInfo info;
+        if (!sd_get_info(info)) {
+            term_error("not mounted");
+            return false;
+        }
 
         char size_str[16];
-        char used_str[16];
-        char avail_str[16];
-        format_human_size(total, size_str, sizeof(size_str));
-        format_human_size(used, used_str, sizeof(used_str));
-        format_human_size(avail, avail_str, sizeof(avail_str));
+        format_human_size(info.capacity_bytes, size_str, sizeof(size_str));
 
-        char line[128];
-        snprintf(line, sizeof(line), "SDCard0    %5s %5s %5s  /media/0\n",
-            size_str, used_str, avail_str);
-        term_puts(line);
+        char buf[64];
+        snprintf(buf, sizeof(buf), "Card:  %s (%02x/%08lx)\n", info.name,
+            (unsigned)info.mfg_id, (unsigned long)info.serial);
+        term_puts(buf);
+        snprintf(buf, sizeof(buf), "Size:  %s\n", size_str);
+        term_puts(buf);
+        snprintf(buf, sizeof(buf), "Clock: %lu kHz%s\n",
+            (unsigned long)info.freq_khz, info.freq_cached ? " (cached)" : "");
+        term_puts(buf);
+
+        SdCacheStats cs;
+        if (sd_cache_get_stats(cs)) {
+            uint32_t lookups = cs.hits + cs.misses;
+            unsigned pct = lookups ? (unsigned)((uint64_t)cs.hits * 100 / lookups) : 0;
+            snprintf(buf, sizeof(buf), "Cache: %lu sect, %lu dirty\n",
+                (unsigned long)cs.slots, (unsigned long)cs.dirty);
+            term_puts(buf);
+            snprintf(buf, sizeof(buf), "  hit %lu miss %lu (%u%%)\n",
+                (unsigned long)cs.hits, (unsigned long)cs.misses, pct);
+            term_puts(buf);
+            snprintf(buf, sizeof(buf), "  flush %lu sect in %lu wr\n",
+                (unsigned long)cs.flushed_sectors, (unsigned long)cs.flush_writes);
+            term_puts(buf);
+        }
+
+        uint32_t kbps = 0;
+        if (sd_measure_read(256, kbps)) {
+            snprintf(buf, sizeof(buf), "Read:  %lu KB/s\n", (unsigned long)kbps);
+        } else {
+            snprintf(buf, sizeof(buf), "Read:  failed\n");
+        }
+        term_puts(buf);
         return true;
     }
 
@@ -1182,14 +1596,14 @@ static bool command_exec_line(const char* line, bool allow_pipe)
             return false;
         }
 
-        char real[128];
-        if (!fs_resolve_real_path(arg1, real, sizeof(real))) {
+        FsStat st;
+        if (!fs_stat(arg1, st) || !st.is_file) {
             term_error("cannot read");
             return false;
         }
 
-        bool is_png = has_ext(real, ".png");
-        bool is_jpg = has_ext(real, ".jpg") || has_ext(real, ".jpeg");
+        bool is_png = has_ext(arg1, ".png");
+        bool is_jpg = has_ext(arg1, ".jpg") || has_ext(arg1, ".jpeg");
         if (!is_png && !is_jpg) {
             term_error("unsupported format");
             return false;
@@ -1198,7 +1612,7 @@ static bool command_exec_line(const char* line, bool allow_pipe)
         screen_clear();
         uint8_t base_rotation = M5.Display.getRotation();
         uint8_t rotation = base_rotation;
-        bool ok = view_render_image(real);
+        bool ok = view_render_image(arg1);
 
         if (!ok) {
             screen_clear();
@@ -1224,7 +1638,7 @@ static bool command_exec_line(const char* line, bool allow_pipe)
                 rotation = (uint8_t)((rotation + 1) % 4);
                 M5.Display.setRotation(rotation);
                 screen_clear();
-                view_render_image(real);
+                view_render_image(arg1);
                 view_wait_for_char_release('r');
                 view_wait_for_char_release('R');
                 continue;
@@ -1320,14 +1734,8 @@ static bool command_exec_line(const char* line, bool allow_pipe)
 
         for (;;) {
             std::string item_path = make_path(items[index]);
-            char real[128];
-            if (!fs_resolve_real_path(item_path.c_str(), real, sizeof(real))) {
-                term_error("cannot read");
-                break;
-            }
-
             screen_clear();
-            if (!view_render_image(real)) {
+            if (!view_render_image(item_path.c_str())) {
                 term_error("cannot read");
                 break;
             }
@@ -1351,7 +1759,7 @@ static bool command_exec_line(const char* line, bool allow_pipe)
                     rotation = (uint8_t)((rotation + 1) % 4);
                     M5.Display.setRotation(rotation);
                     screen_clear();
-                    view_render_image(real);
+                    view_render_image(item_path.c_str());
                     view_wait_for_char_release('r');
                     view_wait_for_char_release('R');
                     continue;
@@ -1415,14 +1823,14 @@ static bool command_exec_line(const char* line, bool allow_pipe)
             return false;
         }
 
-        char real[128];
-        if (!fs_resolve_real_path(path, real, sizeof(real))) {
+        FsStat st;
+        if (!fs_stat(path, st) || !st.is_file) {
             term_error("cannot read");
             return false;
         }
 
-        bool is_wav = has_ext(real, ".wav");
-        bool is_mp3 = has_ext(real, ".mp3");
+        bool is_wav = has_ext(path, ".wav");
+        bool is_mp3 = has_ext(path, ".mp3");
         if (!is_wav && !is_mp3) {
             term_error("unsupported format");
             return false;
@@ -1444,7 +1852,7 @@ static bool command_exec_line(const char* line, bool allow_pipe)
         M5.Speaker.config(spk_cfg);
         M5.Speaker.begin();
         if (is_mp3) {
-            if (!play_mp3_file(real)) {
+            if (!play_mp3_file(path)) {
                 if (volume >= 0) {
                     M5.Speaker.setVolume(prev_vol);
                 }
@@ -1452,7 +1860,7 @@ static bool command_exec_line(const char* line, bool allow_pipe)
                 return false;
             }
         } else {
-            if (!play_wav_file(real)) {
+            if (!play_wav_file(path)) {
                 if (volume >= 0) {
                     M5.Speaker.setVolume(prev_vol);
                 }
@@ -2064,43 +2472,158 @@ static bool command_exec_line(const char* line, bool allow_pipe)
     }
 
     // --------------------------------------------------------
-    // find <path> [-name|-iname pattern]
+    // find [path] [-name|-iname pattern] [-type f|d] [-maxdepth n]
+    //      [-size [+|-]n[c|k|M|G]]
     // --------------------------------------------------------
     if (strcmp(cmd, "find") == 0) {
-        const char* path = (*arg1) ? arg1 : ".";
-        const char* opt = (*arg2) ? arg2 : "";
+        std::vector<std::string> tokens;
+        parse_tokens(line, tokens);
 
-        if ((strcmp(path, ".") == 0 || strcmp(path, "./") == 0) && strcmp(fs_pwd(), "/") == 0) {
+        size_t idx = 1;
+        std::string path = ".";
+        if (idx < tokens.size() && tokens[idx][0] != '-') {
+            path = tokens[idx++];
+        }
+
+        if ((path == "." || path == "./") && strcmp(fs_pwd(), "/") == 0) {
             if (fs_sd_mounted()) {
-                path = "/media/0";
+                path = FS_SD_MOUNT_POINT;
             }
         }
 
-        if (!*opt) {
-            if (!fs_find(path, nullptr, false)) {
-                term_error("cannot access");
+        FsFindOptions opts;
+        for (; idx < tokens.size(); idx++) {
+            const std::string& opt = tokens[idx];
+            if (idx + 1 >= tokens.size()) {
+                term_error(opt == "-name" || opt == "-iname"
+                    ? "missing pattern" : "missing operand");
                 return false;
             }
-            return true;
-        }
-
-        if (strcmp(opt, "-name") == 0 || strcmp(opt, "-iname") == 0) {
-            const char* pattern = (*arg3) ? arg3 : "";
-            if (!*pattern) {
-                term_error("missing pattern");
+            const std::string& val = tokens[++idx];
+            if (opt == "-name" || opt == "-iname") {
+                opts.pattern = val.c_str();
+                opts.case_insensitive = (opt == "-iname");
+            } else if (opt == "-type") {
+                if (val != "f" && val != "d") {
+                    term_error("bad type");
+                    return false;
+                }
+                opts.type = val[0];
+            } else if (opt == "-maxdepth") {
+                char* end = nullptr;
+                long depth = strtol(val.c_str(), &end, 10);
+                if (end == val.c_str() || *end != '\0' || depth < 0) {
+                    term_error("bad depth");
+                    return false;
+                }
+                opts.max_depth = (int)depth;
+            } else if (opt == "-size") {
+                const char* p = val.c_str();
+                if (*p == '+' || *p == '-') {
+                    opts.size_cmp = (*p == '+') ? 1 : -1;
+                    p++;
+                }
+                char* end = nullptr;
+                unsigned long n = strtoul(p, &end, 10);
+                if (end == p) {
+                    term_error("bad size");
+                    return false;
+                }
+                switch (*end) {
+                    case '\0':
+                    case 'c': opts.size_unit = 1; break;
+                    case 'k': opts.size_unit = 1024; break;
+                    case 'M': opts.size_unit = 1024UL * 1024UL; break;
+                    case 'G': opts.size_unit = 1024UL * 1024UL * 1024UL; break;
+                    default:
+                        term_error("bad size");
+                        return false;
+                }
+                if (*end && end[1]) {
+                    term_error("bad size");
+                    return false;
+                }
+                opts.size_value = (uint32_t)n;
+                opts.has_size = true;
+            } else {
+                term_error("bad option");
                 return false;
             }
+        }
 
-            bool ci = (strcmp(opt, "-iname") == 0);
-            if (!fs_find(path, pattern, ci)) {
-                term_error("cannot access");
+        if (!fs_find(path.c_str(), opts)) {
+            term_error("cannot access");
+            return false;
+        }
+        return true;
+    }
+
+    // --------------------------------------------------------
+    // du [-sh] [-d n] [-n n] [path]
+    // --------------------------------------------------------
+    if (strcmp(cmd, "du") == 0) {
+        std::vector<std::string> tokens;
+        parse_tokens(line, tokens);
+
+        FsDuOptions opts;
+        bool human = false;
+        std::string path;
+        for (size_t i = 1; i < tokens.size(); i++) {
+            const std::string& tok = tokens[i];
+            if (tok == "-d" || tok == "-n") {
+                if (i + 1 >= tokens.size()) {
+                    term_error("missing operand");
+                    return false;
+                }
+                const std::string& val = tokens[++i];
+                char* end = nullptr;
+                long n = strtol(val.c_str(), &end, 10);
+                if (end == val.c_str() || *end != '\0' || n < 0) {
+                    term_error(tok == "-d" ? "bad depth" : "bad count");
+                    return false;
+                }
+                if (tok == "-d") {
+                    opts.max_depth = (int)n;
+                } else {
+                    opts.top = (size_t)n;
+                }
+            } else if (tok.size() > 1 && tok[0] == '-') {
+                for (size_t k = 1; k < tok.size(); k++) {
+                    if (tok[k] == 's') {
+                        opts.max_depth = 0;
+                    } else if (tok[k] == 'h') {
+                        human = true;
+                    } else {
+                        term_error("usage: du [-sh] [-d n] [-n n] [path]");
+                        return false;
+                    }
+                }
+            } else if (path.empty()) {
+                path = tok;
+            } else {
+                term_error("too many operands");
                 return false;
             }
-            return true;
+        }
+        if (path.empty()) {
+            path = ".";
         }
 
-        term_error("bad option");
-        return false;
+        std::vector<FsDuEntry> entries;
+        FsDuStats stats;
+        if (!fs_du(path.c_str(), opts, entries, stats)) {
+            term_error("cannot access");
+            return false;
+        }
+        for (const FsDuEntry& e : entries) {
+            du_print_line(e.bytes, human, e.path.c_str());
+        }
+        du_print_line(stats.bytes, human, path.c_str());
+        if (stats.depth_limited) {
+            term_error("depth limit reached");
+            return false;
+        }
+        return true;
     }
 
     // --------------------------------------------------------
@@ -2137,14 +2660,38 @@ static bool command_exec_line(const char* line, bool allow_pipe)
     // cp <src> <dst>
     // --------------------------------------------------------
     if (strcmp(cmd, "cp") == 0) {
-        if (!*arg1 || !*arg2) {
+        FsCopyOptions opts;
+        opts.recursive = (strcmp(arg1, "-r") == 0);
+        opts.progress = true;
+        const char* src = opts.recursive ? arg2 : arg1;
+        const char* dst = opts.recursive ? arg3 : arg2;
+        if (!*src || !*dst) {
             term_error("missing operand");
             return false;
         }
-        if (!fs_cp(arg1, arg2)) {
-            term_error("cannot copy");
+        FsCopyStats stats;
+        if (!fs_copy(src, dst, opts, stats) || stats.depth_limited) {
+            term_error(stats.depth_limited ? "depth limit reached"
+                                           : "cannot copy");
             return false;
         }
+        // débit moyen, pour comparer les cartes
+        char buf[48];
+        unsigned long kb = (unsigned long)(stats.bytes / 1024);
+        if (stats.elapsed_ms > 0) {
+            uint64_t rate = stats.bytes * 100000 / stats.elapsed_ms / 1048576;
+            snprintf(buf, sizeof(buf), "%lu KB, %lu.%02lu MB/s\n", kb,
+                (unsigned long)(rate / 100), (unsigned long)(rate % 100));
+        } else {
+            snprintf(buf, sizeof(buf), "%lu KB\n", kb);
+        }
+        if (stats.files > 1 || stats.dirs > 0) {
+            char files[24];
+            snprintf(files, sizeof(files), "%lu files, ",
+                (unsigned long)stats.files);
+            term_puts(files);
+        }
+        term_puts(buf);
         return true;
     }
 
@@ -2164,19 +2711,270 @@ static bool command_exec_line(const char* line, bool allow_pipe)
     }
 
     // --------------------------------------------------------
-    // rm <path> (confirmation)
+    // dd [if=<src>] [of=<dst>] [bs=<n>] [count=<n>]
+    // --------------------------------------------------------
+    if (strcmp(cmd, "dd") == 0) {
+        FsDdOptions opts;
+        std::vector<std::string> tokens;
+        parse_tokens(line, tokens);
+        for (size_t i = 1; i < tokens.size(); i++) {
+            const char* a = tokens[i].c_str();
+            if (strncmp(a, "if=", 3) == 0) {
+                opts.in = a + 3;
+            } else if (strncmp(a, "of=", 3) == 0) {
+                opts.out = a + 3;
+            } else if (strncmp(a, "bs=", 3) == 0) {
+                char* end = nullptr;
+                unsigned long n = strtoul(a + 3, &end, 10);
+                if (*end == 'k' || *end == 'K') {
+                    n *= 1024;
+                    end++;
+                } else if (*end == 'm' || *end == 'M') {
+                    n *= 1024 * 1024;
+                    end++;
+                }
+                if (*end || n == 0 || n > kFsDdMaxBlock) {
+                    term_error("invalid block size");
+                    return false;
+                }
+                opts.block_size = n;
+            } else if (strncmp(a, "count=", 6) == 0) {
+                char* end = nullptr;
+                opts.count = strtoul(a + 6, &end, 10);
+                if (*end || opts.count == 0) {
+                    term_error("invalid count");
+                    return false;
+                }
+            } else {
+                term_error("invalid operand");
+                return false;
+            }
+        }
+        FsDdStats stats;
+        bool ok = fs_dd(opts, stats);
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%lu+%lu records in\n",
+            (unsigned long)stats.blocks_in, (unsigned long)stats.partial_in);
+        term_puts(buf);
+        snprintf(buf, sizeof(buf), "%lu+%lu records out\n",
+            (unsigned long)stats.blocks_out, (unsigned long)stats.partial_out);
+        term_puts(buf);
+        if (!ok) {
+            term_error("dd failed");
+            return false;
+        }
+        unsigned long rate = stats.elapsed_ms > 0
+            ? (unsigned long)(stats.bytes * 1000 / stats.elapsed_ms / 1024)
+            : 0;
+        snprintf(buf, sizeof(buf), "%lu bytes, %lu KB/s\n",
+            (unsigned long)stats.bytes, rate);
+        term_puts(buf);
+        return true;
+    }
+
+    // --------------------------------------------------------
+    // crc32 / md5sum / sha256sum <path>...
+    // --------------------------------------------------------
+    ChecksumAlgo sum_algo;
+    if (checksum_algo_from_name(cmd, sum_algo)) {
+        std::vector<std::string> tokens;
+        parse_tokens(line, tokens);
+        if (tokens.size() < 2) {
+            term_error("missing operand");
+            return false;
+        }
+        return checksum_files(sum_algo, tokens, 1);
+    }
+
+    // --------------------------------------------------------
+    // gzip [-d] [-k] <path>... / gunzip [-k] <path>...
+    // --------------------------------------------------------
+    if (strcmp(cmd, "gzip") == 0 || strcmp(cmd, "gunzip") == 0) {
+        bool decompress = (cmd[0] == 'g' && cmd[1] == 'u');
+        bool keep = false;
+        std::vector<std::string> tokens;
+        parse_tokens(line, tokens);
+        std::vector<std::string> paths;
+        for (size_t i = 1; i < tokens.size(); i++) {
+            if (tokens[i] == "-d") {
+                decompress = true;
+            } else if (tokens[i] == "-k") {
+                keep = true;
+            } else if (tokens[i][0] == '-') {
+                term_error("invalid option");
+                return false;
+            } else {
+                paths.push_back(tokens[i]);
+            }
+        }
+        if (paths.empty()) {
+            term_error("missing operand");
+            return false;
+        }
+
+        bool ok = true;
+        for (const std::string& src : paths) {
+            std::string dst = src;
+            if (decompress) {
+                if (dst.size() <= 3
+                    || strcasecmp(dst.c_str() + dst.size() - 3, ".gz") != 0) {
+                    term_error(("not a .gz name: " + src).c_str());
+                    ok = false;
+                    continue;
+                }
+                dst.resize(dst.size() - 3);
+            } else {
+                dst += ".gz";
+            }
+            FsGzipStats stats;
+            if (!fs_gzip(src.c_str(), dst.c_str(), decompress, stats)) {
+                if (stats.not_smaller) {
+                    // original gardé, pas de .gz
+                    term_error(((stats.stored ? "no memory to compress: "
+                                              : "not compressible: ") + src).c_str());
+                } else {
+                    term_error(("cannot " + std::string(decompress
+                        ? "decompress " : "compress ") + src).c_str());
+                }
+                ok = false;
+                continue;
+            }
+            if (!keep) {
+                fs_rm(src.c_str());
+            }
+            // taux : part du fichier non compressé économisée
+            uint64_t raw = decompress ? stats.out_bytes : stats.in_bytes;
+            uint64_t packed = decompress ? stats.in_bytes : stats.out_bytes;
+            unsigned long saved = raw > 0 && packed < raw
+                ? (unsigned long)((raw - packed) * 100 / raw) : 0;
+            char buf[48];
+            snprintf(buf, sizeof(buf), "%lu -> %lu KB, %lu%%\n",
+                (unsigned long)(stats.in_bytes / 1024),
+                (unsigned long)(stats.out_bytes / 1024), saved);
+            term_puts(buf);
+        }
+        return ok;
+    }
+
+    // --------------------------------------------------------
+    // tar -c|-x|-t [-z] [-v] -f <archive> [-C <dir>] [path...]
+    // --------------------------------------------------------
+    if (strcmp(cmd, "tar") == 0) {
+        std::vector<std::string> tokens;
+        parse_tokens(line, tokens);
+        char mode = 0;
+        bool verbose = false;
+        bool gzip = false;
+        std::string archive;
+        std::string dir;
+        std::vector<std::string> paths;
+        for (size_t i = 1; i < tokens.size(); i++) {
+            const std::string& tok = tokens[i];
+            // premier argument sans '-' accepté : "tar czf a.tgz lib"
+            bool flags = tok[0] == '-' || (i == 1
+                && tok.find_first_not_of("cxtzvf") == std::string::npos);
+            if (!flags) {
+                paths.push_back(tok);
+                continue;
+            }
+            if (tok == "-C") {
+                if (i + 1 >= tokens.size()) {
+                    term_error("missing directory");
+                    return false;
+                }
+                dir = tokens[++i];
+                continue;
+            }
+            for (size_t k = (tok[0] == '-') ? 1 : 0; k < tok.size(); k++) {
+                char c = tok[k];
+                if (c == 'c' || c == 'x' || c == 't') {
+                    if (mode && mode != c) {
+                        term_error("only one of -c -x -t");
+                        return false;
+                    }
+                    mode = c;
+                } else if (c == 'z') {
+                    gzip = true;
+                } else if (c == 'v') {
+                    verbose = true;
+                } else if (c == 'f' && i + 1 < tokens.size()) {
+                    archive = tokens[++i];
+                } else {
+                    term_error("invalid option");
+                    return false;
+                }
+            }
+        }
+        if (!mode || archive.empty()) {
+            term_error("usage: tar -c|-x|-t -f <archive>");
+            return false;
+        }
+
+        FsTarOptions opts;
+        opts.archive = archive.c_str();
+        opts.dir = dir.empty() ? nullptr : dir.c_str();
+        opts.gzip = gzip || has_gz_suffix(archive);
+        FsTarStats stats;
+        bool ok = false;
+        if (mode == 'c') {
+            if (paths.empty()) {
+                term_error("missing operand");
+                return false;
+            }
+            ok = fs_tar_create(opts, paths, stats,
+                verbose ? tar_print_name : nullptr, nullptr);
+        } else if (mode == 'x') {
+            ok = fs_tar_extract(opts, stats,
+                verbose ? tar_print_name : nullptr, nullptr);
+        } else {
+            // -t : la liste est la sortie
+            if (!fs_tar_list(opts, stats,
+                    verbose ? tar_print_long : tar_print_name, nullptr)) {
+                term_error("cannot read archive");
+                return false;
+            }
+            return true;
+        }
+        if (!ok) {
+            term_error(mode == 'c' ? "cannot create archive"
+                                   : "cannot extract archive");
+        }
+        char buf[64];
+        unsigned long kb = (unsigned long)(stats.bytes / 1024);
+        if (stats.elapsed_ms > 0) {
+            uint64_t rate = stats.bytes * 100000 / stats.elapsed_ms / 1048576;
+            snprintf(buf, sizeof(buf), "%lu files, %lu KB, %lu.%02lu MB/s\n",
+                (unsigned long)stats.files, kb,
+                (unsigned long)(rate / 100), (unsigned long)(rate % 100));
+        } else {
+            snprintf(buf, sizeof(buf), "%lu files, %lu KB\n",
+                (unsigned long)stats.files, kb);
+        }
+        term_puts(buf);
+        if (stats.depth_limited) {
+            term_error("depth limit reached");
+            return false;
+        }
+        return ok;
+    }
+
+    // --------------------------------------------------------
+    // rm [-r] <path> (confirmation)
     // --------------------------------------------------------
     if (strcmp(cmd, "rm") == 0) {
-        if (!*arg1) {
+        const bool recursive = (strcmp(arg1, "-r") == 0);
+        const char* target = recursive ? arg2 : arg1;
+        if (!*target) {
             term_error("missing operand");
             return false;
         }
         rm_pending = true;
-        strncpy(rm_target, arg1, sizeof(rm_target));
+        rm_recursive = recursive;
+        strncpy(rm_target, target, sizeof(rm_target));
         rm_target[sizeof(rm_target) - 1] = 0;
         term_puts("rm: remove '");
-        term_puts(arg1);
-        term_puts("'? (y/n)\n");
+        term_puts(target);
+        term_puts(recursive ? "' and its contents? (y/n)\n" : "'? (y/n)\n");
         return true;
     }
 
@@ -5,14 +5,45 @@
 
 #include <string>
 #include <ctype.h>
+#include <string.h>
 
 namespace {
 static uint8_t pref_brightness = 255;
 static uint32_t pref_saver_start_ms = 2 * 60 * 1000UL;
 static uint32_t pref_screen_off_ms = 5 * 60 * 1000UL;
 static std::string pref_lx_profile = "power";
-static const char* pref_path = "/media/0/.lxshellrc";
-static const char* pref_script_path = "/media/0/.lxscriptrc";
+static const char* pref_name = ".lxshellrc";
+static const char* pref_script_name = ".lxscriptrc";
+
+// lit depuis le répertoire d'état, puis depuis la carte SD (réglages
+// écrits avant que /flash n'existe)
+static bool pref_read(const char* name, std::string& content)
+{
+    const char* dir = fs_state_dir();
+    if (!dir) {
+        return false;
+    }
+    std::string path = std::string(dir) + "/" + name;
+    if (fs_read_file(path.c_str(), content)) {
+        return true;
+    }
+    if (!fs_sd_mounted() || strcmp(dir, FS_SD_MOUNT_POINT) == 0) {
+        return false;
+    }
+    path = std::string(FS_SD_MOUNT_POINT "/") + name;
+    return fs_read_file(path.c_str(), content);
+}
+
+static void pref_write(const char* name, const std::string& content)
+{
+    const char* dir = fs_state_dir();
+    if (!dir) {
+        return;
+    }
+    std::string path = std::string(dir) + "/" + name;
+    fs_write_file(path.c_str(),
+        reinterpret_cast<const unsigned char*>(content.data()), content.size());
+}
 
 static std::string trim_copy(const std::string& in)
 {
@@ -52,11 +83,8 @@ void settings_init()
 
 void settings_load_if_available()
 {
-    if (!fs_sd_mounted()) {
-        return;
-    }
     std::string content;
-    if (!fs_read_file(pref_path, content)) {
+    if (!pref_read(pref_name, content)) {
         return;
     }
     size_t pos = 0;
@@ -98,9 +126,6 @@ void settings_load_if_available()
 
 void settings_save_if_available()
 {
-    if (!fs_sd_mounted()) {
-        return;
-    }
     char buf[256];
     int n = snprintf(buf, sizeof(buf),
         "brightness=%u\nscreensaver_minutes=%lu\nscreen_off_minutes=%lu\n",
@@ -110,16 +135,13 @@ void settings_save_if_available()
     if (n <= 0) {
         return;
     }
-    fs_write_file(pref_path, reinterpret_cast<const unsigned char*>(buf), (size_t)n);
+    pref_write(pref_name, std::string(buf, (size_t)n));
 }
 
 void settings_load_script_if_available()
 {
-    if (!fs_sd_mounted()) {
-        return;
-    }
     std::string content;
-    if (!fs_read_file(pref_script_path, content)) {
+    if (!pref_read(pref_script_name, content)) {
         return;
     }
     size_t pos = 0;
@@ -149,13 +171,8 @@ void settings_load_script_if_available()
 
 void settings_save_script_if_available()
 {
-    if (!fs_sd_mounted()) {
-        return;
-    }
     std::string content = "profile=" + pref_lx_profile + "\n";
-    fs_write_file(pref_script_path,
-        reinterpret_cast<const unsigned char*>(content.c_str()),
-        content.size());
+    pref_write(pref_script_name, content);
 }
 
 uint8_t settings_get_brightness()
@@ -1,14 +1,23 @@
 #include "editor.h"
+#include "line_store.h"
+#include "file_window.h"
+#include "row_index.h"
+#include "regex.h"
+#include "undo_journal.h"
+#include "syntax.h"
 
 #include "ui/screen.h"
 #include "ui/terminal.h"
 #include "ui/encoding.h"
 #include "fs/fs.h"
+#include "fs/vfs.h"
+#include "fs/io_service.h"
 
 #include <M5Unified.h>
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <vector>
 #include <string>
 
@@ -16,6 +25,10 @@ static constexpr int EDIT_COLS = 30;
 static constexpr int EDIT_ROWS = 8;
 static constexpr int TEXT_ROWS = EDIT_ROWS - 1;
 static constexpr int TAB_WIDTH = 4;
+// au-delà, le fichier est ouvert par fenêtre (FileWindow)
+static constexpr uint32_t kEditorFullLoadMax = 64 * 1024;
+// la fenêtre suit le curseur quand il arrive à moins de ces lignes du bord
+static constexpr int kWindowMargin = TEXT_ROWS * 2;
 
 enum EditorMode {
     MODE_NORMAL,
@@ -39,7 +52,10 @@ static std::string prompt_label;
 static std::string prompt_buffer;
 static bool nano_pending_quit = false;
 
-static std::vector<std::string> lines;
+static LineStore doc;
+static RowIndex doc_rows;
+static FileWindow big_file;
+static bool windowed = false;
 static int cur_row = 0;
 static int cur_col = 0;
 static int view_top_line = 0;
@@ -51,6 +67,11 @@ static bool dirty = false;
 static std::string cmd_buffer;
 static std::string search_buffer;
 static std::string last_search;
+static Regex search_re;                 // last_search compilé
+static std::string search_re_src;
+static bool search_re_literal = false;
+static bool search_re_ok = false;
+static Regex subst_re;
 static std::string yank_line;
 static std::string normal_count;
 
@@ -66,6 +87,31 @@ static uint16_t cursor_color = TFT_NAVY;
 static uint16_t status_fg = TFT_BLACK;
 static uint16_t status_bg = TFT_DARKGRAY;
 
+// coloration des scripts .lx, par catégorie de jeton (SynClass)
+static const uint16_t syntax_colors[SYN_CLASS_COUNT] = {
+    TFT_DARKGRAY,               // SYN_TEXT : fg_color
+    TFT_CYAN,                   // SYN_KEYWORD
+    TFT_LIGHTGREY,              // SYN_VARIABLE
+    TFT_YELLOW,                 // SYN_CONSTANT
+    TFT_MAGENTA,                // SYN_NUMBER
+    TFT_ORANGE,                 // SYN_STRING
+    TFT_DARKGREEN,              // SYN_COMMENT
+};
+static SyntaxCache syntax;
+static bool syntax_on = false;
+static std::vector<uint8_t> syntax_line;    // catégorie de chaque octet
+static int syntax_line_row = -1;            // ligne découpée dans syntax_line
+
+// Ce qui est à l'écran : redraw() ne redessine que les cellules qui
+// ont changé (caractère, couleur ou curseur), sans effacer l'écran.
+static char shown_text[EDIT_ROWS][EDIT_COLS];
+static uint8_t shown_attr[EDIT_ROWS][EDIT_COLS];
+static int shown_cursor[EDIT_ROWS];     // colonne du curseur, -1 sinon
+static bool shown_valid = false;
+static uint16_t shown_fg = 0;
+static uint16_t shown_bg = 0;
+static bool shown_color = false;
+
 static void set_status(const char* msg)
 {
     status_msg = msg ? msg : "";
@@ -89,99 +135,216 @@ static std::string make_abs_path(const std::string& path)
     return std::string(cwd) + "/" + path;
 }
 
-static bool map_to_real_path(const std::string& abs_path, std::string& out_real)
+// échec d'allocation du tampon : signalé, le document reste cohérent
+static bool doc_ok(bool ok)
 {
-    if (abs_path.rfind("/media/0", 0) == 0) {
-        if (abs_path.size() == strlen("/media/0")) {
-            out_real = "/sdcard";
-            return true;
-        }
-        if (abs_path.size() > strlen("/media/0/")) {
-            out_real = "/sdcard/" + abs_path.substr(strlen("/media/0/"));
-            return true;
+    if (!ok) {
+        set_status("out of memory");
+    }
+    return ok;
+}
+
+static void ensure_line_exists()
+{
+    if (doc.line_count() == 0) {
+        doc.append_line("", 0);
+    }
+}
+
+// ------------------------------------------------------------
+// Cellules : le texte reste en UTF-8, transcodé en CP437 à l'affichage.
+// Une cellule (un caractère, ou un octet isolé) occupe une colonne, une
+// tabulation TAB_WIDTH ; cur_col est un octet, toujours en début de
+// cellule.
+// ------------------------------------------------------------
+
+// octets de la cellule qui commence en i ; glyph reçoit son caractère
+static size_t line_cell(const LineView& line, size_t i, uint8_t* glyph)
+{
+    const char* p;
+    size_t n;
+    if (i < line.na) {
+        p = line.a + i;
+        n = line.na - i;
+    } else {
+        p = line.b + (i - line.na);
+        n = line.nb - (i - line.na);
+    }
+    uint8_t c = (uint8_t)p[0];
+    if (c >= 0x20 && c < 0x7f) {
+        uint8_t next = (n > 1) ? (uint8_t)p[1] :
+            (i + 1 < line.size()) ? (uint8_t)line[i + 1] : 0;
+        if (next < 0x80) {
+            if (glyph) *glyph = c;
+            return 1;
         }
     }
+    if (n >= UTF8_CELL_MAX || i >= line.na || line.nb == 0) {
+        return utf8_cell_cp437(p, n, glyph);
+    }
+    // cellule à cheval sur le trou
+    char tmp[UTF8_CELL_MAX];
+    n = line.size() - i;
+    if (n > sizeof(tmp)) n = sizeof(tmp);
+    for (size_t k = 0; k < n; k++) {
+        tmp[k] = line[i + k];
+    }
+    return utf8_cell_cp437(tmp, n, glyph);
+}
 
-    return false;
+static int cell_width(const LineView& line, size_t i)
+{
+    return (line[i] == '\t') ? TAB_WIDTH : 1;
 }
 
-static void ensure_line_exists()
+// début de la cellule contenant l'octet col
+static int cell_start(const LineView& line, int col)
 {
-    if (lines.empty()) {
-        lines.push_back("");
+    if (col <= 0) {
+        return 0;
+    }
+    size_t i = 0;
+    while (i < line.size()) {
+        size_t n = line_cell(line, i, nullptr);
+        if (i + n > (size_t)col) {
+            break;
+        }
+        i += n;
     }
+    return (int)i;
 }
 
-static int line_visual_len(const std::string& line)
+static int line_visual_len(const LineView& line)
 {
     int len = 0;
-    for (char ch : line) {
-        len += (ch == '\t') ? TAB_WIDTH : 1;
+    for (size_t i = 0; i < line.size(); i += line_cell(line, i, nullptr)) {
+        len += cell_width(line, i);
     }
     return len;
 }
 
-static int line_visual_rows(const std::string& line)
+static int line_visual_rows(const LineView& line)
 {
     int len = line_visual_len(line);
     return (len <= 0) ? 1 : (1 + (len - 1) / EDIT_COLS);
 }
 
-static int line_visual_col_for_col(const std::string& line, int col)
+static int line_visual_col_for_col(const LineView& line, int col)
 {
     int vcol = 0;
-    int limit = col;
-    if (limit < 0) limit = 0;
-    if (limit > (int)line.size()) limit = (int)line.size();
-    for (int i = 0; i < limit; i++) {
-        vcol += (line[i] == '\t') ? TAB_WIDTH : 1;
+    size_t limit = (col > 0) ? (size_t)col : 0;
+    if (limit > line.size()) limit = line.size();
+    for (size_t i = 0; i < limit; i += line_cell(line, i, nullptr)) {
+        vcol += cell_width(line, i);
     }
     return vcol;
 }
 
+// tenu à jour par LineStore à chaque modification
+static void doc_edited(int row, int removed, int added, void*)
+{
+    doc_rows.replace(row, removed, added);
+    for (int i = row; i < row + added; i++) {
+        doc_rows.set(i, line_visual_rows(doc.line(i)));
+    }
+    if (syntax_on) {
+        syntax.replace(row, removed, added);
+    }
+}
+
+// coloration d'après l'extension du fichier ; en fenêtre (gros
+// fichiers), chaque fenêtre est découpée depuis sa première ligne
+static void syntax_select()
+{
+    size_t n = current_file.size();
+    bool on = n > 3 && strcasecmp(current_file.c_str() + n - 3, ".lx") == 0;
+    if (on == syntax_on) {
+        return;
+    }
+    syntax_on = on;
+    syntax.release();
+    if (on) {
+        syntax.replace(0, 0, doc.line_count());
+    }
+}
+
 static int prefix_visual_rows(int line_idx)
 {
-    int rows = 0;
-    int max_idx = (int)lines.size();
+    int max_idx = doc.line_count();
     if (line_idx < 0) line_idx = 0;
     if (line_idx > max_idx) line_idx = max_idx;
-    for (int i = 0; i < line_idx; i++) {
-        rows += line_visual_rows(lines[i]);
-    }
-    return rows;
+    return doc_rows.prefix(line_idx);
 }
 
 static void set_view_abs(int abs_row)
 {
     if (abs_row < 0) abs_row = 0;
-    int line_idx = 0;
-    while (line_idx < (int)lines.size()) {
-        int rows = line_visual_rows(lines[line_idx]);
-        if (abs_row < rows) {
-            view_top_line = line_idx;
-            view_top_sub = abs_row;
-            return;
-        }
-        abs_row -= rows;
-        line_idx++;
+    if (doc_rows.find(abs_row, view_top_line, view_top_sub)) {
+        return;
     }
-    if (lines.empty()) {
+    if (doc.line_count() == 0) {
         view_top_line = 0;
         view_top_sub = 0;
     } else {
-        view_top_line = (int)lines.size() - 1;
+        view_top_line = doc.line_count() - 1;
         view_top_sub = 0;
     }
 }
 
+// ------------------------------------------------------------
+// Gros fichiers : doc ne contient qu'une fenêtre, cur_row et
+// view_top_line y sont relatifs
+// ------------------------------------------------------------
+
+static int doc_first_line()
+{
+    return windowed ? big_file.first_line() : 0;
+}
+
+static int doc_line_total()
+{
+    return windowed ? big_file.line_count(doc) : doc.line_count();
+}
+
+// charge la fenêtre contenant la ligne line du document ; curseur et vue
+// restent sur les mêmes lignes du document
+static void window_goto(int line)
+{
+    int old_first = big_file.first_line();
+    if (!big_file.load(doc, line)) {
+        set_status("read error");
+    }
+    int shift = big_file.first_line() - old_first;
+    cur_row -= shift;
+    view_top_line -= shift;
+    if (view_top_line < 0) {
+        view_top_line = 0;
+        view_top_sub = 0;
+    }
+}
+
+static void window_follow()
+{
+    if (!windowed) {
+        return;
+    }
+    int n = doc.line_count();
+    bool near_top = cur_row < kWindowMargin && big_file.has_before();
+    bool near_end = cur_row >= n - kWindowMargin && big_file.has_after();
+    if (near_top || near_end) {
+        window_goto(big_file.first_line() + cur_row);
+    }
+}
+
 static void clamp_cursor()
 {
+    window_follow();
     ensure_line_exists();
 
     if (cur_row < 0) cur_row = 0;
-    if (cur_row >= (int)lines.size()) cur_row = (int)lines.size() - 1;
+    if (cur_row >= doc.line_count()) cur_row = doc.line_count() - 1;
 
-    int len = (int)lines[cur_row].size();
+    int len = doc.line_len(cur_row);
     bool allow_past_end = (mode == MODE_INSERT) || nano_mode;
     if (allow_past_end) {
         if (cur_col < 0) cur_col = 0;
@@ -194,12 +357,26 @@ static void clamp_cursor()
             if (cur_col >= len) cur_col = len - 1;
         }
     }
+    cur_col = cell_start(doc.line(cur_row), cur_col);
+}
+
+// octets de la cellule sous le curseur (0 en fin de ligne)
+static int cursor_cell_len()
+{
+    if (cur_row < 0 || cur_row >= doc.line_count()) {
+        return 0;
+    }
+    LineView line = doc.line(cur_row);
+    if (cur_col < 0 || (size_t)cur_col >= line.size()) {
+        return 0;
+    }
+    return (int)line_cell(line, (size_t)cur_col, nullptr);
 }
 
 static void ensure_cursor_visible()
 {
     ensure_line_exists();
-    int cursor_vcol = line_visual_col_for_col(lines[cur_row], cur_col);
+    int cursor_vcol = line_visual_col_for_col(doc.line(cur_row), cur_col);
     int cursor_vrow = cursor_vcol / EDIT_COLS;
     int cursor_abs = prefix_visual_rows(cur_row) + cursor_vrow;
     int view_abs = prefix_visual_rows(view_top_line) + view_top_sub;
@@ -214,78 +391,147 @@ static void ensure_cursor_visible()
     if (view_top_sub < 0) view_top_sub = 0;
 }
 
-static void draw_cell(int col, int row, char ch, bool cursor, bool status_line)
+static void set_color(uint16_t fg, uint16_t bg)
+{
+    if (shown_color && fg == shown_fg && bg == shown_bg) {
+        return;
+    }
+    screen_set_color(fg, bg);
+    shown_fg = fg;
+    shown_bg = bg;
+    shown_color = true;
+}
+
+static void draw_cell(int col, int row, char ch, uint8_t attr, bool cursor,
+    bool status_line)
 {
     if (status_line) {
-        screen_set_color(status_fg, status_bg);
+        set_color(status_fg, status_bg);
     } else if (cursor) {
-        screen_set_color(bg_color, cursor_color);
+        set_color(bg_color, cursor_color);
     } else {
-        screen_set_color(fg_color, bg_color);
+        set_color(attr ? syntax_colors[attr] : fg_color, bg_color);
     }
 
     char s[2] = { ch, 0 };
     screen_draw_text(col, row, s);
 }
 
-static void render_line_segment(const std::string& line, int wrap_row, char* out)
+// ligne d'écran r : seules les cellules différentes de l'affichage
+// précédent sont redessinées
+static void present_row(int r, const char* text, const uint8_t* attr,
+    int cursor, bool status_line)
+{
+    char* shown = shown_text[r];
+    uint8_t* shown_a = shown_attr[r];
+    for (int c = 0; c < EDIT_COLS; c++) {
+        bool is_cursor = (c == cursor);
+        bool was_cursor = (c == shown_cursor[r]);
+        uint8_t a = attr ? attr[c] : 0;
+        if (shown_valid && shown[c] == text[c] && shown_a[c] == a &&
+            is_cursor == was_cursor) {
+            continue;
+        }
+        draw_cell(c, r, text[c], a, is_cursor, status_line);
+        shown[c] = text[c];
+        shown_a[c] = a;
+    }
+    shown_cursor[r] = cursor;
+}
+
+// l'écran a pu être touché ailleurs (économiseur, terminal) : tout refaire
+static void invalidate_screen()
+{
+    shown_valid = false;
+    shown_color = false;
+}
+
+// seules les cellules visibles sont transcodées ; cls (catégorie de
+// chaque octet, ou nullptr) donne la couleur des cellules
+static void render_line_segment(const LineView& line, int wrap_row,
+    const uint8_t* cls, char* out, uint8_t* attr)
 {
     for (int i = 0; i < EDIT_COLS; i++) {
         out[i] = ' ';
+        attr[i] = 0;
     }
 
     int start = wrap_row * EDIT_COLS;
     int end = start + EDIT_COLS;
     int vcol = 0;
-    for (char ch : line) {
-        int span = (ch == '\t') ? TAB_WIDTH : 1;
+    size_t k = 0;
+    while (k < line.size() && vcol < end) {
+        int span = cell_width(line, k);
+        if (vcol + span <= start) {
+            k += line_cell(line, k, nullptr);
+            vcol += span;
+            continue;
+        }
+        uint8_t glyph;
+        bool tab = (line[k] == '\t');
+        uint8_t a = (cls && !tab) ? cls[k] : 0;
+        k += line_cell(line, k, &glyph);
         for (int i = 0; i < span; i++) {
             if (vcol >= start && vcol < end) {
-                out[vcol - start] = (ch == '\t') ? ' ' : ch;
+                out[vcol - start] = tab ? ' ' : (char)glyph;
+                attr[vcol - start] = a;
             }
             vcol++;
         }
-        if (vcol >= end) {
-            break;
-        }
     }
 }
 
 static void redraw()
 {
-    screen_clear();
+    if (!shown_valid) {
+        screen_clear();
+        shown_color = false;
+    }
 
     int cursor_vcol = 0;
     int cursor_vrow = 0;
-    if (cur_row >= 0 && cur_row < (int)lines.size()) {
-        cursor_vcol = line_visual_col_for_col(lines[cur_row], cur_col);
+    if (cur_row >= 0 && cur_row < doc.line_count()) {
+        cursor_vcol = line_visual_col_for_col(doc.line(cur_row), cur_col);
         cursor_vrow = cursor_vcol / EDIT_COLS;
     }
 
     int line_idx = view_top_line;
     int wrap_row = view_top_sub;
+    syntax_line_row = -1;
     for (int r = 0; r < TEXT_ROWS; r++) {
         char row_buf[EDIT_COLS];
-        bool has_line = (line_idx >= 0 && line_idx < (int)lines.size());
+        uint8_t row_attr[EDIT_COLS];
+        bool has_line = (line_idx >= 0 && line_idx < doc.line_count());
         if (has_line) {
-            render_line_segment(lines[line_idx], wrap_row, row_buf);
+            LineView line = doc.line(line_idx);
+            const uint8_t* cls = nullptr;
+            if (syntax_on) {
+                // une ligne repliée n'est découpée qu'une fois
+                if (syntax_line_row != line_idx) {
+                    syntax_line.resize(line.size());
+                    syntax_lex_line(line, syntax.state_at(doc, line_idx),
+                        syntax_line.data());
+                    syntax_line_row = line_idx;
+                }
+                cls = syntax_line.data();
+            }
+            render_line_segment(line, wrap_row, cls, row_buf, row_attr);
         } else {
             for (int i = 0; i < EDIT_COLS; i++) {
                 row_buf[i] = ' ';
+                row_attr[i] = 0;
             }
         }
 
-        for (int c = 0; c < EDIT_COLS; c++) {
-            bool cursor = false;
-            if (has_line && line_idx == cur_row && wrap_row == cursor_vrow &&
-                mode != MODE_COMMAND && mode != MODE_SEARCH) {
-                cursor = (c == (cursor_vcol % EDIT_COLS));
-            }
-            draw_cell(c, r, row_buf[c], cursor, false);
+        int cursor = -1;
+        if (has_line && line_idx == cur_row && wrap_row == cursor_vrow &&
+            mode != MODE_COMMAND && mode != MODE_SEARCH) {
+            cursor = cursor_vcol % EDIT_COLS;
         }
+        present_row(r, row_buf, row_attr, cursor, false);
 
         if (has_line) {
-            int rows = line_visual_rows(lines[line_idx]);
+            int rows = doc_rows.line_rows(line_idx);
             wrap_row++;
             if (wrap_row >= rows) {
                 line_idx++;
@@ -331,14 +577,17 @@ static void redraw()
         }
     }
 
-    if ((int)status.size() > EDIT_COLS) {
-        status = status.substr(0, EDIT_COLS);
-    }
-
+    char status_buf[EDIT_COLS];
+    size_t k = 0;
     for (int c = 0; c < EDIT_COLS; c++) {
-        char ch = (c < (int)status.size()) ? status[c] : ' ';
-        draw_cell(c, EDIT_ROWS - 1, ch, false, true);
+        uint8_t glyph = ' ';
+        if (k < status.size()) {
+            k += utf8_cell_cp437(status.data() + k, status.size() - k, &glyph);
+        }
+        status_buf[c] = (char)glyph;
     }
+    present_row(EDIT_ROWS - 1, status_buf, nullptr, -1, true);
+    shown_valid = true;
 }
 
 void editor_redraw()
@@ -346,144 +595,380 @@ void editor_redraw()
     if (!active) {
         return;
     }
+    invalidate_screen();
     redraw();
 }
 
+void editor_idle()
+{
+    // index des gros fichiers, une tranche par tour de boucle
+    if (active && windowed) {
+        big_file.index_step();
+    }
+}
+
+// fichier dont toutes les lignes finissent par "\r\n" : les '\r' sont
+// retirés au chargement et remis à l'enregistrement. Un fichier mélangé
+// est lu tel quel, chaque '\r' restant dans le texte de sa ligne.
+static bool doc_crlf = false;
+
+// bloc lu en "\r\n" ; cr : '\r' en fin du bloc précédent, en attente.
+// false en erreur ou sur un '\n' seul (mixed)
+static bool append_crlf_block(const char* p, size_t n, bool& cr, bool& mixed)
+{
+    const char* end = p + n;
+    if (cr && p < end) {
+        cr = false;
+        if (*p == '\n') {
+            if (!doc.append_text("\n", 1)) {
+                return false;
+            }
+            p++;
+        } else if (!doc.append_text("\r", 1)) {
+            return false;
+        }
+    }
+    while (p < end) {
+        const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)(end - p)));
+        const char* stop = nl ? nl : end;
+        size_t take = (size_t)(stop - p);
+        if (take > 0 && stop[-1] == '\r') {
+            take--;
+            cr = !nl;
+        } else if (nl) {
+            mixed = true;
+            return false;
+        }
+        if (!doc.append_text(p, take) || (nl && !doc.append_text("\n", 1))) {
+            return false;
+        }
+        p = nl ? nl + 1 : end;
+    }
+    return true;
+}
+
 static bool read_file(const std::string& abs_path)
 {
-    std::string real_path;
-    if (!map_to_real_path(abs_path, real_path)) {
+    VfsPath path;
+    fs_resolve(abs_path.c_str(), path);
+    if (!path.mount) {
         set_status("unsupported path");
         return false;
     }
 
-    FILE* f = fopen(real_path.c_str(), "rb");
-    lines.clear();
+    // tampon d'ajout éventuel (journal) écrit avant la lecture
+    fs_invalidate(abs_path.c_str());
+
+    VfsFile f;
+    doc.clear();
+    big_file.close();
+    windowed = false;
+    doc_crlf = false;
 
-    if (!f) {
+    FsStat st;
+    bool have_size = vfs_stat(path, st) && st.is_file;
+    if (have_size && st.size > kEditorFullLoadMax) {
+        // fichier laissé sur la carte, lu par fenêtre
+        if (!big_file.open(path) || !big_file.load(doc, 0)) {
+            big_file.close();
+            doc.clear();
+            ensure_line_exists();
+            set_status("read error");
+            return false;
+        }
+        windowed = true;
+        set_status("large file: loaded in parts");
+        return true;
+    }
+
+    if (!vfs_open(path, VFS_OPEN_READ, f)) {
         ensure_line_exists();
         set_status("new file");
         return true;
     }
 
-    std::string raw_line;
-    int ch;
-    while ((ch = fgetc(f)) != EOF) {
-        if (ch == '\n') {
-            std::vector<char> conv(raw_line.size() + 1);
-            size_t len = utf8_to_cp437(raw_line.c_str(), conv.data(), conv.size());
-            lines.emplace_back(conv.data(), len);
-            raw_line.clear();
-        } else if (ch != '\r') {
-            raw_line.push_back((char)ch);
+    // tout le texte dans un seul bloc, avec de la marge pour l'édition
+    if (have_size && !doc.reserve(st.size + st.size / 8)) {
+        vfs_close(f);
+        ensure_line_exists();
+        set_status("file too large");
+        return false;
+    }
+
+    // octets copiés tels quels : lignes séparées par '\n', le texte
+    // n'est transcodé qu'à l'affichage
+    IoReader reader;
+    bool ok = reader.begin(f);
+    bool first = true;
+    bool cr = false;
+    bool mixed = false;
+    const uint8_t* data = nullptr;
+    int n = 0;
+    while (ok && (n = reader.next(&data)) > 0) {
+        const char* p = reinterpret_cast<const char*>(data);
+        if (first) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', (size_t)n));
+            doc_crlf = nl && nl > p && nl[-1] == '\r';
+            first = false;
         }
+        if (!doc_crlf) {
+            ok = doc.append_text(p, (size_t)n);
+        } else if (!append_crlf_block(p, (size_t)n, cr, mixed)) {
+            // un '\n' seul plus loin : tout est relu sans rien retirer
+            ok = mixed && reader.seek(0);
+            doc.clear();
+            doc_crlf = false;
+            cr = false;
+        }
+    }
+    if (n < 0) {
+        ok = false;
     }
-    std::vector<char> conv(raw_line.size() + 1);
-    size_t len = utf8_to_cp437(raw_line.c_str(), conv.data(), conv.size());
-    lines.emplace_back(conv.data(), len);
-    fclose(f);
+    if (ok && cr) {
+        ok = doc.append_text("\r", 1);
+    }
+    reader.end();
+    vfs_close(f);
 
+    if (!ok) {
+        doc.clear();
+        ensure_line_exists();
+        set_status("file too large");
+        return false;
+    }
     ensure_line_exists();
     return true;
 }
 
 static bool write_file(const std::string& abs_path)
 {
-    std::string real_path;
-    if (!map_to_real_path(abs_path, real_path)) {
+    VfsPath path;
+    fs_resolve(abs_path.c_str(), path);
+    if (!path.mount) {
         set_status("unsupported path");
         return false;
     }
 
-    FILE* f = fopen(real_path.c_str(), "wb");
-    if (!f) {
+    fs_invalidate(abs_path.c_str());
+
+    if (windowed) {
+        if (!big_file.save(doc, path)) {
+            set_status("write failed");
+            return false;
+        }
+        dirty = false;
+        set_status("written");
+        return true;
+    }
+
+    // tout est écrit dans <path>.swp, synchronisé puis renommé
+    // (fs_replace) : une coupure laisse l'original ou la copie complète
+    std::string tmp_name = path.virt + ".swp";
+    VfsPath tmp;
+    fs_resolve(tmp_name.c_str(), tmp);
+    fs_invalidate(tmp.virt.c_str());
+
+    VfsFile f;
+    if (!vfs_open(tmp, VFS_OPEN_WRITE, f)) {
         set_status("write failed");
         return false;
     }
 
-    for (size_t i = 0; i < lines.size(); i++) {
-        if (!lines[i].empty()) {
-            fwrite(lines[i].data(), 1, lines[i].size(), f);
+    // lignes rejointes par leur séparateur d'origine : un fichier
+    // relu puis enregistré sans modification est identique
+    const char* sep = doc_crlf ? "\r\n" : "\n";
+    const size_t sep_len = doc_crlf ? 2 : 1;
+    const int lines = doc.line_count();
+
+    // FAT : taille allouée d'avance, les écritures n'étendent plus la
+    // chaîne de clusters
+    size_t size = doc.size() + (doc_crlf && lines > 1 ? (size_t)(lines - 1) : 0);
+    if (size > 0 && tmp.mount->fat_drive) {
+        vfs_truncate(f, (uint32_t)size);
+    }
+
+    IoWriter writer;
+    bool ok = writer.begin(f, kIoCopyChunkSize);
+    for (int i = 0; i < lines && ok; i++) {
+        LineView line = doc.line(i);
+        if (i > 0) {
+            ok = writer.write(sep, sep_len);
+        }
+        if (ok && line.na) {
+            ok = writer.write(line.a, line.na);
+        }
+        if (ok && line.nb) {
+            ok = writer.write(line.b, line.nb);
         }
-        fputc('\n', f);
     }
-    fclose(f);
+    if (!writer.finish() || !vfs_sync(f)) {
+        ok = false;
+    }
+    if (!vfs_close(f)) {
+        ok = false;
+    }
+    if (!ok) {
+        vfs_remove(tmp);
+        set_status("write failed");
+        return false;
+    }
+
+    if (!fs_replace(tmp, path)) {
+        set_status("rename failed: text in .swp");
+        return false;
+    }
 
     dirty = false;
     set_status("written");
     return true;
 }
 
-static bool find_next(const std::string& needle)
+static bool find_found(int row, size_t col)
+{
+    cur_row = row;
+    cur_col = (int)col;
+    clamp_cursor();
+    ensure_cursor_visible();
+    return true;
+}
+
+// motif recompilé seulement quand il change ; nano cherche le texte tel
+// quel, vi une expression régulière
+static bool search_compile(const std::string& needle)
 {
     if (needle.empty()) {
+        set_status("pattern not found");
+        return false;
+    }
+    if (!search_re_ok || needle != search_re_src || nano_mode != search_re_literal) {
+        search_re_src = needle;
+        search_re_literal = nano_mode;
+        search_re_ok = search_re.compile(needle, nano_mode);
+    }
+    if (!search_re_ok) {
+        set_status(search_re.error());
+    }
+    return search_re_ok;
+}
+
+// recherche vers le bas, en repartant du début ; un gros fichier est
+// parcouru fenêtre par fenêtre
+static bool find_next(const std::string& needle)
+{
+    if (!search_compile(needle)) {
         return false;
     }
 
+    const int origin = doc_first_line() + cur_row;
+    const bool allow_past_end = (mode == MODE_INSERT) || nano_mode;
     int r = cur_row;
-    int c = cur_col + 1;
-
-    for (int pass = 0; pass < 2; pass++) {
-        for (; r < (int)lines.size(); r++) {
-            const std::string& line = lines[r];
-            size_t start = (r == cur_row) ? (size_t)c : 0;
-            size_t pos = line.find(needle, start);
-            if (pos != std::string::npos) {
-                cur_row = r;
-                cur_col = (int)pos;
-                clamp_cursor();
-                ensure_cursor_visible();
-                return true;
+    size_t start = (size_t)cur_col + 1;
+    bool wrapped = false;
+    std::string line;
+    ReMatch m;
+
+    for (;;) {
+        for (; r < doc.line_count(); r++, start = 0) {
+            if (wrapped && doc_first_line() + r > origin) {
+                break;
+            }
+            doc.get_line(r, line);
+            // en mode normal, une occurrence vide en fin de ligne
+            // ramènerait le curseur où il est
+            if (!allow_past_end && !wrapped && r == cur_row && start >= line.size()) {
+                continue;
             }
+            if (search_re.scan(line.data(), line.size()) && search_re.next(start, m)) {
+                return find_found(r, (size_t)m.cap[0]);
+            }
+        }
+        if (r < doc.line_count()) {
+            break;
+        }
+        if (windowed && big_file.has_after()) {
+            int next = doc_first_line() + doc.line_count();
+            window_goto(next);
+            r = next - doc_first_line();
+            continue;
+        }
+        if (wrapped) {
+            break;
+        }
+        wrapped = true;
+        if (windowed && big_file.has_before()) {
+            window_goto(0);
         }
         r = 0;
-        c = 0;
     }
 
+    if (windowed) {
+        window_goto(origin);
+    }
+    set_status("pattern not found");
     return false;
 }
 
 static bool find_prev(const std::string& needle)
 {
-    if (needle.empty()) {
+    if (!search_compile(needle)) {
         return false;
     }
 
+    const int origin = doc_first_line() + cur_row;
     int r = cur_row;
-    int c = cur_col - 1;
-
-    for (int pass = 0; pass < 2; pass++) {
-        for (; r >= 0; r--) {
-            const std::string& line = lines[r];
-            int end = (r == cur_row) ? c : (int)line.size() - 1;
-            if (end < 0) continue;
-            size_t pos = line.rfind(needle, (size_t)end);
-            if (pos != std::string::npos) {
-                cur_row = r;
-                cur_col = (int)pos;
-                clamp_cursor();
-                ensure_cursor_visible();
-                return true;
+    bool first = true;
+    bool wrapped = false;
+    std::string line;
+    ReMatch m;
+
+    for (;;) {
+        for (; r >= 0; r--, first = false) {
+            if (wrapped && doc_first_line() + r < origin) {
+                break;
+            }
+            doc.get_line(r, line);
+            size_t before = first ? (size_t)cur_col : line.size() + 1;
+            if (search_re.scan(line.data(), line.size()) && search_re.prev(before, m)) {
+                return find_found(r, (size_t)m.cap[0]);
             }
         }
-        r = (int)lines.size() - 1;
-        c = (r >= 0) ? (int)lines[r].size() - 1 : 0;
+        if (r >= 0) {
+            break;
+        }
+        if (windowed && big_file.has_before()) {
+            int prev = doc_first_line() - 1;
+            window_goto(prev);
+            r = prev - doc_first_line();
+            continue;
+        }
+        if (wrapped) {
+            break;
+        }
+        wrapped = true;
+        if (windowed && big_file.has_after()) {
+            window_goto(doc_line_total() - 1);
+        }
+        r = doc.line_count() - 1;
     }
 
+    if (windowed) {
+        window_goto(origin);
+    }
+    set_status("pattern not found");
     return false;
 }
 
 static void delete_current_line()
 {
-    if (lines.empty()) return;
+    if (doc.line_count() == 0) return;
 
-    yank_line = lines[cur_row];
-    lines.erase(lines.begin() + cur_row);
-    if (lines.empty()) {
-        lines.push_back("");
+    doc.get_line(cur_row, yank_line);
+    doc.delete_line(cur_row);
+    if (doc.line_count() == 0) {
+        ensure_line_exists();
         cur_row = 0;
-    } else if (cur_row >= (int)lines.size()) {
-        cur_row = (int)lines.size() - 1;
+    } else if (cur_row >= doc.line_count()) {
+        cur_row = doc.line_count() - 1;
     }
     cur_col = 0;
     dirty = true;
@@ -491,44 +976,225 @@ static void delete_current_line()
 
 static void paste_line_below()
 {
-    if (yank_line.empty() && lines.size() > 0) {
+    if (yank_line.empty() && doc.line_count() > 0) {
+        return;
+    }
+    if (!doc_ok(doc.insert_line(cur_row + 1, yank_line.data(), yank_line.size()))) {
         return;
     }
-    if (lines.empty()) {
-        lines.push_back(yank_line);
+    if (doc.line_count() == 1) {
         cur_row = 0;
     } else {
-        lines.insert(lines.begin() + cur_row + 1, yank_line);
         cur_row++;
     }
     cur_col = 0;
     dirty = true;
 }
 
-static void substitute_current_line(const std::string& from, const std::string& to, bool global)
+// ------------------------------------------------------------
+// Annulation : u / Ctrl-R (vi), Alt-U / Alt-E (nano)
+// ------------------------------------------------------------
+
+static UndoJournal undo_log;
+static bool undo_replaying = false;
+
+// toute modification du texte passe par ici (le chargement non)
+static void doc_changed(int row, int col, const char* data, size_t len,
+    bool insert, void*)
 {
-    if (lines.empty()) return;
+    if (!undo_replaying) {
+        undo_log.record((uint32_t)(doc_first_line() + row), (uint32_t)col,
+            data, len, insert);
+    }
+}
 
-    std::string& line = lines[cur_row];
+static bool undo_apply(const UndoOp& op, void*)
+{
+    const int line = (int)op.line;
+    if (windowed) {
+        // une suppression sur plusieurs lignes doit les avoir toutes
+        int breaks = 0;
+        if (!op.insert) {
+            for (size_t i = 0; i < op.len; i++) {
+                breaks += (op.data[i] == '\n');
+            }
+        }
+        int first = doc_first_line();
+        if (line < first ||
+            (line + breaks >= first + doc.line_count() && big_file.has_after())) {
+            window_goto(line);
+        }
+    }
+    int row = line - doc_first_line();
+    if (row < 0 || row >= doc.line_count() || (int)op.col > doc.line_len(row)) {
+        return false;
+    }
+    bool ok = true;
+    if (op.insert) {
+        ok = doc_ok(doc.insert(row, (int)op.col, op.data, op.len));
+    } else {
+        doc.erase(row, (int)op.col, op.len);
+    }
+    cur_row = row;
+    cur_col = (int)op.col;
+    dirty = true;
+    return ok;
+}
+
+static void undo_step(bool redo)
+{
+    undo_replaying = true;
+    bool ok = redo ? undo_log.redo(undo_apply, nullptr) :
+        undo_log.undo(undo_apply, nullptr);
+    undo_replaying = false;
+    if (!ok && status_msg.empty()) {
+        set_status(redo ? "already at newest change" : "already at oldest change");
+    }
+    clamp_cursor();
+    ensure_cursor_visible();
+}
+
+// :s sur les lignes first..last (numéros du document, à partir de 1),
+// en une passe ; chaque ligne n'est réécrite que si elle change
+static void substitute_lines(int first, int last, const std::string& from,
+    const std::string& to, bool global)
+{
     if (from.empty()) {
         return;
     }
+    if (!subst_re.compile(from, false)) {
+        set_status(subst_re.error());
+        return;
+    }
+    const int total = doc_line_total();
+    if (first > last) std::swap(first, last);
+    if (first < 1) first = 1;
+    if (last > total) last = total;
+
+    const int origin = doc_first_line() + cur_row;
+    int subs = 0;
+    int lines = 0;
+    int last_changed = -1;
+    std::string line;
+    std::string out;
+    ReMatch m;
+
+    for (int g = first - 1; g < last; g++) {
+        if (windowed && (g < doc_first_line() || g >= doc_first_line() + doc.line_count())) {
+            window_goto(g);
+        }
+        int r = g - doc_first_line();
+        doc.get_line(r, line);
+        if (!subst_re.scan(line.data(), line.size())) {
+            continue;
+        }
+
+        out.clear();
+        size_t pos = 0;
+        size_t copied = 0;
+        int prev_end = -1;
+        int n = 0;
+        while (pos <= line.size() && subst_re.next(pos, m)) {
+            // pas d'occurrence vide collée à la précédente
+            if (m.cap[0] == m.cap[1] && m.cap[0] == prev_end) {
+                pos = (size_t)m.cap[0] + 1;
+                continue;
+            }
+            out.append(line, copied, (size_t)m.cap[0] - copied);
+            subst_re.expand(m, to, out);
+            copied = (size_t)m.cap[1];
+            prev_end = m.cap[1];
+            n++;
+            if (!global) {
+                break;
+            }
+            pos = (m.cap[1] > m.cap[0]) ? (size_t)m.cap[1] : (size_t)m.cap[1] + 1;
+        }
+        if (n == 0) {
+            continue;
+        }
+        out.append(line, copied, std::string::npos);
+        if (!doc_ok(doc.set_line(r, out.data(), out.size()))) {
+            break;
+        }
+        dirty = true;
+        subs += n;
+        lines++;
+        last_changed = g;
+    }
+
+    int target = (last_changed >= 0) ? last_changed : origin;
+    if (windowed) {
+        window_goto(target);
+    }
+    cur_row = target - doc_first_line();
+    clamp_cursor();
+    ensure_cursor_visible();
 
-    size_t pos = line.find(from);
-    if (pos == std::string::npos) {
+    if (subs == 0) {
         set_status("pattern not found");
-        return;
+    } else if (lines > 1) {
+        char msg[40];
+        snprintf(msg, sizeof(msg), "%d subs on %d lines", subs, lines);
+        set_status(msg);
     }
+}
 
-    if (global) {
-        while (pos != std::string::npos) {
-            line.replace(pos, from.size(), to);
-            pos = line.find(from, pos + to.size());
+// adresse de ligne : N, . ou $, suivie de +n / -n ; ligne du document
+// à partir de 1
+static bool parse_address(const std::string& cmd, size_t& i, int& line)
+{
+    const int current = doc_first_line() + cur_row + 1;
+    if (i < cmd.size() && cmd[i] == '.') {
+        line = current;
+        i++;
+    } else if (i < cmd.size() && cmd[i] == '$') {
+        line = doc_line_total();
+        i++;
+    } else if (i < cmd.size() && cmd[i] >= '0' && cmd[i] <= '9') {
+        line = 0;
+        while (i < cmd.size() && cmd[i] >= '0' && cmd[i] <= '9') {
+            line = line * 10 + (cmd[i++] - '0');
         }
+    } else if (i < cmd.size() && (cmd[i] == '+' || cmd[i] == '-')) {
+        line = current;
     } else {
-        line.replace(pos, from.size(), to);
+        return false;
     }
-    dirty = true;
+    while (i < cmd.size() && (cmd[i] == '+' || cmd[i] == '-')) {
+        int sign = (cmd[i++] == '-') ? -1 : 1;
+        int n = 0;
+        bool digits = false;
+        while (i < cmd.size() && cmd[i] >= '0' && cmd[i] <= '9') {
+            n = n * 10 + (cmd[i++] - '0');
+            digits = true;
+        }
+        line += sign * (digits ? n : 1);
+    }
+    return true;
+}
+
+// champ de s/../../ jusqu'au '/' suivant non échappé ; \/ devient /
+static bool subst_field(const std::string& cmd, size_t& i, std::string& out)
+{
+    out.clear();
+    while (i < cmd.size()) {
+        char c = cmd[i++];
+        if (c == '/') {
+            return true;
+        }
+        if (c == '\\' && i < cmd.size()) {
+            if (cmd[i] == '/') {
+                out += '/';
+                i++;
+                continue;
+            }
+            out += c;
+            c = cmd[i++];
+        }
+        out += c;
+    }
+    return false;
 }
 
 static void handle_command()
@@ -568,10 +1234,13 @@ static void handle_command()
             set_status("bad line");
             return;
         }
-        if (line_num > (int)lines.size()) {
-            line_num = (int)lines.size();
+        if (line_num > doc_line_total()) {
+            line_num = doc_line_total();
+        }
+        if (windowed) {
+            window_goto(line_num - 1);
         }
-        cur_row = line_num - 1;
+        cur_row = line_num - 1 - doc_first_line();
         cur_col = 0;
         clamp_cursor();
         ensure_cursor_visible();
@@ -603,6 +1272,7 @@ static void handle_command()
         } else {
             current_file = make_abs_path(path);
             write_file(current_file);
+            syntax_select();
         }
         return;
     }
@@ -620,24 +1290,52 @@ static void handle_command()
         return;
     }
 
-    if (cmd.rfind("s/", 0) == 0) {
-        std::string rest = cmd.substr(2);
-        size_t p1 = rest.find('/');
-        if (p1 == std::string::npos) {
-            set_status("bad substitute");
-            return;
+    // plage : %, N, N,M (. $ +n -n) ; sans plage, la ligne courante
+    size_t i = 0;
+    int first = doc_first_line() + cur_row + 1;
+    int last = first;
+    bool has_range = false;
+    if (!cmd.empty() && cmd[0] == '%') {
+        first = 1;
+        last = doc_line_total();
+        i = 1;
+        has_range = true;
+    } else if (parse_address(cmd, i, first)) {
+        last = first;
+        has_range = true;
+        if (i < cmd.size() && cmd[i] == ',') {
+            i++;
+            if (!parse_address(cmd, i, last)) {
+                set_status("bad range");
+                return;
+            }
         }
-        std::string from = rest.substr(0, p1);
-        std::string rest2 = rest.substr(p1 + 1);
-        size_t p2 = rest2.find('/');
-        if (p2 == std::string::npos) {
+    }
+
+    if (cmd.compare(i, 2, "s/") == 0) {
+        std::string from;
+        std::string to;
+        i += 2;
+        if (!subst_field(cmd, i, from) || !subst_field(cmd, i, to)) {
             set_status("bad substitute");
             return;
         }
-        std::string to = rest2.substr(0, p2);
-        std::string flags = rest2.substr(p2 + 1);
-        bool global = (flags.find('g') != std::string::npos);
-        substitute_current_line(from, to, global);
+        bool global = (cmd.find('g', i) != std::string::npos);
+        substitute_lines(first, last, from, to, global);
+        return;
+    }
+
+    // :. :$ :+3 ... : aller à la ligne
+    if (has_range && i == cmd.size()) {
+        if (first < 1) first = 1;
+        if (first > doc_line_total()) first = doc_line_total();
+        if (windowed) {
+            window_goto(first - 1);
+        }
+        cur_row = first - 1 - doc_first_line();
+        cur_col = 0;
+        clamp_cursor();
+        ensure_cursor_visible();
         return;
     }
 
@@ -653,7 +1351,9 @@ void editor_init()
     prompt_label.clear();
     prompt_buffer.clear();
     nano_pending_quit = false;
-    lines.clear();
+    doc.set_edit_hook(doc_edited, nullptr);
+    doc.set_change_hook(doc_changed, nullptr);
+    doc.clear();
     current_file.clear();
     dirty = false;
     cmd_buffer.clear();
@@ -688,12 +1388,18 @@ static void editor_open_impl(const char* path, bool use_nano)
 
     current_file = make_abs_path(path ? path : "");
 
+    undo_log.reset();
+    syntax_on = false;
+    syntax.release();
     if (!current_file.empty()) {
         read_file(current_file);
     } else {
-        lines.clear();
+        big_file.close();
+        windowed = false;
+        doc.clear();
         ensure_line_exists();
     }
+    syntax_select();
 
     cur_row = 0;
     cur_col = 0;
@@ -702,6 +1408,7 @@ static void editor_open_impl(const char* path, bool use_nano)
     dirty = false;
     clamp_cursor();
     ensure_cursor_visible();
+    invalidate_screen();
     redraw();
 }
 
@@ -718,33 +1425,34 @@ void editor_open_with_mode(const char* path, bool use_nano)
 static void shift_current_line(int dir)
 {
     ensure_line_exists();
-    std::string& line = lines[cur_row];
     const int shift = 4;
 
     if (dir > 0) {
-        line.insert(0, (size_t)shift, ' ');
-        cur_col += shift;
-        dirty = true;
+        if (doc_ok(doc.insert(cur_row, 0, "    ", (size_t)shift))) {
+            cur_col += shift;
+            dirty = true;
+        }
         return;
     }
 
-    if (line.empty()) {
+    int len = doc.line_len(cur_row);
+    if (len == 0) {
         return;
     }
 
-    if (line[0] == '\t') {
-        line.erase(0, 1);
+    if (doc.at(cur_row, 0) == '\t') {
+        doc.erase(cur_row, 0, 1);
         if (cur_col > 0) cur_col--;
         dirty = true;
         return;
     }
 
     int remove = 0;
-    while (remove < shift && remove < (int)line.size() && line[remove] == ' ') {
+    while (remove < shift && remove < len && doc.at(cur_row, remove) == ' ') {
         remove++;
     }
     if (remove > 0) {
-        line.erase(0, (size_t)remove);
+        doc.erase(cur_row, 0, (size_t)remove);
         if (cur_col >= remove) cur_col -= remove;
         else cur_col = 0;
         dirty = true;
@@ -753,19 +1461,17 @@ static void shift_current_line(int dir)
 
 static void join_line_below()
 {
-    if (lines.empty()) {
+    if (cur_row < 0 || cur_row >= doc.line_count() - 1) {
         return;
     }
-    if (cur_row < 0 || cur_row >= (int)lines.size() - 1) {
-        return;
-    }
-    std::string& line = lines[cur_row];
-    std::string& next = lines[cur_row + 1];
-    if (!line.empty() && !next.empty() && line.back() != ' ') {
-        line.push_back(' ');
+    int len = doc.line_len(cur_row);
+    if (len > 0 && doc.line_len(cur_row + 1) > 0 &&
+        doc.at(cur_row, len - 1) != ' ') {
+        if (!doc_ok(doc.insert(cur_row, len, " ", 1))) {
+            return;
+        }
     }
-    line += next;
-    lines.erase(lines.begin() + cur_row + 1);
+    doc.join_lines(cur_row);
     dirty = true;
 }
 
@@ -779,15 +1485,15 @@ static bool is_word_char(char ch)
 static void move_to_next_word()
 {
     ensure_line_exists();
-    std::string& line = lines[cur_row];
     int row = cur_row;
     int col = cur_col;
+    LineView line = doc.line(row);
 
     auto advance_line = [&]() {
-        if (row + 1 < (int)lines.size()) {
+        if (row + 1 < doc.line_count()) {
             row++;
             col = 0;
-            line = lines[row];
+            line = doc.line(row);
             return true;
         }
         return false;
@@ -819,6 +1525,15 @@ static void move_to_next_word()
 void editor_close()
 {
     active = false;
+    // le bloc de texte n'est gardé que pendant la session
+    big_file.close();
+    windowed = false;
+    doc.release();
+    doc_rows.release();
+    undo_log.release();
+    syntax_on = false;
+    syntax.release();
+    std::vector<uint8_t>().swap(syntax_line);
     term_init();
     term_prompt();
 }
@@ -856,9 +1571,10 @@ void editor_handle_char(char c)
 
         if (c >= 32 && c <= 126) {
             ensure_line_exists();
-            lines[cur_row].insert((size_t)cur_col, 1, c);
-            cur_col++;
-            dirty = true;
+            if (doc_ok(doc.insert(cur_row, cur_col, &c, 1))) {
+                cur_col++;
+                dirty = true;
+            }
         }
         clamp_cursor();
         ensure_cursor_visible();
@@ -885,9 +1601,10 @@ void editor_handle_char(char c)
     if (mode == MODE_INSERT) {
         if (c >= 32 && c <= 126) {
             ensure_line_exists();
-            lines[cur_row].insert((size_t)cur_col, 1, c);
-            cur_col++;
-            dirty = true;
+            if (doc_ok(doc.insert(cur_row, cur_col, &c, 1))) {
+                cur_col++;
+                dirty = true;
+            }
         }
         clamp_cursor();
         ensure_cursor_visible();
@@ -895,6 +1612,10 @@ void editor_handle_char(char c)
         return;
     }
 
+    // chaque commande est une étape d'annulation ; la saisie qui suit
+    // i, a ou o en fait partie
+    undo_log.cut();
+
     if (c >= '0' && c <= '9') {
         normal_count.push_back(c);
         return;
@@ -902,10 +1623,11 @@ void editor_handle_char(char c)
 
     if (pending_replace) {
         pending_replace = false;
-        if (c >= 32 && c <= 126 && !lines.empty()) {
-            std::string& line = lines[cur_row];
-            if (!line.empty() && cur_col >= 0 && cur_col < (int)line.size()) {
-                line[(size_t)cur_col] = c;
+        if (c >= 32 && c <= 126 && doc.line_count() > 0) {
+            int n = cursor_cell_len();
+            if (n > 0) {
+                doc.erase(cur_row, cur_col, (size_t)n);
+                doc.insert(cur_row, cur_col, &c, 1);
                 dirty = true;
             }
         }
@@ -941,18 +1663,18 @@ void editor_handle_char(char c)
             mode = MODE_INSERT;
             break;
         case 'a':
-            if (!lines.empty()) {
-                int len = (int)lines[cur_row].size();
-                if (cur_col < len) cur_col++;
+            if (doc.line_count() > 0) {
+                cur_col += cursor_cell_len();
             }
             mode = MODE_INSERT;
             break;
         case 'o':
-            if (lines.empty()) {
-                lines.push_back("");
+            if (!doc_ok(doc.insert_line(cur_row + 1, "", 0))) {
+                break;
+            }
+            if (doc.line_count() == 1) {
                 cur_row = 0;
             } else {
-                lines.insert(lines.begin() + cur_row + 1, "");
                 cur_row++;
             }
             cur_col = 0;
@@ -960,18 +1682,19 @@ void editor_handle_char(char c)
             mode = MODE_INSERT;
             break;
         case 'x': {
-            if (!lines.empty()) {
-                std::string& line = lines[cur_row];
-                if (!line.empty() && cur_col >= 0 && cur_col < (int)line.size()) {
-                    line.erase((size_t)cur_col, 1);
-                    dirty = true;
-                }
+            int n = cursor_cell_len();
+            if (n > 0) {
+                doc.erase(cur_row, cur_col, (size_t)n);
+                dirty = true;
             }
             break;
         }
         case 'r':
             pending_replace = true;
             break;
+        case 'u':
+            undo_step(false);
+            break;
         case 'p':
             paste_line_below();
             break;
@@ -993,27 +1716,28 @@ void editor_handle_char(char c)
         case 'n':
             if (last_search.empty()) {
                 set_status("no previous search");
-            } else if (!find_next(last_search)) {
-                set_status("pattern not found");
+            } else {
+                find_next(last_search);
             }
             break;
         case 'N':
             if (last_search.empty()) {
                 set_status("no previous search");
-            } else if (!find_prev(last_search)) {
-                set_status("pattern not found");
+            } else {
+                find_prev(last_search);
             }
             break;
         case 'G': {
-            int target = -1;
+            int target = doc_line_total();
             if (!normal_count.empty()) {
                 target = atoi(normal_count.c_str());
                 if (target < 1) target = 1;
-                if (target > (int)lines.size()) target = (int)lines.size();
-                cur_row = target - 1;
-            } else {
-                cur_row = (int)lines.size() - 1;
+                if (target > doc_line_total()) target = doc_line_total();
+            }
+            if (windowed) {
+                window_goto(target - 1);
             }
+            cur_row = target - 1 - doc_first_line();
             cur_col = 0;
             break;
         }
@@ -1024,8 +1748,8 @@ void editor_handle_char(char c)
             cur_col = 0;
             break;
         case '$':
-            if (!lines.empty()) {
-                int len = (int)lines[cur_row].size();
+            if (doc.line_count() > 0) {
+                int len = doc.line_len(cur_row);
                 cur_col = (len > 0) ? len - 1 : 0;
             } else {
                 cur_col = 0;
@@ -1072,10 +1796,20 @@ void editor_handle_char_raw(uint8_t c)
         return;
     }
 
+    // au-delà de l'ASCII (tabulation comprise), le clavier donne un
+    // caractère CP437 ; le texte est en UTF-8
     ensure_line_exists();
-    lines[cur_row].insert((size_t)cur_col, 1, (char)c);
-    cur_col++;
-    dirty = true;
+    char utf8[3];
+    size_t n = 1;
+    if (c < 0x80) {
+        utf8[0] = (char)c;
+    } else {
+        n = cp437_to_utf8(c, utf8);
+    }
+    if (doc_ok(doc.insert(cur_row, cur_col, utf8, n))) {
+        cur_col += (int)n;
+        dirty = true;
+    }
     clamp_cursor();
     ensure_cursor_visible();
     redraw();
@@ -1112,13 +1846,13 @@ void editor_handle_backspace()
     }
 
     if (cur_col > 0) {
-        lines[cur_row].erase((size_t)cur_col - 1, 1);
-        cur_col--;
+        int start = cell_start(doc.line(cur_row), cur_col - 1);
+        doc.erase(cur_row, start, (size_t)(cur_col - start));
+        cur_col = start;
         dirty = true;
     } else if (cur_row > 0) {
-        int prev_len = (int)lines[cur_row - 1].size();
-        lines[cur_row - 1] += lines[cur_row];
-        lines.erase(lines.begin() + cur_row);
+        int prev_len = doc.line_len(cur_row - 1);
+        doc.join_lines(cur_row - 1);
         cur_row--;
         cur_col = prev_len;
         dirty = true;
@@ -1152,6 +1886,7 @@ void editor_handle_enter()
             } else {
                 current_file = make_abs_path(path);
                 write_file(current_file);
+                syntax_select();
             }
         }
         prompt_kind = PROMPT_NONE;
@@ -1174,9 +1909,7 @@ void editor_handle_enter()
         last_search = search_buffer;
         search_buffer.clear();
         mode = nano_mode ? MODE_INSERT : MODE_NORMAL;
-        if (!find_next(last_search)) {
-            set_status("pattern not found");
-        }
+        find_next(last_search);
         redraw();
         return;
     }
@@ -1186,13 +1919,11 @@ void editor_handle_enter()
     }
 
     ensure_line_exists();
-    std::string& line = lines[cur_row];
-    std::string tail = line.substr((size_t)cur_col);
-    line.erase((size_t)cur_col);
-    lines.insert(lines.begin() + cur_row + 1, tail);
-    cur_row++;
-    cur_col = 0;
-    dirty = true;
+    if (doc_ok(doc.split_line(cur_row, cur_col))) {
+        cur_row++;
+        cur_col = 0;
+        dirty = true;
+    }
 
     clamp_cursor();
     ensure_cursor_visible();
@@ -1233,12 +1964,10 @@ void editor_handle_delete()
     if (!active) return;
 
     if (mode == MODE_INSERT) {
-        if (!lines.empty()) {
-            std::string& line = lines[cur_row];
-            if (cur_col >= 0 && cur_col < (int)line.size()) {
-                line.erase((size_t)cur_col, 1);
-                dirty = true;
-            }
+        int n = cursor_cell_len();
+        if (n > 0) {
+            doc.erase(cur_row, cur_col, (size_t)n);
+            dirty = true;
         }
         redraw();
     }
@@ -1247,6 +1976,7 @@ void editor_handle_delete()
 void editor_cursor_up()
 {
     if (!active) return;
+    undo_log.cut();
     cur_row--;
     clamp_cursor();
     ensure_cursor_visible();
@@ -1256,6 +1986,7 @@ void editor_cursor_up()
 void editor_cursor_down()
 {
     if (!active) return;
+    undo_log.cut();
     cur_row++;
     clamp_cursor();
     ensure_cursor_visible();
@@ -1265,7 +1996,10 @@ void editor_cursor_down()
 void editor_cursor_left()
 {
     if (!active) return;
-    cur_col--;
+    undo_log.cut();
+    if (cur_col > 0 && cur_row >= 0 && cur_row < doc.line_count()) {
+        cur_col = cell_start(doc.line(cur_row), cur_col - 1);
+    }
     clamp_cursor();
     ensure_cursor_visible();
     redraw();
@@ -1274,7 +2008,8 @@ void editor_cursor_left()
 void editor_cursor_right()
 {
     if (!active) return;
-    cur_col++;
+    undo_log.cut();
+    cur_col += cursor_cell_len();
     clamp_cursor();
     ensure_cursor_visible();
     redraw();
@@ -1282,12 +2017,23 @@ void editor_cursor_right()
 
 void editor_handle_ctrl(uint8_t c)
 {
-    if (!active || !nano_mode) return;
+    if (!active) return;
 
     if (c >= 'A' && c <= 'Z') {
         c = (uint8_t)(c - 'A' + 'a');
     }
 
+    if (!nano_mode) {
+        if (c == 'r' && mode == MODE_NORMAL) {
+            status_msg.clear();
+            undo_step(true);
+            redraw();
+        }
+        return;
+    }
+    // couper / coller : une étape à part, pas dans la saisie voisine
+    undo_log.cut();
+
     switch (c) {
         case 'x':
             if (dirty && !nano_pending_quit) {
@@ -1315,6 +2061,7 @@ void editor_handle_ctrl(uint8_t c)
         case 'k':
             nano_pending_quit = false;
             delete_current_line();
+            undo_log.cut();
             clamp_cursor();
             ensure_cursor_visible();
             set_status("cut");
@@ -1323,6 +2070,7 @@ void editor_handle_ctrl(uint8_t c)
         case 'u':
             nano_pending_quit = false;
             paste_line_below();
+            undo_log.cut();
             clamp_cursor();
             ensure_cursor_visible();
             set_status("pasted");
@@ -1330,10 +2078,30 @@ void editor_handle_ctrl(uint8_t c)
             return;
         case 'g':
             nano_pending_quit = false;
-            set_status("nano: ^O write ^X exit ^W find ^K cut ^U paste");
+            set_status("nano: ^O write ^X exit ^W find ^K cut ^U paste M-U undo");
             redraw();
             return;
         default:
             return;
     }
 }
+
+// Alt-U / Alt-E : annuler / refaire dans nano ; les autres combinaisons
+// Alt restent au clavier
+bool editor_takes_alt(uint8_t c)
+{
+    if (!active || !nano_mode || mode != MODE_INSERT) {
+        return false;
+    }
+    return c == 'u' || c == 'U' || c == 'e' || c == 'E';
+}
+
+void editor_handle_alt(uint8_t c)
+{
+    if (!editor_takes_alt(c)) return;
+
+    nano_pending_quit = false;
+    status_msg.clear();
+    undo_step(c == 'e' || c == 'E');
+    redraw();
+}
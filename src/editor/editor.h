@@ -11,11 +11,16 @@ void editor_close();
 void editor_handle_char(char c);
 void editor_handle_char_raw(uint8_t c);
 void editor_handle_ctrl(uint8_t c);
+// true si Alt+c est une commande de l'éditeur (annuler / refaire de nano)
+bool editor_takes_alt(uint8_t c);
+void editor_handle_alt(uint8_t c);
 void editor_handle_backspace();
 void editor_handle_enter();
 void editor_handle_escape();
 void editor_handle_delete();
 void editor_redraw();
+// travail de fond (index des gros fichiers), appelé à chaque tour de boucle
+void editor_idle();
 
 void editor_cursor_up();
 void editor_cursor_down();
@@ -0,0 +1,658 @@
+#include "file_window.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "line_store.h"
+#include "fs/fs.h"
+
+static constexpr int kIndexStepBlocks = 4;                  // 16 Ko par tranche
+static constexpr uint32_t kWindowLead = kWindowLines / 4;   // lignes avant la cible
+static constexpr uint32_t kWindowTail = 32;                 // minimum après
+
+// ------------------------------------------------------------
+// Lignes : empreinte
+// ------------------------------------------------------------
+
+// FNV-1a 64 bits : une ligne inchangée garde son empreinte
+static uint64_t hash_bytes(uint64_t h, const char* p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        h ^= (uint8_t)p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t hash_line(const LineView& v)
+{
+    uint64_t h = 14695981039346656037ULL;
+    h = hash_bytes(h, v.a, v.na);
+    return hash_bytes(h, v.b, v.nb);
+}
+
+static uint64_t hash_line(const std::string& s)
+{
+    return hash_bytes(14695981039346656037ULL, s.data(), s.size());
+}
+
+// ------------------------------------------------------------
+// Sortie de l'enregistrement : compte les lignes, refait l'index
+// ------------------------------------------------------------
+
+class WindowSink {
+public:
+    WindowSink(IoWriter& w, std::vector<uint32_t>& index, bool crlf)
+        : w_(w), index_(index), off_(0), lines_(0), any_(false),
+          after_text_(false), crlf_(crlf)
+    {
+    }
+
+    bool write(const void* data, size_t len)
+    {
+        const char* base = static_cast<const char*>(data);
+        const char* p = base;
+        const char* end = base + len;
+        const char* nl;
+        while ((nl = static_cast<const char*>(memchr(p, '\n', end - p)))) {
+            lines_++;
+            if (lines_ % kWindowIndexStride == 0) {
+                index_.push_back(off_ + (uint32_t)(nl - base) + 1);
+            }
+            p = nl + 1;
+        }
+        off_ += (uint32_t)len;
+        return w_.write(data, len);
+    }
+
+    // début d'un morceau d'au moins une ligne : séparateur si besoin.
+    // Des lignes recopiées gardent leur '\r' éventuel, seul le '\n'
+    // manque ; après du texte de l'éditeur, la fin de ligne du fichier.
+    bool piece(bool edited)
+    {
+        bool ok = !any_ || (after_text_ ? eol() : write("\n", 1));
+        any_ = true;
+        after_text_ = edited;
+        return ok;
+    }
+
+    // lignes de l'éditeur séparées par '\n'
+    bool text(const std::string& s)
+    {
+        if (!crlf_) {
+            return write(s.data(), s.size());
+        }
+        size_t pos = 0;
+        for (;;) {
+            size_t nl = s.find('\n', pos);
+            if (nl == std::string::npos) {
+                return write(s.data() + pos, s.size() - pos);
+            }
+            if (!write(s.data() + pos, nl - pos) || !eol()) {
+                return false;
+            }
+            pos = nl + 1;
+        }
+    }
+
+    uint32_t size() const { return off_; }
+    uint32_t newlines() const { return lines_; }
+
+private:
+    IoWriter& w_;
+    std::vector<uint32_t>& index_;
+    uint32_t off_;
+    uint32_t lines_;
+    bool any_;
+    bool after_text_;
+    bool crlf_;
+
+    bool eol() { return crlf_ ? write("\r\n", 2) : write("\n", 1); }
+};
+
+// ------------------------------------------------------------
+// Ouverture
+// ------------------------------------------------------------
+
+FileWindow::FileWindow()
+    : open_(false),
+      file_size_(0),
+      crlf_(false),
+      blk_(nullptr),
+      blk_len_(0),
+      more_(false),
+      scan_off_(0),
+      scan_lines_(0),
+      scan_done_(true),
+      a_(0),
+      b_(0),
+      at_end_(true),
+      first_(0),
+      loaded_lines_(0),
+      rev_(0)
+{
+}
+
+FileWindow::~FileWindow()
+{
+    close();
+}
+
+bool FileWindow::open(const VfsPath& path)
+{
+    close();
+    FsStat st;
+    if (!vfs_stat(path, st) || !st.is_file) {
+        return false;
+    }
+    if (!vfs_open(path, VFS_OPEN_READ, file_)) {
+        return false;
+    }
+    if (!reader_.begin(file_)) {
+        vfs_close(file_);
+        return false;
+    }
+    path_ = path;
+    open_ = true;
+    file_size_ = st.size;
+    blk_ = nullptr;
+    blk_len_ = 0;
+    more_ = true;
+    index_.assign(1, 0);
+    scan_off_ = 0;
+    scan_lines_ = 0;
+    scan_done_ = (file_size_ == 0);
+    overlays_.clear();
+    a_ = 0;
+    b_ = 0;
+    at_end_ = false;
+    first_ = 0;
+    loaded_lines_ = 0;
+
+    // fin de ligne d'après la première ligne, comme en chargement complet
+    crlf_ = false;
+    if (fill() > 0) {
+        const uint8_t* nl = static_cast<const uint8_t*>(
+            memchr(blk_, '\n', blk_len_));
+        crlf_ = nl && nl > blk_ && nl[-1] == '\r';
+    }
+    return true;
+}
+
+void FileWindow::close()
+{
+    if (!open_) {
+        return;
+    }
+    reader_.end();
+    vfs_close(file_);
+    open_ = false;
+    std::vector<uint32_t>().swap(index_);
+    std::vector<WindowOverlay>().swap(overlays_);
+    scan_done_ = true;
+    at_end_ = true;
+    first_ = 0;
+}
+
+// ------------------------------------------------------------
+// Lecture du fichier d'origine
+// ------------------------------------------------------------
+
+bool FileWindow::seek(uint32_t pos)
+{
+    blk_len_ = 0;
+    return reader_.seek(pos);
+}
+
+uint32_t FileWindow::tell() const
+{
+    return reader_.tell() - (uint32_t)blk_len_;
+}
+
+int FileWindow::fill()
+{
+    if (blk_len_ > 0) {
+        return (int)blk_len_;
+    }
+    const uint8_t* data = nullptr;
+    int n = reader_.next(&data);
+    if (n > 0) {
+        blk_ = data;
+        blk_len_ = (size_t)n;
+    }
+    return n;
+}
+
+// ligne suivante sans '\n', ni '\r' final si le fichier est en "\r\n"
+// (out nul : sautée) ; false en erreur, après la dernière ligne ou sur
+// une ligne trop longue
+bool FileWindow::read_line(std::string* out)
+{
+    if (out) {
+        out->clear();
+    }
+    if (!more_) {
+        return false;
+    }
+    size_t len = 0;
+    for (;;) {
+        int n = fill();
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            more_ = false;      // dernière ligne, sans '\n'
+            break;
+        }
+        const uint8_t* nl = static_cast<const uint8_t*>(
+            memchr(blk_, '\n', blk_len_));
+        size_t take = nl ? (size_t)(nl - blk_) : blk_len_;
+        len += take;
+        if (out) {
+            if (len > kWindowMaxLine) {
+                return false;
+            }
+            out->append(reinterpret_cast<const char*>(blk_), take);
+        }
+        if (nl) {
+            blk_ = nl + 1;
+            blk_len_ -= take + 1;
+            break;
+        }
+        blk_len_ = 0;
+    }
+    if (crlf_ && out && !out->empty() && out->back() == '\r') {
+        out->pop_back();
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// Index clairsemé
+// ------------------------------------------------------------
+
+bool FileWindow::index_step()
+{
+    if (!open_ || scan_done_) {
+        return false;
+    }
+    if (tell() != scan_off_ && !seek(scan_off_)) {
+        scan_done_ = true;
+        return false;
+    }
+    for (int i = 0; i < kIndexStepBlocks; i++) {
+        if (fill() <= 0) {
+            scan_done_ = true;
+            return false;
+        }
+        const uint8_t* p = blk_;
+        const uint8_t* end = blk_ + blk_len_;
+        const uint8_t* nl;
+        while ((nl = static_cast<const uint8_t*>(memchr(p, '\n', end - p)))) {
+            scan_lines_++;
+            if (scan_lines_ % kWindowIndexStride == 0) {
+                index_.push_back(scan_off_ + (uint32_t)(nl - blk_) + 1);
+            }
+            p = nl + 1;
+        }
+        scan_off_ += (uint32_t)blk_len_;
+        blk_len_ = 0;
+    }
+    if (scan_off_ >= file_size_) {
+        scan_done_ = true;
+    }
+    return !scan_done_;
+}
+
+// vrai si la ligne existe ; indexe jusque-là au besoin
+bool FileWindow::index_until(uint32_t line)
+{
+    while (lines_known() <= line && index_step()) {
+    }
+    return line < lines_known();
+}
+
+bool FileWindow::seek_line(uint32_t line)
+{
+    if (!index_until(line)) {
+        return false;
+    }
+    uint32_t k = line / kWindowIndexStride;
+    if (!seek(index_[k])) {
+        return false;
+    }
+    more_ = true;
+    for (uint32_t i = k * kWindowIndexStride; i < line; i++) {
+        if (!read_line(nullptr)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int FileWindow::line_count(const LineStore& doc)
+{
+    while (index_step()) {
+    }
+    long total = (long)lines_known();
+    for (const WindowOverlay& ov : overlays_) {
+        total += (long)ov.new_count - (long)ov.orig_count;
+    }
+    total += doc.line_count() - loaded_lines_;
+    return (int)total;
+}
+
+// ------------------------------------------------------------
+// Fenêtre
+// ------------------------------------------------------------
+
+bool FileWindow::in_window(const WindowOverlay& ov) const
+{
+    return ov.orig_first >= a_ &&
+        (ov.orig_first < b_ || (at_end_ && ov.orig_first == b_));
+}
+
+// Les lignes modifiées de la fenêtre, comparées au fichier d'origine,
+// remplacent les morceaux mis de côté qu'elle contenait.
+bool FileWindow::spill(LineStore& doc)
+{
+    if (!open_ || doc.revision() == rev_) {
+        return true;
+    }
+
+    const uint32_t wc = b_ - a_;
+    std::vector<uint64_t> orig;
+    orig.reserve(wc);
+    std::string raw;
+    if (wc > 0) {
+        if (!seek_line(a_)) {
+            return false;
+        }
+        for (uint32_t k = 0; k < wc; k++) {
+            if (!read_line(&raw)) {
+                return false;
+            }
+            orig.push_back(hash_line(raw));
+        }
+    }
+
+    const uint32_t n = (uint32_t)doc.line_count();
+    uint32_t p = 0;
+    while (p < n && p < wc && hash_line(doc.line((int)p)) == orig[p]) {
+        p++;
+    }
+    uint32_t s = 0;
+    while (s < n - p && s < wc - p &&
+        hash_line(doc.line((int)(n - 1 - s))) == orig[wc - 1 - s]) {
+        s++;
+    }
+
+    overlays_.erase(std::remove_if(overlays_.begin(), overlays_.end(),
+        [this](const WindowOverlay& ov) { return in_window(ov); }),
+        overlays_.end());
+
+    if (n - p - s > 0 || wc - p - s > 0) {
+        WindowOverlay ov;
+        ov.orig_first = a_ + p;
+        ov.orig_count = wc - p - s;
+        ov.new_count = n - p - s;
+        std::string line;
+        for (uint32_t r = p; r < n - s; r++) {
+            if (r > p) {
+                ov.text.push_back('\n');
+            }
+            doc.get_line((int)r, line);
+            ov.text += line;
+        }
+        // avant un morceau de même origine : le texte de la fenêtre le précède
+        auto at = std::lower_bound(overlays_.begin(), overlays_.end(),
+            ov.orig_first, [](const WindowOverlay& o, uint32_t first) {
+                return o.orig_first < first;
+            });
+        overlays_.insert(at, std::move(ov));
+    }
+
+    loaded_lines_ = (int)n;
+    rev_ = doc.revision();
+    return true;
+}
+
+bool FileWindow::load(LineStore& doc, int line)
+{
+    if (!open_ || !spill(doc)) {
+        return false;
+    }
+    if (line < 0) {
+        line = 0;
+    }
+
+    // ligne du document -> ligne d'origine
+    long delta = 0;
+    bool inside = false;
+    uint32_t o = 0;
+    for (const WindowOverlay& ov : overlays_) {
+        long start = (long)ov.orig_first + delta;
+        if (line < start) {
+            break;
+        }
+        if (line < start + (long)ov.new_count) {
+            o = ov.orig_first;
+            inside = true;
+            break;
+        }
+        delta += (long)ov.new_count - (long)ov.orig_count;
+    }
+    if (!inside) {
+        o = (uint32_t)std::max(0L, (long)line - delta);
+    }
+    index_until(o);
+    if (o >= lines_known()) {
+        o = lines_known() - 1;
+    }
+
+    uint32_t a = (o > kWindowLead) ? o - kWindowLead : 0;
+    // lignes très longues : peu de contexte avant la cible
+    if (index_[o / kWindowIndexStride] - index_[a / kWindowIndexStride] >
+        kWindowBytes / 2) {
+        a = (o > 8) ? o - 8 : 0;
+    }
+    // jamais au milieu d'un morceau remplacé : la fenêtre commence après
+    // lui plutôt qu'avant, sinon une suite de fenêtres modifiées de bout
+    // en bout (:%s) fusionnerait en un morceau rechargé en entier
+    for (const WindowOverlay& ov : overlays_) {
+        if (ov.orig_first < a && ov.orig_first + ov.orig_count > a) {
+            uint32_t end = ov.orig_first + ov.orig_count;
+            a = (end <= o) ? end : ov.orig_first;
+        }
+    }
+
+    long before = 0;
+    size_t ov_i = 0;
+    while (ov_i < overlays_.size() && overlays_[ov_i].orig_first < a) {
+        before += (long)overlays_[ov_i].new_count -
+            (long)overlays_[ov_i].orig_count;
+        ov_i++;
+    }
+
+    bool ok = seek_line(a);
+    doc.clear();
+    std::string raw;
+    uint32_t k = a;
+    size_t bytes = 0;
+    while (ok) {
+        if (more_ && k > o + kWindowTail &&
+            (doc.line_count() >= kWindowLines || bytes >= kWindowBytes)) {
+            break;
+        }
+        while (ok && ov_i < overlays_.size() && overlays_[ov_i].orig_first == k) {
+            const WindowOverlay& ov = overlays_[ov_i++];
+            size_t pos = 0;
+            for (uint32_t i = 0; i < ov.new_count && ok; i++) {
+                size_t nl = ov.text.find('\n', pos);
+                if (nl == std::string::npos) {
+                    nl = ov.text.size();
+                }
+                ok = doc.append_line(ov.text.data() + pos, nl - pos);
+                pos = nl + 1;
+            }
+            bytes += ov.text.size() + 1;
+            for (uint32_t i = 0; i < ov.orig_count && ok; i++) {
+                ok = read_line(nullptr);
+            }
+            k += ov.orig_count;
+        }
+        if (!ok || !more_) {
+            break;
+        }
+        if (!read_line(&raw)) {
+            ok = false;
+            break;
+        }
+        ok = doc.append_line(raw.data(), raw.size());
+        bytes += raw.size() + 1;
+        k++;
+    }
+
+    if (!ok) {
+        // fenêtre vide insérée avant a : rien d'origine n'est perdu
+        doc.clear();
+        k = a;
+        more_ = true;
+    }
+    if (doc.line_count() == 0) {
+        doc.append_line("", 0);
+    }
+    a_ = a;
+    b_ = k;
+    at_end_ = !more_;
+    first_ = (int)((long)a + before);
+    loaded_lines_ = doc.line_count();
+    rev_ = doc.revision();
+    return ok;
+}
+
+// ------------------------------------------------------------
+// Enregistrement
+// ------------------------------------------------------------
+
+// lignes d'origine [first, end) (ou jusqu'à la fin), sans le '\n' final
+bool FileWindow::copy_lines(uint32_t first, uint32_t end, bool to_eof,
+    WindowSink& sink)
+{
+    if (!to_eof && end <= first) {
+        return true;
+    }
+    if (!index_until(first)) {
+        return to_eof;
+    }
+    if (!seek_line(first) || !sink.piece(false)) {
+        return false;
+    }
+    uint32_t left = end - first;
+    for (;;) {
+        int n = fill();
+        if (n < 0) {
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        size_t take = blk_len_;
+        bool done = false;
+        if (!to_eof) {
+            const uint8_t* p = blk_;
+            const uint8_t* stop = blk_ + blk_len_;
+            const uint8_t* nl;
+            while ((nl = static_cast<const uint8_t*>(memchr(p, '\n', stop - p)))) {
+                if (--left == 0) {
+                    take = (size_t)(nl - blk_);
+                    done = true;
+                    break;
+                }
+                p = nl + 1;
+            }
+        }
+        if (!sink.write(blk_, take)) {
+            return false;
+        }
+        blk_len_ = 0;
+        if (done) {
+            return true;
+        }
+    }
+}
+
+bool FileWindow::save(LineStore& doc, const VfsPath& path)
+{
+    if (!open_ || !spill(doc)) {
+        return false;
+    }
+
+    std::string tmp_name = path.virt + ".swp";
+    VfsPath tmp;
+    fs_resolve(tmp_name.c_str(), tmp);
+    fs_invalidate(tmp.virt.c_str());
+
+    VfsFile out;
+    if (!vfs_open(tmp, VFS_OPEN_WRITE, out)) {
+        return false;
+    }
+    std::vector<uint32_t> index(1, 0);
+    IoWriter writer;
+    bool ok = writer.begin(out, kIoCopyChunkSize);
+    WindowSink sink(writer, index, crlf_);
+
+    uint32_t k = 0;
+    for (size_t i = 0; i < overlays_.size() && ok; i++) {
+        const WindowOverlay& ov = overlays_[i];
+        ok = copy_lines(k, ov.orig_first, false, sink);
+        if (ok && ov.new_count) {
+            ok = sink.piece(true) && sink.text(ov.text);
+        }
+        k = ov.orig_first + ov.orig_count;
+    }
+    if (ok) {
+        ok = copy_lines(k, 0, true, sink);
+    }
+    if (!writer.finish() || !vfs_sync(out)) {
+        ok = false;
+    }
+    if (!vfs_close(out)) {
+        ok = false;
+    }
+    if (!ok) {
+        vfs_remove(tmp);
+        return false;
+    }
+
+    // le fichier écrit remplace l'original, puis devient la source
+    reader_.end();
+    vfs_close(file_);
+    open_ = false;
+    bool renamed = fs_replace(tmp, path);
+    const VfsPath& src = renamed ? path : tmp;
+    fs_invalidate(src.virt.c_str());
+
+    if (!vfs_open(src, VFS_OPEN_READ, file_)) {
+        return false;
+    }
+    if (!reader_.begin(file_)) {
+        vfs_close(file_);
+        return false;
+    }
+    path_ = src;
+    open_ = true;
+    file_size_ = sink.size();
+    blk_len_ = 0;
+    more_ = true;
+    index_.swap(index);
+    scan_off_ = file_size_;
+    scan_lines_ = sink.newlines();
+    scan_done_ = true;
+    overlays_.clear();
+    a_ = (uint32_t)first_;
+    b_ = a_ + (uint32_t)doc.line_count();
+    loaded_lines_ = doc.line_count();
+    rev_ = doc.revision();
+    return renamed;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "fs/vfs.h"
+#include "fs/io_service.h"
+
+class LineStore;
+class WindowSink;
+
+// ------------------------------------------------------------
+// Gros fichiers : fenêtre de lignes sur le fichier d'origine
+// ------------------------------------------------------------
+//
+// Le fichier reste sur la carte. Un index clairsemé (position d'une
+// ligne sur kWindowIndexStride) est construit par tranches pendant les
+// temps morts, et seule une fenêtre de lignes est chargée dans le
+// LineStore de l'éditeur. Quand la fenêtre se déplace, ce qui y a
+// changé est mis de côté sous la forme « lignes d'origine [a, b)
+// remplacées par ce texte ». L'enregistrement recopie le fichier
+// d'origine par blocs en y insérant ces morceaux, dans un fichier
+// temporaire renommé ensuite.
+
+static constexpr int kWindowLines = 1024;
+static constexpr size_t kWindowBytes = 48 * 1024;
+static constexpr size_t kWindowMaxLine = 16 * 1024;
+static constexpr uint32_t kWindowIndexStride = 128;
+
+// lignes d'origine [orig_first, orig_first + orig_count) remplacées
+struct WindowOverlay {
+    uint32_t orig_first;
+    uint32_t orig_count;
+    uint32_t new_count;
+    std::string text;           // new_count lignes séparées par '\n'
+};
+
+class FileWindow {
+public:
+    FileWindow();
+    ~FileWindow();
+
+    bool open(const VfsPath& path);
+    void close();
+    bool is_open() const { return open_; }
+
+    // une tranche d'indexation ; false quand l'index est complet
+    bool index_step();
+    bool index_done() const { return scan_done_; }
+
+    // ligne du document chargée en tête de doc
+    int first_line() const { return first_; }
+    // lignes du document (termine l'index si besoin)
+    int line_count(const LineStore& doc);
+    bool has_before() const { return first_ > 0; }
+    bool has_after() const { return !at_end_; }
+
+    // charge la fenêtre autour de la ligne line du document ; ce qui a
+    // changé dans la fenêtre courante est d'abord mis de côté
+    bool load(LineStore& doc, int line);
+
+    // écrit le document complet dans path (temporaire puis renommage) ;
+    // path devient le fichier d'origine
+    bool save(LineStore& doc, const VfsPath& path);
+
+private:
+    FileWindow(const FileWindow&) = delete;
+    FileWindow& operator=(const FileWindow&) = delete;
+
+    bool seek(uint32_t pos);
+    uint32_t tell() const;
+    int fill();
+    bool read_line(std::string* out);
+    bool index_until(uint32_t line);
+    uint32_t lines_known() const { return scan_lines_ + 1; }
+    bool seek_line(uint32_t line);
+    bool in_window(const WindowOverlay& ov) const;
+    bool spill(LineStore& doc);
+    bool copy_lines(uint32_t first, uint32_t end, bool to_eof,
+        WindowSink& sink);
+
+    VfsPath path_;
+    VfsFile file_;
+    IoReader reader_;
+    bool open_;
+    uint32_t file_size_;
+    bool crlf_;                 // fins de ligne "\r\n" (première ligne)
+
+    // lecture en cours (bloc tenu par reader_)
+    const uint8_t* blk_;
+    size_t blk_len_;
+    bool more_;                 // une ligne commence à la position courante
+
+    // index_[k] = position de la ligne k * kWindowIndexStride
+    std::vector<uint32_t> index_;
+    uint32_t scan_off_;
+    uint32_t scan_lines_;       // '\n' vus
+    bool scan_done_;
+
+    std::vector<WindowOverlay> overlays_;   // triés par orig_first
+
+    // fenêtre : lignes d'origine [a_, b_), première ligne du document
+    uint32_t a_;
+    uint32_t b_;
+    bool at_end_;               // la fenêtre va jusqu'à la fin du fichier
+    int first_;
+    int loaded_lines_;          // lignes de doc après load() / spill()
+    uint32_t rev_;              // doc.revision() à ce moment
+};
@@ -0,0 +1,434 @@
+#include "line_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// croissance minimale du texte / de l'index
+static constexpr size_t kTextGrowMin = 1024;
+static constexpr size_t kIndexGrowMin = 64;
+
+LineStore::LineStore()
+    : buf_(nullptr),
+      cap_(0),
+      gap_pos_(0),
+      gap_len_(0),
+      len_(0),
+      idx_(nullptr),
+      idx_cap_(0),
+      front_(0),
+      back_(0),
+      rev_(0),
+      hook_(nullptr),
+      hook_user_(nullptr),
+      change_(nullptr),
+      change_user_(nullptr)
+{
+}
+
+LineStore::~LineStore()
+{
+    hook_ = nullptr;
+    change_ = nullptr;
+    release();
+}
+
+void LineStore::clear()
+{
+    const int count = line_count();
+    gap_pos_ = 0;
+    gap_len_ = cap_;
+    len_ = 0;
+    front_ = 0;
+    back_ = 0;
+    rev_++;
+    edited(0, count, 0);
+}
+
+void LineStore::release()
+{
+    free(buf_);
+    free(idx_);
+    buf_ = nullptr;
+    idx_ = nullptr;
+    cap_ = 0;
+    idx_cap_ = 0;
+    clear();
+}
+
+bool LineStore::reserve(size_t bytes)
+{
+    if (bytes <= len_) {
+        return true;
+    }
+    return grow_text(bytes - len_);
+}
+
+void LineStore::set_edit_hook(LineEditFn fn, void* user)
+{
+    hook_ = fn;
+    hook_user_ = user;
+}
+
+void LineStore::set_change_hook(LineChangeFn fn, void* user)
+{
+    change_ = fn;
+    change_user_ = user;
+}
+
+void LineStore::edited(int row, int removed, int added)
+{
+    if (hook_ && (removed || added)) {
+        hook_(row, removed, added, hook_user_);
+    }
+}
+
+// ------------------------------------------------------------
+// Trou du texte
+// ------------------------------------------------------------
+
+char LineStore::byte_at(size_t pos) const
+{
+    return buf_[pos < gap_pos_ ? pos : pos + gap_len_];
+}
+
+void LineStore::move_gap(size_t pos)
+{
+    if (pos < gap_pos_) {
+        memmove(buf_ + pos + gap_len_, buf_ + pos, gap_pos_ - pos);
+    } else if (pos > gap_pos_) {
+        memmove(buf_ + gap_pos_, buf_ + gap_pos_ + gap_len_, pos - gap_pos_);
+    }
+    gap_pos_ = pos;
+}
+
+// agrandit le bloc d'au moins la moitié : réallocations rares, la suite
+// du texte est recalée en fin de bloc
+bool LineStore::grow_text(size_t need)
+{
+    if (gap_len_ >= need) {
+        return true;
+    }
+    size_t extra = need - gap_len_;
+    if (extra < cap_ / 2) {
+        extra = cap_ / 2;
+    }
+    if (extra < kTextGrowMin) {
+        extra = kTextGrowMin;
+    }
+    size_t new_cap = cap_ + extra;
+    char* nb = static_cast<char*>(realloc(buf_, new_cap));
+    if (!nb) {
+        return false;
+    }
+    size_t tail = cap_ - gap_pos_ - gap_len_;
+    memmove(nb + new_cap - tail, nb + gap_pos_ + gap_len_, tail);
+    buf_ = nb;
+    gap_len_ += new_cap - cap_;
+    cap_ = new_cap;
+    return true;
+}
+
+// ------------------------------------------------------------
+// Index des lignes
+// ------------------------------------------------------------
+
+bool LineStore::grow_index(size_t need)
+{
+    if (idx_cap_ - front_ - back_ >= need) {
+        return true;
+    }
+    size_t new_cap = idx_cap_ + idx_cap_ / 2;
+    if (new_cap < front_ + back_ + need) {
+        new_cap = front_ + back_ + need;
+    }
+    if (new_cap < idx_cap_ + kIndexGrowMin) {
+        new_cap = idx_cap_ + kIndexGrowMin;
+    }
+    uint32_t* ni = static_cast<uint32_t*>(
+        realloc(idx_, new_cap * sizeof(uint32_t)));
+    if (!ni) {
+        return false;
+    }
+    memmove(ni + new_cap - back_, ni + idx_cap_ - back_,
+        back_ * sizeof(uint32_t));
+    idx_ = ni;
+    idx_cap_ = new_cap;
+    return true;
+}
+
+// lignes [0, front) en absolu, les suivantes relatives à la fin
+void LineStore::move_split(size_t front)
+{
+    while (front_ < front) {
+        uint32_t v = idx_[idx_cap_ - back_];
+        back_--;
+        idx_[front_++] = (uint32_t)(len_ - v);
+    }
+    while (front_ > front) {
+        uint32_t start = idx_[--front_];
+        back_++;
+        idx_[idx_cap_ - back_] = (uint32_t)(len_ - start);
+    }
+}
+
+size_t LineStore::line_start(int row) const
+{
+    size_t r = (size_t)row;
+    if (r < front_) {
+        return idx_[r];
+    }
+    return len_ - idx_[idx_cap_ - back_ + (r - front_)];
+}
+
+int LineStore::line_len(int row) const
+{
+    size_t start = line_start(row);
+    size_t end = (row + 1 < line_count()) ? line_start(row + 1) - 1 : len_;
+    return (int)(end - start);
+}
+
+int LineStore::line_of(size_t pos) const
+{
+    int lo = 0;
+    int hi = line_count() - 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo + 1) / 2;
+        if (line_start(mid) <= pos) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+size_t LineStore::pos_of(int row, int col) const
+{
+    int len = line_len(row);
+    if (col < 0) col = 0;
+    if (col > len) col = len;
+    return line_start(row) + (size_t)col;
+}
+
+// ------------------------------------------------------------
+// Lecture
+// ------------------------------------------------------------
+
+LineView LineStore::line(int row) const
+{
+    LineView v = { "", 0, "", 0 };
+    if (row < 0 || row >= line_count()) {
+        return v;
+    }
+    size_t s = line_start(row);
+    size_t n = (size_t)line_len(row);
+    if (s + n <= gap_pos_) {
+        v.a = buf_ + s;
+        v.na = n;
+    } else if (s >= gap_pos_) {
+        v.a = buf_ + s + gap_len_;
+        v.na = n;
+    } else {
+        v.a = buf_ + s;
+        v.na = gap_pos_ - s;
+        v.b = buf_ + gap_pos_ + gap_len_;
+        v.nb = n - v.na;
+    }
+    return v;
+}
+
+void LineStore::get_line(int row, std::string& out) const
+{
+    LineView v = line(row);
+    out.assign(v.a, v.na);
+    out.append(v.b, v.nb);
+}
+
+char LineStore::at(int row, int col) const
+{
+    if (col < 0 || col >= line_len(row)) {
+        return '\0';
+    }
+    return byte_at(line_start(row) + (size_t)col);
+}
+
+// ------------------------------------------------------------
+// Édition
+// ------------------------------------------------------------
+
+bool LineStore::insert(int row, int col, const char* data, size_t len)
+{
+    if (len == 0) {
+        return true;
+    }
+    size_t lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '\n') {
+            lines++;
+        }
+    }
+    if (!grow_text(len) || !grow_index(lines)) {
+        return false;
+    }
+    size_t pos = pos_of(row, col);
+    move_split((size_t)row + 1);
+    move_gap(pos);
+    memcpy(buf_ + gap_pos_, data, len);
+    if (change_) {
+        change_(row, (int)(pos - line_start(row)), data, len, true, change_user_);
+    }
+    // les lignes suivantes, relatives à la fin, ne bougent pas
+    for (size_t i = 0; i < len; i++) {
+        if (data[i] == '\n') {
+            idx_[front_++] = (uint32_t)(pos + i + 1);
+        }
+    }
+    gap_pos_ += len;
+    gap_len_ -= len;
+    len_ += len;
+    rev_++;
+    edited(row, 1, 1 + (int)lines);
+    return true;
+}
+
+void LineStore::erase(int row, int col, size_t len)
+{
+    size_t pos = pos_of(row, col);
+    if (len > len_ - pos) {
+        len = len_ - pos;
+    }
+    if (len == 0) {
+        return;
+    }
+    move_split((size_t)row + 1);
+    move_gap(pos);
+    const char* p = buf_ + gap_pos_ + gap_len_;
+    if (change_) {
+        change_(row, (int)(pos - line_start(row)), p, len, false, change_user_);
+    }
+    int lines = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] == '\n') {
+            back_--;
+            lines++;
+        }
+    }
+    gap_len_ += len;
+    len_ -= len;
+    rev_++;
+    edited(row, 1 + lines, 1);
+}
+
+bool LineStore::split_line(int row, int col)
+{
+    return insert(row, col, "\n", 1);
+}
+
+void LineStore::join_lines(int row)
+{
+    if (row + 1 < line_count()) {
+        erase(row, line_len(row), 1);
+    }
+}
+
+bool LineStore::insert_line(int row, const char* data, size_t len)
+{
+    const int count = line_count();
+    if (count == 0) {
+        return append_line(data, len);
+    }
+    if (row >= count) {
+        int last = count - 1;
+        return insert(last, line_len(last), "\n", 1) &&
+            insert(count, 0, data, len);
+    }
+    return insert(row, 0, data, len) && insert(row, (int)len, "\n", 1);
+}
+
+void LineStore::delete_line(int row)
+{
+    const int count = line_count();
+    if (row < 0 || row >= count) {
+        return;
+    }
+    if (count == 1) {
+        erase(0, 0, (size_t)line_len(0));
+    } else if (row + 1 < count) {
+        erase(row, 0, (size_t)line_len(row) + 1);
+    } else {
+        erase(row - 1, line_len(row - 1), (size_t)line_len(row) + 1);
+    }
+}
+
+// seul ce qui diffère entre l'ancienne et la nouvelle ligne est remplacé
+bool LineStore::set_line(int row, const char* data, size_t len)
+{
+    LineView old = line(row);
+    const size_t n = old.size();
+    size_t p = 0;
+    while (p < n && p < len && old[p] == data[p]) {
+        p++;
+    }
+    size_t s = 0;
+    while (s < n - p && s < len - p && old[n - 1 - s] == data[len - 1 - s]) {
+        s++;
+    }
+    erase(row, (int)p, n - p - s);
+    return insert(row, (int)p, data + p, len - p - s);
+}
+
+bool LineStore::append_line(const char* data, size_t len)
+{
+    const bool first = (line_count() == 0);
+    size_t need = len + (first ? 0 : 1);
+    if (!grow_text(need) || !grow_index(1)) {
+        return false;
+    }
+    move_split(front_ + back_);
+    move_gap(len_);
+    if (!first) {
+        buf_[gap_pos_++] = '\n';
+    }
+    idx_[front_++] = (uint32_t)gap_pos_;
+    if (len) {
+        memcpy(buf_ + gap_pos_, data, len);
+    }
+    gap_pos_ += len;
+    gap_len_ -= need;
+    len_ += need;
+    rev_++;
+    edited(line_count() - 1, 0, 1);
+    return true;
+}
+
+bool LineStore::append_text(const char* data, size_t len)
+{
+    const bool first = (line_count() == 0);
+    size_t breaks = 0;
+    for (const char* p = data; (p = static_cast<const char*>(
+             memchr(p, '\n', (size_t)(data + len - p)))); p++) {
+        breaks++;
+    }
+    if (!grow_text(len) || !grow_index(breaks + (first ? 1 : 0))) {
+        return false;
+    }
+    move_split(front_ + back_);
+    move_gap(len_);
+    const int row = first ? 0 : line_count() - 1;
+    if (first) {
+        idx_[front_++] = (uint32_t)gap_pos_;
+    }
+    if (len) {
+        memcpy(buf_ + gap_pos_, data, len);
+    }
+    for (const char* p = data; (p = static_cast<const char*>(
+             memchr(p, '\n', (size_t)(data + len - p)))); p++) {
+        idx_[front_++] = (uint32_t)(gap_pos_ + (size_t)(p - data) + 1);
+    }
+    gap_pos_ += len;
+    gap_len_ -= len;
+    len_ += len;
+    rev_++;
+    edited(row, first ? 0 : 1, 1 + (int)breaks);
+    return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// ------------------------------------------------------------
+// Texte de l'éditeur : tampon à trou + index des débuts de ligne
+// ------------------------------------------------------------
+//
+// Tout le document tient dans un seul bloc (lignes séparées par '\n'),
+// avec un trou à l'endroit de la dernière modification : une frappe,
+// un dd ou un o au même endroit ne déplacent rien. L'index des débuts
+// de ligne a lui aussi un trou, aligné sur la ligne modifiée : les
+// lignes avant sont en position absolue, celles après en distance à la
+// fin du texte, si bien qu'aucune entrée n'est réécrite lors d'une
+// édition. Déplacer l'un ou l'autre trou coûte la distance parcourue.
+
+// Ligne en lecture seule, en deux morceaux de part et d'autre du trou ;
+// valide jusqu'à la prochaine modification.
+struct LineView {
+    const char* a;
+    size_t na;
+    const char* b;
+    size_t nb;
+
+    size_t size() const { return na + nb; }
+    char operator[](size_t i) const { return i < na ? a[i] : b[i - na]; }
+};
+
+// appelé après chaque modification : lignes [row, row + removed)
+// remplacées par [row, row + added)
+typedef void (*LineEditFn)(int row, int removed, int added, void* user);
+// appelé à chaque insertion ou suppression (pas au chargement) : len
+// octets data insérés, ou sur le point d'être supprimés, en (row, col)
+typedef void (*LineChangeFn)(int row, int col, const char* data, size_t len,
+    bool insert, void* user);
+
+class LineStore {
+public:
+    LineStore();
+    ~LineStore();
+
+    // document vide (aucune ligne) ; garde la mémoire
+    void clear();
+    // libère tout (fermeture de l'éditeur)
+    void release();
+    // capacité pour bytes octets de texte (une seule allocation)
+    bool reserve(size_t bytes);
+    void set_edit_hook(LineEditFn fn, void* user);
+    void set_change_hook(LineChangeFn fn, void* user);
+
+    int line_count() const { return (int)(front_ + back_); }
+    // change à chaque modification du texte
+    uint32_t revision() const { return rev_; }
+    size_t size() const { return len_; }
+    int line_len(int row) const;
+    size_t line_start(int row) const;
+    // ligne contenant l'octet pos (recherche dichotomique)
+    int line_of(size_t pos) const;
+
+    LineView line(int row) const;
+    void get_line(int row, std::string& out) const;
+    char at(int row, int col) const;
+
+    // data peut contenir des '\n' (nouvelles lignes)
+    bool insert(int row, int col, const char* data, size_t len);
+    // len octets à partir de (row, col), '\n' compris
+    void erase(int row, int col, size_t len);
+
+    bool split_line(int row, int col);
+    void join_lines(int row);
+    // row == line_count() : ajoute à la fin
+    bool insert_line(int row, const char* data, size_t len);
+    void delete_line(int row);
+    bool set_line(int row, const char* data, size_t len);
+
+    // chargement : ajoute à la fin sans interpréter '\n'
+    bool append_line(const char* data, size_t len);
+    // chargement : texte brut ajouté à la fin, qui prolonge la dernière
+    // ligne ; chaque '\n' en commence une nouvelle
+    bool append_text(const char* data, size_t len);
+
+private:
+    LineStore(const LineStore&) = delete;
+    LineStore& operator=(const LineStore&) = delete;
+
+    char byte_at(size_t pos) const;
+    size_t pos_of(int row, int col) const;
+    void move_gap(size_t pos);
+    bool grow_text(size_t need);
+    bool grow_index(size_t need);
+    void move_split(size_t front);
+    void edited(int row, int removed, int added);
+
+    char* buf_;
+    size_t cap_;
+    size_t gap_pos_;            // position logique du trou
+    size_t gap_len_;
+    size_t len_;                // octets de texte (cap_ - gap_len_)
+
+    uint32_t* idx_;
+    size_t idx_cap_;
+    size_t front_;              // lignes [0, front_) : débuts absolus
+    size_t back_;               // lignes suivantes : len_ - début, en fin de idx_
+
+    uint32_t rev_;
+    LineEditFn hook_;
+    void* hook_user_;
+    LineChangeFn change_;
+    void* change_user_;
+};
@@ -0,0 +1,924 @@
+#include "regex.h"
+
+#include <string.h>
+#include <algorithm>
+
+static constexpr size_t kReMaxPattern = 256;
+static constexpr size_t kReMaxInsts = 2048;
+static constexpr int kReMaxDepth = 16;          // parenthèses imbriquées
+static constexpr size_t kReDfaBytes = 8 * 1024; // cache de chaque automate
+
+enum ReOp : uint8_t {
+    RE_SET,
+    RE_MATCH,
+    RE_JMP,
+    RE_SPLIT,
+    RE_SAVE,
+    RE_BOL,
+    RE_EOL,
+};
+
+enum : uint8_t {
+    DFA_MATCH = 1,              // occurrence ici
+    DFA_MATCH_EOL = 2,          // occurrence ici si c'est la fin de ligne
+    DFA_DEAD = 4,               // plus aucune occurrence possible
+};
+
+// ------------------------------------------------------------
+// Analyse du motif
+// ------------------------------------------------------------
+
+enum ReNodeKind : uint8_t {
+    N_EMPTY,
+    N_SET,
+    N_BOL,
+    N_EOL,
+    N_CAT,
+    N_ALT,
+    N_STAR,
+    N_PLUS,
+    N_QUEST,
+    N_GROUP,
+};
+
+// N_CAT / N_ALT : fils kids[first .. first + count) ; répétitions et
+// groupes : fils first
+struct ReNode {
+    uint8_t kind;
+    uint16_t arg;
+    uint32_t first;
+    uint32_t count;
+};
+
+class ReParser {
+public:
+    ReParser(const std::string& pattern, std::vector<uint8_t>& sets)
+        : error(nullptr), groups(0), p_(pattern), pos_(0), sets_(sets)
+    {
+    }
+
+    int parse(bool literal);
+
+    const char* error;
+    int groups;
+    std::vector<ReNode> nodes;
+    std::vector<uint32_t> kids;
+
+private:
+    int node(uint8_t kind, uint16_t arg, uint32_t first, uint32_t count);
+    int list(uint8_t kind, const std::vector<uint32_t>& items);
+    int set_node(const uint8_t* bits);
+    int fail(const char* msg);
+    int alt(int depth);
+    int cat(int depth);
+    int repeat(int depth);
+    int atom(int depth);
+    bool bracket(uint8_t* bits);
+    bool class_escape(char c, uint8_t* bits);
+
+    const std::string& p_;
+    size_t pos_;
+    std::vector<uint8_t>& sets_;
+};
+
+static void bits_add(uint8_t* bits, int lo, int hi)
+{
+    for (int c = lo; c <= hi; c++) {
+        bits[c >> 3] |= (uint8_t)(1u << (c & 7));
+    }
+}
+
+static void bits_invert(uint8_t* bits)
+{
+    for (int i = 0; i < 32; i++) {
+        bits[i] = (uint8_t)~bits[i];
+    }
+}
+
+int ReParser::node(uint8_t kind, uint16_t arg, uint32_t first, uint32_t count)
+{
+    ReNode n = { kind, arg, first, count };
+    nodes.push_back(n);
+    return (int)nodes.size() - 1;
+}
+
+int ReParser::list(uint8_t kind, const std::vector<uint32_t>& items)
+{
+    if (items.size() == 1) {
+        return (int)items[0];
+    }
+    uint32_t first = (uint32_t)kids.size();
+    kids.insert(kids.end(), items.begin(), items.end());
+    return node(kind, 0, first, (uint32_t)items.size());
+}
+
+// ensembles identiques partagés
+int ReParser::set_node(const uint8_t* bits)
+{
+    size_t n = sets_.size() / 32;
+    size_t i = 0;
+    while (i < n && memcmp(&sets_[i * 32], bits, 32) != 0) {
+        i++;
+    }
+    if (i == n) {
+        if (n >= 0xFFFF) {
+            return fail("pattern too long");
+        }
+        sets_.insert(sets_.end(), bits, bits + 32);
+    }
+    return node(N_SET, (uint16_t)i, 0, 0);
+}
+
+int ReParser::fail(const char* msg)
+{
+    if (!error) {
+        error = msg;
+    }
+    return -1;
+}
+
+int ReParser::parse(bool literal)
+{
+    if (literal) {
+        std::vector<uint32_t> items;
+        for (char ch : p_) {
+            uint8_t bits[32] = { 0 };
+            bits_add(bits, (uint8_t)ch, (uint8_t)ch);
+            int n = set_node(bits);
+            if (n < 0) return -1;
+            items.push_back((uint32_t)n);
+        }
+        return items.empty() ? node(N_EMPTY, 0, 0, 0) : list(N_CAT, items);
+    }
+    int root = alt(0);
+    if (root >= 0 && pos_ < p_.size()) {
+        return fail("unmatched )");
+    }
+    return root;
+}
+
+int ReParser::alt(int depth)
+{
+    if (depth > kReMaxDepth) {
+        return fail("too many ( )");
+    }
+    std::vector<uint32_t> items;
+    for (;;) {
+        int n = cat(depth);
+        if (n < 0) return -1;
+        items.push_back((uint32_t)n);
+        if (pos_ < p_.size() && p_[pos_] == '|') {
+            pos_++;
+            continue;
+        }
+        break;
+    }
+    return list(N_ALT, items);
+}
+
+int ReParser::cat(int depth)
+{
+    std::vector<uint32_t> items;
+    while (pos_ < p_.size() && p_[pos_] != '|' && p_[pos_] != ')') {
+        int n = repeat(depth);
+        if (n < 0) return -1;
+        items.push_back((uint32_t)n);
+    }
+    return items.empty() ? node(N_EMPTY, 0, 0, 0) : list(N_CAT, items);
+}
+
+int ReParser::repeat(int depth)
+{
+    int n = atom(depth);
+    while (n >= 0 && pos_ < p_.size()) {
+        char q = p_[pos_];
+        uint8_t kind = (q == '*') ? N_STAR : (q == '+') ? N_PLUS :
+            (q == '?') ? N_QUEST : N_EMPTY;
+        if (kind == N_EMPTY) {
+            break;
+        }
+        pos_++;
+        uint8_t k = nodes[n].kind;
+        if (k == N_BOL || k == N_EOL || k == N_EMPTY) {
+            return fail("nothing to repeat");
+        }
+        // a** = a*, a+? = a*... : pas de chaînes de répétitions
+        if (k == N_STAR || k == N_PLUS || k == N_QUEST) {
+            if (k != kind) {
+                nodes[n].kind = N_STAR;
+            }
+            continue;
+        }
+        n = node(kind, 0, (uint32_t)n, 0);
+    }
+    return n;
+}
+
+int ReParser::atom(int depth)
+{
+    char c = p_[pos_++];
+    uint8_t bits[32] = { 0 };
+    switch (c) {
+    case '(': {
+        int idx = ++groups;
+        int inner = alt(depth + 1);
+        if (inner < 0) return -1;
+        if (pos_ >= p_.size() || p_[pos_] != ')') {
+            return fail("unmatched (");
+        }
+        pos_++;
+        return node(N_GROUP, (uint16_t)idx, (uint32_t)inner, 0);
+    }
+    case '*':
+    case '+':
+    case '?':
+        return fail("nothing to repeat");
+    case '^':
+        return node(N_BOL, 0, 0, 0);
+    case '$':
+        return node(N_EOL, 0, 0, 0);
+    case '.':
+        bits_add(bits, 0, 255);
+        return set_node(bits);
+    case '[':
+        if (!bracket(bits)) return -1;
+        return set_node(bits);
+    case '\\':
+        if (pos_ >= p_.size()) {
+            return fail("trailing \\");
+        }
+        c = p_[pos_++];
+        if (c >= '0' && c <= '9') {
+            return fail("no \\N in pattern");
+        }
+        if (!class_escape(c, bits)) {
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                return fail("bad escape");
+            }
+            bits_add(bits, (uint8_t)c, (uint8_t)c);
+        }
+        return set_node(bits);
+    default:
+        bits_add(bits, (uint8_t)c, (uint8_t)c);
+        return set_node(bits);
+    }
+}
+
+// \d \w \s (et majuscules : complément), \t
+bool ReParser::class_escape(char c, uint8_t* bits)
+{
+    uint8_t b[32] = { 0 };
+    switch (c) {
+    case 'd': case 'D':
+        bits_add(b, '0', '9');
+        break;
+    case 'w': case 'W':
+        bits_add(b, '0', '9');
+        bits_add(b, 'a', 'z');
+        bits_add(b, 'A', 'Z');
+        bits_add(b, '_', '_');
+        break;
+    case 's': case 'S':
+        bits_add(b, ' ', ' ');
+        bits_add(b, '\t', '\r');
+        break;
+    case 't':
+        bits_add(b, '\t', '\t');
+        break;
+    default:
+        return false;
+    }
+    if (c == 'D' || c == 'W' || c == 'S') {
+        bits_invert(b);
+    }
+    for (int i = 0; i < 32; i++) {
+        bits[i] |= b[i];
+    }
+    return true;
+}
+
+bool ReParser::bracket(uint8_t* bits)
+{
+    bool negate = false;
+    if (pos_ < p_.size() && p_[pos_] == '^') {
+        negate = true;
+        pos_++;
+    }
+    bool first = true;
+    for (;;) {
+        if (pos_ >= p_.size()) {
+            fail("unmatched [");
+            return false;
+        }
+        int lo = (uint8_t)p_[pos_++];
+        if (lo == ']' && !first) {
+            break;
+        }
+        first = false;
+        if (lo == '\\' && pos_ < p_.size()) {
+            char e = p_[pos_++];
+            if (class_escape(e, bits)) {
+                continue;
+            }
+            lo = (uint8_t)e;
+        }
+        int hi = lo;
+        if (pos_ + 1 < p_.size() && p_[pos_] == '-' && p_[pos_ + 1] != ']') {
+            hi = (uint8_t)p_[pos_ + 1];
+            pos_ += 2;
+            if (hi == '\\' && pos_ < p_.size()) {
+                hi = (uint8_t)p_[pos_++];
+            }
+            if (hi < lo) {
+                fail("bad range");
+                return false;
+            }
+        }
+        bits_add(bits, lo, hi);
+    }
+    if (negate) {
+        bits_invert(bits);
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// Programme (Thompson), à l'endroit ou à l'envers
+// ------------------------------------------------------------
+
+class ReEmitter {
+public:
+    ReEmitter(const ReParser& ps, bool reverse, std::vector<ReInst>& prog)
+        : ps_(ps), rev_(reverse), prog_(prog), full_(false)
+    {
+    }
+
+    bool emit(uint32_t n);
+    uint16_t inst(uint8_t op, uint16_t arg, uint16_t x, uint16_t y);
+    uint16_t pc() const { return (uint16_t)prog_.size(); }
+    bool full() const { return full_; }
+
+private:
+    const ReParser& ps_;
+    bool rev_;
+    std::vector<ReInst>& prog_;
+    bool full_;
+};
+
+uint16_t ReEmitter::inst(uint8_t op, uint16_t arg, uint16_t x, uint16_t y)
+{
+    if (prog_.size() >= kReMaxInsts) {
+        full_ = true;
+        return 0;
+    }
+    ReInst in = { op, arg, x, y };
+    prog_.push_back(in);
+    return (uint16_t)(prog_.size() - 1);
+}
+
+bool ReEmitter::emit(uint32_t n)
+{
+    const ReNode& nd = ps_.nodes[n];
+    uint16_t l;
+    switch (nd.kind) {
+    case N_EMPTY:
+        break;
+    case N_SET:
+        inst(RE_SET, nd.arg, pc() + 1, 0);
+        break;
+    // à l'envers, le début de ligne est atteint en dernier
+    case N_BOL:
+        inst(rev_ ? RE_EOL : RE_BOL, 0, pc() + 1, 0);
+        break;
+    case N_EOL:
+        inst(rev_ ? RE_BOL : RE_EOL, 0, pc() + 1, 0);
+        break;
+    case N_CAT:
+        for (uint32_t i = 0; i < nd.count; i++) {
+            uint32_t k = rev_ ? nd.first + nd.count - 1 - i : nd.first + i;
+            if (!emit(ps_.kids[k])) return false;
+        }
+        break;
+    case N_ALT: {
+        std::vector<uint16_t> jumps;
+        for (uint32_t i = 0; i < nd.count; i++) {
+            bool last = (i + 1 == nd.count);
+            uint16_t split = 0;
+            if (!last) {
+                split = inst(RE_SPLIT, 0, pc() + 1, 0);
+            }
+            if (!emit(ps_.kids[nd.first + i])) return false;
+            if (!last) {
+                jumps.push_back(inst(RE_JMP, 0, 0, 0));
+                if (!full_) prog_[split].y = pc();
+            }
+        }
+        for (uint16_t j : jumps) {
+            if (!full_) prog_[j].x = pc();
+        }
+        break;
+    }
+    case N_STAR:
+        l = inst(RE_SPLIT, 0, pc() + 1, 0);
+        if (!emit(nd.first)) return false;
+        inst(RE_JMP, 0, l, 0);
+        if (!full_) prog_[l].y = pc();
+        break;
+    case N_PLUS:
+        l = pc();
+        if (!emit(nd.first)) return false;
+        inst(RE_SPLIT, 0, l, pc() + 1);
+        break;
+    case N_QUEST:
+        l = inst(RE_SPLIT, 0, pc() + 1, 0);
+        if (!emit(nd.first)) return false;
+        if (!full_) prog_[l].y = pc();
+        break;
+    case N_GROUP: {
+        bool save = !rev_ && nd.arg <= kReMaxGroups;
+        if (save) inst(RE_SAVE, (uint16_t)(2 * nd.arg), pc() + 1, 0);
+        if (!emit(nd.first)) return false;
+        if (save) inst(RE_SAVE, (uint16_t)(2 * nd.arg + 1), pc() + 1, 0);
+        break;
+    }
+    }
+    return !full_;
+}
+
+// ------------------------------------------------------------
+// Compilation
+// ------------------------------------------------------------
+
+Regex::Regex()
+    : error_(nullptr),
+      groups_(0),
+      text_(""),
+      len_(0),
+      gen_(0)
+{
+    memset(cls_, 0, sizeof(cls_));
+    fwd_.prog = nullptr;
+    rev_.prog = nullptr;
+}
+
+bool Regex::compile(const std::string& pattern, bool literal)
+{
+    error_ = nullptr;
+    groups_ = 0;
+    sets_.clear();
+    fwd_prog_.clear();
+    rev_prog_.clear();
+    if (pattern.size() > kReMaxPattern) {
+        error_ = "pattern too long";
+        return false;
+    }
+
+    ReParser ps(pattern, sets_);
+    int root = ps.parse(literal);
+    if (root < 0) {
+        error_ = ps.error;
+        return false;
+    }
+
+    ReEmitter fwd(ps, false, fwd_prog_);
+    fwd.inst(RE_SAVE, 0, 1, 0);
+    fwd.emit((uint32_t)root);
+    fwd.inst(RE_SAVE, 1, fwd.pc() + 1, 0);
+    fwd.inst(RE_MATCH, 0, 0, 0);
+    ReEmitter rev(ps, true, rev_prog_);
+    rev.emit((uint32_t)root);
+    rev.inst(RE_MATCH, 0, 0, 0);
+    if (fwd.full() || rev.full()) {
+        fwd_prog_.clear();
+        rev_prog_.clear();
+        error_ = "pattern too long";
+        return false;
+    }
+
+    groups_ = ps.groups;
+    build_classes();
+    mark_.assign(std::max(fwd_prog_.size(), rev_prog_.size()), 0);
+    gen_ = 0;
+    dfa_reset(fwd_, &fwd_prog_, false);
+    dfa_reset(rev_, &rev_prog_, true);
+    return true;
+}
+
+bool Regex::set_has(uint16_t set, uint8_t c) const
+{
+    return (sets_[(size_t)set * 32 + (c >> 3)] >> (c & 7)) & 1;
+}
+
+// octets que le motif ne distingue jamais : même classe, une seule
+// colonne par classe dans les tables de l'automate
+void Regex::build_classes()
+{
+    const size_t nsets = sets_.size() / 32;
+    cls_[0] = 0;
+    cls_rep_.assign(1, 0);
+    for (int c = 1; c < 256; c++) {
+        bool cut = false;
+        for (size_t s = 0; s < nsets && !cut; s++) {
+            cut = set_has((uint16_t)s, (uint8_t)c) != set_has((uint16_t)s, (uint8_t)(c - 1));
+        }
+        cls_[c] = (uint8_t)(cls_[c - 1] + (cut ? 1 : 0));
+        if (cut) {
+            cls_rep_.push_back((uint8_t)c);
+        }
+    }
+}
+
+// ------------------------------------------------------------
+// Automate déterministe paresseux
+// ------------------------------------------------------------
+
+// transitions vides depuis pc ; ajoute à out les instructions qui
+// attendent un octet (RE_SET), la fin de ligne (RE_EOL) ou RE_MATCH
+void Regex::closure(const std::vector<ReInst>& prog, uint16_t pc, bool bol,
+    std::vector<uint16_t>& out)
+{
+    stack_.clear();
+    stack_.push_back(pc);
+    while (!stack_.empty()) {
+        uint16_t p = stack_.back();
+        stack_.pop_back();
+        if (mark_[p] == gen_) {
+            continue;
+        }
+        mark_[p] = gen_;
+        const ReInst& in = prog[p];
+        switch (in.op) {
+        case RE_JMP:
+        case RE_SAVE:
+            stack_.push_back(in.x);
+            break;
+        case RE_SPLIT:
+            stack_.push_back(in.y);
+            stack_.push_back(in.x);
+            break;
+        case RE_BOL:
+            if (bol) {
+                stack_.push_back(in.x);
+            }
+            break;
+        default:
+            out.push_back(p);
+            break;
+        }
+    }
+}
+
+static void next_gen(std::vector<uint32_t>& mark, uint32_t& gen)
+{
+    if (++gen == 0) {
+        std::fill(mark.begin(), mark.end(), 0);
+        gen = 1;
+    }
+}
+
+void Regex::dfa_reset(ReDfa& d, const std::vector<ReInst>* prog, bool unanchored)
+{
+    d.prog = prog;
+    d.unanchored = unanchored;
+    d.max_states = kReDfaBytes / (cls_rep_.size() * sizeof(int16_t) + 16);
+    if (d.max_states < 8) d.max_states = 8;
+    d.epoch = 0;
+    dfa_flush(d);
+}
+
+// cache plein : on repart de zéro, les états utiles reviennent vite
+void Regex::dfa_flush(ReDfa& d)
+{
+    d.leaves.clear();
+    d.leaf_off.assign(1, 0);
+    d.flags.clear();
+    d.next.clear();
+    d.ids.clear();
+    d.start[0] = -1;
+    d.start[1] = -1;
+    d.epoch++;
+}
+
+// bol : état de départ en début de ligne, où une ligne vide satisfait
+// aussi les ^ placés après un $ ; il a donc sa propre clé
+int Regex::dfa_add(ReDfa& d, std::vector<uint16_t>& leaves, bool bol)
+{
+    std::sort(leaves.begin(), leaves.end());
+    leaves.erase(std::unique(leaves.begin(), leaves.end()), leaves.end());
+    std::string key(reinterpret_cast<const char*>(leaves.data()),
+        leaves.size() * sizeof(uint16_t));
+    if (bol) {
+        key += '^';
+    }
+    auto it = d.ids.find(key);
+    if (it != d.ids.end()) {
+        return it->second;
+    }
+    if (d.flags.size() >= d.max_states) {
+        dfa_flush(d);
+    }
+
+    const std::vector<ReInst>& prog = *d.prog;
+    uint8_t f = leaves.empty() ? DFA_DEAD : 0;
+    for (uint16_t p : leaves) {
+        if (prog[p].op == RE_MATCH) {
+            f |= DFA_MATCH | DFA_MATCH_EOL;
+        }
+    }
+    if (!(f & DFA_MATCH)) {
+        // en fin de ligne, les $ en attente sont franchis ; jusqu'au
+        // point fixe, car $^$ peut alterner sur une ligne vide
+        next_gen(mark_, gen_);
+        eol_tmp_.clear();
+        for (uint16_t p : leaves) {
+            if (prog[p].op == RE_EOL) {
+                closure(prog, prog[p].x, bol, eol_tmp_);
+            }
+        }
+        for (size_t i = 0; i < eol_tmp_.size(); i++) {
+            const ReInst& in = prog[eol_tmp_[i]];
+            if (in.op == RE_MATCH) {
+                f |= DFA_MATCH_EOL;
+                break;
+            }
+            if (in.op == RE_EOL) {
+                closure(prog, in.x, bol, eol_tmp_);
+            }
+        }
+    }
+
+    int id = (int)d.flags.size();
+    d.leaves.insert(d.leaves.end(), leaves.begin(), leaves.end());
+    d.leaf_off.push_back((uint32_t)d.leaves.size());
+    d.flags.push_back(f);
+    d.next.resize(d.next.size() + cls_rep_.size(), -1);
+    d.ids.emplace(std::move(key), id);
+    return id;
+}
+
+int Regex::dfa_start(ReDfa& d, bool bol)
+{
+    if (d.start[bol] < 0) {
+        next_gen(mark_, gen_);
+        tmp_.clear();
+        closure(*d.prog, 0, bol, tmp_);
+        int s = dfa_add(d, tmp_, bol);
+        d.start[bol] = s;
+    }
+    return d.start[bol];
+}
+
+int Regex::dfa_step(ReDfa& d, int s, uint8_t c)
+{
+    const size_t ncls = cls_rep_.size();
+    const size_t slot = (size_t)s * ncls + cls_[c];
+    int t = d.next[slot];
+    if (t >= 0) {
+        return t;
+    }
+
+    const std::vector<ReInst>& prog = *d.prog;
+    next_gen(mark_, gen_);
+    tmp_.clear();
+    for (uint32_t i = d.leaf_off[s]; i < d.leaf_off[s + 1]; i++) {
+        const ReInst& in = prog[d.leaves[i]];
+        if (in.op == RE_SET && set_has(in.arg, c)) {
+            closure(prog, in.x, false, tmp_);
+        }
+    }
+    if (d.unanchored) {
+        closure(prog, 0, false, tmp_);
+    }
+    uint32_t epoch = d.epoch;
+    t = dfa_add(d, tmp_, false);
+    if (d.epoch == epoch) {
+        d.next[slot] = (int16_t)t;
+    }
+    return t;
+}
+
+// ------------------------------------------------------------
+// Recherche dans une ligne
+// ------------------------------------------------------------
+
+// une passe à l'envers : starts_[p] si une occurrence commence en p
+bool Regex::scan(const char* text, size_t len)
+{
+    text_ = text;
+    len_ = len;
+    starts_.assign(len + 1, 0);
+    if (!valid()) {
+        return false;
+    }
+    bool any = false;
+    int s = dfa_start(rev_, true);
+    size_t p = len;
+    for (;;) {
+        uint8_t f = rev_.flags[s];
+        if ((f & DFA_MATCH) || (p == 0 && (f & DFA_MATCH_EOL))) {
+            starts_[p] = 1;
+            any = true;
+        }
+        if (p == 0) {
+            break;
+        }
+        p--;
+        s = dfa_step(rev_, s, (uint8_t)text[p]);
+    }
+    return any;
+}
+
+// fin de la plus longue occurrence commençant en start, -1 si aucune
+int Regex::extend(size_t start)
+{
+    int last = -1;
+    int s = dfa_start(fwd_, start == 0);
+    size_t p = start;
+    for (;;) {
+        uint8_t f = fwd_.flags[s];
+        if ((f & DFA_MATCH) || (p == len_ && (f & DFA_MATCH_EOL))) {
+            last = (int)p;
+        }
+        if (p == len_ || (f & DFA_DEAD)) {
+            break;
+        }
+        s = dfa_step(fwd_, s, (uint8_t)text_[p]);
+        p++;
+    }
+    return last;
+}
+
+void Regex::fill_match(size_t start, int end, ReMatch& m) const
+{
+    m.cap[0] = (int)start;
+    m.cap[1] = end;
+    for (int i = 2; i < 2 * (kReMaxGroups + 1); i++) {
+        m.cap[i] = -2;          // groupes pas encore calculés
+    }
+}
+
+bool Regex::next(size_t from, ReMatch& m)
+{
+    for (size_t p = from; p <= len_; p++) {
+        if (starts_[p]) {
+            int end = extend(p);
+            if (end >= 0) {
+                fill_match(p, end, m);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Regex::prev(size_t before, ReMatch& m)
+{
+    if (before > len_ + 1) before = len_ + 1;
+    for (size_t p = before; p > 0; p--) {
+        if (starts_[p - 1]) {
+            int end = extend(p - 1);
+            if (end >= 0) {
+                fill_match(p - 1, end, m);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// ------------------------------------------------------------
+// Groupes : machine de Pike sur l'occurrence seule
+// ------------------------------------------------------------
+
+namespace {
+struct PikeJob {
+    uint16_t pc;
+    int16_t slot;               // >= 0 : restaurer cap[slot] = old
+    int old;
+};
+}
+
+void Regex::captures(ReMatch& m)
+{
+    const int ncap = 2 * (std::min(groups_, kReMaxGroups) + 1);
+    for (int i = 2; i < 2 * (kReMaxGroups + 1); i++) {
+        m.cap[i] = -1;
+    }
+    if (groups_ == 0) {
+        return;
+    }
+
+    const std::vector<ReInst>& prog = fwd_prog_;
+    const size_t start = (size_t)m.cap[0];
+    const size_t end = (size_t)m.cap[1];
+    std::vector<uint16_t> clist, nlist;
+    std::vector<int> ccaps, ncaps;
+    std::vector<int> caps((size_t)ncap, -1);
+    std::vector<PikeJob> jobs;
+
+    // ajoute les fils de pc par ordre de priorité, avec les cases de caps
+    auto add = [&](std::vector<uint16_t>& list, std::vector<int>& lcaps,
+                   uint16_t pc0, size_t pos) {
+        jobs.push_back({ pc0, -1, 0 });
+        while (!jobs.empty()) {
+            PikeJob j = jobs.back();
+            jobs.pop_back();
+            if (j.slot >= 0) {
+                caps[(size_t)j.slot] = j.old;
+                continue;
+            }
+            if (mark_[j.pc] == gen_) {
+                continue;
+            }
+            mark_[j.pc] = gen_;
+            const ReInst& in = prog[j.pc];
+            switch (in.op) {
+            case RE_JMP:
+                jobs.push_back({ in.x, -1, 0 });
+                break;
+            case RE_SPLIT:
+                jobs.push_back({ in.y, -1, 0 });
+                jobs.push_back({ in.x, -1, 0 });
+                break;
+            case RE_SAVE:
+                if (in.arg < ncap) {
+                    jobs.push_back({ 0, (int16_t)in.arg, caps[in.arg] });
+                    caps[in.arg] = (int)pos;
+                }
+                jobs.push_back({ in.x, -1, 0 });
+                break;
+            case RE_BOL:
+                if (pos == 0) jobs.push_back({ in.x, -1, 0 });
+                break;
+            case RE_EOL:
+                if (pos == len_) jobs.push_back({ in.x, -1, 0 });
+                break;
+            default:
+                list.push_back(j.pc);
+                lcaps.insert(lcaps.end(), caps.begin(), caps.end());
+                break;
+            }
+        }
+    };
+
+    next_gen(mark_, gen_);
+    add(clist, ccaps, 0, start);
+    for (size_t pos = start;; pos++) {
+        next_gen(mark_, gen_);
+        nlist.clear();
+        ncaps.clear();
+        for (size_t i = 0; i < clist.size(); i++) {
+            const ReInst& in = prog[clist[i]];
+            const int* tc = &ccaps[i * (size_t)ncap];
+            if (in.op == RE_MATCH) {
+                // la première qui finit au bon endroit l'emporte
+                if (pos == end) {
+                    memcpy(m.cap, tc, sizeof(int) * (size_t)ncap);
+                    return;
+                }
+                continue;
+            }
+            if (pos < end && set_has(in.arg, (uint8_t)text_[pos])) {
+                caps.assign(tc, tc + ncap);
+                add(nlist, ncaps, in.x, pos + 1);
+            }
+        }
+        if (pos >= end || nlist.empty()) {
+            break;
+        }
+        clist.swap(nlist);
+        ccaps.swap(ncaps);
+    }
+}
+
+// ------------------------------------------------------------
+// Remplacement
+// ------------------------------------------------------------
+
+void Regex::expand(ReMatch& m, const std::string& repl, std::string& out)
+{
+    for (size_t i = 0; i < repl.size(); i++) {
+        char c = repl[i];
+        int group = -1;
+        if (c == '&') {
+            group = 0;
+        } else if (c == '\\' && i + 1 < repl.size()) {
+            c = repl[++i];
+            if (c >= '0' && c <= '9') {
+                group = c - '0';
+            }
+        }
+        if (group < 0) {
+            out += c;
+            continue;
+        }
+        if (group > 0 && m.cap[2] == -2) {
+            captures(m);
+        }
+        int a = m.cap[2 * group];
+        int b = m.cap[2 * group + 1];
+        if (a >= 0 && b >= a) {
+            out.append(text_ + a, (size_t)(b - a));
+        }
+    }
+}
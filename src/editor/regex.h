@@ -0,0 +1,112 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// ------------------------------------------------------------
+// Expressions régulières de l'éditeur (recherche, :s)
+// ------------------------------------------------------------
+//
+// Syntaxe étendue : . [..] [^..] \d \w \s \D \W \S \t ^ $ * + ? ( ) |,
+// et dans le remplacement & (ou \0) pour l'occurrence, \1..\9 pour les
+// groupes. Le motif est compilé en automate de Thompson, parcouru sous
+// forme d'automate déterministe construit à la demande : chaque état
+// n'est calculé qu'une fois, dans un cache borné vidé quand il est
+// plein. Pas de retour arrière : le temps reste linéaire en la taille
+// du texte quel que soit le motif.
+//
+// Une ligne est lue une fois à l'envers pour marquer les positions où
+// une occurrence peut commencer ; chaque occurrence est ensuite étendue
+// vers l'avant (la plus longue). Les groupes ne sont calculés que sur
+// l'occurrence elle-même, et seulement si le remplacement les utilise.
+
+static constexpr int kReMaxGroups = 9;
+
+struct ReMatch {
+    // cap[0], cap[1] : occurrence ; cap[2k], cap[2k + 1] : groupe k
+    // (-1 si le groupe n'a rien pris)
+    int cap[2 * (kReMaxGroups + 1)];
+};
+
+struct ReInst {
+    uint8_t op;
+    uint16_t arg;               // ensemble (RE_SET), case (RE_SAVE)
+    uint16_t x;                 // suite
+    uint16_t y;                 // seconde branche de RE_SPLIT
+};
+
+// automate déterministe paresseux sur un programme
+struct ReDfa {
+    const std::vector<ReInst>* prog;
+    bool unanchored;            // relance le motif à chaque position
+    size_t max_states;
+
+    std::vector<uint16_t> leaves;       // instructions de chaque état
+    std::vector<uint32_t> leaf_off;     // état i : [leaf_off[i], leaf_off[i + 1])
+    std::vector<uint8_t> flags;
+    std::vector<int16_t> next;          // état * classes ; -1 inconnu
+    std::unordered_map<std::string, int> ids;
+    int start[2];                       // début de ligne ou non
+    uint32_t epoch;                     // change à chaque vidage
+};
+
+class Regex {
+public:
+    Regex();
+
+    // literal : le motif est pris tel quel (recherche nano)
+    bool compile(const std::string& pattern, bool literal);
+    const char* error() const { return error_; }
+    bool valid() const { return !fwd_prog_.empty(); }
+    int groups() const { return groups_; }
+
+    // prépare la recherche dans une ligne ; false si aucune occurrence
+    bool scan(const char* text, size_t len);
+    // occurrence commençant en from ou après / strictement avant before
+    bool next(size_t from, ReMatch& m);
+    bool prev(size_t before, ReMatch& m);
+    // ajoute à out le remplacement de l'occurrence m
+    void expand(ReMatch& m, const std::string& repl, std::string& out);
+
+private:
+    Regex(const Regex&) = delete;
+    Regex& operator=(const Regex&) = delete;
+
+    bool set_has(uint16_t set, uint8_t c) const;
+    void build_classes();
+    void closure(const std::vector<ReInst>& prog, uint16_t pc, bool bol,
+        std::vector<uint16_t>& out);
+    void dfa_reset(ReDfa& d, const std::vector<ReInst>* prog, bool unanchored);
+    void dfa_flush(ReDfa& d);
+    int dfa_add(ReDfa& d, std::vector<uint16_t>& leaves, bool bol);
+    int dfa_start(ReDfa& d, bool bol);
+    int dfa_step(ReDfa& d, int s, uint8_t c);
+    int extend(size_t start);
+    void captures(ReMatch& m);
+    void fill_match(size_t start, int end, ReMatch& m) const;
+
+    const char* error_;
+    int groups_;
+    std::vector<uint8_t> sets_;         // 32 octets (256 bits) par ensemble
+    uint8_t cls_[256];                  // octet -> classe
+    std::vector<uint8_t> cls_rep_;      // classe -> un octet représentant
+    std::vector<ReInst> fwd_prog_;
+    std::vector<ReInst> rev_prog_;
+    ReDfa fwd_;
+    ReDfa rev_;
+
+    // ligne en cours
+    const char* text_;
+    size_t len_;
+    std::vector<uint8_t> starts_;       // une occurrence commence ici
+
+    // espaces de travail
+    std::vector<uint32_t> mark_;
+    uint32_t gen_;
+    std::vector<uint16_t> stack_;
+    std::vector<uint16_t> tmp_;
+    std::vector<uint16_t> eol_tmp_;
+};
@@ -0,0 +1,146 @@
+#include "row_index.h"
+
+static inline size_t low_bit(size_t i)
+{
+    return i & (~i + 1);
+}
+
+RowIndex::RowIndex()
+    : valid_(0)
+{
+}
+
+void RowIndex::release()
+{
+    std::vector<uint16_t>().swap(rows_);
+    std::vector<uint32_t>().swap(sums_);
+    std::vector<uint32_t>().swap(tree_);
+    valid_ = 0;
+}
+
+// ------------------------------------------------------------
+// Mise à jour
+// ------------------------------------------------------------
+
+void RowIndex::replace(int row, int removed, int added)
+{
+    if (removed == added) {
+        return;
+    }
+    // les lignes gardées conservent leur compte : set() corrigera
+    size_t r = (size_t)row;
+    if (added > removed) {
+        rows_.insert(rows_.begin() + (r + removed), (size_t)(added - removed), 0);
+    } else {
+        rows_.erase(rows_.begin() + (r + added), rows_.begin() + (r + removed));
+    }
+
+    // les blocs suivants ont glissé : sommes refaites, arbre invalidé
+    const size_t n = rows_.size();
+    const size_t nb = (n + kRowBlock - 1) / kRowBlock;
+    const size_t first = r / kRowBlock;
+    sums_.resize(nb);
+    tree_.resize(nb + 1);
+    for (size_t k = first; k < nb; k++) {
+        size_t end = (k + 1) * kRowBlock;
+        if (end > n) end = n;
+        uint32_t s = 0;
+        for (size_t i = k * kRowBlock; i < end; i++) {
+            s += rows_[i];
+        }
+        sums_[k] = s;
+    }
+    if (valid_ > first) {
+        valid_ = first;
+    }
+}
+
+void RowIndex::set(int row, int rows)
+{
+    if (rows > 0xFFFF) rows = 0xFFFF;
+    size_t r = (size_t)row;
+    int delta = rows - (int)rows_[r];
+    if (delta == 0) {
+        return;
+    }
+    rows_[r] = (uint16_t)rows;
+    size_t b = r / kRowBlock;
+    sums_[b] += (uint32_t)delta;
+    for (size_t i = b + 1; i <= valid_; i += low_bit(i)) {
+        tree_[i] += (uint32_t)delta;
+    }
+}
+
+// nœuds au-delà de valid_ : chacun est son bloc plus ses fils
+void RowIndex::rebuild()
+{
+    const size_t nb = sums_.size();
+    for (size_t i = valid_ + 1; i <= nb; i++) {
+        uint32_t s = sums_[i - 1];
+        size_t low = low_bit(i);
+        for (size_t m = 1; m < low; m <<= 1) {
+            s += tree_[i - m];
+        }
+        tree_[i] = s;
+    }
+    valid_ = nb;
+}
+
+// ------------------------------------------------------------
+// Requêtes
+// ------------------------------------------------------------
+
+int RowIndex::prefix(int row)
+{
+    if (row <= 0) {
+        return 0;
+    }
+    size_t r = (size_t)row;
+    if (r > rows_.size()) r = rows_.size();
+    size_t b = r / kRowBlock;
+    if (b > valid_) {
+        rebuild();
+    }
+    uint32_t s = 0;
+    for (size_t i = b; i > 0; i -= low_bit(i)) {
+        s += tree_[i];
+    }
+    for (size_t k = b * kRowBlock; k < r; k++) {
+        s += rows_[k];
+    }
+    return (int)s;
+}
+
+bool RowIndex::find(int abs, int& row, int& sub)
+{
+    const size_t nb = sums_.size();
+    if (valid_ < nb) {
+        rebuild();
+    }
+    uint32_t rem = abs > 0 ? (uint32_t)abs : 0;
+
+    // descente : blocs entiers tant que leur somme tient dans rem
+    size_t pos = 0;
+    size_t step = 1;
+    while (step * 2 <= nb) {
+        step *= 2;
+    }
+    for (; step > 0; step >>= 1) {
+        if (pos + step <= nb && tree_[pos + step] <= rem) {
+            pos += step;
+            rem -= tree_[pos];
+        }
+    }
+
+    size_t r = pos * kRowBlock;
+    while (r < rows_.size() && rem >= rows_[r]) {
+        rem -= rows_[r];
+        r++;
+    }
+    if (r >= rows_.size()) {
+        return false;
+    }
+    row = (int)r;
+    sub = (int)rem;
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// ------------------------------------------------------------
+// Lignes d'écran par ligne de texte (retour à la ligne visuel)
+// ------------------------------------------------------------
+//
+// Le nombre de lignes d'écran de chaque ligne est gardé sur 16 bits,
+// et un arbre de Fenwick somme ces nombres par blocs de kRowBlock
+// lignes : ligne -> rang d'écran et rang -> ligne coûtent O(log n),
+// plus un parcours d'au plus un bloc. Modifier une ligne met l'arbre à
+// jour en O(log n) ; insérer ou supprimer des lignes décale les blocs
+// suivants, recalculés seulement à la requête suivante qui les touche.
+
+static constexpr int kRowBlock = 32;
+
+class RowIndex {
+public:
+    RowIndex();
+
+    // libère la mémoire (fermeture de l'éditeur)
+    void release();
+
+    // lignes [row, row + removed) remplacées par added lignes, à
+    // renseigner ensuite avec set()
+    void replace(int row, int removed, int added);
+    void set(int row, int rows);
+
+    int line_rows(int row) const { return rows_[(size_t)row]; }
+    // rangs d'écran des lignes [0, row)
+    int prefix(int row);
+    // ligne contenant le rang abs, et rang dans cette ligne ; false
+    // au-delà de la dernière ligne
+    bool find(int abs, int& row, int& sub);
+
+private:
+    void rebuild();
+
+    std::vector<uint16_t> rows_;    // par ligne
+    std::vector<uint32_t> sums_;    // par bloc
+    std::vector<uint32_t> tree_;    // Fenwick sur sums_, indices 1..n
+    size_t valid_;                  // blocs [0, valid_) à jour dans tree_
+};
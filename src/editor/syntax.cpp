@@ -0,0 +1,230 @@
+#include "syntax.h"
+
+#include <string.h>
+
+// ------------------------------------------------------------
+// Lexer d'une ligne
+// ------------------------------------------------------------
+
+static const char* const kLxKeywords[] = {
+    "as", "break", "case", "continue", "default", "do", "else", "elseif",
+    "false", "for", "foreach", "function", "global", "if", "include",
+    "null", "return", "switch", "true", "unset", "while",
+};
+
+static constexpr size_t kLxKeywordMax = 8;
+
+static bool is_digit(uint8_t c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool is_name_start(uint8_t c)
+{
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool is_name_char(uint8_t c)
+{
+    return is_name_start(c) || is_digit(c);
+}
+
+static bool is_keyword(const char* word, size_t len)
+{
+    for (size_t k = 0; k < sizeof(kLxKeywords) / sizeof(kLxKeywords[0]); k++) {
+        const char* kw = kLxKeywords[k];
+        if (strlen(kw) == len && memcmp(kw, word, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// nom de jeton pour [from, to) : mot-clé, constante ou simple nom
+static uint8_t name_class(const LineView& line, size_t from, size_t to)
+{
+    size_t len = to - from;
+    bool upper = false;
+    bool lower = false;
+    char word[kLxKeywordMax];
+    for (size_t i = from; i < to; i++) {
+        char c = line[i];
+        if (c >= 'a' && c <= 'z') lower = true;
+        if (c >= 'A' && c <= 'Z') upper = true;
+        if (len <= kLxKeywordMax) word[i - from] = c;
+    }
+    if (!upper && len <= kLxKeywordMax && is_keyword(word, len)) {
+        return SYN_KEYWORD;
+    }
+    return (upper && !lower && len > 1) ? SYN_CONSTANT : SYN_TEXT;
+}
+
+uint8_t syntax_lex_line(const LineView& line, uint8_t state, uint8_t* cls)
+{
+    const size_t n = line.size();
+    size_t i = 0;
+    while (i < n) {
+        size_t j = i;
+        uint8_t kind;
+        if (state == SYN_IN_COMMENT) {
+            while (j < n && !(line[j] == '*' && j + 1 < n && line[j + 1] == '/')) {
+                j++;
+            }
+            if (j < n) {
+                j += 2;
+                state = SYN_IN_CODE;
+            }
+            kind = SYN_COMMENT;
+        } else if (state == SYN_IN_DQUOTE || state == SYN_IN_SQUOTE) {
+            char quote = (state == SYN_IN_DQUOTE) ? '"' : '\'';
+            while (j < n) {
+                char c = line[j++];
+                if (c == '\\') {
+                    j++;
+                } else if (c == quote) {
+                    state = SYN_IN_CODE;
+                    break;
+                }
+            }
+            if (j > n) j = n;
+            kind = SYN_STRING;
+        } else {
+            uint8_t c = (uint8_t)line[i];
+            uint8_t next = (i + 1 < n) ? (uint8_t)line[i + 1] : 0;
+            j = i + 1;
+            if (c == '/' && next == '/') {
+                j = n;
+                kind = SYN_COMMENT;
+            } else if (c == '/' && next == '*') {
+                j = i + 2;
+                state = SYN_IN_COMMENT;
+                kind = SYN_COMMENT;
+            } else if (c == '"' || c == '\'') {
+                state = (c == '"') ? SYN_IN_DQUOTE : SYN_IN_SQUOTE;
+                kind = SYN_STRING;
+            } else if (c == '$' && is_name_start(next)) {
+                while (j < n && is_name_char((uint8_t)line[j])) j++;
+                kind = SYN_VARIABLE;
+            } else if (is_digit(c) || (c == '.' && is_digit(next))) {
+                // 12, 0x1F, 1.5e-3
+                while (j < n) {
+                    uint8_t d = (uint8_t)line[j];
+                    uint8_t e = (uint8_t)line[j - 1];
+                    if (is_name_char(d) || d == '.' ||
+                        ((d == '+' || d == '-') && (e == 'e' || e == 'E'))) {
+                        j++;
+                    } else {
+                        break;
+                    }
+                }
+                kind = SYN_NUMBER;
+            } else if (is_name_start(c)) {
+                while (j < n && is_name_char((uint8_t)line[j])) j++;
+                kind = name_class(line, i, j);
+            } else {
+                kind = SYN_TEXT;
+            }
+        }
+        if (cls) {
+            memset(cls + i, kind, j - i);
+        }
+        i = j;
+    }
+    return state;
+}
+
+// ------------------------------------------------------------
+// États par ligne
+// ------------------------------------------------------------
+
+SyntaxCache::SyntaxCache()
+    : known_(0)
+    , dirty_on_(false)
+    , dirty_(0)
+    , settle_(0)
+{
+}
+
+void SyntaxCache::release()
+{
+    std::vector<uint8_t>().swap(start_);
+    known_ = 0;
+    dirty_on_ = false;
+}
+
+void SyntaxCache::replace(int row, int removed, int added)
+{
+    // l'état au début de row ne dépend que des lignes précédentes
+    const size_t r = (size_t)row;
+    const size_t old_known = known_;
+    uint8_t keep = (r < old_known) ? start_[r] : 0;
+    if (added > removed) {
+        start_.insert(start_.begin() + r, (size_t)(added - removed), 0);
+    } else if (removed > added) {
+        start_.erase(start_.begin() + r, start_.begin() + (r + (size_t)(removed - added)));
+    }
+    if (r < start_.size()) {
+        start_[r] = keep;
+    }
+
+    if (old_known > r) {
+        known_ = (old_known >= r + (size_t)removed) ?
+            old_known + (size_t)added - (size_t)removed : r + 1;
+    }
+    if (known_ > start_.size()) {
+        known_ = start_.size();
+    }
+
+    size_t settle = r + (size_t)added;
+    if (dirty_on_) {
+        // jusqu'à dirty_, les états ont déjà été relus : seuls ceux
+        // d'après sont encore les anciens, auxquels se comparer
+        size_t s = (settle_ > dirty_ + 1) ? settle_ : dirty_ + 1;
+        if (s > r) {
+            s = (s >= r + (size_t)removed) ? s + (size_t)added - (size_t)removed : settle;
+        }
+        if (dirty_ > r) dirty_ = r;
+        settle_ = (s > settle) ? s : settle;
+    } else {
+        dirty_on_ = true;
+        dirty_ = r;
+        settle_ = settle;
+    }
+    if (dirty_ + 1 >= known_) {
+        dirty_on_ = false;
+    }
+}
+
+uint8_t SyntaxCache::state_at(const LineStore& doc, int row)
+{
+    const size_t r = (size_t)row;
+    if (r >= start_.size()) {
+        return SYN_IN_CODE;
+    }
+    if (known_ == 0) {
+        start_[0] = SYN_IN_CODE;
+        known_ = 1;
+    }
+
+    // relecture après modification, jusqu'à retrouver les anciens états
+    while (dirty_on_ && dirty_ < r) {
+        size_t i = dirty_ + 1;
+        uint8_t s = syntax_lex_line(doc.line((int)dirty_), start_[dirty_], nullptr);
+        if (i >= settle_ && start_[i] == s) {
+            dirty_on_ = false;
+            break;
+        }
+        start_[i] = s;
+        dirty_ = i;
+        if (dirty_ + 1 >= known_) {
+            dirty_on_ = false;
+        }
+    }
+
+    while (known_ <= r) {
+        start_[known_] = syntax_lex_line(doc.line((int)known_ - 1),
+            start_[known_ - 1], nullptr);
+        known_++;
+    }
+    return start_[r];
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "line_store.h"
+
+// ------------------------------------------------------------
+// Coloration des scripts Lx
+// ------------------------------------------------------------
+//
+// Une ligne se découpe seule à partir de l'état du lexer à son début
+// (texte, commentaire /* */ ou chaîne ouverts sur une ligne
+// précédente). Cet état est gardé pour chaque ligne : une modification
+// invalide les lignes qui suivent, mais elles ne sont relues qu'à la
+// demande, et la relecture s'arrête dès qu'une ligne retrouve l'état
+// qu'elle avait avant. Afficher l'écran ne lit ainsi que les lignes
+// visibles, plus celles qui séparent la modification de l'écran.
+
+// catégories des jetons du lexer Lx
+enum SynClass : uint8_t {
+    SYN_TEXT = 0,               // ponctuation, opérateurs, noms
+    SYN_KEYWORD,
+    SYN_VARIABLE,               // $nom
+    SYN_CONSTANT,               // NOM_EN_MAJUSCULES
+    SYN_NUMBER,
+    SYN_STRING,
+    SYN_COMMENT,
+    SYN_CLASS_COUNT
+};
+
+// état du lexer en début de ligne
+enum SynState : uint8_t {
+    SYN_IN_CODE = 0,
+    SYN_IN_COMMENT,             // /* non refermé
+    SYN_IN_DQUOTE,              // "... non refermée
+    SYN_IN_SQUOTE,              // '... non refermée
+};
+
+// découpe line depuis l'état state ; cls (une case par octet, ou
+// nullptr) reçoit la catégorie de chaque octet. Renvoie l'état en fin de
+// ligne.
+uint8_t syntax_lex_line(const LineView& line, uint8_t state, uint8_t* cls);
+
+class SyntaxCache {
+public:
+    SyntaxCache();
+
+    // libère la mémoire (fermeture de l'éditeur)
+    void release();
+
+    // mêmes arguments que le LineEditFn de LineStore
+    void replace(int row, int removed, int added);
+    // état du lexer au début de la ligne row de doc
+    uint8_t state_at(const LineStore& doc, int row);
+
+private:
+    std::vector<uint8_t> start_;    // état en début de chaque ligne
+    size_t known_;                  // start_[0, known_) calculés
+    // lignes modifiées : start_[dirty_] est juste, les suivants peut-être
+    // plus ; au-delà de settle_, retrouver l'ancien état suffit
+    bool dirty_on_;
+    size_t dirty_;
+    size_t settle_;
+};
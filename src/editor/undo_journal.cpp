@@ -0,0 +1,250 @@
+#include "undo_journal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+// enregistrement : ligne, colonne, meta, octets, meta (pour remonter)
+static constexpr size_t kUndoRecordBytes = 16;
+static constexpr uint32_t kUndoLenMask = 0x3FFFFFFF;
+static constexpr uint32_t kUndoStep = 0x40000000;     // début d'étape
+static constexpr uint32_t kUndoInsert = 0x80000000;
+
+// positions prises modulo la taille : elle doit diviser 2^32
+static_assert((kUndoArenaBytes & (kUndoArenaBytes - 1)) == 0,
+    "kUndoArenaBytes must be a power of two");
+
+UndoJournal::UndoJournal()
+    : buf_(nullptr),
+      cap_(0),
+      tail_(0),
+      cursor_(0),
+      head_(0),
+      step_open_(false),
+      step_start_(0),
+      skip_step_(false),
+      last_(0),
+      last_mergeable_(false)
+{
+}
+
+UndoJournal::~UndoJournal()
+{
+    release();
+}
+
+void UndoJournal::reset()
+{
+    tail_ = 0;
+    cursor_ = 0;
+    head_ = 0;
+    step_open_ = false;
+    skip_step_ = false;
+    last_mergeable_ = false;
+}
+
+void UndoJournal::release()
+{
+    free(buf_);
+    buf_ = nullptr;
+    cap_ = 0;
+    reset();
+}
+
+// ------------------------------------------------------------
+// Anneau
+// ------------------------------------------------------------
+
+void UndoJournal::put(size_t off, const void* src, size_t n)
+{
+    size_t p = off % cap_;
+    size_t first = (n < cap_ - p) ? n : cap_ - p;
+    memcpy(buf_ + p, src, first);
+    memcpy(buf_, static_cast<const uint8_t*>(src) + first, n - first);
+}
+
+void UndoJournal::get(size_t off, void* dst, size_t n) const
+{
+    size_t p = off % cap_;
+    size_t first = (n < cap_ - p) ? n : cap_ - p;
+    memcpy(dst, buf_ + p, first);
+    memcpy(static_cast<uint8_t*>(dst) + first, buf_, n - first);
+}
+
+uint32_t UndoJournal::get32(size_t off) const
+{
+    uint32_t v;
+    get(off, &v, sizeof(v));
+    return v;
+}
+
+void UndoJournal::put32(size_t off, uint32_t v)
+{
+    put(off, &v, sizeof(v));
+}
+
+// oublie l'étape la plus ancienne
+void UndoJournal::drop()
+{
+    do {
+        tail_ += kUndoRecordBytes + (get32(tail_ + 8) & kUndoLenMask);
+    } while (tail_ != cursor_ && !(get32(tail_ + 8) & kUndoStep));
+}
+
+bool UndoJournal::make_room(size_t need)
+{
+    while (cap_ - (head_ - tail_) < need) {
+        if (tail_ == cursor_ || (step_open_ && tail_ == step_start_)) {
+            // l'étape en cours ne tient pas : tout est oublié
+            reset();
+            step_open_ = true;
+            skip_step_ = true;
+            return false;
+        }
+        drop();
+    }
+    return true;
+}
+
+// ------------------------------------------------------------
+// Enregistrement
+// ------------------------------------------------------------
+
+void UndoJournal::record(uint32_t line, uint32_t col, const char* data,
+    size_t len, bool insert)
+{
+    if (!step_open_) {
+        skip_step_ = false;
+    } else if (skip_step_) {
+        return;
+    }
+    if (len == 0) {
+        return;
+    }
+    if (!buf_) {
+        buf_ = static_cast<uint8_t*>(malloc(kUndoArenaBytes));
+        if (!buf_) {
+            step_open_ = true;
+            skip_step_ = true;
+            return;
+        }
+        cap_ = kUndoArenaBytes;
+    }
+    // ce qui avait été annulé ne peut plus être refait
+    head_ = cursor_;
+
+    if (kUndoRecordBytes + len > cap_) {
+        reset();
+        step_open_ = true;
+        skip_step_ = true;
+        return;
+    }
+
+    const bool plain = !memchr(data, '\n', len);
+
+    // frappe à la suite de l'insertion précédente : elle l'allonge
+    if (step_open_ && last_mergeable_ && insert && plain) {
+        uint32_t meta = get32(last_ + 8);
+        size_t old_len = meta & kUndoLenMask;
+        if (get32(last_) == line && get32(last_ + 4) + old_len == col &&
+            old_len + len <= kUndoLenMask) {
+            if (!make_room(len)) {
+                return;
+            }
+            meta += (uint32_t)len;
+            put(last_ + 12 + old_len, data, len);
+            put32(last_ + 8, meta);
+            put32(last_ + 12 + old_len + len, meta);
+            head_ = cursor_ = last_ + kUndoRecordBytes + old_len + len;
+            return;
+        }
+    }
+
+    const size_t need = kUndoRecordBytes + len;
+    if (!make_room(need)) {
+        return;
+    }
+    const bool step = !step_open_;
+    uint32_t meta = (uint32_t)len | (step ? kUndoStep : 0) | (insert ? kUndoInsert : 0);
+    size_t s = head_;
+    put32(s, line);
+    put32(s + 4, col);
+    put32(s + 8, meta);
+    put(s + 12, data, len);
+    put32(s + 12 + len, meta);
+    head_ = cursor_ = s + need;
+    if (step) {
+        step_open_ = true;
+        step_start_ = s;
+    }
+    last_ = s;
+    last_mergeable_ = insert && plain;
+}
+
+// ------------------------------------------------------------
+// Annuler / refaire
+// ------------------------------------------------------------
+
+bool UndoJournal::undo(UndoApplyFn fn, void* user)
+{
+    cut();
+    last_mergeable_ = false;
+    if (!can_undo()) {
+        return false;
+    }
+    std::string tmp;
+    size_t end = cursor_;
+    for (;;) {
+        uint32_t meta = get32(end - 4);
+        size_t len = meta & kUndoLenMask;
+        size_t s = end - kUndoRecordBytes - len;
+        tmp.resize(len);
+        get(s + 12, &tmp[0], len);
+        UndoOp op;
+        op.line = get32(s);
+        op.col = get32(s + 4);
+        op.insert = !(meta & kUndoInsert);
+        op.data = tmp.data();
+        op.len = len;
+        if (!fn(op, user)) {
+            reset();
+            return false;
+        }
+        end = s;
+        if ((meta & kUndoStep) || end == tail_) {
+            break;
+        }
+    }
+    cursor_ = end;
+    return true;
+}
+
+bool UndoJournal::redo(UndoApplyFn fn, void* user)
+{
+    cut();
+    last_mergeable_ = false;
+    if (!can_redo()) {
+        return false;
+    }
+    std::string tmp;
+    size_t s = cursor_;
+    do {
+        uint32_t meta = get32(s + 8);
+        size_t len = meta & kUndoLenMask;
+        tmp.resize(len);
+        get(s + 12, &tmp[0], len);
+        UndoOp op;
+        op.line = get32(s);
+        op.col = get32(s + 4);
+        op.insert = (meta & kUndoInsert) != 0;
+        op.data = tmp.data();
+        op.len = len;
+        if (!fn(op, user)) {
+            reset();
+            return false;
+        }
+        s += kUndoRecordBytes + len;
+    } while (s != head_ && !(get32(s + 8) & kUndoStep));
+    cursor_ = s;
+    return true;
+}
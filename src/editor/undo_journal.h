@@ -0,0 +1,79 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+// ------------------------------------------------------------
+// Annulation : journal des insertions et suppressions
+// ------------------------------------------------------------
+//
+// Chaque modification du texte est notée « len octets insérés ou
+// supprimés en (ligne, colonne) », avec ces octets, dans un anneau de
+// taille fixe : la mémoire ne dépend pas de la taille du fichier, et
+// les étapes les plus anciennes sont oubliées quand il est plein. Les
+// opérations d'une même étape (une commande, une session de saisie)
+// s'annulent ensemble ; des frappes consécutives sont fusionnées en une
+// seule insertion. Les lignes sont celles du document entier, si bien
+// que le journal reste valable quand la fenêtre d'un gros fichier se
+// déplace.
+
+static constexpr size_t kUndoArenaBytes = 16 * 1024;
+
+struct UndoOp {
+    uint32_t line;              // ligne du document
+    uint32_t col;               // octet dans la ligne
+    bool insert;                // data inséré (sinon supprimé)
+    const char* data;
+    size_t len;
+};
+
+// applique op au document ; false si elle n'a pas pu l'être
+typedef bool (*UndoApplyFn)(const UndoOp& op, void* user);
+
+class UndoJournal {
+public:
+    UndoJournal();
+    ~UndoJournal();
+
+    // oublie tout (nouveau fichier) ; garde la mémoire
+    void reset();
+    // libère l'anneau (fermeture de l'éditeur)
+    void release();
+
+    // l'opération suivante commence une nouvelle étape
+    void cut() { step_open_ = false; }
+    void record(uint32_t line, uint32_t col, const char* data, size_t len,
+        bool insert);
+
+    bool can_undo() const { return cursor_ != tail_; }
+    bool can_redo() const { return cursor_ != head_; }
+    // rejoue l'étape précédente à l'envers / la suivante ; false si
+    // rien à faire ou si fn a échoué (le journal est alors vidé)
+    bool undo(UndoApplyFn fn, void* user);
+    bool redo(UndoApplyFn fn, void* user);
+
+private:
+    UndoJournal(const UndoJournal&) = delete;
+    UndoJournal& operator=(const UndoJournal&) = delete;
+
+    void put(size_t off, const void* src, size_t n);
+    void get(size_t off, void* dst, size_t n) const;
+    uint32_t get32(size_t off) const;
+    void put32(size_t off, uint32_t v);
+    bool make_room(size_t need);
+    void drop();
+
+    uint8_t* buf_;
+    size_t cap_;
+    // positions croissantes, prises modulo cap_ : étapes oubliables
+    // [tail_, cursor_), étapes annulées rejouables [cursor_, head_)
+    size_t tail_;
+    size_t cursor_;
+    size_t head_;
+
+    bool step_open_;
+    size_t step_start_;         // premier enregistrement de l'étape ouverte
+    bool skip_step_;            // étape trop grande : plus rien jusqu'à cut()
+    size_t last_;               // dernier enregistrement (fusion des frappes)
+    bool last_mergeable_;
+};
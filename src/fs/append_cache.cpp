@@ -0,0 +1,184 @@
+#include "append_cache.h"
+
+#include <string.h>
+#include <new>
+#include <string>
+#include <Arduino.h>
+
+#include "vfs.h"
+
+// ------------------------------------------------------------
+// État
+// ------------------------------------------------------------
+
+static constexpr int kAppendSlots = 4;          // max_files SD = 5
+static constexpr size_t kAppendBufSize = 512;
+static constexpr uint32_t kAppendFlushMs = 1000;
+static constexpr uint32_t kAppendCloseMs = 5000;
+
+struct AppendSlot {
+    std::string path;           // chemin virtuel canonique
+    VfsFile file;
+    uint8_t* buf = nullptr;
+    size_t fill = 0;
+    uint32_t first_ms = 0;      // plus ancien octet en attente
+    uint32_t last_ms = 0;       // dernier ajout (LRU)
+    bool synced = true;         // rien d'écrit depuis le dernier sync
+};
+
+static AppendSlot slots[kAppendSlots];
+
+static bool slot_open(const AppendSlot& s)
+{
+    return s.file.handle != nullptr;
+}
+
+// ------------------------------------------------------------
+// Vidage
+// ------------------------------------------------------------
+
+static bool slot_flush(AppendSlot& s, bool sync)
+{
+    bool ok = true;
+    if (s.fill > 0) {
+        ok = vfs_write(s.file, s.buf, s.fill) == (int)s.fill;
+        s.fill = 0;
+        s.synced = false;
+    }
+    if (sync && !s.synced) {
+        if (!vfs_sync(s.file)) {
+            ok = false;
+        }
+        s.synced = true;
+    }
+    return ok;
+}
+
+static bool slot_close(AppendSlot& s)
+{
+    if (!slot_open(s)) {
+        return true;
+    }
+    bool ok = slot_flush(s, false);
+    if (!vfs_close(s.file)) {
+        ok = false;
+    }
+    delete[] s.buf;
+    s.buf = nullptr;
+    s.path.clear();
+    s.fill = 0;
+    s.synced = true;
+    return ok;
+}
+
+static AppendSlot* slot_find(const std::string& path)
+{
+    for (AppendSlot& s : slots) {
+        if (slot_open(s) && s.path == path) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+static AppendSlot* slot_acquire(const VfsPath& p)
+{
+    AppendSlot* victim = &slots[0];
+    for (AppendSlot& s : slots) {
+        if (!slot_open(s)) {
+            victim = &s;
+            break;
+        }
+        if (s.last_ms < victim->last_ms) {
+            victim = &s;
+        }
+    }
+    slot_close(*victim);
+
+    uint8_t* buf = new (std::nothrow) uint8_t[kAppendBufSize];
+    if (!buf) {
+        return nullptr;
+    }
+    if (!vfs_open(p, VFS_OPEN_APPEND, victim->file)) {
+        delete[] buf;
+        return nullptr;
+    }
+    victim->path = p.virt;
+    victim->buf = buf;
+    victim->fill = 0;
+    victim->synced = true;
+    return victim;
+}
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+bool append_cache_write(const VfsPath& p, const void* data, size_t len)
+{
+    AppendSlot* s = slot_find(p.virt);
+    if (!s) {
+        s = slot_acquire(p);
+        if (!s) {
+            return false;
+        }
+    }
+
+    uint32_t now = millis();
+    s->last_ms = now;
+    bool ok = true;
+    if (s->fill + len > kAppendBufSize) {
+        ok = slot_flush(*s, false);
+    }
+    if (ok && len >= kAppendBufSize) {
+        // gros bloc : directement au fichier
+        ok = vfs_write(s->file, data, len) == (int)len;
+        s->synced = false;
+    } else if (ok && len > 0) {
+        if (s->fill == 0) {
+            s->first_ms = now;
+        }
+        memcpy(s->buf + s->fill, data, len);
+        s->fill += len;
+    }
+    // journal écrit en boucle : pas plus d'une seconde de retard
+    if (ok && s->fill > 0 && now - s->first_ms >= kAppendFlushMs) {
+        ok = slot_flush(*s, true);
+    }
+    if (!ok) {
+        slot_close(*s);
+    }
+    return ok;
+}
+
+void append_cache_flush(const char* prefix, bool close)
+{
+    for (AppendSlot& s : slots) {
+        if (!slot_open(s)) {
+            continue;
+        }
+        if (prefix && !vfs_path_under(s.path.c_str(), prefix)) {
+            continue;
+        }
+        if (close) {
+            slot_close(s);
+        } else {
+            slot_flush(s, true);
+        }
+    }
+}
+
+void append_cache_idle()
+{
+    uint32_t now = millis();
+    for (AppendSlot& s : slots) {
+        if (!slot_open(s)) {
+            continue;
+        }
+        if (now - s.last_ms >= kAppendCloseMs) {
+            slot_close(s);
+        } else if (s.fill > 0 && now - s.first_ms >= kAppendFlushMs) {
+            slot_flush(s, true);
+        }
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+struct VfsPath;
+
+// Cache de descripteurs ouverts en ajout (historique, tee -a, >>).
+// Un ajout ne coûte qu'une copie dans le tampon du fichier ; le tampon
+// part sur le support quand il est plein, après kAppendFlushMs, au
+// sync ou quand le fichier est touché par une autre opération.
+// Seuls les montages adossés à un stockage sont concernés.
+
+bool append_cache_write(const VfsPath& p, const void* data, size_t len);
+
+// vide les tampons des fichiers situés sous prefix (nullptr = tous) ;
+// close ferme aussi leurs descripteurs (rm, mv, réécriture, démontage)
+void append_cache_flush(const char* prefix, bool close);
+
+// vide les tampons anciens, ferme les descripteurs inutilisés
+void append_cache_idle();
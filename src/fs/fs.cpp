@@ -2,180 +2,35 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
-#include <dirent.h>
-#include <sys/stat.h>
-#include <unistd.h>
 #include <vector>
 #include <string>
 #include <algorithm>
 #include <time.h>
 #include <Arduino.h>
-#include <esp_system.h>
-#include "ff.h"
+#include "esp_heap_caps.h"
 
 #include "ui/terminal.h"
 #include "hal/sdcard.h"
+#include "hal/flashfs.h"
+#include "fs_walk.h"
+#include "vfs.h"
+#include "io_service.h"
+#include "append_cache.h"
+#include "stat_cache.h"
+#include "gzip.h"
 
 // ------------------------------------------------------------
 // État global
 // ------------------------------------------------------------
 
-static char cwd[128] = "/";
+static std::string cwd = "/";
 
 // ------------------------------------------------------------
 // Utils
 // ------------------------------------------------------------
 
-static bool path_eq(const char* a, const char* b)
-{
-    return strcmp(a, b) == 0;
-}
-
-static const char* k_dev_entries[] = {
-    "console",
-    "stdout",
-    "stderr",
-    "tty",
-    "kmsg",
-    "full",
-    "zero",
-    "random",
-    "urandom",
-    "null"
-};
-
-static bool dev_entry_has(const char* name)
-{
-    if (!name || !*name) {
-        return false;
-    }
-    for (size_t i = 0; i < sizeof(k_dev_entries) / sizeof(k_dev_entries[0]); i++) {
-        if (strcmp(k_dev_entries[i], name) == 0) {
-            return true;
-        }
-    }
-    return false;
-}
-
-static void append_hex_byte(std::string& out, uint8_t value)
-{
-    static const char kHex[] = "0123456789abcdef";
-    out.push_back(kHex[(value >> 4) & 0x0F]);
-    out.push_back(kHex[value & 0x0F]);
-}
-
-static void append_hex_sample(std::string& out, size_t bytes, bool randomize)
-{
-    out.reserve(out.size() + bytes * 2 + 1);
-    for (size_t i = 0; i < bytes; i++) {
-        uint8_t value = 0;
-        if (randomize) {
-            value = static_cast<uint8_t>(esp_random() & 0xFF);
-        }
-        append_hex_byte(out, value);
-    }
-    out.push_back('\n');
-}
-
-// construit un chemin canonique absolu à partir de cwd + path
-static bool fs_norm(const char* base, const char* path, char* out, size_t out_sz)
-{
-    if (!path || !*path) {
-        strncpy(out, base, out_sz);
-        return true;
-    }
-
-    char tmp[128];
-
-    if (path[0] == '/') {
-        strncpy(tmp, path, sizeof(tmp));
-    } else {
-        if (strcmp(base, "/") == 0)
-            snprintf(tmp, sizeof(tmp), "/%s", path);
-        else
-            snprintf(tmp, sizeof(tmp), "%s/%s", base, path);
-    }
-
-    // normalisation . et ..
-    char* parts[16];
-    int n = 0;
-
-    char buf[128];
-    strncpy(buf, tmp, sizeof(buf));
-
-    char* tok = strtok(buf, "/");
-    while (tok && n < 16) {
-        if (strcmp(tok, ".") == 0) {
-            // ignore
-        } else if (strcmp(tok, "..") == 0) {
-            if (n > 0) n--;
-        } else {
-            parts[n++] = tok;
-        }
-        tok = strtok(nullptr, "/");
-    }
-
-    // reconstruction
-    out[0] = '/';
-    out[1] = '\0';
-    for (int i = 0; i < n; i++) {
-        strncat(out, parts[i], out_sz);
-        if (i != n - 1)
-            strncat(out, "/", out_sz);
-    }
-
-    return true;
-}
-
-static bool fs_resolve_media_path(const char* path, char* out, size_t out_sz)
-{
-    if (!path || !*path) {
-        return false;
-    }
-
-    if (!sd_is_mounted()) {
-        return false;
-    }
-
-    char canon[128];
-    fs_norm(cwd, path, canon, sizeof(canon));
-
-    if (path_eq(canon, "/media/0") || path_eq(canon, "/media/0/.")) {
-        strncpy(out, "/sdcard", out_sz);
-        return true;
-    }
-
-    if (strncmp(canon, "/media/0/", 9) == 0) {
-        snprintf(out, out_sz, "/sdcard/%s", canon + 9);
-        return true;
-    }
-
-    return false;
-}
-
-static bool fs_real_to_virtual(const char* real, char* out, size_t out_sz)
-{
-    const char* prefix = "/sdcard";
-    size_t prefix_len = strlen(prefix);
-
-    if (strncmp(real, prefix, prefix_len) != 0) {
-        return false;
-    }
-
-    if (strcmp(real, "/sdcard") == 0) {
-        strncpy(out, "/media/0", out_sz);
-        return true;
-    }
-
-    if (real[prefix_len] == '/') {
-        snprintf(out, out_sz, "/media/0%s", real + prefix_len);
-        return true;
-    }
-
-    return false;
-}
-
 static bool match_pattern(const char* name, const char* pattern, bool ci)
 {
     if (!pattern || !*pattern) {
@@ -222,63 +77,79 @@ static bool match_pattern(const char* name, const char* pattern, bool ci)
     return match_pattern(name + 1, pattern + 1, ci);
 }
 
-static const char* fs_basename(const char* path)
+static bool copy_out(const std::string& s, char* out, size_t out_sz)
 {
-    const char* slash = strrchr(path, '/');
-    return slash ? slash + 1 : path;
+    if (!out || out_sz == 0 || s.size() >= out_sz) {
+        return false;
+    }
+    memcpy(out, s.c_str(), s.size() + 1);
+    return true;
 }
 
-static bool find_walk(const char* real_root, const char* pattern, bool ci, bool include_self)
+// ------------------------------------------------------------
+// find
+// ------------------------------------------------------------
+
+static constexpr size_t kFindFlushBytes = 1024;
+
+struct FindCtx {
+    const FsFindOptions* opts;
+    std::string out;
+};
+
+static bool find_size_match(const FsFindOptions& opts, uint32_t size)
 {
-    if (include_self) {
-        char virt[192];
-        if (fs_real_to_virtual(real_root, virt, sizeof(virt))) {
-            const char* name = nullptr;
-            if (strcmp(real_root, "/sdcard") == 0) {
-                name = "0";
-            } else {
-                name = fs_basename(real_root);
-            }
-            if (!pattern || match_pattern(name, pattern, ci)) {
-                term_puts(virt);
-                term_putc('\n');
-            }
-        }
+    if (!opts.has_size) {
+        return true;
     }
+    // en 64 bits : size + unit - 1 déborde au-delà de 4 Gio - unit
+    uint64_t unit = opts.size_unit ? opts.size_unit : 1;
+    uint64_t units = ((uint64_t)size + unit - 1) / unit;
+    if (opts.size_cmp < 0) {
+        return units < opts.size_value;
+    }
+    if (opts.size_cmp > 0) {
+        return units > opts.size_value;
+    }
+    return units == opts.size_value;
+}
 
-    DIR* dir = opendir(real_root);
-    if (!dir) {
+static bool find_match(const FsFindOptions& opts, const char* name,
+    bool is_dir, uint32_t size)
+{
+    if (opts.type == 'f' && is_dir) {
         return false;
     }
+    if (opts.type == 'd' && !is_dir) {
+        return false;
+    }
+    if (opts.pattern && !match_pattern(name, opts.pattern, opts.case_insensitive)) {
+        return false;
+    }
+    return find_size_match(opts, is_dir ? 0 : size);
+}
 
-    struct dirent* ent;
-    while ((ent = readdir(dir)) != nullptr) {
-        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
-            continue;
-        }
-
-        char full[192];
-        snprintf(full, sizeof(full), "%s/%s", real_root, ent->d_name);
-
-        struct stat st;
-        if (stat(full, &st) != 0) {
-            continue;
-        }
-
-        if (!pattern || match_pattern(ent->d_name, pattern, ci)) {
-            char virt[192];
-            if (fs_real_to_virtual(full, virt, sizeof(virt))) {
-                term_puts(virt);
-                term_putc('\n');
-            }
-        }
+static void find_flush(FindCtx& ctx, bool force)
+{
+    if (ctx.out.empty() || (!force && ctx.out.size() < kFindFlushBytes)) {
+        return;
+    }
+    term_write_bytes(ctx.out.data(), ctx.out.size());
+    ctx.out.clear();
+    // fin du lot : le bloc est affiché avant que la recherche continue
+    term_batch_end();
+    term_batch_begin();
+}
 
-        if (S_ISDIR(st.st_mode)) {
-            find_walk(full, pattern, ci, false);
-        }
+static bool find_visit(const FsWalkEntry& e, void* user)
+{
+    FindCtx& ctx = *static_cast<FindCtx*>(user);
+    if (!find_match(*ctx.opts, e.name, e.is_dir, e.size)) {
+        return true;
     }
-
-    closedir(dir);
+    ctx.out += e.path;
+    ctx.out.push_back('\n');
+    find_flush(ctx, false);
     return true;
 }
 
@@ -291,68 +162,156 @@ bool fs_sd_mounted()
     return sd_is_mounted();
 }
 
+bool fs_flash_mounted()
+{
+    return flash_is_mounted();
+}
+
+const char* fs_state_dir()
+{
+    if (flash_is_mounted()) {
+        return FS_FLASH_MOUNT_POINT;
+    }
+    if (sd_is_mounted()) {
+        return FS_SD_MOUNT_POINT;
+    }
+    return nullptr;
+}
+
 const char* fs_pwd()
 {
-    return cwd;
+    return cwd.c_str();
+}
+
+bool fs_resolve(const char* path, VfsPath& out)
+{
+    return vfs_resolve(cwd.c_str(), path, out);
 }
 
 // ------------------------------------------------------------
 // cd
 // ------------------------------------------------------------
 
-bool fs_cd(const char* path)
+// path et ce qui est dessous vont changer : métadonnées oubliées,
+// descripteurs d'ajout fermés
+static void path_changed(const VfsPath& p)
 {
-    char canon[128];
-    fs_norm(cwd, path, canon, sizeof(canon));
-
-    // répertoires virtuels valides
-    if (path_eq(canon, "/") ||
-        path_eq(canon, "/bin") ||
-        path_eq(canon, "/dev") ||
-        path_eq(canon, "/media") ||
-        path_eq(canon, "/media/0")) {
-
-        if (path_eq(canon, "/media/0") && !sd_is_mounted())
-            return false;
-
-        strncpy(cwd, canon, sizeof(cwd));
-        return true;
-    }
-
-    // sous-répertoires SD
-    if (strncmp(canon, "/media/0/", 9) == 0) {
-        if (!sd_is_mounted())
-            return false;
+    stat_cache_invalidate(p.virt.c_str());
+    append_cache_flush(p.virt.c_str(), true);
+}
 
-        char real[128];
-        snprintf(real, sizeof(real), "/sdcard/%s", canon + 9);
+void fs_invalidate(const char* path)
+{
+    VfsPath p;
+    fs_resolve(path, p);
+    path_changed(p);
+}
 
-        DIR* d = opendir(real);
-        if (!d)
-            return false;
-        closedir(d);
+bool fs_cd(const char* path)
+{
+    VfsPath p;
+    fs_resolve(path, p);
 
-        strncpy(cwd, canon, sizeof(cwd));
-        return true;
+    FsStat st;
+    if (!vfs_stat(p, st) || !st.is_dir) {
+        return false;
     }
-
-    return false;
+    cwd.swap(p.virt);
+    return true;
 }
 
 // ------------------------------------------------------------
-// Montage SD
+// Montage
 // ------------------------------------------------------------
 
+void fs_init()
+{
+    io_service_start();
+    if (!vfs_find_mount(FS_TMP_MOUNT_POINT)) {
+        vfs_mount(FS_TMP_MOUNT_POINT, &vfs_tmpfs_ops, nullptr, nullptr, "tmpfs");
+    }
+    // partition vierge au premier démarrage : formatée
+    if (flash_mount(true) && !vfs_find_mount(FS_FLASH_MOUNT_POINT)) {
+        vfs_mount(FS_FLASH_MOUNT_POINT, &vfs_posix_ops, flash_mount_point(),
+            nullptr, "flash");
+    }
+}
+
 bool fs_mount()
 {
-    return sd_mount(false);
+    if (!sd_mount(false)) {
+        return false;
+    }
+    if (!vfs_find_mount(FS_SD_MOUNT_POINT)) {
+        vfs_mount(FS_SD_MOUNT_POINT, &vfs_fat_ops, sd_mount_point(),
+            sd_fat_drive(), "SDCard0");
+    }
+    stat_cache_invalidate(nullptr);
+    return true;
 }
 
 void fs_umount()
 {
+    if (vfs_path_under(cwd.c_str(), FS_SD_MOUNT_POINT)) {
+        cwd = "/";
+    }
+    append_cache_flush(FS_SD_MOUNT_POINT, true);
+    stat_cache_invalidate(nullptr);
+    vfs_umount(FS_SD_MOUNT_POINT);
     sd_umount();
 }
 
+bool fs_sync()
+{
+    append_cache_flush(nullptr, false);
+    if (!sd_is_mounted()) {
+        return true;
+    }
+    return sd_sync();
+}
+
+void fs_idle()
+{
+    append_cache_idle();
+    if (sd_is_mounted()) {
+        sd_idle();
+    }
+}
+
+bool fs_space(const char* path, FsSpace& out)
+{
+    out = FsSpace();
+    VfsPath p;
+    fs_resolve(path, p);
+    if (!p.mount) {
+        return false;
+    }
+    if (p.mount->ops == &vfs_tmpfs_ops) {
+        out.total = vfs_tmpfs_budget();
+        uint64_t used = vfs_tmpfs_used();
+        out.free = used < out.total ? out.total - used : 0;
+        return true;
+    }
+    if (strcmp(p.mount->prefix, FS_FLASH_MOUNT_POINT) == 0) {
+        out.total = flash_total_bytes();
+        uint64_t used = flash_used_bytes();
+        out.free = used < out.total ? out.total - used : 0;
+        return true;
+    }
+    if (p.mount->fat_drive) {
+        SdSpace sd;
+        if (!sd_get_space(sd)) {
+            return false;
+        }
+        out.total = sd.total_bytes;
+        out.free = sd.free_bytes;
+        out.known = (sd.state == SD_SPACE_READY);
+        out.updating = (sd.state == SD_SPACE_UPDATING);
+        return true;
+    }
+    return false;
+}
+
 // ------------------------------------------------------------
 // Listage
 // ------------------------------------------------------------
@@ -376,31 +335,6 @@ static void format_size(uint32_t size, char* out, size_t out_sz)
     }
 }
 
-static const char* k_bin_names[] = {
-    "ls", "pwd", "cd", "mount", "umount",
-    "df",
-    "mkdir", "rmdir", "cp", "mv", "rm",
-    "vi", "nano", "touch", "cat",
-    "view", "slideshow", "play", "led",
-    "lx", "lxprofile", "more", "less", "find", "tee",
-    "clear", "reset", "battery", "free", "echo", "shutdown", "reboot", "brightness",
-    "man",
-    "uptime"
-};
-
-static bool bin_has(const char* name)
-{
-    if (!name || !*name) {
-        return false;
-    }
-    for (size_t i = 0; i < sizeof(k_bin_names) / sizeof(k_bin_names[0]); i++) {
-        if (strcmp(k_bin_names[i], name) == 0) {
-            return true;
-        }
-    }
-    return false;
-}
-
 static void print_long_entry(bool is_dir, bool writable, bool hidden_name,
     bool hidden_attr, bool system, bool archive, uint32_t size,
     const char* date, const std::string& name)
@@ -423,102 +357,43 @@ static void print_long_entry(bool is_dir, bool writable, bool hidden_name,
     term_putc('\n');
 }
 
-static void list_bin_entries(std::vector<FsEntry>& out, bool include_hidden)
+static bool read_dir(const VfsPath& p, std::vector<VfsDirent>& out,
+    bool include_hidden)
 {
-    for (size_t i = 0; i < sizeof(k_bin_names) / sizeof(k_bin_names[0]); i++) {
-        if (!include_hidden && k_bin_names[i][0] == '.') {
-            continue;
-        }
-        FsEntry e;
-        e.name = k_bin_names[i];
-        e.is_dir = false;
-        out.push_back(e);
+    append_cache_flush(p.virt.c_str(), false);
+    VfsDir dir;
+    if (!vfs_opendir(p, dir)) {
+        return false;
     }
-
-    std::sort(out.begin(), out.end(),
-        [](const FsEntry& a, const FsEntry& b) {
-            return a.name < b.name;
-        });
-}
-
-static void list_bin(const char* opts)
-{
-    bool opt_long = opts && strchr(opts, 'l');
-    bool opt_all = opts && strchr(opts, 'a');
-    const char* date = "1970-01-01";
-
-    std::vector<FsEntry> entries;
-    list_bin_entries(entries, opt_all);
-
-    for (const auto& e : entries) {
-        if (opt_long) {
-            const bool hidden_by_name = !e.name.empty() && e.name[0] == '.';
-            print_long_entry(false, false, hidden_by_name, false, true, false,
-                0, date, e.name);
-        } else {
-            term_puts(e.name.c_str());
-            term_putc('\n');
+    VfsDirent ent;
+    while (vfs_readdir(dir, ent)) {
+        if (!include_hidden && ent.name[0] == '.') {
+            continue;
         }
+        out.push_back(ent);
     }
+    vfs_closedir(dir);
+    return true;
 }
 
-struct ls_entry {
-    std::string name;
-    uint32_t mtime;
-    uint32_t size;
-    bool is_dir;
-    uint8_t fat_attr;
-    bool fat_valid;
-};
-
-
-static bool list_sd_dir(const char* real_path, const char* opts)
+bool fs_list(const char* path, const char* opts)
 {
     bool opt_all = opts && strchr(opts, 'a');
     bool opt_long = opts && strchr(opts, 'l');
     bool opt_time = opts && strchr(opts, 't');
     bool opt_rev = opts && strchr(opts, 'r');
 
-    DIR* dir = opendir(real_path);
-    if (!dir)
-        return false;
-
-    std::vector<ls_entry> entries;
-    struct dirent* ent;
-    while ((ent = readdir(dir)) != nullptr) {
-        if (!opt_all && ent->d_name[0] == '.') {
-            continue;
-        }
-
-        ls_entry e;
-        e.name = ent->d_name;
-        e.mtime = 0;
-        e.size = 0;
-        e.is_dir = false;
-        e.fat_attr = 0;
-        e.fat_valid = false;
-
-        char full[192];
-        snprintf(full, sizeof(full), "%s/%s", real_path, ent->d_name);
-        struct stat st;
-        if (stat(full, &st) == 0) {
-            e.mtime = (uint32_t)st.st_mtime;
-            e.size = (uint32_t)st.st_size;
-            e.is_dir = S_ISDIR(st.st_mode);
-        }
-        FILINFO fno;
-        if (f_stat(full, &fno) == FR_OK) {
-            e.fat_attr = fno.fattrib;
-            e.fat_valid = true;
-        }
+    VfsPath p;
+    fs_resolve(path, p);
 
-        entries.push_back(e);
+    std::vector<VfsDirent> entries;
+    if (!read_dir(p, entries, opt_all)) {
+        return false;
     }
-    closedir(dir);
 
     if (opt_time) {
         std::sort(entries.begin(), entries.end(),
-            [](const ls_entry& a, const ls_entry& b) {
+            [](const VfsDirent& a, const VfsDirent& b) {
                 if (a.mtime == b.mtime) {
                     return a.name < b.name;
                 }
@@ -526,7 +401,7 @@ static bool list_sd_dir(const char* real_path, const char* opts)
             });
     } else {
         std::sort(entries.begin(), entries.end(),
-            [](const ls_entry& a, const ls_entry& b) {
+            [](const VfsDirent& a, const VfsDirent& b) {
                 return a.name < b.name;
             });
     }
@@ -538,11 +413,10 @@ static bool list_sd_dir(const char* real_path, const char* opts)
     for (const auto& e : entries) {
         if (opt_long) {
             const bool hidden_by_name = !e.name.empty() && e.name[0] == '.';
-            const bool hidden_by_attr = e.fat_valid && (e.fat_attr & AM_HID);
-            const bool read_only = e.fat_valid && (e.fat_attr & AM_RDO);
-            const bool archive = e.fat_valid && (e.fat_attr & AM_ARC);
-            const bool system = e.fat_valid && (e.fat_attr & AM_SYS);
-            const bool hidden = hidden_by_name || hidden_by_attr;
+            const bool hidden_by_attr = e.attr_valid && (e.attr & VFS_ATTR_HID);
+            const bool read_only = e.attr_valid && (e.attr & VFS_ATTR_RDO);
+            const bool archive = e.attr_valid && (e.attr & VFS_ATTR_ARC);
+            const bool system = e.attr_valid && (e.attr & VFS_ATTR_SYS);
 
             char date[16] = "1970-01-01";
             time_t tt = (time_t)e.mtime;
@@ -565,565 +439,904 @@ static bool list_sd_dir(const char* real_path, const char* opts)
     return true;
 }
 
-static bool list_sd_dir_entries(const char* real_path,
-    std::vector<FsEntry>& out, bool include_hidden)
+bool fs_list_entries(const char* path, std::vector<FsEntry>& out,
+    bool include_hidden)
 {
-    DIR* dir = opendir(real_path);
-    if (!dir) {
-        return false;
-    }
-
-    std::vector<FsEntry> entries;
-    struct dirent* ent;
-    while ((ent = readdir(dir)) != nullptr) {
-        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
-            continue;
-        }
-        if (!include_hidden && ent->d_name[0] == '.') {
-            continue;
-        }
-
-        FsEntry e;
-        e.name = ent->d_name;
-        e.is_dir = false;
+    out.clear();
 
-        char full[192];
-        snprintf(full, sizeof(full), "%s/%s", real_path, ent->d_name);
-        struct stat st;
-        if (stat(full, &st) == 0) {
-            e.is_dir = S_ISDIR(st.st_mode);
-        }
+    VfsPath p;
+    fs_resolve(path, p);
 
-        entries.push_back(e);
+    std::vector<VfsDirent> entries;
+    if (!read_dir(p, entries, include_hidden)) {
+        return false;
     }
-    closedir(dir);
 
-    std::sort(entries.begin(), entries.end(),
+    out.reserve(entries.size());
+    for (auto& e : entries) {
+        FsEntry fe;
+        fe.name.swap(e.name);
+        fe.is_dir = e.is_dir;
+        out.push_back(fe);
+    }
+    std::sort(out.begin(), out.end(),
         [](const FsEntry& a, const FsEntry& b) {
             return a.name < b.name;
         });
-
-    out.swap(entries);
     return true;
 }
 
-bool fs_list(const char* path, const char* opts)
+bool fs_resolve_path(const char* path, char* out, size_t out_sz)
 {
-    char canon[128];
-    fs_norm(cwd, path, canon, sizeof(canon));
-    bool opt_long = opts && strchr(opts, 'l');
-
-    if (path_eq(canon, "/")) {
-        if (opt_long) {
-            const char* date = "1970-01-01";
-            print_long_entry(true, true, false, false, true, false, 0, date, "bin");
-            print_long_entry(true, true, false, false, true, false, 0, date, "dev");
-            print_long_entry(true, true, false, false, true, false, 0, date, "media");
-        } else {
-            term_puts("bin\n");
-            term_puts("dev\n");
-            term_puts("media\n");
-        }
-        return true;
-    }
+    std::string canon;
+    vfs_normalize(cwd.c_str(), path, canon);
+    return copy_out(canon, out, out_sz);
+}
 
-    if (path_eq(canon, "/bin")) {
-        list_bin(opts);
-        return true;
+bool fs_resolve_real_path(const char* path, char* out, size_t out_sz)
+{
+    VfsPath p;
+    fs_resolve(path, p);
+    if (p.real.empty()) {
+        return false;
     }
+    return copy_out(p.real, out, out_sz);
+}
 
-    if (path_eq(canon, "/dev")) {
-        if (opt_long) {
-            const char* date = "1970-01-01";
-            for (size_t i = 0; i < sizeof(k_dev_entries) / sizeof(k_dev_entries[0]); i++) {
-                print_long_entry(false, true, false, false, true, false, 0,
-                    date, k_dev_entries[i]);
-            }
-        } else {
-            for (size_t i = 0; i < sizeof(k_dev_entries) / sizeof(k_dev_entries[0]); i++) {
-                term_puts(k_dev_entries[i]);
-                term_putc('\n');
-            }
-        }
-        return true;
-    }
+bool fs_stat(const char* path, FsStat& out)
+{
+    VfsPath p;
+    fs_resolve(path, p);
 
-    if (path_eq(canon, "/media")) {
-        if (sd_is_mounted()) {
-            if (opt_long) {
-                const char* date = "1970-01-01";
-                print_long_entry(true, true, false, false, true, false, 0, date, "0");
-            } else {
-                term_puts("0\n");
-            }
-        }
-        return true;
+    bool exists = false;
+    if (stat_cache_lookup(p.virt.c_str(), exists, out)) {
+        return exists;
     }
+    append_cache_flush(p.virt.c_str(), false);
+    exists = vfs_stat(p, out);
+    stat_cache_store(p.virt.c_str(), exists, out);
+    return exists;
+}
 
-    if (path_eq(canon, "/media/0")) {
-        if (!sd_is_mounted())
-            return false;
-        return list_sd_dir("/sdcard", opts);
-    }
+// ------------------------------------------------------------
+// Lecture / écriture
+// ------------------------------------------------------------
 
-    if (strncmp(canon, "/media/0/", 9) == 0) {
-        if (!sd_is_mounted())
-            return false;
+static constexpr size_t kStreamReadBytes = 512;
 
-        char real[128];
-        snprintf(real, sizeof(real), "/sdcard/%s", canon + 9);
-        return list_sd_dir(real, opts);
+static bool write_with_mode(const char* path, const unsigned char* data,
+    size_t len, VfsOpenMode mode)
+{
+    VfsPath p;
+    fs_resolve(path, p);
+
+    // ajouts vers un stockage : descripteur gardé ouvert et tamponné
+    if (mode == VFS_OPEN_APPEND && p.mount && p.mount->real_root) {
+        stat_cache_invalidate(p.virt.c_str());
+        return append_cache_write(p, data, len);
     }
+    path_changed(p);
 
-    return false;
+    VfsFile f;
+    if (!vfs_open(p, mode, f)) {
+        return false;
+    }
+    bool ok = true;
+    if (len > 0) {
+        ok = vfs_write(f, data, len) == (int)len;
+    }
+    if (!vfs_close(f)) {
+        ok = false;
+    }
+    return ok;
 }
 
-bool fs_resolve_path(const char* path, char* out, size_t out_sz)
+bool fs_write_file(const char* path, const unsigned char* data, size_t len)
 {
-    return fs_norm(cwd, path, out, out_sz);
+    return write_with_mode(path, data, len, VFS_OPEN_WRITE);
 }
 
-bool fs_resolve_real_path(const char* path, char* out, size_t out_sz)
+bool fs_append_file(const char* path, const unsigned char* data, size_t len)
 {
-    return fs_resolve_media_path(path, out, out_sz);
+    return write_with_mode(path, data, len, VFS_OPEN_APPEND);
 }
 
-bool fs_stat(const char* path, FsStat& out)
+static void append_text(std::string& out, const uint8_t* data, int n)
 {
-    out.size = 0;
-    out.is_dir = false;
-    out.is_file = false;
-
-    char canon[128];
-    fs_norm(cwd, path, canon, sizeof(canon));
-
-    if (path_eq(canon, "/") || path_eq(canon, "/bin") ||
-        path_eq(canon, "/dev") || path_eq(canon, "/media") ||
-        path_eq(canon, "/media/0")) {
-        if (path_eq(canon, "/media/0") && !sd_is_mounted()) {
-            return false;
+    for (int i = 0; i < n; i++) {
+        if (data[i] != '\r') {
+            out.push_back((char)data[i]);
         }
-        out.is_dir = true;
-        return true;
     }
+}
 
-    if (strncmp(canon, "/dev/", 5) == 0) {
-        const char* name = canon + 5;
-        if (!dev_entry_has(name)) {
-            return false;
-        }
-        out.is_file = true;
-        return true;
-    }
+static bool is_gz_path(const std::string& path)
+{
+    return path.size() > 3
+        && strcasecmp(path.c_str() + path.size() - 3, ".gz") == 0;
+}
 
-    if (strncmp(canon, "/bin/", 5) == 0) {
-        const char* name = canon + 5;
-        if (!*name) {
-            return false;
-        }
-        if (!bin_has(name)) {
-            return false;
-        }
-        out.is_file = true;
-        return true;
+bool fs_read_file(const char* path, std::string& out)
+{
+    out.clear();
+
+    VfsPath p;
+    fs_resolve(path, p);
+    append_cache_flush(p.virt.c_str(), false);
+
+    VfsFile f;
+    if (!vfs_open(p, VFS_OPEN_READ, f)) {
+        return false;
     }
 
-    if (strncmp(canon, "/media/0/", 9) == 0) {
-        if (!sd_is_mounted()) {
+    FsStat st;
+    bool has_stat = vfs_stat(p, st);
+    if (has_stat && st.is_stream) {
+        // flux sans fin (/dev/zero, /dev/urandom) : un bloc, octets bruts
+        out.resize(kStreamReadBytes);
+        int n = vfs_read(f, &out[0], out.size());
+        vfs_close(f);
+        out.resize(n > 0 ? (size_t)n : 0);
+        return n >= 0;
+    }
+    if (is_gz_path(p.virt) && gz_probe(f)) {
+        // .gz : moins d'octets lus sur la carte, fenêtre de 32 Ko
+        GzReader gz;
+        if (!gz.begin(f)) {
+            vfs_close(f);
             return false;
         }
-
-        char real[128];
-        snprintf(real, sizeof(real), "/sdcard/%s", canon + 9);
-        struct stat st;
-        if (stat(real, &st) != 0) {
-            return false;
+        const uint8_t* data = nullptr;
+        int n = 0;
+        while ((n = gz.next(&data)) > 0) {
+            append_text(out, data, n);
         }
-        out.size = (uint32_t)st.st_size;
-        out.is_dir = S_ISDIR(st.st_mode);
-        out.is_file = S_ISREG(st.st_mode);
-        return true;
+        gz.end();
+        vfs_close(f);
+        return n == 0;
+    }
+    if (has_stat && st.size > 0) {
+        out.reserve(st.size);
     }
 
-    return false;
+    // lecture anticipée : le bloc suivant arrive pendant le filtrage
+    IoReader reader;
+    if (!reader.begin(f)) {
+        vfs_close(f);
+        return false;
+    }
+    const uint8_t* data = nullptr;
+    int n = 0;
+    while ((n = reader.next(&data)) > 0) {
+        append_text(out, data, n);
+    }
+    reader.end();
+    vfs_close(f);
+    return n == 0;
 }
 
-bool fs_write_file(const char* path, const unsigned char* data, size_t len)
+bool fs_read_blocks(const char* path, FsBlockFn fn, void* user)
 {
-    char canon[128];
-    fs_norm(cwd, path, canon, sizeof(canon));
-    if (path_eq(canon, "/dev/console")) {
-        if (len > 0) {
-            Serial.write(data, len);
-            Serial.flush();
-        }
-        return true;
+    VfsPath p;
+    fs_resolve(path, p);
+    append_cache_flush(p.virt.c_str(), false);
+
+    FsStat st;
+    if (!vfs_stat(p, st) || st.is_dir || st.is_stream) {
+        return false;
     }
-    if (path_eq(canon, "/dev/stdout")) {
-        if (len > 0) {
-            term_write_bytes(reinterpret_cast<const char*>(data), len);
-        }
-        return true;
+    VfsFile f;
+    if (!vfs_open(p, VFS_OPEN_READ, f)) {
+        return false;
     }
-    if (path_eq(canon, "/dev/stderr")) {
-        if (len > 0) {
-            term_write_bytes_error(reinterpret_cast<const char*>(data), len);
-        }
-        return true;
+    // gros blocs : le calcul de l'appelant recouvre la lecture suivante
+    IoReader reader;
+    if (!reader.begin(f, kIoCopyChunkSize) && !reader.begin(f)) {
+        vfs_close(f);
+        return false;
     }
-    if (path_eq(canon, "/dev/tty")) {
-        if (len > 0) {
-            term_write_bytes(reinterpret_cast<const char*>(data), len);
-        }
-        return true;
+    const uint8_t* data = nullptr;
+    int n = 0;
+    while ((n = reader.next(&data)) > 0) {
+        fn(data, (size_t)n, user);
     }
-    if (path_eq(canon, "/dev/kmsg")) {
-        if (len > 0) {
-            Serial.write(data, len);
-            Serial.flush();
-        }
-        return true;
+    reader.end();
+    vfs_close(f);
+    return n == 0;
+}
+
+// ------------------------------------------------------------
+// Fichiers / dossiers
+// ------------------------------------------------------------
+
+bool fs_mkdir(const char* path)
+{
+    VfsPath p;
+    fs_resolve(path, p);
+    stat_cache_invalidate(p.virt.c_str());
+    return vfs_mkdir(p);
+}
+
+bool fs_rmdir(const char* path)
+{
+    VfsPath p;
+    fs_resolve(path, p);
+    path_changed(p);
+    return vfs_rmdir(p);
+}
+
+bool fs_rm(const char* path)
+{
+    VfsPath p;
+    fs_resolve(path, p);
+    path_changed(p);
+    return vfs_remove(p);
+}
+
+// ------------------------------------------------------------
+// cp / mv
+// ------------------------------------------------------------
+
+static constexpr uint32_t kCopyProgressDelayMs = 1000;  // copies courtes : rien
+static constexpr uint32_t kCopyProgressEveryMs = 250;
+
+struct CopyCtx {
+    const FsCopyOptions* opts;
+    FsCopyStats* stats;
+    uint64_t total;             // octets à copier (progression)
+    uint64_t base;              // octets des fichiers déjà copiés
+    uint32_t start_ms;
+    uint32_t last_ms;
+    bool shown;
+    const VfsPath* dst_root;
+    size_t src_len;             // longueur du chemin source à remplacer
+    bool ok;
+};
+
+static void copy_progress_line(CopyCtx& ctx, uint64_t done)
+{
+    char line[40];
+    uint32_t done_kb = (uint32_t)(done / 1024);
+    if (ctx.total > 0) {
+        uint32_t pct = (uint32_t)(done * 100 / ctx.total);
+        snprintf(line, sizeof(line), "\r%lu/%lu KB %lu%%  ",
+            (unsigned long)done_kb, (unsigned long)(ctx.total / 1024),
+            (unsigned long)pct);
+    } else {
+        snprintf(line, sizeof(line), "\r%lu KB  ", (unsigned long)done_kb);
     }
-    if (path_eq(canon, "/dev/full")) {
-        return false;
+    term_puts(line);
+    ctx.shown = true;
+}
+
+// appelé entre deux blocs : n'affiche qu'à intervalle fixe
+static void copy_progress(uint64_t done, void* user)
+{
+    CopyCtx& ctx = *static_cast<CopyCtx*>(user);
+    if (!ctx.opts->progress) {
+        return;
     }
-    if (path_eq(canon, "/dev/null")) {
-        return true;
+    uint32_t now = millis();
+    if (now - ctx.start_ms < kCopyProgressDelayMs ||
+        now - ctx.last_ms < kCopyProgressEveryMs) {
+        return;
     }
+    ctx.last_ms = now;
+    copy_progress_line(ctx, ctx.base + done);
+}
 
-    char real[128];
-    if (!fs_resolve_media_path(path, real, sizeof(real))) {
+static bool copy_file(const VfsPath& src, const VfsPath& dst, CopyCtx& ctx)
+{
+    VfsFile in;
+    if (!vfs_open(src, VFS_OPEN_READ, in)) {
         return false;
     }
 
-    FILE* f = fopen(real, "wb");
-    if (!f) {
+    VfsFile out;
+    if (!vfs_open(dst, VFS_OPEN_WRITE, out)) {
+        vfs_close(in);
         return false;
     }
-    size_t written = 0;
-    if (len > 0) {
-        written = fwrite(data, 1, len, f);
+
+    // FAT : la chaîne de la destination est allouée d'avance (f_lseek au
+    // bout, voir posix_truncate), les écritures ne l'étendent plus
+    int32_t size = vfs_seek(in, 0, SEEK_END);
+    vfs_seek(in, 0, SEEK_SET);
+    bool reserved = false;
+    if (size > 0 && dst.mount->fat_drive) {
+        reserved = vfs_truncate(out, (uint32_t)size);
+    }
+
+    int64_t n = io_copy(in, out, kIoCopyChunkSize, copy_progress, &ctx);
+    bool ok = n >= 0;
+    if (ok && reserved && n != size) {
+        // la source a changé pendant la copie
+        ok = vfs_truncate(out, (uint32_t)n);
     }
-    fclose(f);
-    return written == len;
+
+    vfs_close(in);
+    if (!vfs_close(out)) {
+        ok = false;
+    }
+    if (ok) {
+        ctx.stats->files++;
+        ctx.stats->bytes += (uint64_t)n;
+        ctx.base += (uint64_t)n;
+    }
+    return ok;
 }
 
-bool fs_append_file(const char* path, const unsigned char* data, size_t len)
+static bool copy_size_visit(const FsWalkEntry& e, void* user)
 {
-    char canon[128];
-    fs_norm(cwd, path, canon, sizeof(canon));
-    if (path_eq(canon, "/dev/console")) {
-        if (len > 0) {
-            Serial.write(data, len);
-            Serial.flush();
-        }
-        return true;
-    }
-    if (path_eq(canon, "/dev/stdout")) {
-        if (len > 0) {
-            term_write_bytes(reinterpret_cast<const char*>(data), len);
-        }
-        return true;
+    if (!e.is_dir) {
+        *static_cast<uint64_t*>(user) += e.size;
     }
-    if (path_eq(canon, "/dev/stderr")) {
-        if (len > 0) {
-            term_write_bytes_error(reinterpret_cast<const char*>(data), len);
+    return true;
+}
+
+static bool copy_tree_visit(const FsWalkEntry& e, void* user)
+{
+    CopyCtx& ctx = *static_cast<CopyCtx*>(user);
+
+    std::string target = ctx.dst_root->virt;
+    target += e.path + ctx.src_len;
+    VfsPath dst;
+    vfs_resolve("/", target.c_str(), dst);
+
+    if (e.is_dir) {
+        FsStat st;
+        if (vfs_stat(dst, st)) {
+            if (!st.is_dir) {
+                ctx.ok = false;
+                return false;
+            }
+        } else if (!vfs_mkdir(dst)) {
+            ctx.ok = false;
+            return false;
         }
+        ctx.stats->dirs++;
         return true;
     }
-    if (path_eq(canon, "/dev/tty")) {
-        if (len > 0) {
-            term_write_bytes(reinterpret_cast<const char*>(data), len);
-        }
-        return true;
+    if (!copy_file(*e.vpath, dst, ctx)) {
+        ctx.ok = false;
+        return false;
     }
-    if (path_eq(canon, "/dev/kmsg")) {
-        if (len > 0) {
-            Serial.write(data, len);
-            Serial.flush();
-        }
-        return true;
+    return true;
+}
+
+// cp <src> <dir> copie dans <dir>/<nom de src>
+static void copy_target(const VfsPath& src, const char* dst, VfsPath& out)
+{
+    fs_resolve(dst, out);
+    FsStat st;
+    if (!vfs_stat(out, st) || !st.is_dir) {
+        return;
+    }
+    size_t slash = src.virt.find_last_of('/');
+    std::string name = src.virt.substr(slash + 1);
+    if (name.empty()) {
+        return;
+    }
+    std::string joined = out.virt;
+    joined += '/';
+    joined += name;
+    vfs_resolve("/", joined.c_str(), out);
+}
+
+static bool copy_paths(const VfsPath& src, const VfsPath& dst,
+    const FsCopyOptions& opts, FsCopyStats& stats)
+{
+    FsStat st;
+    if (!vfs_stat(src, st)) {
+        return false;
     }
-    if (path_eq(canon, "/dev/full")) {
+    if (st.is_dir && !opts.recursive) {
         return false;
     }
-    if (path_eq(canon, "/dev/null")) {
-        return true;
+    // flux sans fin : dd avec count=
+    if (st.is_stream) {
+        return false;
     }
-
-    char real[128];
-    if (!fs_resolve_media_path(path, real, sizeof(real))) {
+    if (src.virt == dst.virt) {
         return false;
     }
 
-    FILE* f = fopen(real, "ab");
-    if (!f) {
-        return false;
+    CopyCtx ctx;
+    ctx.opts = &opts;
+    ctx.stats = &stats;
+    ctx.total = st.size;
+    ctx.base = 0;
+    ctx.start_ms = millis();
+    ctx.last_ms = ctx.start_ms;
+    ctx.shown = false;
+    ctx.dst_root = &dst;
+    ctx.src_len = (src.virt == "/") ? 0 : src.virt.size();
+    ctx.ok = true;
+
+    bool ok = false;
+    if (!st.is_dir) {
+        ok = copy_file(src, dst, ctx);
+    } else if (!vfs_path_under(dst.virt.c_str(), src.virt.c_str())) {
+        // pas de copie d'un répertoire dans lui-même
+        FsWalkOptions wopts;
+        if (opts.progress) {
+            ctx.total = 0;
+            fs_walk(src, wopts, copy_size_visit, &ctx.total);
+        }
+        wopts.depth_limited = &stats.depth_limited;
+        ok = fs_walk(src, wopts, copy_tree_visit, &ctx) && ctx.ok;
     }
-    size_t written = 0;
-    if (len > 0) {
-        written = fwrite(data, 1, len, f);
+
+    if (ctx.shown) {
+        copy_progress_line(ctx, ctx.base);
+        term_putc('\n');
     }
-    fclose(f);
-    return written == len;
+    stats.elapsed_ms = millis() - ctx.start_ms;
+    return ok;
 }
 
-bool fs_list_entries(const char* path, std::vector<FsEntry>& out,
-    bool include_hidden)
+bool fs_copy(const char* src, const char* dst, const FsCopyOptions& opts,
+    FsCopyStats& stats)
 {
-    out.clear();
+    stats = FsCopyStats();
+    VfsPath p_src;
+    VfsPath p_dst;
+    fs_resolve(src, p_src);
+    copy_target(p_src, dst, p_dst);
+    append_cache_flush(p_src.virt.c_str(), false);
+    path_changed(p_dst);
+    return copy_paths(p_src, p_dst, opts, stats);
+}
 
-    char canon[128];
-    fs_norm(cwd, path, canon, sizeof(canon));
+bool fs_cp(const char* src, const char* dst)
+{
+    FsCopyOptions opts;
+    FsCopyStats stats;
+    return fs_copy(src, dst, opts, stats);
+}
 
-    if (path_eq(canon, "/")) {
-        out.push_back({ "bin", true });
-        out.push_back({ "dev", true });
-        out.push_back({ "media", true });
+bool fs_mv(const char* src, const char* dst)
+{
+    VfsPath p_src;
+    VfsPath p_dst;
+    fs_resolve(src, p_src);
+    copy_target(p_src, dst, p_dst);
+    path_changed(p_src);
+    path_changed(p_dst);
+
+    if (vfs_rename(p_src, p_dst)) {
         return true;
     }
 
-    if (path_eq(canon, "/bin")) {
-        list_bin_entries(out, include_hidden);
-        return true;
+    // autre montage : copie puis suppression
+    FsCopyOptions opts;
+    opts.recursive = true;
+    FsCopyStats stats;
+    // copie incomplète : la source reste
+    if (!copy_paths(p_src, p_dst, opts, stats) || stats.depth_limited) {
+        return false;
     }
-
-    if (path_eq(canon, "/dev")) {
-        for (size_t i = 0; i < sizeof(k_dev_entries) / sizeof(k_dev_entries[0]); i++) {
-            out.push_back({ k_dev_entries[i], false });
-        }
-        return true;
+    FsStat st;
+    if (vfs_stat(p_src, st) && st.is_dir) {
+        return fs_rm_recursive(p_src.virt.c_str());
     }
+    return vfs_remove(p_src);
+}
 
-    if (path_eq(canon, "/media")) {
-        if (sd_is_mounted()) {
-            out.push_back({ "0", true });
+bool fs_replace(const VfsPath& tmp, const VfsPath& path)
+{
+    // nom réservé à l'éditeur : un <path>~ de l'utilisateur n'est
+    // jamais touché
+    std::string bak_name = path.virt + ".swp~";
+    VfsPath bak;
+    fs_resolve(bak_name.c_str(), bak);
+    path_changed(tmp);
+    path_changed(path);
+    path_changed(bak);
+
+    // FAT ne renomme pas sur un fichier existant
+    FsStat st;
+    bool had = vfs_stat(path, st);
+    if (had) {
+        if (vfs_stat(bak, st) && st.is_file) {
+            vfs_remove(bak);    // reste d'un enregistrement interrompu
         }
-        return true;
-    }
-
-    if (path_eq(canon, "/media/0")) {
-        if (!sd_is_mounted())
+        if (!vfs_rename(path, bak)) {
             return false;
-        return list_sd_dir_entries("/sdcard", out, include_hidden);
-    }
-
-    if (strncmp(canon, "/media/0/", 9) == 0) {
-        if (!sd_is_mounted())
-            return false;
-
-        char real[128];
-        snprintf(real, sizeof(real), "/sdcard/%s", canon + 9);
-        return list_sd_dir_entries(real, out, include_hidden);
+        }
     }
-
-    return false;
-}
-
-bool fs_mkdir(const char* path)
-{
-    char real[128];
-    if (!fs_resolve_media_path(path, real, sizeof(real))) {
+    if (!vfs_rename(tmp, path)) {
+        if (had) {
+            vfs_rename(bak, path);
+        }
         return false;
     }
-    return mkdir(real, 0777) == 0;
+    // le nouveau contenu et son entrée de répertoire sur la carte avant
+    // que l'ancien disparaisse ; sinon la copie de secours reste
+    if (had && fs_sync()) {
+        vfs_remove(bak);
+    }
+    path_changed(path);
+    path_changed(bak);
+    return true;
 }
 
-bool fs_rmdir(const char* path)
+// ------------------------------------------------------------
+// dd
+// ------------------------------------------------------------
+
+// Copie bloc par bloc, sans tampon intermédiaire : mesure la pile
+// VFS / FatFS / pilote pour une taille de bloc donnée.
+bool fs_dd(const FsDdOptions& opts, FsDdStats& stats)
 {
-    char real[128];
-    if (!fs_resolve_media_path(path, real, sizeof(real))) {
+    stats = FsDdStats();
+    if (opts.block_size == 0 || opts.block_size > kFsDdMaxBlock) {
         return false;
     }
-    return rmdir(real) == 0;
-}
 
-bool fs_rm(const char* path)
-{
-    char real[128];
-    if (!fs_resolve_media_path(path, real, sizeof(real))) {
+    VfsPath p_in;
+    VfsPath p_out;
+    fs_resolve(opts.in, p_in);
+    fs_resolve(opts.out, p_out);
+    if (p_in.virt == p_out.virt) {
         return false;
     }
-    return remove(real) == 0;
-}
+    append_cache_flush(p_in.virt.c_str(), false);
+    path_changed(p_out);
 
-bool fs_cp(const char* src, const char* dst)
-{
-    char real_src[128];
-    char real_dst[128];
-    if (!fs_resolve_media_path(src, real_src, sizeof(real_src))) {
+    FsStat st;
+    if (!vfs_stat(p_in, st) || st.is_dir) {
         return false;
     }
-    if (!fs_resolve_media_path(dst, real_dst, sizeof(real_dst))) {
+    if (st.is_stream && opts.count == 0) {
         return false;
     }
 
-    FILE* in = fopen(real_src, "r");
-    if (!in) {
+    VfsFile in;
+    if (!vfs_open(p_in, VFS_OPEN_READ, in)) {
         return false;
     }
-
-    FILE* out = fopen(real_dst, "w");
-    if (!out) {
-        fclose(in);
+    VfsFile out;
+    if (!vfs_open(p_out, VFS_OPEN_WRITE, out)) {
+        vfs_close(in);
+        return false;
+    }
+    uint8_t* buf = static_cast<uint8_t*>(
+        heap_caps_malloc(opts.block_size, MALLOC_CAP_DMA));
+    if (!buf) {
+        vfs_close(in);
+        vfs_close(out);
         return false;
     }
 
-    char buf[256];
-    size_t n = 0;
-    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
-        if (fwrite(buf, 1, n, out) != n) {
-            fclose(in);
-            fclose(out);
-            return false;
+    bool ok = true;
+    uint32_t start = millis();
+    while (opts.count == 0 || stats.blocks_in + stats.partial_in < opts.count) {
+        int n = vfs_read(in, buf, opts.block_size);
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        if ((size_t)n == opts.block_size) {
+            stats.blocks_in++;
+        } else {
+            stats.partial_in++;
         }
+        if (vfs_write(out, buf, (size_t)n) != n) {
+            ok = false;
+            break;
+        }
+        if ((size_t)n == opts.block_size) {
+            stats.blocks_out++;
+        } else {
+            stats.partial_out++;
+        }
+        stats.bytes += (uint64_t)n;
     }
-
-    fclose(in);
-    fclose(out);
-    return true;
+    // le temps inclut la fermeture : données réellement écrites
+    if (!vfs_close(out)) {
+        ok = false;
+    }
+    stats.elapsed_ms = millis() - start;
+    vfs_close(in);
+    heap_caps_free(buf);
+    return ok;
 }
 
-bool fs_mv(const char* src, const char* dst)
+// ------------------------------------------------------------
+// gzip / gunzip
+// ------------------------------------------------------------
+
+static bool gunzip_to(VfsFile& in, VfsFile& out, FsGzipStats& stats)
 {
-    char real_src[128];
-    char real_dst[128];
-    if (!fs_resolve_media_path(src, real_src, sizeof(real_src))) {
+    GzReader gz;
+    if (!gz.begin(in)) {
         return false;
     }
-    if (!fs_resolve_media_path(dst, real_dst, sizeof(real_dst))) {
+    IoWriter writer;
+    if (!writer.begin(out, kIoCopyChunkSize) && !writer.begin(out)) {
         return false;
     }
-
-    if (rename(real_src, real_dst) == 0) {
-        return true;
+    const uint8_t* data = nullptr;
+    int n = 0;
+    bool ok = true;
+    while (ok && (n = gz.next(&data)) > 0) {
+        ok = writer.write(data, (size_t)n);
+        stats.out_bytes += (uint64_t)n;
+    }
+    if (!writer.finish() || n < 0) {
+        ok = false;
     }
+    stats.in_bytes = gz.in_bytes();
+    gz.end();
+    return ok;
+}
 
-    if (!fs_cp(src, dst)) {
+bool fs_gzip(const char* src, const char* dst, bool decompress,
+    FsGzipStats& stats)
+{
+    stats = FsGzipStats();
+    VfsPath p_in;
+    VfsPath p_out;
+    fs_resolve(src, p_in);
+    fs_resolve(dst, p_out);
+    if (p_in.virt == p_out.virt) {
         return false;
     }
+    FsStat st;
+    if (!vfs_stat(p_in, st) || !st.is_file || st.is_stream) {
+        return false;
+    }
+    append_cache_flush(p_in.virt.c_str(), false);
+    path_changed(p_out);
 
-    return fs_rm(src);
+    VfsFile in;
+    if (!vfs_open(p_in, VFS_OPEN_READ, in)) {
+        return false;
+    }
+    VfsFile out;
+    if (!vfs_open(p_out, VFS_OPEN_WRITE, out)) {
+        vfs_close(in);
+        return false;
+    }
+    uint32_t start = millis();
+    bool ok = decompress
+        ? gunzip_to(in, out, stats)
+        : gz_compress(in, out, stats.in_bytes, stats.out_bytes, stats.stored);
+    vfs_close(in);
+    if (!vfs_close(out)) {
+        ok = false;
+    }
+    // un .gz plus gros que l'original ne remplace rien
+    if (ok && !decompress && stats.out_bytes >= stats.in_bytes) {
+        stats.not_smaller = true;
+        ok = false;
+    }
+    stats.elapsed_ms = millis() - start;
+    if (!ok) {
+        // pas de demi-fichier
+        vfs_remove(p_out);
+    }
+    path_changed(p_out);
+    return ok;
 }
 
 bool fs_touch(const char* path)
 {
-    char real[128];
-    if (!fs_resolve_media_path(path, real, sizeof(real))) {
-        return false;
-    }
+    VfsPath p;
+    fs_resolve(path, p);
+    stat_cache_invalidate(p.virt.c_str());
 
-    FILE* f = fopen(real, "a");
-    if (!f) {
+    VfsFile f;
+    if (!vfs_open(p, VFS_OPEN_APPEND, f)) {
         return false;
     }
-    fclose(f);
-    return true;
+    return vfs_close(f);
 }
 
-bool fs_read_file(const char* path, std::string& out)
+bool fs_find(const char* path, const FsFindOptions& opts)
 {
-    out.clear();
+    const char* in_path = (path && *path) ? path : ".";
 
-    char canon[128];
-    fs_norm(cwd, path, canon, sizeof(canon));
-    if (path_eq(canon, "/dev/zero")) {
-        append_hex_sample(out, 128, false);
-        return true;
-    }
-    if (path_eq(canon, "/dev/random") || path_eq(canon, "/dev/urandom")) {
-        append_hex_sample(out, 128, true);
-        return true;
-    }
+    VfsPath root;
+    fs_resolve(in_path, root);
 
-    char real[128];
-    if (!fs_resolve_media_path(path, real, sizeof(real))) {
-        return false;
-    }
+    FindCtx ctx;
+    ctx.opts = &opts;
 
-    FILE* f = fopen(real, "rb");
-    if (!f) {
-        return false;
-    }
+    FsWalkOptions wopts;
+    wopts.max_depth = opts.max_depth;
 
-    int ch = 0;
-    while ((ch = fgetc(f)) != EOF) {
-        if (ch == '\r') {
-            continue;
-        }
-        out.push_back((char)ch);
+    term_batch_begin();
+    bool ok = fs_walk(root, wopts, find_visit, &ctx);
+    find_flush(ctx, true);
+    term_batch_end();
+    return ok;
+}
+
+// ------------------------------------------------------------
+// du
+// ------------------------------------------------------------
+
+// Un répertoire en cours : ses sommes montent dans le parent à la
+// visite post-ordre.
+struct DuFrame {
+    SizeCacheEntry sum;
+    uint32_t mtime;
+    bool cached;
+};
+
+struct DuCtx {
+    const FsDuOptions* opts;
+    std::vector<DuFrame> stack;
+    std::vector<FsDuEntry>* out;
+    FsDuStats* stats;
+    size_t root_len;
+};
+
+static bool du_greater(const FsDuEntry& a, const FsDuEntry& b)
+{
+    if (a.bytes != b.bytes) {
+        return a.bytes > b.bytes;
     }
-    fclose(f);
-    return true;
+    return a.path < b.path;
 }
 
-bool fs_find(const char* path, const char* pattern, bool case_insensitive)
+// -n N : tas des N plus grosses (la plus petite en tête)
+static void du_add(DuCtx& ctx, const FsWalkEntry& e, uint64_t bytes)
 {
-    const char* in_path = (path && *path) ? path : ".";
+    if (e.depth == 0 || e.depth > ctx.opts->max_depth) {
+        return;
+    }
+    std::vector<FsDuEntry>& out = *ctx.out;
+    const size_t top = ctx.opts->top;
+    if (top && out.size() == top && bytes <= out.front().bytes) {
+        return;
+    }
+    FsDuEntry entry;
+    entry.path.assign(e.path + ctx.root_len);
+    if (e.is_dir) {
+        entry.path += '/';
+    }
+    entry.bytes = bytes;
+    if (!top) {
+        out.push_back(std::move(entry));
+        return;
+    }
+    if (out.size() == top) {
+        std::pop_heap(out.begin(), out.end(), du_greater);
+        out.pop_back();
+    }
+    out.push_back(std::move(entry));
+    std::push_heap(out.begin(), out.end(), du_greater);
+}
 
-    char canon[128];
-    fs_norm(cwd, in_path, canon, sizeof(canon));
+static bool du_visit(const FsWalkEntry& e, void* user)
+{
+    DuCtx& ctx = *static_cast<DuCtx*>(user);
 
-    if (path_eq(canon, "/")) {
-        if (!pattern || match_pattern("bin", pattern, case_insensitive)) {
-            term_puts("/bin\n");
-        }
-        if (!pattern || match_pattern("dev", pattern, case_insensitive)) {
-            term_puts("/dev\n");
-        }
-        if (!pattern || match_pattern("media", pattern, case_insensitive)) {
-            term_puts("/media\n");
-        }
-        if (sd_is_mounted()) {
-            if (!pattern || match_pattern("0", pattern, case_insensitive)) {
-                term_puts("/media/0\n");
-            }
-            return find_walk("/sdcard", pattern, case_insensitive, false);
+    if (!e.is_dir) {
+        if (ctx.stack.empty()) {
+            // du sur un fichier
+            ctx.stats->bytes = e.size;
+            ctx.stats->files = 1;
+            return true;
         }
+        SizeCacheEntry& sum = ctx.stack.back().sum;
+        sum.bytes += e.size;
+        sum.files++;
+        du_add(ctx, e, e.size);
         return true;
     }
 
-    if (path_eq(canon, "/bin")) {
-        const char* names[] = {
-            "ls", "pwd", "cd", "mount", "umount",
-            "mkdir", "rmdir", "cp", "mv", "rm",
-            "vi", "touch", "cat", "more", "find",
-            "uptime"
-        };
-        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
-            if (!pattern || match_pattern(names[i], pattern, case_insensitive)) {
-                term_puts("/bin/");
-                term_puts(names[i]);
-                term_putc('\n');
-            }
+    if (!e.post) {
+        DuFrame frame;
+        frame.mtime = e.mtime;
+        frame.cached = false;
+        // sous-arbre dont le détail n'est pas affiché : repris du cache
+        if (e.depth >= ctx.opts->max_depth && e.prune &&
+            size_cache_lookup(e.path, e.mtime, frame.sum)) {
+            frame.cached = true;
+            *e.prune = true;
+            ctx.stats->cached_dirs++;
         }
+        ctx.stack.push_back(frame);
         return true;
     }
 
-    if (path_eq(canon, "/dev")) {
-        for (size_t i = 0; i < sizeof(k_dev_entries) / sizeof(k_dev_entries[0]); i++) {
-            if (!pattern || match_pattern(k_dev_entries[i], pattern, case_insensitive)) {
-                term_puts("/dev/");
-                term_puts(k_dev_entries[i]);
-                term_putc('\n');
-            }
-        }
+    if (ctx.stack.empty()) {
         return true;
     }
+    DuFrame frame = ctx.stack.back();
+    ctx.stack.pop_back();
+    if (!frame.cached) {
+        size_cache_store(e.path, frame.mtime, frame.sum);
+    }
+    du_add(ctx, e, frame.sum.bytes);
+    if (ctx.stack.empty()) {
+        ctx.stats->bytes = frame.sum.bytes;
+        ctx.stats->files = frame.sum.files;
+        ctx.stats->dirs = frame.sum.dirs;
+        return true;
+    }
+    SizeCacheEntry& parent = ctx.stack.back().sum;
+    parent.bytes += frame.sum.bytes;
+    parent.files += frame.sum.files;
+    parent.dirs += frame.sum.dirs + 1;
+    return true;
+}
 
-    if (path_eq(canon, "/media")) {
-        if (sd_is_mounted()) {
-            if (!pattern || match_pattern("0", pattern, case_insensitive)) {
-                term_puts("/media/0\n");
-            }
+bool fs_du(const char* path, const FsDuOptions& opts,
+    std::vector<FsDuEntry>& out, FsDuStats& stats)
+{
+    out.clear();
+    stats = FsDuStats();
+
+    VfsPath root;
+    fs_resolve((path && *path) ? path : ".", root);
+    // les ajouts en attente comptent dans les tailles
+    append_cache_flush(root.virt.c_str(), false);
+
+    DuCtx ctx;
+    ctx.opts = &opts;
+    ctx.out = &out;
+    ctx.stats = &stats;
+    ctx.root_len = root.virt.size();
+    if (root.virt != "/") {
+        ctx.root_len++;
+    }
+    ctx.stack.reserve(16);
+
+    FsWalkOptions wopts;
+    wopts.post_order = true;
+    wopts.depth_limited = &stats.depth_limited;
+
+    uint32_t start = millis();
+    bool ok = fs_walk(root, wopts, du_visit, &ctx);
+    std::sort(out.begin(), out.end(), du_greater);
+    stats.elapsed_ms = millis() - start;
+    return ok;
+}
+
+// ------------------------------------------------------------
+// rm -r
+// ------------------------------------------------------------
+
+static bool rm_tree_visit(const FsWalkEntry& e, void* user)
+{
+    bool* ok = static_cast<bool*>(user);
+    if (!e.is_dir) {
+        if (!vfs_remove(*e.vpath)) {
+            *ok = false;
+        }
+    } else if (e.post) {
+        if (!vfs_rmdir(*e.vpath)) {
+            *ok = false;
         }
-        return true;
     }
+    return true;
+}
 
-    char real[128];
-    if (!fs_resolve_media_path(canon, real, sizeof(real))) {
+bool fs_rm_recursive(const char* path, bool* depth_limited)
+{
+    VfsPath p;
+    fs_resolve(path, p);
+
+    // ni répertoire synthétique, ni racine d'un montage
+    if (!p.mount || !*p.rel_path()) {
         return false;
     }
+    path_changed(p);
 
-    return find_walk(real, pattern, case_insensitive, true);
+    FsWalkOptions wopts;
+    wopts.post_order = true;
+    wopts.depth_limited = depth_limited;
+    bool ok = true;
+    if (!fs_walk(p, wopts, rm_tree_visit, &ok)) {
+        return false;
+    }
+    return ok;
 }
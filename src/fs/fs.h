@@ -1,31 +1,140 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <stddef.h>
 
+// point de montage virtuel de la carte SD
+#define FS_SD_MOUNT_POINT "/media/0"
+// tmpfs en RAM
+#define FS_TMP_MOUNT_POINT "/tmp"
+// LittleFS en flash interne
+#define FS_FLASH_MOUNT_POINT "/flash"
+
+struct VfsPath;
+
 struct FsEntry {
     std::string name;
     bool is_dir;
 };
 
+struct FsFindOptions {
+    const char* pattern = nullptr;
+    bool case_insensitive = false;
+    int max_depth = -1;         // -1 = illimité
+    char type = 0;              // 'f', 'd' ou 0 (tous)
+    bool has_size = false;
+    int size_cmp = 0;           // -1 : moins de, 0 : égal, 1 : plus de
+    uint32_t size_value = 0;    // exprimé en size_unit octets
+    uint32_t size_unit = 1;
+};
+
+struct FsCopyOptions {
+    bool recursive = false;     // -r : copie les répertoires
+    bool progress = false;      // ligne de progression sur le terminal
+};
+
+struct FsCopyStats {
+    uint32_t files = 0;
+    uint32_t dirs = 0;
+    uint64_t bytes = 0;
+    uint32_t elapsed_ms = 0;
+    bool depth_limited = false; // sous-arbres trop profonds non copiés
+};
+
+struct FsDdOptions {
+    const char* in = "/dev/zero";
+    const char* out = "/dev/null";
+    size_t block_size = 512;
+    uint32_t count = 0;         // 0 = jusqu'à la fin de l'entrée
+};
+
+struct FsDdStats {
+    uint32_t blocks_in = 0;     // blocs complets
+    uint32_t partial_in = 0;
+    uint32_t blocks_out = 0;
+    uint32_t partial_out = 0;
+    uint64_t bytes = 0;
+    uint32_t elapsed_ms = 0;
+};
+
+struct FsSpace {
+    uint64_t total = 0;
+    uint64_t free = 0;
+    bool known = true;          // false : free pas encore calculé
+    bool updating = false;      // comptage en cours (carte SD)
+};
+
+struct FsGzipStats {
+    uint64_t in_bytes = 0;
+    uint64_t out_bytes = 0;
+    uint32_t elapsed_ms = 0;
+    bool not_smaller = false;   // compression : sortie pas plus petite, effacée
+    bool stored = false;        // compression : pas de mémoire, rien compressé
+};
+
+struct FsDuOptions {
+    int max_depth = 1;          // entrées listées jusqu'à cette profondeur
+    size_t top = 0;             // garde les N plus grosses (0 = toutes)
+};
+
+struct FsDuEntry {
+    std::string path;           // relatif à la racine ; '/' final = dossier
+    uint64_t bytes;
+};
+
+struct FsDuStats {
+    uint64_t bytes = 0;         // total sous la racine
+    uint32_t files = 0;
+    uint32_t dirs = 0;
+    uint32_t cached_dirs = 0;   // sous-arbres repris du cache
+    uint32_t elapsed_ms = 0;
+    bool depth_limited = false; // sous-arbres trop profonds non comptés
+};
+
+typedef void (*FsBlockFn)(const uint8_t* data, size_t len, void* user);
+
+static constexpr size_t kFsDdMaxBlock = 64 * 1024;
+
 struct FsStat {
     uint32_t size;
     bool is_dir;
     bool is_file;
+    bool is_stream = false;     // périphérique sans fin (/dev/zero…)
+    uint32_t mtime = 0;         // date brute du backend ; 0 = inconnue
 };
 
 // état
 bool fs_sd_mounted();
+bool fs_flash_mounted();
+
+// répertoire des fichiers d'état (réglages, historique) : /flash si
+// disponible, sinon la carte SD ; nullptr si aucun support persistant
+const char* fs_state_dir();
 
 // cwd
 const char* fs_pwd();
 bool fs_cd(const char* path);
 
+// résout path (relatif à cwd) via la table de montage, une seule fois
+bool fs_resolve(const char* path, VfsPath& out);
+// à appeler avant de modifier path sans passer par fs_* (vfs_open direct) :
+// oublie ses métadonnées en cache et ferme son descripteur d'ajout
+void fs_invalidate(const char* path);
+
 // montage / démontage
+void fs_init();
 bool fs_mount();
 void fs_umount();
 
+// écritures différées : sync force, idle vide après inactivité
+bool fs_sync();
+void fs_idle();
+
+// espace du montage contenant path ; immédiat (pas de parcours de FAT)
+bool fs_space(const char* path, FsSpace& out);
+
 // listage
 bool fs_list(const char* path, const char* opts);
 bool fs_list_entries(const char* path, std::vector<FsEntry>& out,
@@ -40,8 +149,27 @@ bool fs_resolve_real_path(const char* path, char* out, size_t out_sz);
 bool fs_mkdir(const char* path);
 bool fs_rmdir(const char* path);
 bool fs_rm(const char* path);
+// depth_limited : mis à true si des sous-arbres trop profonds sont restés
+bool fs_rm_recursive(const char* path, bool* depth_limited = nullptr);
 bool fs_mv(const char* src, const char* dst);
+// remplace path par tmp, déjà écrit et synchronisé. L'original devient
+// <path>.swp~ le temps des renommages et n'est supprimé qu'après fs_sync() :
+// une coupure laisse toujours l'un des deux sur la carte. false si tmp
+// n'a pas pu prendre la place de path (l'original est alors remis).
+bool fs_replace(const VfsPath& tmp, const VfsPath& path);
 bool fs_cp(const char* src, const char* dst);
+bool fs_copy(const char* src, const char* dst, const FsCopyOptions& opts,
+    FsCopyStats& stats);
+bool fs_dd(const FsDdOptions& opts, FsDdStats& stats);
+bool fs_gzip(const char* src, const char* dst, bool decompress,
+    FsGzipStats& stats);
 bool fs_touch(const char* path);
+// texte sans '\r' ; un fichier *.gz est décompressé au vol
 bool fs_read_file(const char* path, std::string& out);
-bool fs_find(const char* path, const char* pattern, bool case_insensitive);
+// contenu brut bloc par bloc (sommes de contrôle, compression)
+bool fs_read_blocks(const char* path, FsBlockFn fn, void* user);
+bool fs_find(const char* path, const FsFindOptions& opts);
+// entrées triées par taille décroissante ; les sous-arbres inchangés
+// depuis le dernier passage sont repris du cache sans être relus
+bool fs_du(const char* path, const FsDuOptions& opts,
+    std::vector<FsDuEntry>& out, FsDuStats& stats);
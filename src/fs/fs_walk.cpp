@@ -0,0 +1,157 @@
+#include "fs_walk.h"
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "vfs.h"
+
+// ------------------------------------------------------------
+// Pile explicite
+// ------------------------------------------------------------
+
+// Un niveau de la pile : le répertoire ouvert et la position du chemin
+// du répertoire dans le VfsPath partagé (le chemin n'est jamais recopié).
+struct WalkFrame {
+    VfsDir dir;
+    VfsPathMark mark;
+};
+
+static const char* walk_basename(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) {
+        return path.c_str();
+    }
+    return path.c_str() + slash + 1;
+}
+
+static bool walk_visit(const VfsPath& path, uint32_t size, uint32_t mtime,
+    int depth, bool is_dir, bool post, FsWalkFn fn, void* ctx,
+    bool* prune = nullptr)
+{
+    FsWalkEntry e;
+    e.path = path.virt.c_str();
+    e.name = walk_basename(path.virt);
+    e.vpath = &path;
+    e.size = size;
+    e.mtime = mtime;
+    e.depth = depth;
+    e.is_dir = is_dir;
+    e.post = post;
+    e.prune = prune;
+    return fn(e, ctx);
+}
+
+static void walk_close_all(std::vector<WalkFrame>& stack)
+{
+    while (!stack.empty()) {
+        vfs_closedir(stack.back().dir);
+        stack.pop_back();
+    }
+}
+
+// ------------------------------------------------------------
+// Parcours
+// ------------------------------------------------------------
+
+bool fs_walk(const VfsPath& root, const FsWalkOptions& opts,
+    FsWalkFn fn, void* ctx)
+{
+    if (!fn) {
+        return false;
+    }
+
+    VfsPath path = root;
+    path.virt.reserve(256);
+
+    FsStat st;
+    if (!vfs_stat(path, st)) {
+        return false;
+    }
+
+    bool prune = false;
+    if (opts.include_root) {
+        if (!walk_visit(path, st.size, st.mtime, 0, st.is_dir, false, fn, ctx,
+                &prune)) {
+            return true;
+        }
+    }
+    if (!st.is_dir) {
+        return true;
+    }
+
+    std::vector<WalkFrame> stack;
+    stack.reserve(8);
+
+    const bool descend_root = !prune &&
+        (opts.max_depth < 0 || opts.max_depth > 0);
+    if (descend_root) {
+        stack.emplace_back();
+        stack.back().mark = vfs_path_mark(path);
+        if (!vfs_opendir(path, stack.back().dir)) {
+            return false;
+        }
+    } else if (opts.post_order && opts.include_root) {
+        walk_visit(path, 0, 0, 0, true, true, fn, ctx);
+    }
+
+    VfsDirent ent;
+    while (!stack.empty()) {
+        if (!vfs_readdir(stack.back().dir, ent)) {
+            vfs_path_reset(path, stack.back().mark);
+            vfs_closedir(stack.back().dir);
+            stack.pop_back();
+            if (opts.post_order && (!stack.empty() || opts.include_root)) {
+                if (!walk_visit(path, 0, 0, (int)stack.size(), true, true,
+                        fn, ctx)) {
+                    walk_close_all(stack);
+                    return true;
+                }
+            }
+            continue;
+        }
+
+        vfs_path_reset(path, stack.back().mark);
+        vfs_path_push(path, ent.name.c_str());
+
+        const int depth = (int)stack.size();
+        prune = false;
+        if (!walk_visit(path, ent.size, ent.mtime, depth, ent.is_dir, false,
+                fn, ctx, ent.is_dir ? &prune : nullptr)) {
+            walk_close_all(stack);
+            return true;
+        }
+        if (!ent.is_dir) {
+            continue;
+        }
+
+        bool descend = !prune &&
+            (opts.max_depth < 0 || depth < opts.max_depth);
+        if (descend && depth >= kFsWalkDepthLimit) {
+            // résultat incomplet : l'appelant doit le dire
+            descend = false;
+            if (opts.depth_limited) {
+                *opts.depth_limited = true;
+            }
+        }
+        if (descend) {
+            WalkFrame frame;
+            frame.mark = vfs_path_mark(path);
+            if (vfs_opendir(path, frame.dir)) {
+                stack.push_back(std::move(frame));
+                continue;
+            }
+        }
+
+        // répertoire non parcouru : la visite post-ordre suit immédiatement
+        if (opts.post_order) {
+            if (!walk_visit(path, 0, ent.mtime, depth, true, true, fn, ctx)) {
+                walk_close_all(stack);
+                return true;
+            }
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+struct VfsPath;
+
+// Parcours itératif d'une arborescence VFS (pile explicite sur le tas,
+// un seul VfsPath partagé par tous les niveaux).
+
+struct FsWalkEntry {
+    const char* path;   // chemin virtuel complet (valide pendant le callback)
+    const char* name;   // nom de l'entrée (pointe dans path)
+    const VfsPath* vpath;   // chemin résolu, utilisable avec vfs_*()
+    uint32_t size;
+    uint32_t mtime;     // date brute du backend ; 0 = inconnue
+    int depth;          // 0 = racine du parcours
+    bool is_dir;
+    bool post;          // visite post-ordre d'un répertoire (après ses enfants)
+    bool* prune;        // pré-ordre d'un répertoire : *prune = true pour
+                        // ne pas y descendre (la visite post-ordre suit)
+};
+
+// Retourne false pour interrompre le parcours.
+typedef bool (*FsWalkFn)(const FsWalkEntry& entry, void* ctx);
+
+struct FsWalkOptions {
+    int max_depth = -1;         // -1 = illimité
+    bool include_root = true;   // visite la racine elle-même
+    bool post_order = false;    // revisite les répertoires après leurs enfants
+    bool* depth_limited = nullptr;  // mis à true si kFsWalkDepthLimit a
+                                    // écarté un sous-arbre
+};
+
+// Profondeur maximale suivie par le walker (borne la pile sur le tas) ;
+// au-delà, les répertoires sont visités sans qu'on y descende.
+static constexpr int kFsWalkDepthLimit = 64;
+
+bool fs_walk(const VfsPath& root, const FsWalkOptions& opts,
+    FsWalkFn fn, void* ctx);
@@ -0,0 +1,814 @@
+#include "gzip.h"
+
+#include <string.h>
+#include <new>
+
+#include "esp_heap_caps.h"
+#include "rom/miniz.h"
+#include "core/checksum.h"
+
+// ------------------------------------------------------------
+// Format
+// ------------------------------------------------------------
+
+static constexpr uint8_t kGzId1 = 0x1f;
+static constexpr uint8_t kGzId2 = 0x8b;
+static constexpr uint8_t kGzDeflate = 8;
+
+static constexpr uint8_t kGzFlagHcrc = 0x02;
+static constexpr uint8_t kGzFlagExtra = 0x04;
+static constexpr uint8_t kGzFlagName = 0x08;
+static constexpr uint8_t kGzFlagComment = 0x10;
+static constexpr uint8_t kGzFlagReserved = 0xe0;
+
+static constexpr uint8_t kGzOsUnix = 3;
+
+// niveau 6 de miniz / gzip : bon compromis pour du texte
+static constexpr int kGzProbes = 128;
+
+// laissé libre après l'état tdefl (tampons d'E/S, autres tâches)
+static constexpr size_t kGzHeapMargin = 32 * 1024;
+// bloc deflate stocké : au plus 65535 octets
+static constexpr size_t kGzStoredMax = 0xffff;
+
+bool gz_is_magic(const uint8_t* data, size_t len)
+{
+    return len >= 2 && data[0] == kGzId1 && data[1] == kGzId2;
+}
+
+// ------------------------------------------------------------
+// GzReader
+// ------------------------------------------------------------
+
+GzReader::GzReader()
+    : in_ptr_(nullptr), in_avail_(0), in_eof_(false), in_total_(0),
+      back_len_(0), back_pos_(0), inf_(nullptr), dict_(nullptr),
+      dict_ofs_(0), out_ptr_(nullptr), out_avail_(0), crc_(0), size_(0),
+      state_(GZ_END)
+{
+}
+
+GzReader::~GzReader()
+{
+    end();
+}
+
+bool GzReader::begin(VfsFile& f)
+{
+    end();
+    inf_ = new (std::nothrow) tinfl_decompressor;
+    dict_ = new (std::nothrow) uint8_t[TINFL_LZ_DICT_SIZE];
+    if (!inf_ || !dict_ || !in_.begin(f)) {
+        end();
+        return false;
+    }
+    in_eof_ = false;
+    in_total_ = 0;
+    if (!read_header(true)) {
+        end();
+        return false;
+    }
+    return true;
+}
+
+void GzReader::end()
+{
+    in_.end();
+    delete inf_;
+    inf_ = nullptr;
+    delete[] dict_;
+    dict_ = nullptr;
+    in_ptr_ = nullptr;
+    in_avail_ = 0;
+    back_len_ = 0;
+    back_pos_ = 0;
+    out_avail_ = 0;
+    state_ = GZ_END;
+}
+
+int GzReader::in_byte()
+{
+    if (back_pos_ < back_len_) {
+        return back_[back_pos_++];
+    }
+    if (in_avail_ == 0) {
+        if (in_eof_) {
+            return -1;
+        }
+        int n = in_.next(&in_ptr_);
+        if (n <= 0) {
+            in_eof_ = true;
+            return -1;
+        }
+        in_avail_ = (size_t)n;
+        in_total_ += (uint64_t)n;
+    }
+    in_avail_--;
+    return *in_ptr_++;
+}
+
+// first : un fichier vide ou tronqué n'est pas du gzip ; ensuite, la
+// fin des données après un membre est la fin normale du flux
+bool GzReader::read_header(bool first)
+{
+    int id1 = in_byte();
+    if (id1 < 0 && !first) {
+        state_ = GZ_END;
+        return true;
+    }
+    int id2 = in_byte();
+    int method = in_byte();
+    int flags = in_byte();
+    if (id1 != kGzId1 || id2 != kGzId2 || method != kGzDeflate
+        || flags < 0 || (flags & kGzFlagReserved)) {
+        state_ = GZ_ERROR;
+        return false;
+    }
+    // mtime (4), xfl, os
+    for (int i = 0; i < 6; i++) {
+        if (in_byte() < 0) {
+            state_ = GZ_ERROR;
+            return false;
+        }
+    }
+    if (flags & kGzFlagExtra) {
+        int lo = in_byte();
+        int hi = in_byte();
+        if (lo < 0 || hi < 0) {
+            state_ = GZ_ERROR;
+            return false;
+        }
+        for (int n = lo | (hi << 8); n > 0; n--) {
+            if (in_byte() < 0) {
+                state_ = GZ_ERROR;
+                return false;
+            }
+        }
+    }
+    for (uint8_t flag : { kGzFlagName, kGzFlagComment }) {
+        if (!(flags & flag)) {
+            continue;
+        }
+        int c;
+        do {
+            c = in_byte();
+        } while (c > 0);
+        if (c < 0) {
+            state_ = GZ_ERROR;
+            return false;
+        }
+    }
+    if ((flags & kGzFlagHcrc) && (in_byte() < 0 || in_byte() < 0)) {
+        state_ = GZ_ERROR;
+        return false;
+    }
+
+    tinfl_init(inf_);
+    dict_ofs_ = 0;
+    crc_ = 0;
+    size_ = 0;
+    state_ = GZ_DATA;
+    return true;
+}
+
+bool GzReader::read_trailer()
+{
+    uint8_t t[8];
+    for (int i = 0; i < 8; i++) {
+        int c = in_byte();
+        if (c < 0) {
+            return false;
+        }
+        t[i] = (uint8_t)c;
+    }
+    uint32_t crc = (uint32_t)t[0] | ((uint32_t)t[1] << 8)
+        | ((uint32_t)t[2] << 16) | ((uint32_t)t[3] << 24);
+    uint32_t size = (uint32_t)t[4] | ((uint32_t)t[5] << 8)
+        | ((uint32_t)t[6] << 16) | ((uint32_t)t[7] << 24);
+    return crc == crc_ && size == size_;
+}
+
+// un appel à tinfl ; retourne les octets produits dans la fenêtre
+int GzReader::inflate_step()
+{
+    if (in_avail_ == 0 && !in_eof_) {
+        int n = in_.next(&in_ptr_);
+        if (n < 0) {
+            return -1;
+        }
+        in_eof_ = (n == 0);
+        in_avail_ = n > 0 ? (size_t)n : 0;
+        in_total_ += in_avail_;
+    }
+
+    // fenêtre circulaire : tinfl veut la place jusqu'au bout du tampon
+    size_t in_size = in_avail_;
+    size_t out_size = TINFL_LZ_DICT_SIZE - dict_ofs_;
+    uint8_t* out = dict_ + dict_ofs_;
+    tinfl_status status = tinfl_decompress(inf_, in_ptr_, &in_size, dict_,
+        out, &out_size, in_eof_ ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+    in_ptr_ += in_size;
+    in_avail_ -= in_size;
+
+    if (status < TINFL_STATUS_DONE
+        || (status == TINFL_STATUS_NEEDS_MORE_INPUT && in_eof_)) {
+        return -1;
+    }
+    crc_ = checksum_crc32(crc_, out, out_size);
+    size_ += (uint32_t)out_size;
+    out_ptr_ = out;
+    out_avail_ = out_size;
+    dict_ofs_ = (dict_ofs_ + out_size) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status == TINFL_STATUS_DONE) {
+        // tinfl a pu charger d'avance quelques octets du trailer dans
+        // son registre de bits : on les rend avant de lire la suite
+        uint32_t bits = inf_->m_num_bits;
+        uint64_t buf = (uint64_t)inf_->m_bit_buf >> (bits & 7);
+        back_len_ = (int)(bits >> 3);
+        back_pos_ = 0;
+        for (int i = 0; i < back_len_; i++) {
+            back_[i] = (uint8_t)buf;
+            buf >>= 8;
+        }
+        state_ = GZ_TRAILER;
+    }
+    return (int)out_size;
+}
+
+int GzReader::next(const uint8_t** data)
+{
+    for (;;) {
+        if (out_avail_ > 0) {
+            *data = out_ptr_;
+            int n = (int)out_avail_;
+            out_ptr_ += out_avail_;
+            out_avail_ = 0;
+            return n;
+        }
+        switch (state_) {
+        case GZ_DATA:
+            if (inflate_step() < 0) {
+                state_ = GZ_ERROR;
+            }
+            break;
+        case GZ_TRAILER:
+            if (!read_trailer()) {
+                state_ = GZ_ERROR;
+            } else {
+                read_header(false);
+            }
+            break;
+        case GZ_END:
+            return 0;
+        default:
+            return -1;
+        }
+    }
+}
+
+int GzReader::read(void* dst, size_t len)
+{
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    size_t done = 0;
+    while (done < len) {
+        if (out_avail_ == 0) {
+            const uint8_t* data = nullptr;
+            int n = next(&data);
+            if (n <= 0) {
+                if (n < 0 && done == 0) {
+                    return -1;
+                }
+                break;
+            }
+            // next() a tout rendu : on reprend la main sur le bloc
+            out_ptr_ = data;
+            out_avail_ = (size_t)n;
+        }
+        size_t n = out_avail_ < len - done ? out_avail_ : len - done;
+        memcpy(out + done, out_ptr_, n);
+        out_ptr_ += n;
+        out_avail_ -= n;
+        done += n;
+    }
+    return (int)done;
+}
+
+// ------------------------------------------------------------
+// Deflate réduit : LZ77 sur 8 Ko, codes de Huffman fixes
+// ------------------------------------------------------------
+//
+// Fenêtre double (le texte à coder suit les 8 Ko déjà vus), chaînes de
+// hachage sur 3 octets, recherche gloutonne d'au plus kLzProbes
+// candidats. Chaque bloc d'environ kLzBlock octets est codé à part puis
+// écrit stocké s'il n'a pas rétréci : un fichier déjà compressé ne
+// grossit que des en-têtes de blocs.
+
+static constexpr size_t kLzWindow = 8192;
+static constexpr int kLzHashBits = 12;
+static constexpr size_t kLzHashSize = (size_t)1 << kLzHashBits;
+static constexpr int kLzProbes = 32;
+static constexpr size_t kLzMinMatch = 3;
+static constexpr size_t kLzMaxMatch = 258;
+static constexpr size_t kLzBlock = 4096;
+// pire cas : 9 bits par littéral, plus en-tête et fin de bloc
+static constexpr size_t kLzBlockOut = (kLzBlock + kLzMaxMatch) * 9 / 8 + 8;
+static constexpr uint16_t kLzNil = 0xffff;
+
+static const uint16_t kLenBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t kLenExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t kDistBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+};
+static const uint8_t kDistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+typedef int (*GzPutFn)(const void* buf, int len, void* user);
+
+class GzLz {
+public:
+    static GzLz* create(GzPutFn put, void* user);
+    ~GzLz();
+
+    bool write(const uint8_t* data, size_t len);
+    // dernier bloc, aligné sur l'octet
+    bool finish();
+
+private:
+    GzLz(GzPutFn put, void* user);
+
+    bool compress(bool flush);
+    void slide();
+    uint32_t hash(size_t p) const;
+    void insert(size_t p);
+    size_t longest(size_t p, size_t& dist) const;
+
+    void bits(uint32_t v, int n);
+    void code(uint32_t c, int n);
+    void symbol(int s);
+    void begin_block();
+    bool end_block();
+
+    GzPutFn put_;
+    void* user_;
+    uint8_t* win_;              // [0, 2 * kLzWindow)
+    uint16_t* head_;            // dernière position par empreinte
+    uint16_t* prev_;            // position précédente, par p % kLzWindow
+    uint8_t* out_;              // bloc codé
+    size_t fill_;               // octets dans win_
+    size_t pos_;                // prochain octet à coder
+    size_t block_;              // début du bloc en cours
+    bool in_block_;
+    size_t out_len_;
+    uint32_t acc_;              // bits pas encore écrits dans out_
+    int nbits_;
+    uint32_t acc0_;             // état du flux au début du bloc
+    int nbits0_;
+};
+
+GzLz::GzLz(GzPutFn put, void* user)
+    : put_(put), user_(user), win_(nullptr), head_(nullptr), prev_(nullptr),
+      out_(nullptr), fill_(0), pos_(0), block_(0), in_block_(false),
+      out_len_(0), acc_(0), nbits_(0), acc0_(0), nbits0_(0)
+{
+}
+
+GzLz* GzLz::create(GzPutFn put, void* user)
+{
+    GzLz* lz = new (std::nothrow) GzLz(put, user);
+    if (!lz) {
+        return nullptr;
+    }
+    lz->win_ = new (std::nothrow) uint8_t[2 * kLzWindow];
+    lz->head_ = new (std::nothrow) uint16_t[kLzHashSize];
+    lz->prev_ = new (std::nothrow) uint16_t[kLzWindow];
+    lz->out_ = new (std::nothrow) uint8_t[kLzBlockOut];
+    if (!lz->win_ || !lz->head_ || !lz->prev_ || !lz->out_) {
+        delete lz;
+        return nullptr;
+    }
+    for (size_t i = 0; i < kLzHashSize; i++) {
+        lz->head_[i] = kLzNil;
+    }
+    return lz;
+}
+
+GzLz::~GzLz()
+{
+    delete[] win_;
+    delete[] head_;
+    delete[] prev_;
+    delete[] out_;
+}
+
+void GzLz::bits(uint32_t v, int n)
+{
+    acc_ |= v << nbits_;
+    nbits_ += n;
+    while (nbits_ >= 8) {
+        out_[out_len_++] = (uint8_t)acc_;
+        acc_ >>= 8;
+        nbits_ -= 8;
+    }
+}
+
+// codes de Huffman : bit de poids fort en premier
+void GzLz::code(uint32_t c, int n)
+{
+    uint32_t r = 0;
+    for (int i = 0; i < n; i++) {
+        r = (r << 1) | ((c >> i) & 1);
+    }
+    bits(r, n);
+}
+
+// table fixe de la RFC 1951, 3.2.6
+void GzLz::symbol(int s)
+{
+    if (s < 144) {
+        code(0x30 + s, 8);
+    } else if (s < 256) {
+        code(0x190 + (s - 144), 9);
+    } else if (s < 280) {
+        code(s - 256, 7);
+    } else {
+        code(0xc0 + (s - 280), 8);
+    }
+}
+
+void GzLz::begin_block()
+{
+    acc0_ = acc_;
+    nbits0_ = nbits_;
+    out_len_ = 0;
+    bits(0, 1);                 // BFINAL
+    bits(1, 2);                 // BTYPE 01 : codes fixes
+    block_ = pos_;
+    in_block_ = true;
+}
+
+// bloc codé, ou stocké s'il n'a pas rétréci
+bool GzLz::end_block()
+{
+    in_block_ = false;
+    symbol(256);
+    size_t raw = pos_ - block_;
+    size_t fixed_bits = out_len_ * 8 + (size_t)nbits_ - (size_t)nbits0_;
+    size_t stored_bits = 3 + (size_t)((8 - (nbits0_ + 3) % 8) % 8) + 32 + raw * 8;
+    if (fixed_bits <= stored_bits) {
+        return put_(out_, (int)out_len_, user_) != 0;
+    }
+    acc_ = acc0_;
+    nbits_ = nbits0_;
+    out_len_ = 0;
+    bits(0, 3);                 // BFINAL 0, BTYPE 00
+    if (nbits_ > 0) {
+        bits(0, 8 - nbits_);
+    }
+    out_[out_len_++] = (uint8_t)raw;
+    out_[out_len_++] = (uint8_t)(raw >> 8);
+    out_[out_len_++] = (uint8_t)~raw;
+    out_[out_len_++] = (uint8_t)(~raw >> 8);
+    return put_(out_, (int)out_len_, user_) != 0
+        && put_(win_ + block_, (int)raw, user_) != 0;
+}
+
+uint32_t GzLz::hash(size_t p) const
+{
+    uint32_t v = ((uint32_t)win_[p] << 16) | ((uint32_t)win_[p + 1] << 8)
+        | win_[p + 2];
+    return (v * 2654435761u) >> (32 - kLzHashBits);
+}
+
+void GzLz::insert(size_t p)
+{
+    if (p + kLzMinMatch > fill_) {
+        return;
+    }
+    uint32_t h = hash(p);
+    prev_[p & (kLzWindow - 1)] = head_[h];
+    head_[h] = (uint16_t)p;
+}
+
+size_t GzLz::longest(size_t p, size_t& dist) const
+{
+    size_t max = fill_ - p;
+    if (max > kLzMaxMatch) {
+        max = kLzMaxMatch;
+    }
+    size_t best = 0;
+    uint16_t cand = head_[hash(p)];
+    for (int probes = kLzProbes; cand != kLzNil && probes > 0; probes--) {
+        size_t c = cand;
+        // prev_ ne remonte pas plus loin que la fenêtre
+        if (c >= p || p - c >= kLzWindow) {
+            break;
+        }
+        if (win_[c + best] == win_[p + best]) {
+            size_t n = 0;
+            while (n < max && win_[c + n] == win_[p + n]) {
+                n++;
+            }
+            if (n > best) {
+                best = n;
+                dist = p - c;
+                if (n == max) {
+                    break;
+                }
+            }
+        }
+        cand = prev_[c & (kLzWindow - 1)];
+    }
+    return best;
+}
+
+// la seconde moitié de la fenêtre devient la première
+void GzLz::slide()
+{
+    memmove(win_, win_ + kLzWindow, kLzWindow);
+    fill_ -= kLzWindow;
+    pos_ -= kLzWindow;
+    block_ -= kLzWindow;
+    for (size_t i = 0; i < kLzHashSize; i++) {
+        uint16_t v = head_[i];
+        head_[i] = (v != kLzNil && v >= kLzWindow) ? (uint16_t)(v - kLzWindow) : kLzNil;
+    }
+    for (size_t i = 0; i < kLzWindow; i++) {
+        uint16_t v = prev_[i];
+        prev_[i] = (v != kLzNil && v >= kLzWindow) ? (uint16_t)(v - kLzWindow) : kLzNil;
+    }
+}
+
+// code ce qui est en fenêtre ; sans flush, garde de quoi trouver une
+// correspondance de longueur maximale
+bool GzLz::compress(bool flush)
+{
+    for (;;) {
+        size_t avail = fill_ - pos_;
+        if (avail == 0 || (!flush && avail < kLzMaxMatch)) {
+            return true;
+        }
+        if (in_block_ && pos_ - block_ >= kLzBlock && !end_block()) {
+            return false;
+        }
+        if (!in_block_) {
+            begin_block();
+        }
+        size_t dist = 0;
+        size_t len = (avail >= kLzMinMatch) ? longest(pos_, dist) : 0;
+        if (len < kLzMinMatch) {
+            symbol(win_[pos_]);
+            insert(pos_);
+            pos_++;
+            continue;
+        }
+        int i = 28;
+        while (kLenBase[i] > len) {
+            i--;
+        }
+        symbol(257 + i);
+        bits((uint32_t)(len - kLenBase[i]), kLenExtra[i]);
+        int j = 29;
+        while (kDistBase[j] > dist) {
+            j--;
+        }
+        code((uint32_t)j, 5);
+        bits((uint32_t)(dist - kDistBase[j]), kDistExtra[j]);
+        for (size_t k = 0; k < len; k++) {
+            insert(pos_ + k);
+        }
+        pos_ += len;
+    }
+}
+
+bool GzLz::write(const uint8_t* data, size_t len)
+{
+    while (len > 0) {
+        if (fill_ == 2 * kLzWindow) {
+            slide();
+        }
+        size_t n = 2 * kLzWindow - fill_;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(win_ + fill_, data, n);
+        fill_ += n;
+        data += n;
+        len -= n;
+        if (!compress(false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool GzLz::finish()
+{
+    if (!compress(true) || (in_block_ && !end_block())) {
+        return false;
+    }
+    // bloc final vide : en-tête et fin de bloc
+    out_len_ = 0;
+    bits(1, 1);
+    bits(1, 2);
+    symbol(256);
+    if (nbits_ > 0) {
+        bits(0, 8 - nbits_);
+    }
+    return put_(out_, (int)out_len_, user_) != 0;
+}
+
+// ------------------------------------------------------------
+// GzWriter
+// ------------------------------------------------------------
+
+mz_bool GzWriter::put(const void* buf, int len, void* user)
+{
+    GzWriter* w = static_cast<GzWriter*>(user);
+    w->out_bytes_ += (uint64_t)len;
+    return w->writer_.write(buf, (size_t)len) ? MZ_TRUE : MZ_FALSE;
+}
+
+GzWriter::GzWriter()
+    : open_(false), stored_(false), def_(nullptr), lz_(nullptr), crc_(0), size_(0),
+      out_bytes_(0), error_(false)
+{
+}
+
+// en-tête de bloc stocké (BTYPE 00, aligné sur l'octet) puis données
+bool GzWriter::put_stored(const void* data, size_t len, bool final)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    do {
+        size_t n = len < kGzStoredMax ? len : kGzStoredMax;
+        bool last = final && n == len;
+        uint8_t head[5] = {
+            (uint8_t)(last ? 1 : 0),
+            (uint8_t)n, (uint8_t)(n >> 8),
+            (uint8_t)~n, (uint8_t)(~n >> 8)
+        };
+        if (!put(head, sizeof(head), this) || (n && !put(p, (int)n, this))) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    } while (len > 0);
+    return true;
+}
+
+GzWriter::~GzWriter()
+{
+    finish();
+}
+
+bool GzWriter::begin(VfsFile& f)
+{
+    finish();
+    if (!writer_.begin(f, kIoCopyChunkSize) && !writer_.begin(f)) {
+        return false;
+    }
+    // gros état (tables de hachage + tampons) : seulement le temps de
+    // la compression, et seulement s'il tient d'un bloc avec de la marge ;
+    // sinon le deflate réduit, en petits blocs
+    tdefl_compressor* def = nullptr;
+    if (heap_caps_get_largest_free_block(MALLOC_CAP_8BIT) >=
+        sizeof(tdefl_compressor) + kGzHeapMargin) {
+        def = new (std::nothrow) tdefl_compressor;
+    }
+    open_ = true;
+    def_ = def;
+    lz_ = def ? nullptr : GzLz::create(put, this);
+    stored_ = (def == nullptr && lz_ == nullptr);
+    crc_ = 0;
+    size_ = 0;
+    out_bytes_ = 0;
+    error_ = false;
+
+    static const uint8_t header[10] = {
+        kGzId1, kGzId2, kGzDeflate, 0, 0, 0, 0, 0, 0, kGzOsUnix
+    };
+    if (!put(header, sizeof(header), this)
+        || (def && tdefl_init(def, put, this, kGzProbes) != TDEFL_STATUS_OKAY)) {
+        error_ = true;
+        finish();
+        return false;
+    }
+    return true;
+}
+
+bool GzWriter::write(const void* data, size_t len)
+{
+    if (!open_ || error_) {
+        return false;
+    }
+    crc_ = checksum_crc32(crc_, data, len);
+    size_ += (uint32_t)len;
+    if (stored_) {
+        if (len > 0 && !put_stored(data, len, false)) {
+            error_ = true;
+        }
+        return !error_;
+    }
+    if (lz_) {
+        if (!lz_->write(static_cast<const uint8_t*>(data), len)) {
+            error_ = true;
+        }
+        return !error_;
+    }
+    size_t n = len;
+    tdefl_compressor* def = static_cast<tdefl_compressor*>(def_);
+    if (tdefl_compress(def, data, &n, nullptr, nullptr, TDEFL_NO_FLUSH)
+        != TDEFL_STATUS_OKAY) {
+        error_ = true;
+    }
+    return !error_;
+}
+
+bool GzWriter::finish()
+{
+    if (!open_) {
+        return !error_;
+    }
+    tdefl_compressor* def = static_cast<tdefl_compressor*>(def_);
+    if (!error_) {
+        size_t n = 0;
+        uint8_t trailer[8] = {
+            (uint8_t)crc_, (uint8_t)(crc_ >> 8),
+            (uint8_t)(crc_ >> 16), (uint8_t)(crc_ >> 24),
+            (uint8_t)size_, (uint8_t)(size_ >> 8),
+            (uint8_t)(size_ >> 16), (uint8_t)(size_ >> 24)
+        };
+        bool ended = def
+            ? tdefl_compress(def, nullptr, &n, nullptr, nullptr, TDEFL_FINISH)
+                == TDEFL_STATUS_DONE
+            : lz_ ? lz_->finish() : put_stored(nullptr, 0, true);
+        if (!ended || !put(trailer, sizeof(trailer), this)) {
+            error_ = true;
+        }
+    }
+    if (!writer_.finish()) {
+        error_ = true;
+    }
+    delete def;
+    def_ = nullptr;
+    delete lz_;
+    lz_ = nullptr;
+    open_ = false;
+    return !error_;
+}
+
+// ------------------------------------------------------------
+// Fichier entier
+// ------------------------------------------------------------
+
+bool gz_probe(VfsFile& f)
+{
+    uint8_t magic[2];
+    int n = vfs_read(f, magic, sizeof(magic));
+    vfs_seek(f, 0, SEEK_SET);
+    return n > 0 && gz_is_magic(magic, (size_t)n);
+}
+
+bool gz_compress(VfsFile& in, VfsFile& out, uint64_t& in_bytes,
+    uint64_t& out_bytes, bool& stored)
+{
+    in_bytes = 0;
+    out_bytes = 0;
+    stored = false;
+
+    IoReader reader;
+    GzWriter gz;
+    if (!reader.begin(in, kIoCopyChunkSize) && !reader.begin(in)) {
+        return false;
+    }
+    if (!gz.begin(out)) {
+        return false;
+    }
+    stored = gz.stored();
+    const uint8_t* data = nullptr;
+    int n = 0;
+    bool ok = true;
+    while (ok && (n = reader.next(&data)) > 0) {
+        in_bytes += (uint64_t)n;
+        ok = gz.write(data, (size_t)n);
+    }
+    if (n < 0) {
+        ok = false;
+    }
+    reader.end();
+    if (!gz.finish()) {
+        ok = false;
+    }
+    out_bytes = gz.out_bytes();
+    return ok;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "vfs.h"
+#include "io_service.h"
+
+// ------------------------------------------------------------
+// gzip (RFC 1952) en flux, sur le miniz de la ROM
+// ------------------------------------------------------------
+//
+// Décompression : état tinfl (~11 Ko) + fenêtre circulaire de 32 Ko,
+// quelle que soit la taille du fichier. Le fichier compressé est lu en
+// avance par IoReader ; les membres concaténés sont enchaînés.
+
+struct tinfl_decompressor_tag;
+
+class GzReader {
+public:
+    GzReader();
+    ~GzReader();
+
+    // lit l'en-tête ; false si f n'est pas un flux gzip ou sans mémoire
+    bool begin(VfsFile& f);
+    void end();
+
+    // bloc décompressé suivant, valide jusqu'au prochain appel ;
+    // 0 = fin (CRC et taille vérifiés), -1 = erreur
+    int next(const uint8_t** data);
+    int read(void* dst, size_t len);
+
+    uint64_t in_bytes() const { return in_total_; }
+
+private:
+    GzReader(const GzReader&) = delete;
+    GzReader& operator=(const GzReader&) = delete;
+
+    int in_byte();
+    bool read_header(bool first);
+    bool read_trailer();
+    int inflate_step();
+
+    enum State : uint8_t {
+        GZ_DATA = 0,
+        GZ_TRAILER,
+        GZ_END,
+        GZ_ERROR
+    };
+
+    IoReader in_;
+    const uint8_t* in_ptr_;
+    size_t in_avail_;
+    bool in_eof_;
+    uint64_t in_total_;
+    uint8_t back_[8];           // octets lus d'avance par tinfl
+    int back_len_;
+    int back_pos_;
+
+    tinfl_decompressor_tag* inf_;
+    uint8_t* dict_;
+    size_t dict_ofs_;
+    const uint8_t* out_ptr_;
+    size_t out_avail_;
+    uint32_t crc_;
+    uint32_t size_;
+    State state_;
+};
+
+// ------------------------------------------------------------
+// Compression en flux, sortie par IoWriter
+// ------------------------------------------------------------
+//
+// tdefl (niveau 6) quand ses ~165 Ko d'un seul bloc tiennent dans le
+// tas, ce qui est rare sans PSRAM. Sinon, un deflate réduit (GzLz :
+// LZ77 sur 8 Ko, codes de Huffman fixes, ~45 Ko en quatre blocs) ; en
+// dernier recours, des blocs « stockés » (non compressés).
+
+class GzLz;
+
+class GzWriter {
+public:
+    GzWriter();
+    ~GzWriter();
+
+    // écrit l'en-tête ; false si l'écriture échoue
+    bool begin(VfsFile& f);
+    bool write(const void* data, size_t len);
+    // termine le flux et le trailer, attend les écritures
+    bool finish();
+
+    uint64_t out_bytes() const { return out_bytes_; }
+    // pas de mémoire pour compresser : blocs stockés
+    bool stored() const { return stored_; }
+    // deflate réduit au lieu de tdefl
+    bool reduced() const { return lz_ != nullptr; }
+
+private:
+    GzWriter(const GzWriter&) = delete;
+    GzWriter& operator=(const GzWriter&) = delete;
+
+    static int put(const void* buf, int len, void* user);
+    bool put_stored(const void* data, size_t len, bool final);
+
+    IoWriter writer_;
+    bool open_;
+    bool stored_;
+    void* def_;                 // tdefl_compressor (typedef anonyme)
+    GzLz* lz_;
+    uint32_t crc_;
+    uint32_t size_;
+    uint64_t out_bytes_;
+    bool error_;
+};
+
+// compresse in vers out ; tailles lue / écrite en sortie, stored vrai
+// si faute de mémoire rien n'a été compressé
+bool gz_compress(VfsFile& in, VfsFile& out, uint64_t& in_bytes,
+    uint64_t& out_bytes, bool& stored);
+
+// vrai si les premiers octets sont la signature gzip (1f 8b)
+bool gz_is_magic(const uint8_t* data, size_t len);
+// idem sur un fichier ouvert, ramené ensuite au début
+bool gz_probe(VfsFile& f);
@@ -0,0 +1,486 @@
+#include "io_service.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "esp_heap_caps.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+// ------------------------------------------------------------
+// Tâche d'E/S
+// ------------------------------------------------------------
+
+static constexpr UBaseType_t kIoQueueLen = 16;
+static constexpr uint32_t kIoTaskStack = 4096;
+static constexpr UBaseType_t kIoTaskPriority = 2;   // au-dessus de loop()
+static constexpr BaseType_t kIoTaskCore = 0;        // loop() tourne sur le cœur 1
+
+static QueueHandle_t io_queue = nullptr;
+static TaskHandle_t io_task = nullptr;
+
+static void io_execute(IoRequest& req)
+{
+    if (req.op == IO_OP_READ) {
+        req.result = vfs_read(*req.file, req.buf, req.len);
+    } else {
+        req.result = vfs_write(*req.file, req.buf, req.len);
+    }
+    if (req.on_done) {
+        req.on_done(req);
+    }
+    xSemaphoreGive(req.done);
+}
+
+static void io_task_entry(void*)
+{
+    IoRequest* req = nullptr;
+    for (;;) {
+        if (xQueueReceive(io_queue, &req, portMAX_DELAY) == pdTRUE && req) {
+            io_execute(*req);
+        }
+    }
+}
+
+bool io_service_start()
+{
+    if (io_task) {
+        return true;
+    }
+    io_queue = xQueueCreate(kIoQueueLen, sizeof(IoRequest*));
+    if (!io_queue) {
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(io_task_entry, "io_task", kIoTaskStack,
+            nullptr, kIoTaskPriority, &io_task, kIoTaskCore) != pdPASS) {
+        vQueueDelete(io_queue);
+        io_queue = nullptr;
+        io_task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool io_service_running()
+{
+    return io_task != nullptr;
+}
+
+void io_request_init(IoRequest& req)
+{
+    if (!req.done) {
+        req.done = xSemaphoreCreateBinaryStatic(&req.done_buf);
+    }
+    req.busy = false;
+    req.result = 0;
+}
+
+// seuls les montages adossés à un stockage passent par la tâche :
+// tmpfs et /dev ne sont pas protégés contre les accès concurrents
+static bool io_async(const IoRequest& req)
+{
+    return io_task && req.file && req.file->mount &&
+        req.file->mount->real_root;
+}
+
+bool io_submit(IoRequest& req)
+{
+    if (!req.file || !req.done || req.busy) {
+        return false;
+    }
+    req.busy = true;
+    if (!io_async(req)) {
+        io_execute(req);
+        return true;
+    }
+    IoRequest* p = &req;
+    xQueueSend(io_queue, &p, portMAX_DELAY);
+    return true;
+}
+
+int io_wait(IoRequest& req)
+{
+    if (req.busy) {
+        xSemaphoreTake(req.done, portMAX_DELAY);
+        req.busy = false;
+    }
+    return req.result;
+}
+
+// ------------------------------------------------------------
+// Tampons
+// ------------------------------------------------------------
+
+// mémoire DMA alignée : le pilote SPI lit directement dedans
+static uint8_t* io_buf_alloc(size_t len)
+{
+    return static_cast<uint8_t*>(heap_caps_malloc(len, MALLOC_CAP_DMA));
+}
+
+static void io_buf_free(uint8_t*& buf)
+{
+    if (buf) {
+        heap_caps_free(buf);
+        buf = nullptr;
+    }
+}
+
+// ------------------------------------------------------------
+// Copie
+// ------------------------------------------------------------
+
+int64_t io_copy(VfsFile& in, VfsFile& out, size_t chunk,
+    IoCopyProgressFn progress, void* user)
+{
+    uint8_t* buf[2] = { io_buf_alloc(chunk), io_buf_alloc(chunk) };
+    if (!buf[0] || !buf[1]) {
+        io_buf_free(buf[0]);
+        io_buf_free(buf[1]);
+        // mémoire DMA fragmentée : on retente avec des blocs plus petits
+        if (chunk > kIoChunkSize) {
+            return io_copy(in, out, kIoChunkSize, progress, user);
+        }
+        return -1;
+    }
+
+    IoRequest rd[2];
+    IoRequest wr[2];
+    for (int i = 0; i < 2; i++) {
+        io_request_init(rd[i]);
+        io_request_init(wr[i]);
+        rd[i].op = IO_OP_READ;
+        rd[i].file = &in;
+        rd[i].buf = buf[i];
+        rd[i].len = chunk;
+        wr[i].op = IO_OP_WRITE;
+        wr[i].file = &out;
+        wr[i].buf = buf[i];
+    }
+
+    int64_t total = 0;
+    bool ok = true;
+    int cur = 0;
+    io_submit(rd[0]);
+    for (;;) {
+        int n = io_wait(rd[cur]);
+        if (n < 0) {
+            ok = false;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        int other = cur ^ 1;
+        // l'autre tampon doit être écrit avant d'être relu
+        if (wr[other].busy && io_wait(wr[other]) != (int)wr[other].len) {
+            ok = false;
+            break;
+        }
+        const bool last = (size_t)n < chunk;
+        if (!last) {
+            io_submit(rd[other]);
+        }
+        wr[cur].len = (size_t)n;
+        io_submit(wr[cur]);
+        total += n;
+        if (progress) {
+            progress((uint64_t)total, user);
+        }
+        if (last) {
+            break;
+        }
+        cur = other;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        io_wait(rd[i]);
+        if (wr[i].busy && io_wait(wr[i]) != (int)wr[i].len) {
+            ok = false;
+        }
+    }
+    io_buf_free(buf[0]);
+    io_buf_free(buf[1]);
+    return ok ? total : -1;
+}
+
+// ------------------------------------------------------------
+// IoReader
+// ------------------------------------------------------------
+
+IoReader::IoReader()
+    : file_(nullptr), chunk_(0), cur_(0), held_(false), stop_(false),
+      data_(nullptr), avail_(0), held_len_(0), next_off_(0)
+{
+    buf_[0] = buf_[1] = nullptr;
+    io_request_init(req_[0]);
+    io_request_init(req_[1]);
+}
+
+IoReader::~IoReader()
+{
+    end();
+}
+
+bool IoReader::begin(VfsFile& f, size_t chunk)
+{
+    end();
+    if (!f.handle || chunk == 0) {
+        return false;
+    }
+    buf_[0] = io_buf_alloc(chunk);
+    buf_[1] = io_buf_alloc(chunk);
+    if (!buf_[0] || !buf_[1]) {
+        io_buf_free(buf_[0]);
+        io_buf_free(buf_[1]);
+        return false;
+    }
+    file_ = &f;
+    chunk_ = chunk;
+    int32_t pos = vfs_seek(f, 0, SEEK_CUR);
+    next_off_ = pos > 0 ? (uint32_t)pos : 0;
+    cur_ = 0;
+    held_ = false;
+    stop_ = false;
+    data_ = nullptr;
+    avail_ = 0;
+    held_len_ = 0;
+    prefetch(0);
+    prefetch(1);
+    return true;
+}
+
+void IoReader::end()
+{
+    if (!file_) {
+        return;
+    }
+    drain();
+    io_buf_free(buf_[0]);
+    io_buf_free(buf_[1]);
+    file_ = nullptr;
+}
+
+void IoReader::prefetch(int slot)
+{
+    IoRequest& r = req_[slot];
+    if (stop_) {
+        r.result = 0;
+        return;
+    }
+    r.op = IO_OP_READ;
+    r.file = file_;
+    r.buf = buf_[slot];
+    r.len = chunk_;
+    io_submit(r);
+}
+
+void IoReader::drain()
+{
+    io_wait(req_[0]);
+    io_wait(req_[1]);
+}
+
+int IoReader::fill()
+{
+    if (held_) {
+        // le bloc rendu est libre : il repart en lecture anticipée
+        held_ = false;
+        prefetch(cur_);
+        cur_ ^= 1;
+    }
+    avail_ = 0;
+    held_len_ = 0;
+    int n = io_wait(req_[cur_]);
+    if (n < 0) {
+        stop_ = true;
+        return -1;
+    }
+    if ((size_t)n < chunk_) {
+        stop_ = true;
+    }
+    if (n == 0) {
+        return 0;
+    }
+    held_ = true;
+    data_ = buf_[cur_];
+    avail_ = (size_t)n;
+    held_len_ = (size_t)n;
+    next_off_ += (uint32_t)n;
+    return n;
+}
+
+int IoReader::next(const uint8_t** data)
+{
+    if (!file_) {
+        return -1;
+    }
+    if (avail_ > 0) {
+        // reste d'un bloc entamé par read()
+        int n = (int)avail_;
+        *data = data_;
+        avail_ = 0;
+        return n;
+    }
+    int n = fill();
+    if (n > 0) {
+        *data = data_;
+        avail_ = 0;
+    }
+    return n;
+}
+
+int IoReader::read(void* dst, size_t len)
+{
+    if (!file_) {
+        return -1;
+    }
+    uint8_t* out = static_cast<uint8_t*>(dst);
+    size_t done = 0;
+    while (done < len) {
+        if (avail_ == 0) {
+            int n = fill();
+            if (n < 0) {
+                return done > 0 ? (int)done : -1;
+            }
+            if (n == 0) {
+                break;
+            }
+        }
+        size_t take = std::min(avail_, len - done);
+        memcpy(out + done, data_, take);
+        data_ += take;
+        avail_ -= take;
+        done += take;
+    }
+    return (int)done;
+}
+
+bool IoReader::seek(uint32_t pos)
+{
+    if (!file_) {
+        return false;
+    }
+    // dans le bloc tenu : pas d'E/S
+    uint32_t held_start = next_off_ - (uint32_t)held_len_;
+    if (held_ && pos >= held_start && pos <= next_off_) {
+        size_t skip = pos - held_start;
+        data_ = buf_[cur_] + skip;
+        avail_ = held_len_ - skip;
+        return true;
+    }
+    drain();
+    int32_t r = vfs_seek(*file_, (int32_t)pos, SEEK_SET);
+    cur_ = 0;
+    held_ = false;
+    data_ = nullptr;
+    avail_ = 0;
+    held_len_ = 0;
+    if (r < 0) {
+        stop_ = true;
+        req_[0].result = -1;
+        req_[1].result = -1;
+        return false;
+    }
+    next_off_ = (uint32_t)r;
+    stop_ = false;
+    prefetch(0);
+    prefetch(1);
+    return true;
+}
+
+// ------------------------------------------------------------
+// IoWriter
+// ------------------------------------------------------------
+
+IoWriter::IoWriter()
+    : file_(nullptr), chunk_(0), fill_(0), cur_(0), error_(false)
+{
+    buf_[0] = buf_[1] = nullptr;
+    io_request_init(req_[0]);
+    io_request_init(req_[1]);
+}
+
+IoWriter::~IoWriter()
+{
+    finish();
+}
+
+bool IoWriter::begin(VfsFile& f, size_t chunk)
+{
+    finish();
+    if (!f.handle || chunk == 0) {
+        return false;
+    }
+    buf_[0] = io_buf_alloc(chunk);
+    buf_[1] = io_buf_alloc(chunk);
+    if (!buf_[0] || !buf_[1]) {
+        io_buf_free(buf_[0]);
+        io_buf_free(buf_[1]);
+        return false;
+    }
+    file_ = &f;
+    chunk_ = chunk;
+    fill_ = 0;
+    cur_ = 0;
+    error_ = false;
+    return true;
+}
+
+void IoWriter::submit(size_t len)
+{
+    IoRequest& r = req_[cur_];
+    r.op = IO_OP_WRITE;
+    r.file = file_;
+    r.buf = buf_[cur_];
+    r.len = len;
+    io_submit(r);
+    cur_ ^= 1;
+    fill_ = 0;
+    // l'autre tampon doit avoir fini de partir avant d'être réutilisé
+    IoRequest& prev = req_[cur_];
+    if (prev.busy && io_wait(prev) != (int)prev.len) {
+        error_ = true;
+    }
+}
+
+bool IoWriter::write(const void* src, size_t len)
+{
+    if (!file_ || error_) {
+        return false;
+    }
+    const uint8_t* in = static_cast<const uint8_t*>(src);
+    while (len > 0) {
+        size_t take = std::min(chunk_ - fill_, len);
+        memcpy(buf_[cur_] + fill_, in, take);
+        fill_ += take;
+        in += take;
+        len -= take;
+        if (fill_ == chunk_) {
+            submit(chunk_);
+            if (error_) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool IoWriter::finish()
+{
+    if (!file_) {
+        return false;
+    }
+    if (fill_ > 0 && !error_) {
+        submit(fill_);
+    }
+    for (IoRequest& r : req_) {
+        if (r.busy && io_wait(r) != (int)r.len) {
+            error_ = true;
+        }
+    }
+    io_buf_free(buf_[0]);
+    io_buf_free(buf_[1]);
+    file_ = nullptr;
+    return !error_;
+}
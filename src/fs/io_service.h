@@ -0,0 +1,132 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "vfs.h"
+
+// ------------------------------------------------------------
+// Service d'E/S asynchrone
+// ------------------------------------------------------------
+//
+// Une tâche dédiée (cœur 0) exécute les lectures / écritures VFS
+// déposées dans une file. L'appelant continue à calculer pendant le
+// transfert SPI et récupère le résultat avec io_wait() ou un callback.
+// Les requêtes d'un même fichier sont traitées dans l'ordre de dépôt.
+// Les montages sans stockage (tmpfs, /dev, /bin) et le cas où le
+// service n'est pas démarré sont exécutés sur place.
+
+static constexpr size_t kIoChunkSize = 4096;    // multiple de secteurs
+static constexpr size_t kIoCopyChunkSize = 16384;
+
+enum IoOp : uint8_t {
+    IO_OP_READ = 0,
+    IO_OP_WRITE
+};
+
+struct IoRequest;
+// appelé depuis la tâche d'E/S, avant la libération de io_wait()
+typedef void (*IoDoneFn)(IoRequest& req);
+
+struct IoRequest {
+    IoOp op = IO_OP_READ;
+    VfsFile* file = nullptr;
+    void* buf = nullptr;
+    size_t len = 0;
+    int result = 0;             // octets transférés, -1 = erreur
+    IoDoneFn on_done = nullptr;
+    void* user = nullptr;
+    bool busy = false;          // déposée et pas encore attendue
+    SemaphoreHandle_t done = nullptr;
+    StaticSemaphore_t done_buf;
+};
+
+bool io_service_start();
+bool io_service_running();
+
+// prépare une requête (une fois, avant le premier io_submit)
+void io_request_init(IoRequest& req);
+bool io_submit(IoRequest& req);
+// attend la fin de la requête ; retourne req.result
+int io_wait(IoRequest& req);
+
+// ------------------------------------------------------------
+// Copie de flux : deux tampons, la lecture du bloc suivant est en file
+// pendant l'écriture du courant, sans recopie mémoire.
+// ------------------------------------------------------------
+
+// appelé sur la tâche appelante après chaque bloc
+typedef void (*IoCopyProgressFn)(uint64_t done, void* user);
+
+// retourne le nombre d'octets copiés, -1 en cas d'erreur
+int64_t io_copy(VfsFile& in, VfsFile& out, size_t chunk = kIoCopyChunkSize,
+    IoCopyProgressFn progress = nullptr, void* user = nullptr);
+
+// ------------------------------------------------------------
+// Lecture anticipée : deux tampons DMA, le suivant est lu pendant
+// que l'appelant consomme le courant.
+// ------------------------------------------------------------
+
+class IoReader {
+public:
+    IoReader();
+    ~IoReader();
+
+    bool begin(VfsFile& f, size_t chunk = kIoChunkSize);
+    // attend les lectures en cours et libère les tampons
+    // (le fichier reste ouvert)
+    void end();
+
+    // bloc suivant, valide jusqu'au prochain appel ; 0 = fin, -1 = erreur
+    int next(const uint8_t** data);
+    int read(void* dst, size_t len);
+    bool seek(uint32_t pos);
+    uint32_t tell() const { return next_off_ - (uint32_t)avail_; }
+
+private:
+    void prefetch(int slot);
+    void drain();
+    int fill();
+
+    VfsFile* file_;
+    uint8_t* buf_[2];
+    IoRequest req_[2];
+    size_t chunk_;
+    int cur_;
+    bool held_;                 // buf_[cur_] appartient à l'appelant
+    bool stop_;                 // fin de fichier vue : plus de lecture
+    const uint8_t* data_;
+    size_t avail_;
+    size_t held_len_;
+    uint32_t next_off_;         // position fichier après le bloc tenu
+};
+
+// ------------------------------------------------------------
+// Écriture différée : un tampon se remplit pendant que l'autre part
+// vers la carte.
+// ------------------------------------------------------------
+
+class IoWriter {
+public:
+    IoWriter();
+    ~IoWriter();
+
+    bool begin(VfsFile& f, size_t chunk = kIoChunkSize);
+    bool write(const void* src, size_t len);
+    // écrit le reste, attend la fin ; false si une écriture a échoué
+    bool finish();
+
+private:
+    void submit(size_t len);
+
+    VfsFile* file_;
+    uint8_t* buf_[2];
+    IoRequest req_[2];
+    size_t chunk_;
+    size_t fill_;
+    int cur_;
+    bool error_;
+};
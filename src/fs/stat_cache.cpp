@@ -0,0 +1,158 @@
+#include "stat_cache.h"
+
+#include <string>
+
+#include "vfs.h"
+
+// ------------------------------------------------------------
+// État
+// ------------------------------------------------------------
+
+static constexpr int kStatCacheSlots = 32;
+
+struct StatSlot {
+    std::string path;           // vide = libre
+    FsStat st;
+    bool exists = false;
+    uint32_t stamp = 0;         // dernier accès (LRU)
+};
+
+static StatSlot slots[kStatCacheSlots];
+static uint32_t clock_stamp = 0;
+
+// Tailles de répertoires : les dossiers peu profonds sont terminés (donc
+// rangés) en dernier par du, ce sont eux que la LRU garde.
+static constexpr int kSizeCacheSlots = 128;
+
+struct SizeSlot {
+    std::string path;           // vide = libre
+    SizeCacheEntry e;
+    uint32_t mtime = 0;
+    uint32_t stamp = 0;
+};
+
+static SizeSlot size_slots[kSizeCacheSlots];
+static uint32_t size_stamp = 0;
+
+static StatSlot* slot_find(const char* path)
+{
+    for (StatSlot& s : slots) {
+        if (!s.path.empty() && s.path == path) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+static SizeSlot* size_slot_find(const char* path)
+{
+    for (SizeSlot& s : size_slots) {
+        if (!s.path.empty() && s.path == path) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+bool stat_cache_lookup(const char* path, bool& exists, FsStat& out)
+{
+    StatSlot* s = slot_find(path);
+    if (!s) {
+        return false;
+    }
+    s->stamp = ++clock_stamp;
+    exists = s->exists;
+    out = s->st;
+    return true;
+}
+
+void stat_cache_store(const char* path, bool exists, const FsStat& st)
+{
+    StatSlot* s = slot_find(path);
+    if (!s) {
+        s = &slots[0];
+        for (StatSlot& c : slots) {
+            if (c.path.empty()) {
+                s = &c;
+                break;
+            }
+            if (c.stamp < s->stamp) {
+                s = &c;
+            }
+        }
+        s->path = path;
+    }
+    s->st = st;
+    s->exists = exists;
+    s->stamp = ++clock_stamp;
+}
+
+void stat_cache_invalidate(const char* prefix)
+{
+    for (StatSlot& s : slots) {
+        if (s.path.empty()) {
+            continue;
+        }
+        if (!prefix || vfs_path_under(s.path.c_str(), prefix)) {
+            s.path.clear();
+        }
+    }
+    // la taille d'un répertoire inclut tout ce qui est dessous
+    for (SizeSlot& s : size_slots) {
+        if (s.path.empty()) {
+            continue;
+        }
+        if (!prefix || vfs_path_under(s.path.c_str(), prefix) ||
+            vfs_path_under(prefix, s.path.c_str())) {
+            s.path.clear();
+        }
+    }
+}
+
+// ------------------------------------------------------------
+// Tailles de répertoires
+// ------------------------------------------------------------
+
+bool size_cache_lookup(const char* path, uint32_t mtime, SizeCacheEntry& out)
+{
+    SizeSlot* s = size_slot_find(path);
+    if (!s) {
+        return false;
+    }
+    if (mtime && s->mtime && mtime != s->mtime) {
+        s->path.clear();
+        return false;
+    }
+    s->stamp = ++size_stamp;
+    out = s->e;
+    return true;
+}
+
+void size_cache_store(const char* path, uint32_t mtime,
+    const SizeCacheEntry& e)
+{
+    SizeSlot* s = size_slot_find(path);
+    if (!s) {
+        s = &size_slots[0];
+        for (SizeSlot& c : size_slots) {
+            if (c.path.empty()) {
+                s = &c;
+                break;
+            }
+            if (c.stamp < s->stamp) {
+                s = &c;
+            }
+        }
+        s->path = path;
+        s->mtime = 0;
+    }
+    s->e = e;
+    if (mtime) {
+        s->mtime = mtime;
+    }
+    s->stamp = ++size_stamp;
+}
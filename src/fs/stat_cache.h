@@ -0,0 +1,31 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "fs.h"
+
+// Cache LRU des résultats de stat, indexé par chemin virtuel canonique.
+// Les absences sont gardées aussi (tests d'existence des scripts).
+// Chaque point d'entrée fs_* qui modifie l'arborescence invalide les
+// chemins touchés ; les montages / démontages vident tout.
+
+bool stat_cache_lookup(const char* path, bool& exists, FsStat& out);
+void stat_cache_store(const char* path, bool exists, const FsStat& st);
+
+// oublie path et tout ce qui est dessous (nullptr = tout)
+void stat_cache_invalidate(const char* prefix);
+
+// Tailles cumulées des répertoires (du), indexées par chemin et par la
+// date du répertoire quand le backend la donne. Même invalidation : un
+// chemin modifié oublie aussi tous ses ancêtres.
+struct SizeCacheEntry {
+    uint64_t bytes = 0;
+    uint32_t files = 0;
+    uint32_t dirs = 0;          // sous-répertoires, à toute profondeur
+};
+
+// mtime 0 = inconnue (racine d'un parcours) : accepte toute entrée
+bool size_cache_lookup(const char* path, uint32_t mtime, SizeCacheEntry& out);
+void size_cache_store(const char* path, uint32_t mtime,
+    const SizeCacheEntry& e);
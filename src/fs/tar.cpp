@@ -0,0 +1,681 @@
+#include "tar.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+#include <set>
+#include <Arduino.h>
+
+#include "fs.h"
+#include "fs_walk.h"
+#include "vfs.h"
+#include "io_service.h"
+#include "gzip.h"
+
+// ------------------------------------------------------------
+// Format ustar
+// ------------------------------------------------------------
+
+static constexpr size_t kTarBlock = 512;
+static constexpr size_t kTarBufSize = 16384;    // transfert des contenus
+
+struct TarHeader {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+};
+
+static_assert(sizeof(TarHeader) == kTarBlock, "en-tête tar de 512 octets");
+
+static void tar_octal_put(char* field, size_t len, uint64_t v)
+{
+    snprintf(field, len, "%0*llo", (int)(len - 1), (unsigned long long)v);
+}
+
+static uint64_t tar_octal_get(const char* field, size_t len)
+{
+    uint64_t v = 0;
+    if ((uint8_t)field[0] & 0x80) {
+        // extension GNU : base 256 (fichiers > 8 Go)
+        for (size_t i = 1; i < len; i++) {
+            v = (v << 8) | (uint8_t)field[i];
+        }
+        return v;
+    }
+    size_t i = 0;
+    while (i < len && field[i] == ' ') {
+        i++;
+    }
+    for (; i < len && field[i] >= '0' && field[i] <= '7'; i++) {
+        v = (v << 3) | (uint64_t)(field[i] - '0');
+    }
+    return v;
+}
+
+static uint32_t tar_sum(const TarHeader& h)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&h);
+    uint32_t sum = 0;
+    for (size_t i = 0; i < kTarBlock; i++) {
+        bool in_chksum = i >= offsetof(TarHeader, chksum)
+            && i < offsetof(TarHeader, chksum) + sizeof(h.chksum);
+        sum += in_chksum ? (uint32_t)' ' : p[i];
+    }
+    return sum;
+}
+
+static void tar_header_seal(TarHeader& h)
+{
+    snprintf(h.chksum, sizeof(h.chksum), "%06o", (unsigned)tar_sum(h));
+    h.chksum[7] = ' ';
+}
+
+// noms > 100 octets : coupés en prefix / name sur un '/' ; false si
+// le nom ne rentre pas (en-tête GNU 'L' nécessaire)
+static bool tar_header_build(TarHeader& h, const std::string& name,
+    uint64_t size, bool is_dir, uint32_t mtime)
+{
+    memset(&h, 0, sizeof(h));
+    if (name.size() <= sizeof(h.name)) {
+        memcpy(h.name, name.data(), name.size());
+    } else {
+        size_t cut = name.rfind('/', sizeof(h.prefix));
+        if (cut == std::string::npos || cut == 0
+            || name.size() - cut - 1 > sizeof(h.name)) {
+            return false;
+        }
+        memcpy(h.prefix, name.data(), cut);
+        memcpy(h.name, name.data() + cut + 1, name.size() - cut - 1);
+    }
+    tar_octal_put(h.mode, sizeof(h.mode), is_dir ? 0755 : 0644);
+    tar_octal_put(h.uid, sizeof(h.uid), 0);
+    tar_octal_put(h.gid, sizeof(h.gid), 0);
+    tar_octal_put(h.size, sizeof(h.size), is_dir ? 0 : size);
+    tar_octal_put(h.mtime, sizeof(h.mtime), mtime);
+    h.typeflag = is_dir ? '5' : '0';
+    memcpy(h.magic, "ustar", 6);
+    memcpy(h.version, "00", 2);
+    tar_header_seal(h);
+    return true;
+}
+
+static bool tar_header_empty(const TarHeader& h)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&h);
+    for (size_t i = 0; i < kTarBlock; i++) {
+        if (p[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string tar_field(const char* p, size_t len)
+{
+    return std::string(p, strnlen(p, len));
+}
+
+static size_t tar_padding(uint64_t size)
+{
+    return (size_t)((kTarBlock - size % kTarBlock) % kTarBlock);
+}
+
+// nom relatif sûr : sans '/', '.' ni '..' en tête, jamais au-dessus
+// de la racine d'extraction
+static bool tar_clean_name(const std::string& in, std::string& out)
+{
+    out.clear();
+    size_t i = 0;
+    while (i <= in.size()) {
+        size_t j = in.find('/', i);
+        if (j == std::string::npos) {
+            j = in.size();
+        }
+        std::string part = in.substr(i, j - i);
+        if (part == "..") {
+            return false;
+        }
+        if (!part.empty() && part != ".") {
+            if (!out.empty()) {
+                out += '/';
+            }
+            out += part;
+        }
+        i = j + 1;
+    }
+    return !out.empty();
+}
+
+// ------------------------------------------------------------
+// Flux d'archive (brut ou gzip)
+// ------------------------------------------------------------
+
+class TarSink {
+public:
+    bool begin(VfsFile& f, bool gz)
+    {
+        gz_ = gz;
+        if (gz_) {
+            return gzw_.begin(f);
+        }
+        return raw_.begin(f, kIoCopyChunkSize) || raw_.begin(f);
+    }
+    bool write(const void* data, size_t len)
+    {
+        return gz_ ? gzw_.write(data, len) : raw_.write(data, len);
+    }
+    bool zeros(size_t len)
+    {
+        static const uint8_t zero[kTarBlock] = {};
+        while (len > 0) {
+            size_t n = len < kTarBlock ? len : kTarBlock;
+            if (!write(zero, n)) {
+                return false;
+            }
+            len -= n;
+        }
+        return true;
+    }
+    bool finish()
+    {
+        return gz_ ? gzw_.finish() : raw_.finish();
+    }
+
+private:
+    IoWriter raw_;
+    GzWriter gzw_;
+    bool gz_ = false;
+};
+
+class TarSource {
+public:
+    bool begin(VfsFile& f)
+    {
+        gz_ = gz_probe(f);
+        if (gz_) {
+            return gzr_.begin(f);
+        }
+        return raw_.begin(f, kIoCopyChunkSize) || raw_.begin(f);
+    }
+    void end()
+    {
+        if (gz_) {
+            gzr_.end();
+        } else {
+            raw_.end();
+        }
+    }
+    // len octets ou rien ; n vaut 0 à la fin propre de l'archive
+    bool read_full(void* dst, size_t len, int* n = nullptr)
+    {
+        int got = gz_ ? gzr_.read(dst, len) : raw_.read(dst, len);
+        if (n) {
+            *n = got;
+        }
+        return got == (int)len;
+    }
+    bool skip(uint64_t len, uint8_t* buf)
+    {
+        while (len > 0) {
+            size_t n = len < kTarBufSize ? (size_t)len : kTarBufSize;
+            if (!read_full(buf, n)) {
+                return false;
+            }
+            len -= n;
+        }
+        return true;
+    }
+
+private:
+    IoReader raw_;
+    GzReader gzr_;
+    bool gz_ = false;
+};
+
+// ------------------------------------------------------------
+// Création
+// ------------------------------------------------------------
+
+struct TarCreateCtx {
+    TarSink* sink;
+    uint8_t* buf;
+    const std::string* archive;     // jamais archivée elle-même
+    std::string base;               // nom de l'opérande dans l'archive
+    size_t root_len;
+    uint32_t mtime;                 // entrées sans date (opérandes)
+    FsTarStats* stats;
+    FsTarEntryFn fn;
+    void* user;
+    bool ok;                        // faux dès qu'une entrée est en défaut
+    bool broken;                    // écriture de l'archive impossible
+};
+
+// nom trop long pour ustar : entrée GNU "././@LongLink" avant l'en-tête
+static bool tar_add_header(TarCreateCtx& ctx, const std::string& name,
+    uint64_t size, bool is_dir, uint32_t mtime)
+{
+    TarHeader h;
+    if (tar_header_build(h, name, size, is_dir, mtime)) {
+        return ctx.sink->write(&h, sizeof(h));
+    }
+    TarHeader l;
+    tar_header_build(l, "././@LongLink", name.size() + 1, false, 0);
+    l.typeflag = 'L';
+    tar_header_seal(l);
+    tar_header_build(h, name.substr(0, sizeof(h.name)), size, is_dir,
+        mtime);
+    return ctx.sink->write(&l, sizeof(l))
+        && ctx.sink->write(name.c_str(), name.size() + 1)
+        && ctx.sink->zeros(tar_padding(name.size() + 1))
+        && ctx.sink->write(&h, sizeof(h));
+}
+
+static bool tar_add_file(TarCreateCtx& ctx, const VfsPath& p, uint64_t size)
+{
+    VfsFile f;
+    bool opened = vfs_open(p, VFS_OPEN_READ, f);
+    uint64_t left = size;
+    while (opened && left > 0) {
+        size_t want = left < kTarBufSize ? (size_t)left : kTarBufSize;
+        int n = vfs_read(f, ctx.buf, want);
+        if (n <= 0) {
+            break;
+        }
+        if (!ctx.sink->write(ctx.buf, (size_t)n)) {
+            vfs_close(f);
+            return false;
+        }
+        left -= (uint64_t)n;
+    }
+    if (opened) {
+        vfs_close(f);
+    }
+    // illisible ou raccourci pendant l'archivage : zéros, comme GNU tar
+    if (left > 0) {
+        ctx.ok = false;
+    }
+    return ctx.sink->zeros((size_t)left + tar_padding(size));
+}
+
+static bool tar_create_visit(const FsWalkEntry& e, void* user)
+{
+    TarCreateCtx& ctx = *static_cast<TarCreateCtx*>(user);
+    if (*ctx.archive == e.path) {
+        return true;
+    }
+    // <base>/<chemin sous l'opérande>
+    std::string name = ctx.base;
+    const char* rest = e.path + ctx.root_len;
+    if (*rest) {
+        if (*rest == '/') {
+            rest++;
+        }
+        if (!name.empty()) {
+            name += '/';
+        }
+        name += rest;
+    }
+    if (name.empty()) {
+        return true;
+    }
+    if (e.is_dir) {
+        name += '/';
+    }
+
+    // date du fichier (inconnue pour la racine d'un volume FAT)
+    uint64_t size = e.is_dir ? 0 : e.size;
+    uint32_t mtime = e.mtime ? e.mtime : ctx.mtime;
+    if (!tar_add_header(ctx, name, size, e.is_dir, mtime)) {
+        ctx.broken = true;
+        return false;
+    }
+    if (ctx.fn) {
+        ctx.fn(name.c_str(), size, ctx.user);
+    }
+    if (e.is_dir) {
+        ctx.stats->dirs++;
+        return true;
+    }
+    if (!tar_add_file(ctx, *e.vpath, size)) {
+        ctx.broken = true;
+        return false;
+    }
+    ctx.stats->files++;
+    ctx.stats->bytes += size;
+    return true;
+}
+
+bool fs_tar_create(const FsTarOptions& opts,
+    const std::vector<std::string>& paths, FsTarStats& stats,
+    FsTarEntryFn fn, void* user)
+{
+    stats = FsTarStats();
+    if (!opts.archive || paths.empty()) {
+        return false;
+    }
+    VfsPath ap;
+    fs_resolve(opts.archive, ap);
+    fs_invalidate(ap.virt.c_str());
+
+    VfsFile out;
+    if (!vfs_open(ap, VFS_OPEN_WRITE, out)) {
+        return false;
+    }
+    uint8_t* buf = new (std::nothrow) uint8_t[kTarBufSize];
+    TarSink sink;
+    if (!buf || !sink.begin(out, opts.gzip)) {
+        delete[] buf;
+        vfs_close(out);
+        vfs_remove(ap);
+        return false;
+    }
+
+    uint32_t start = millis();
+    TarCreateCtx ctx;
+    ctx.sink = &sink;
+    ctx.buf = buf;
+    ctx.archive = &ap.virt;
+    ctx.mtime = (uint32_t)time(nullptr);
+    ctx.stats = &stats;
+    ctx.fn = fn;
+    ctx.user = user;
+    ctx.ok = true;
+    ctx.broken = false;
+
+    for (const std::string& path : paths) {
+        VfsPath root;
+        fs_resolve(path.c_str(), root);
+        FsStat st;
+        if (!vfs_stat(root, st) || st.is_stream) {
+            ctx.ok = false;
+            continue;
+        }
+        // dernier composant : "tar -cf a.tar /media/0/lib" -> lib/...
+        size_t slash = root.virt.find_last_of('/');
+        ctx.base = root.virt.substr(slash + 1);
+        ctx.root_len = root.virt.size();
+
+        FsWalkOptions wopts;
+        wopts.depth_limited = &stats.depth_limited;
+        if (!fs_walk(root, wopts, tar_create_visit, &ctx)) {
+            ctx.ok = false;
+        }
+        if (ctx.broken) {
+            break;
+        }
+    }
+
+    // fin d'archive : deux blocs nuls
+    if (!sink.zeros(2 * kTarBlock)) {
+        ctx.ok = false;
+    }
+    if (!sink.finish()) {
+        ctx.ok = false;
+    }
+    if (!vfs_close(out)) {
+        ctx.ok = false;
+    }
+    delete[] buf;
+    if (ctx.broken) {
+        vfs_remove(ap);
+    }
+    fs_invalidate(ap.virt.c_str());
+    stats.elapsed_ms = millis() - start;
+    return ctx.ok && !ctx.broken;
+}
+
+// ------------------------------------------------------------
+// Lecture : extraction et liste
+// ------------------------------------------------------------
+
+struct TarExtractCtx {
+    std::string root;                   // chemin virtuel de -C
+    std::set<std::string> made;         // dossiers déjà vérifiés / créés
+};
+
+static bool tar_ensure_dir(TarExtractCtx& ctx, const std::string& dir)
+{
+    if (dir.size() <= ctx.root.size() || ctx.made.count(dir)) {
+        return true;
+    }
+    size_t slash = dir.find_last_of('/');
+    if (slash != std::string::npos && slash > 0
+        && !tar_ensure_dir(ctx, dir.substr(0, slash))) {
+        return false;
+    }
+    FsStat st;
+    if (fs_stat(dir.c_str(), st)) {
+        if (!st.is_dir) {
+            return false;
+        }
+    } else if (!fs_mkdir(dir.c_str())) {
+        return false;
+    }
+    ctx.made.insert(dir);
+    return true;
+}
+
+static bool tar_extract_file(TarSource& src, const std::string& target,
+    uint64_t size, uint8_t* buf)
+{
+    fs_invalidate(target.c_str());
+    VfsPath p;
+    fs_resolve(target.c_str(), p);
+    VfsFile out;
+    if (!vfs_open(p, VFS_OPEN_WRITE, out)) {
+        return false;
+    }
+    // FAT : taille connue d'avance, la chaîne est allouée en une fois
+    if (size > 0 && p.mount->fat_drive) {
+        vfs_truncate(out, (uint32_t)size);
+    }
+    bool ok = true;
+    uint64_t left = size;
+    while (ok && left > 0) {
+        size_t n = left < kTarBufSize ? (size_t)left : kTarBufSize;
+        ok = src.read_full(buf, n) && vfs_write(out, buf, n) == (int)n;
+        left -= n;
+    }
+    if (!vfs_close(out)) {
+        ok = false;
+    }
+    fs_invalidate(target.c_str());
+    return ok;
+}
+
+// "NN path=valeur\n" dans un en-tête pax : seule la clé path compte
+static void tar_pax_path(const std::string& data, std::string& name)
+{
+    size_t i = 0;
+    while (i < data.size()) {
+        size_t sp = data.find(' ', i);
+        if (sp == std::string::npos) {
+            break;
+        }
+        size_t len = (size_t)strtoul(data.c_str() + i, nullptr, 10);
+        if (len == 0 || i + len > data.size()) {
+            break;
+        }
+        std::string rec = data.substr(sp + 1, i + len - sp - 2);
+        if (rec.compare(0, 5, "path=") == 0) {
+            name = rec.substr(5);
+        }
+        i += len;
+    }
+}
+
+static bool tar_read(const FsTarOptions& opts, bool extract,
+    FsTarStats& stats, FsTarEntryFn fn, void* user)
+{
+    stats = FsTarStats();
+    if (!opts.archive) {
+        return false;
+    }
+    TarExtractCtx ctx;
+    if (extract) {
+        VfsPath rp;
+        fs_resolve(opts.dir ? opts.dir : fs_pwd(), rp);
+        FsStat st;
+        if (!vfs_stat(rp, st) || !st.is_dir) {
+            return false;
+        }
+        ctx.root = rp.virt == "/" ? "" : rp.virt;
+    }
+
+    VfsPath ap;
+    fs_resolve(opts.archive, ap);
+    fs_invalidate(ap.virt.c_str());
+    VfsFile in;
+    if (!vfs_open(ap, VFS_OPEN_READ, in)) {
+        return false;
+    }
+    uint8_t* buf = new (std::nothrow) uint8_t[kTarBufSize];
+    TarSource src;
+    if (!buf || !src.begin(in)) {
+        delete[] buf;
+        vfs_close(in);
+        return false;
+    }
+
+    uint32_t start = millis();
+    bool ok = true;
+    std::string long_name;
+    for (;;) {
+        TarHeader h;
+        int n = 0;
+        if (!src.read_full(&h, sizeof(h), &n)) {
+            // archive sans blocs de fin : acceptée si coupée sur un en-tête
+            ok = (n == 0);
+            break;
+        }
+        if (tar_header_empty(h)) {
+            break;
+        }
+        if (tar_octal_get(h.chksum, sizeof(h.chksum)) != tar_sum(h)) {
+            ok = false;
+            break;
+        }
+        uint64_t size = tar_octal_get(h.size, sizeof(h.size));
+        uint64_t pad = tar_padding(size);
+
+        // noms longs : GNU ('L') et pax ('x') ; 'g' ignoré
+        if (h.typeflag == 'L' || h.typeflag == 'x') {
+            if (size >= kTarBufSize || !src.read_full(buf, (size_t)size)) {
+                ok = false;
+                break;
+            }
+            std::string data((const char*)buf, (size_t)size);
+            if (!src.skip(pad, buf)) {
+                ok = false;
+                break;
+            }
+            if (h.typeflag == 'L') {
+                long_name = data.c_str();
+            } else {
+                tar_pax_path(data, long_name);
+            }
+            continue;
+        }
+
+        std::string raw = long_name;
+        long_name.clear();
+        if (raw.empty()) {
+            std::string prefix = tar_field(h.prefix, sizeof(h.prefix));
+            raw = tar_field(h.name, sizeof(h.name));
+            if (!prefix.empty()) {
+                raw = prefix + "/" + raw;
+            }
+        }
+        bool is_dir = h.typeflag == '5'
+            || (!raw.empty() && raw.back() == '/' && h.typeflag != 'g');
+        bool is_file = !is_dir
+            && (h.typeflag == '0' || h.typeflag == '\0' || h.typeflag == '7');
+        std::string rel;
+        bool usable = tar_clean_name(raw, rel) && (is_dir || is_file);
+        if (fn && usable) {
+            fn(is_dir ? (rel + "/").c_str() : rel.c_str(), is_file ? size : 0,
+                user);
+        }
+
+        if (!extract || !usable) {
+            // liens, périphériques, noms dangereux : sautés
+            if (extract && (is_dir || is_file)) {
+                ok = false;
+            }
+            if (!src.skip(size + pad, buf)) {
+                ok = false;
+                break;
+            }
+            if (usable) {
+                if (is_dir) {
+                    stats.dirs++;
+                } else {
+                    stats.files++;
+                    stats.bytes += size;
+                }
+            }
+            continue;
+        }
+
+        std::string target = ctx.root + "/" + rel;
+        if (is_dir) {
+            if (!tar_ensure_dir(ctx, target)) {
+                ok = false;
+            }
+            stats.dirs++;
+            if (!src.skip(size + pad, buf)) {
+                ok = false;
+                break;
+            }
+            continue;
+        }
+        size_t slash = target.find_last_of('/');
+        if (!tar_ensure_dir(ctx, target.substr(0, slash))) {
+            ok = false;
+            if (!src.skip(size + pad, buf)) {
+                break;
+            }
+            continue;
+        }
+        if (!tar_extract_file(src, target, size, buf) || !src.skip(pad, buf)) {
+            ok = false;
+            break;
+        }
+        stats.files++;
+        stats.bytes += size;
+    }
+
+    src.end();
+    vfs_close(in);
+    delete[] buf;
+    stats.elapsed_ms = millis() - start;
+    return ok;
+}
+
+bool fs_tar_extract(const FsTarOptions& opts, FsTarStats& stats,
+    FsTarEntryFn fn, void* user)
+{
+    return tar_read(opts, true, stats, fn, user);
+}
+
+bool fs_tar_list(const FsTarOptions& opts, FsTarStats& stats,
+    FsTarEntryFn fn, void* user)
+{
+    return tar_read(opts, false, stats, fn, user);
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// ------------------------------------------------------------
+// Archives tar (ustar), éventuellement gzip
+// ------------------------------------------------------------
+//
+// L'archive est lue / écrite en un seul flux séquentiel (lecture
+// anticipée, écriture différée) : un seul descripteur pour des
+// milliers de petits fichiers. À l'extraction, chaque répertoire est
+// créé une fois et les fichiers sont alloués d'avance sur FAT.
+// Les archives compressées sont reconnues à leur signature.
+
+struct FsTarOptions {
+    const char* archive = nullptr;
+    const char* dir = nullptr;  // -C : racine d'extraction (défaut : cwd)
+    bool gzip = false;          // création : compresser l'archive
+};
+
+struct FsTarStats {
+    uint32_t files = 0;
+    uint32_t dirs = 0;
+    uint64_t bytes = 0;         // contenu des fichiers
+    uint32_t elapsed_ms = 0;
+    bool depth_limited = false; // création : sous-arbres trop profonds omis
+};
+
+// appelé pour chaque entrée (nom dans l'archive ; "/" final = dossier)
+typedef void (*FsTarEntryFn)(const char* name, uint64_t size, void* user);
+
+bool fs_tar_create(const FsTarOptions& opts,
+    const std::vector<std::string>& paths, FsTarStats& stats,
+    FsTarEntryFn fn = nullptr, void* user = nullptr);
+bool fs_tar_extract(const FsTarOptions& opts, FsTarStats& stats,
+    FsTarEntryFn fn = nullptr, void* user = nullptr);
+bool fs_tar_list(const FsTarOptions& opts, FsTarStats& stats,
+    FsTarEntryFn fn, void* user);
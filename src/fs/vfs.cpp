@@ -0,0 +1,430 @@
+#include "vfs.h"
+
+#include <string.h>
+#include <algorithm>
+
+// ------------------------------------------------------------
+// Table de montage
+// ------------------------------------------------------------
+
+// Slots fixes : un montage libéré laisse son slot vide, les pointeurs
+// VfsMount* restent donc stables.
+static VfsMount mounts[kVfsMaxMounts] = {
+    { "/bin", 4, &vfs_bin_ops, nullptr, nullptr, "bin" },
+    { "/dev", 4, &vfs_dev_ops, nullptr, nullptr, "dev" },
+};
+
+// répertoires toujours présents même sans montage dessous
+static const char* k_static_dirs[] = {
+    "/media"
+};
+
+bool vfs_mount(const char* prefix, const VfsOps* ops, const char* real_root,
+    const char* fat_drive, const char* label)
+{
+    if (!prefix || prefix[0] != '/' || !prefix[1] || !ops) {
+        return false;
+    }
+    if (vfs_find_mount(prefix)) {
+        return false;
+    }
+    for (int i = 0; i < kVfsMaxMounts; i++) {
+        if (mounts[i].ops) {
+            continue;
+        }
+        mounts[i].prefix = prefix;
+        mounts[i].prefix_len = strlen(prefix);
+        mounts[i].ops = ops;
+        mounts[i].real_root = real_root;
+        mounts[i].fat_drive = fat_drive;
+        mounts[i].label = label ? label : prefix;
+        return true;
+    }
+    return false;
+}
+
+bool vfs_umount(const char* prefix)
+{
+    for (int i = 0; i < kVfsMaxMounts; i++) {
+        if (mounts[i].ops && strcmp(mounts[i].prefix, prefix) == 0) {
+            mounts[i] = VfsMount{ nullptr, 0, nullptr, nullptr, nullptr, nullptr };
+            return true;
+        }
+    }
+    return false;
+}
+
+int vfs_mount_count()
+{
+    return kVfsMaxMounts;
+}
+
+const VfsMount* vfs_mount_at(int index)
+{
+    if (index < 0 || index >= kVfsMaxMounts || !mounts[index].ops) {
+        return nullptr;
+    }
+    return &mounts[index];
+}
+
+const VfsMount* vfs_find_mount(const char* prefix)
+{
+    for (int i = 0; i < kVfsMaxMounts; i++) {
+        if (mounts[i].ops && strcmp(mounts[i].prefix, prefix) == 0) {
+            return &mounts[i];
+        }
+    }
+    return nullptr;
+}
+
+// ------------------------------------------------------------
+// Chemins
+// ------------------------------------------------------------
+
+static void norm_append(std::string& out, const char* s, size_t len)
+{
+    if (len == 0 || (len == 1 && s[0] == '.')) {
+        return;
+    }
+    if (len == 2 && s[0] == '.' && s[1] == '.') {
+        size_t slash = out.find_last_of('/');
+        out.resize(slash == std::string::npos ? 0 : slash);
+        return;
+    }
+    out.push_back('/');
+    out.append(s, len);
+}
+
+static void norm_walk(std::string& out, const char* path)
+{
+    const char* p = path;
+    while (*p) {
+        const char* start = p;
+        while (*p && *p != '/') {
+            p++;
+        }
+        norm_append(out, start, (size_t)(p - start));
+        while (*p == '/') {
+            p++;
+        }
+    }
+}
+
+// construit un chemin canonique absolu à partir de base + path,
+// en une passe et sans limite de longueur ni de composants
+void vfs_normalize(const char* base, const char* path, std::string& out)
+{
+    out.clear();
+    if (!path || !*path) {
+        path = ".";
+    }
+    if (path[0] != '/' && base) {
+        norm_walk(out, base);
+    }
+    norm_walk(out, path);
+    if (out.empty()) {
+        out.push_back('/');
+    }
+}
+
+bool vfs_path_under(const char* path, const char* prefix)
+{
+    size_t len = strlen(prefix);
+    if (len == 1 && prefix[0] == '/') {
+        return path[0] == '/';
+    }
+    return strncmp(path, prefix, len) == 0 &&
+        (path[len] == '\0' || path[len] == '/');
+}
+
+static const VfsMount* lookup_mount(const std::string& virt)
+{
+    const VfsMount* best = nullptr;
+    for (int i = 0; i < kVfsMaxMounts; i++) {
+        const VfsMount& m = mounts[i];
+        if (!m.ops || (best && m.prefix_len <= best->prefix_len)) {
+            continue;
+        }
+        if (vfs_path_under(virt.c_str(), m.prefix)) {
+            best = &m;
+        }
+    }
+    return best;
+}
+
+static void bind_mount(VfsPath& p, const VfsMount* m)
+{
+    p.mount = m;
+    p.real.clear();
+    if (!m) {
+        p.rel = p.virt.size();
+        return;
+    }
+    p.rel = m->prefix_len;
+    if (p.virt.size() > p.rel) {
+        p.rel++;    // saute le '/'
+    }
+    if (m->real_root) {
+        p.real = m->real_root;
+        if (p.virt.size() > m->prefix_len) {
+            p.real.append(p.virt, m->prefix_len, std::string::npos);
+        }
+    }
+}
+
+bool vfs_resolve(const char* base, const char* path, VfsPath& out)
+{
+    vfs_normalize(base, path, out.virt);
+    bind_mount(out, lookup_mount(out.virt));
+    return true;
+}
+
+VfsPathMark vfs_path_mark(const VfsPath& p)
+{
+    return VfsPathMark{ p.virt.size(), p.real.size(), p.mount, p.rel };
+}
+
+void vfs_path_push(VfsPath& p, const char* name)
+{
+    const bool at_mount_root = p.mount && p.rel >= p.virt.size();
+    if (p.virt.size() > 1) {
+        p.virt.push_back('/');
+    }
+    p.virt += name;
+    if (!p.mount) {
+        // hors montage : le nouveau composant peut être un point de montage
+        bind_mount(p, lookup_mount(p.virt));
+        return;
+    }
+    if (p.mount->real_root) {
+        p.real.push_back('/');
+        p.real += name;
+    }
+    if (at_mount_root) {
+        p.rel = p.virt.size() - strlen(name);
+    }
+}
+
+void vfs_path_reset(VfsPath& p, const VfsPathMark& mark)
+{
+    p.virt.resize(mark.virt_len);
+    p.real.resize(mark.real_len);
+    p.mount = mark.mount;
+    p.rel = mark.rel;
+}
+
+// ------------------------------------------------------------
+// Répertoires synthétiques (préfixes des points de montage)
+// ------------------------------------------------------------
+
+static bool synthetic_dir(const std::string& virt)
+{
+    if (virt == "/") {
+        return true;
+    }
+    for (size_t i = 0; i < sizeof(k_static_dirs) / sizeof(k_static_dirs[0]); i++) {
+        if (virt == k_static_dirs[i]) {
+            return true;
+        }
+    }
+    for (int i = 0; i < kVfsMaxMounts; i++) {
+        if (mounts[i].ops && vfs_path_under(mounts[i].prefix, virt.c_str())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void synthetic_add(std::vector<std::string>& names, const std::string& virt,
+    const char* child)
+{
+    size_t start = (virt.size() == 1) ? 1 : virt.size() + 1;
+    if (!vfs_path_under(child, virt.c_str()) || strlen(child) <= start) {
+        return;
+    }
+    const char* name = child + start;
+    const char* slash = strchr(name, '/');
+    std::string entry = slash ? std::string(name, (size_t)(slash - name)) : name;
+    if (std::find(names.begin(), names.end(), entry) == names.end()) {
+        names.push_back(entry);
+    }
+}
+
+static void synthetic_list(const std::string& virt, std::vector<std::string>& names)
+{
+    names.clear();
+    for (int i = 0; i < kVfsMaxMounts; i++) {
+        if (mounts[i].ops) {
+            synthetic_add(names, virt, mounts[i].prefix);
+        }
+    }
+    for (size_t i = 0; i < sizeof(k_static_dirs) / sizeof(k_static_dirs[0]); i++) {
+        synthetic_add(names, virt, k_static_dirs[i]);
+    }
+    std::sort(names.begin(), names.end());
+}
+
+// ------------------------------------------------------------
+// Opérations
+// ------------------------------------------------------------
+
+bool vfs_stat(const VfsPath& p, FsStat& out)
+{
+    out.size = 0;
+    out.is_dir = false;
+    out.is_file = false;
+
+    if (!p.mount) {
+        if (!synthetic_dir(p.virt)) {
+            return false;
+        }
+        out.is_dir = true;
+        return true;
+    }
+    if (!p.mount->ops->stat) {
+        return false;
+    }
+    return p.mount->ops->stat(p, out);
+}
+
+bool vfs_opendir(const VfsPath& p, VfsDir& out)
+{
+    out.mount = p.mount;
+    out.handle = nullptr;
+    out.names.clear();
+    out.index = 0;
+
+    if (!p.mount) {
+        if (!synthetic_dir(p.virt)) {
+            return false;
+        }
+        synthetic_list(p.virt, out.names);
+        return true;
+    }
+    if (!p.mount->ops->opendir) {
+        return false;
+    }
+    out.handle = p.mount->ops->opendir(p);
+    return out.handle != nullptr;
+}
+
+bool vfs_readdir(VfsDir& dir, VfsDirent& out)
+{
+    if (!dir.mount) {
+        if (dir.index >= dir.names.size()) {
+            return false;
+        }
+        out.name = dir.names[dir.index++];
+        out.size = 0;
+        out.mtime = 0;
+        out.attr = VFS_ATTR_SYS;
+        out.attr_valid = true;
+        out.is_dir = true;
+        return true;
+    }
+    if (!dir.handle) {
+        return false;
+    }
+    return dir.mount->ops->readdir(dir.handle, out);
+}
+
+void vfs_closedir(VfsDir& dir)
+{
+    if (dir.mount && dir.handle && dir.mount->ops->closedir) {
+        dir.mount->ops->closedir(dir.handle);
+    }
+    dir.handle = nullptr;
+    dir.names.clear();
+}
+
+bool vfs_open(const VfsPath& p, VfsOpenMode mode, VfsFile& out)
+{
+    out.mount = p.mount;
+    out.handle = nullptr;
+    if (!p.mount || !p.mount->ops->open) {
+        return false;
+    }
+    out.handle = p.mount->ops->open(p, mode);
+    return out.handle != nullptr;
+}
+
+int vfs_read(VfsFile& f, void* buf, size_t len)
+{
+    if (!f.handle || !f.mount->ops->read) {
+        return -1;
+    }
+    return f.mount->ops->read(f.handle, buf, len);
+}
+
+int vfs_write(VfsFile& f, const void* buf, size_t len)
+{
+    if (!f.handle || !f.mount->ops->write) {
+        return -1;
+    }
+    return f.mount->ops->write(f.handle, buf, len);
+}
+
+bool vfs_close(VfsFile& f)
+{
+    if (!f.handle) {
+        return false;
+    }
+    bool ok = f.mount->ops->close ? f.mount->ops->close(f.handle) : true;
+    f.handle = nullptr;
+    return ok;
+}
+
+int32_t vfs_seek(VfsFile& f, int32_t offset, int whence)
+{
+    if (!f.handle || !f.mount->ops->seek) {
+        return -1;
+    }
+    return f.mount->ops->seek(f.handle, offset, whence);
+}
+
+bool vfs_truncate(VfsFile& f, uint32_t size)
+{
+    return f.handle && f.mount->ops->truncate &&
+        f.mount->ops->truncate(f.handle, size);
+}
+
+bool vfs_sync(VfsFile& f)
+{
+    if (!f.handle) {
+        return false;
+    }
+    return f.mount->ops->sync ? f.mount->ops->sync(f.handle) : true;
+}
+
+bool vfs_mkdir(const VfsPath& p)
+{
+    return p.mount && p.mount->ops->mkdir && p.mount->ops->mkdir(p);
+}
+
+bool vfs_rmdir(const VfsPath& p)
+{
+    // la racine d'un montage ne se supprime pas
+    if (!p.mount || !*p.rel_path()) {
+        return false;
+    }
+    return p.mount->ops->rmdir && p.mount->ops->rmdir(p);
+}
+
+bool vfs_remove(const VfsPath& p)
+{
+    if (!p.mount || !*p.rel_path()) {
+        return false;
+    }
+    return p.mount->ops->remove && p.mount->ops->remove(p);
+}
+
+bool vfs_rename(const VfsPath& src, const VfsPath& dst)
+{
+    if (!src.mount || src.mount != dst.mount || !src.mount->ops->rename) {
+        return false;
+    }
+    if (!*src.rel_path() || !*dst.rel_path()) {
+        return false;
+    }
+    return src.mount->ops->rename(src, dst);
+}
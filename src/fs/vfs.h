@@ -0,0 +1,152 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "fs.h"
+
+// ------------------------------------------------------------
+// Table de montage
+// ------------------------------------------------------------
+//
+// Chaque point de montage associe un préfixe virtuel ("/media/0") à un
+// backend (VfsOps). Un chemin est normalisé une seule fois dans un
+// VfsPath, qui garde le montage trouvé (plus long préfixe) et, pour les
+// backends POSIX, le chemin réel correspondant.
+
+static constexpr int kVfsMaxMounts = 8;
+
+// attributs d'entrée (mêmes valeurs que FatFS)
+enum {
+    VFS_ATTR_RDO = 0x01,
+    VFS_ATTR_HID = 0x02,
+    VFS_ATTR_SYS = 0x04,
+    VFS_ATTR_ARC = 0x20
+};
+
+// modes d'ouverture
+enum VfsOpenMode {
+    VFS_OPEN_READ = 0,
+    VFS_OPEN_WRITE,
+    VFS_OPEN_APPEND
+};
+
+struct VfsMount;
+
+struct VfsPath {
+    std::string virt;           // chemin virtuel canonique
+    std::string real;           // chemin réel (backends POSIX), sinon vide
+    const VfsMount* mount = nullptr;
+    size_t rel = 0;             // début du chemin relatif au montage dans virt
+
+    // chemin relatif au point de montage ("" pour la racine du montage)
+    const char* rel_path() const { return virt.c_str() + rel; }
+};
+
+// position sauvegardée pour revenir en arrière après vfs_path_push()
+struct VfsPathMark {
+    size_t virt_len;
+    size_t real_len;
+    const VfsMount* mount;
+    size_t rel;
+};
+
+struct VfsDirent {
+    std::string name;
+    uint32_t size;
+    uint32_t mtime;
+    uint8_t attr;               // VFS_ATTR_*
+    bool attr_valid;
+    bool is_dir;
+};
+
+// Opérations d'un backend. Un pointeur nul = opération non supportée.
+struct VfsOps {
+    bool (*stat)(const VfsPath& p, FsStat& out);
+    void* (*opendir)(const VfsPath& p);
+    bool (*readdir)(void* dir, VfsDirent& out);
+    void (*closedir)(void* dir);
+    void* (*open)(const VfsPath& p, VfsOpenMode mode);
+    int (*read)(void* file, void* buf, size_t len);
+    int (*write)(void* file, const void* buf, size_t len);
+    bool (*close)(void* file);
+    int32_t (*seek)(void* file, int32_t offset, int whence);   // nouvelle position
+    // agrandit (contenu indéfini, clusters alloués d'un coup sur FAT) ou
+    // raccourcit
+    bool (*truncate)(void* file, uint32_t size);
+    bool (*sync)(void* file);                       // tampons -> support
+    bool (*mkdir)(const VfsPath& p);
+    bool (*rmdir)(const VfsPath& p);
+    bool (*remove)(const VfsPath& p);
+    bool (*rename)(const VfsPath& src, const VfsPath& dst);
+};
+
+struct VfsMount {
+    const char* prefix;         // point de montage virtuel
+    size_t prefix_len;
+    const VfsOps* ops;
+    const char* real_root;      // racine réelle (POSIX) ou nullptr
+    const char* fat_drive;      // lecteur FatFS ("0:") ou nullptr
+    const char* label;          // nom affiché par df
+};
+
+struct VfsFile {
+    const VfsMount* mount = nullptr;
+    void* handle = nullptr;
+};
+
+struct VfsDir {
+    const VfsMount* mount = nullptr;
+    void* handle = nullptr;
+    std::vector<std::string> names;     // répertoire synthétique
+    size_t index = 0;
+};
+
+// backends fournis
+extern const VfsOps vfs_fat_ops;
+extern const VfsOps vfs_posix_ops;
+extern const VfsOps vfs_dev_ops;
+extern const VfsOps vfs_bin_ops;
+extern const VfsOps vfs_tmpfs_ops;
+
+// tmpfs : budget mémoire (octets) ; les blocs au-delà ne sont plus alloués
+void vfs_tmpfs_set_budget(size_t bytes);
+size_t vfs_tmpfs_budget();
+size_t vfs_tmpfs_used();
+
+// montage
+bool vfs_mount(const char* prefix, const VfsOps* ops, const char* real_root,
+    const char* fat_drive, const char* label);
+bool vfs_umount(const char* prefix);
+int vfs_mount_count();
+const VfsMount* vfs_mount_at(int index);
+const VfsMount* vfs_find_mount(const char* prefix);
+
+// chemins
+void vfs_normalize(const char* base, const char* path, std::string& out);
+bool vfs_resolve(const char* base, const char* path, VfsPath& out);
+bool vfs_path_under(const char* path, const char* prefix);
+VfsPathMark vfs_path_mark(const VfsPath& p);
+void vfs_path_push(VfsPath& p, const char* name);
+void vfs_path_reset(VfsPath& p, const VfsPathMark& mark);
+
+// opérations
+bool vfs_stat(const VfsPath& p, FsStat& out);
+bool vfs_opendir(const VfsPath& p, VfsDir& out);
+bool vfs_readdir(VfsDir& dir, VfsDirent& out);
+void vfs_closedir(VfsDir& dir);
+bool vfs_open(const VfsPath& p, VfsOpenMode mode, VfsFile& out);
+int vfs_read(VfsFile& f, void* buf, size_t len);
+int vfs_write(VfsFile& f, const void* buf, size_t len);
+bool vfs_close(VfsFile& f);
+// whence : SEEK_SET / SEEK_CUR / SEEK_END ; retourne la position ou -1
+int32_t vfs_seek(VfsFile& f, int32_t offset, int whence);
+bool vfs_truncate(VfsFile& f, uint32_t size);
+// vrai aussi si le backend n'a rien à synchroniser
+bool vfs_sync(VfsFile& f);
+bool vfs_mkdir(const VfsPath& p);
+bool vfs_rmdir(const VfsPath& p);
+bool vfs_remove(const VfsPath& p);
+bool vfs_rename(const VfsPath& src, const VfsPath& dst);
@@ -0,0 +1,104 @@
+#include "vfs.h"
+
+#include <string.h>
+
+// ------------------------------------------------------------
+// /bin : liste des commandes intégrées (lecture seule)
+// ------------------------------------------------------------
+
+static const char* k_bin_names[] = {
+    "ls", "pwd", "cd", "mount", "umount",
+    "df", "du", "sdinfo", "sync",
+    "mkdir", "rmdir", "cp", "mv", "dd", "rm",
+    "crc32", "md5sum", "sha256sum", "gzip", "gunzip", "tar",
+    "vi", "nano", "touch", "cat",
+    "view", "slideshow", "play", "led",
+    "lx", "lxprofile", "more", "less", "find", "tee",
+    "clear", "reset", "battery", "free", "echo", "shutdown", "reboot", "brightness",
+    "man",
+    "uptime"
+};
+
+static constexpr size_t kBinCount = sizeof(k_bin_names) / sizeof(k_bin_names[0]);
+
+struct BinDir {
+    size_t index;
+};
+
+static bool bin_has(const char* name)
+{
+    if (!name || !*name) {
+        return false;
+    }
+    for (size_t i = 0; i < kBinCount; i++) {
+        if (strcmp(k_bin_names[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool bin_stat(const VfsPath& p, FsStat& out)
+{
+    out.size = 0;
+    out.is_dir = false;
+    out.is_file = false;
+    const char* rel = p.rel_path();
+    if (!*rel) {
+        out.is_dir = true;
+        return true;
+    }
+    if (!bin_has(rel)) {
+        return false;
+    }
+    out.is_file = true;
+    return true;
+}
+
+static void* bin_opendir(const VfsPath& p)
+{
+    if (*p.rel_path()) {
+        return nullptr;
+    }
+    BinDir* d = new BinDir;
+    d->index = 0;
+    return d;
+}
+
+static bool bin_readdir(void* handle, VfsDirent& out)
+{
+    BinDir* d = static_cast<BinDir*>(handle);
+    if (d->index >= kBinCount) {
+        return false;
+    }
+    out.name = k_bin_names[d->index++];
+    out.size = 0;
+    out.mtime = 0;
+    out.attr = VFS_ATTR_SYS | VFS_ATTR_RDO;
+    out.attr_valid = true;
+    out.is_dir = false;
+    return true;
+}
+
+static void bin_closedir(void* handle)
+{
+    delete static_cast<BinDir*>(handle);
+}
+
+const VfsOps vfs_bin_ops = {
+    bin_stat,
+    bin_opendir,
+    bin_readdir,
+    bin_closedir,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr
+};
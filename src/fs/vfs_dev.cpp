@@ -0,0 +1,201 @@
+#include "vfs.h"
+
+#include <string.h>
+#include <Arduino.h>
+#include <esp_system.h>
+
+#include "ui/terminal.h"
+
+// ------------------------------------------------------------
+// /dev
+// ------------------------------------------------------------
+
+// Pilote d'un périphérique : lecture / écriture en flux.
+// Un pointeur nul = ouverture refusée dans ce sens.
+struct DevDriver {
+    const char* name;
+    int (*read)(void* buf, size_t len);
+    int (*write)(const void* buf, size_t len);
+    bool stream;            // lecture sans fin (zero, random…)
+};
+
+static int dev_read_zero(void* buf, size_t len)
+{
+    memset(buf, 0, len);
+    return (int)len;
+}
+
+// RNG matériel, rempli par blocs entiers
+static int dev_read_random(void* buf, size_t len)
+{
+    esp_fill_random(buf, len);
+    return (int)len;
+}
+
+static int dev_read_eof(void*, size_t)
+{
+    return 0;
+}
+
+static int dev_write_sink(const void*, size_t len)
+{
+    return (int)len;
+}
+
+static int dev_write_full(const void*, size_t)
+{
+    return -1;
+}
+
+static int dev_write_serial(const void* buf, size_t len)
+{
+    if (len > 0) {
+        Serial.write(static_cast<const uint8_t*>(buf), len);
+        Serial.flush();
+    }
+    return (int)len;
+}
+
+static int dev_write_term(const void* buf, size_t len)
+{
+    if (len > 0) {
+        term_write_bytes(static_cast<const char*>(buf), len);
+    }
+    return (int)len;
+}
+
+static int dev_write_term_err(const void* buf, size_t len)
+{
+    if (len > 0) {
+        term_write_bytes_error(static_cast<const char*>(buf), len);
+    }
+    return (int)len;
+}
+
+static const DevDriver k_dev_drivers[] = {
+    { "console", nullptr, dev_write_serial, false },
+    { "stdout", nullptr, dev_write_term, false },
+    { "stderr", nullptr, dev_write_term_err, false },
+    { "tty", nullptr, dev_write_term, false },
+    { "kmsg", nullptr, dev_write_serial, false },
+    { "full", dev_read_zero, dev_write_full, true },
+    { "zero", dev_read_zero, dev_write_sink, true },
+    { "random", dev_read_random, dev_write_sink, true },
+    { "urandom", dev_read_random, dev_write_sink, true },
+    { "null", dev_read_eof, dev_write_sink, false }
+};
+
+static constexpr size_t kDevCount = sizeof(k_dev_drivers) / sizeof(k_dev_drivers[0]);
+
+struct DevDir {
+    size_t index;
+};
+
+static const DevDriver* dev_find(const char* name)
+{
+    if (!name || !*name || strchr(name, '/')) {
+        return nullptr;
+    }
+    for (size_t i = 0; i < kDevCount; i++) {
+        if (strcmp(k_dev_drivers[i].name, name) == 0) {
+            return &k_dev_drivers[i];
+        }
+    }
+    return nullptr;
+}
+
+static bool dev_stat(const VfsPath& p, FsStat& out)
+{
+    out.size = 0;
+    out.is_dir = false;
+    out.is_file = false;
+    out.is_stream = false;
+    const char* rel = p.rel_path();
+    if (!*rel) {
+        out.is_dir = true;
+        return true;
+    }
+    const DevDriver* dev = dev_find(rel);
+    if (!dev) {
+        return false;
+    }
+    out.is_file = true;
+    out.is_stream = dev->stream;
+    return true;
+}
+
+static void* dev_opendir(const VfsPath& p)
+{
+    if (*p.rel_path()) {
+        return nullptr;
+    }
+    DevDir* d = new DevDir;
+    d->index = 0;
+    return d;
+}
+
+static bool dev_readdir(void* handle, VfsDirent& out)
+{
+    DevDir* d = static_cast<DevDir*>(handle);
+    if (d->index >= kDevCount) {
+        return false;
+    }
+    out.name = k_dev_drivers[d->index++].name;
+    out.size = 0;
+    out.mtime = 0;
+    out.attr = VFS_ATTR_SYS;
+    out.attr_valid = true;
+    out.is_dir = false;
+    return true;
+}
+
+static void dev_closedir(void* handle)
+{
+    delete static_cast<DevDir*>(handle);
+}
+
+// le handle est le pilote lui-même : aucun état par ouverture
+static void* dev_open(const VfsPath& p, VfsOpenMode mode)
+{
+    const DevDriver* dev = dev_find(p.rel_path());
+    if (!dev) {
+        return nullptr;
+    }
+    if (mode == VFS_OPEN_READ ? !dev->read : !dev->write) {
+        return nullptr;
+    }
+    return const_cast<DevDriver*>(dev);
+}
+
+static int dev_read(void* handle, void* buf, size_t len)
+{
+    return static_cast<const DevDriver*>(handle)->read(buf, len);
+}
+
+static int dev_write(void* handle, const void* buf, size_t len)
+{
+    return static_cast<const DevDriver*>(handle)->write(buf, len);
+}
+
+static bool dev_close(void*)
+{
+    return true;
+}
+
+const VfsOps vfs_dev_ops = {
+    dev_stat,
+    dev_opendir,
+    dev_readdir,
+    dev_closedir,
+    dev_open,
+    dev_read,
+    dev_write,
+    dev_close,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr,
+    nullptr
+};
@@ -0,0 +1,321 @@
+#include "vfs.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ff.h"
+
+// ------------------------------------------------------------
+// Backend POSIX (chemin réel via la VFS ESP-IDF)
+// ------------------------------------------------------------
+
+struct PosixDir {
+    DIR* dir;
+    std::string path;   // chemin réel du répertoire, réutilisé pour stat()
+    size_t base_len;
+};
+
+static bool posix_stat(const VfsPath& p, FsStat& out)
+{
+    struct stat st;
+    if (stat(p.real.c_str(), &st) != 0) {
+        return false;
+    }
+    out.size = (uint32_t)st.st_size;
+    out.is_dir = S_ISDIR(st.st_mode);
+    out.is_file = S_ISREG(st.st_mode);
+    out.mtime = (uint32_t)st.st_mtime;
+    return true;
+}
+
+static void* posix_opendir(const VfsPath& p)
+{
+    DIR* d = opendir(p.real.c_str());
+    if (!d) {
+        return nullptr;
+    }
+    PosixDir* pd = new PosixDir;
+    pd->dir = d;
+    pd->path = p.real;
+    if (pd->path.empty() || pd->path.back() != '/') {
+        pd->path.push_back('/');
+    }
+    pd->base_len = pd->path.size();
+    return pd;
+}
+
+static bool posix_readdir(void* handle, VfsDirent& out)
+{
+    PosixDir* pd = static_cast<PosixDir*>(handle);
+    struct dirent* ent;
+    while ((ent = readdir(pd->dir)) != nullptr) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+        out.name = ent->d_name;
+        out.size = 0;
+        out.mtime = 0;
+        out.attr = 0;
+        out.attr_valid = false;
+        out.is_dir = false;
+
+        pd->path.resize(pd->base_len);
+        pd->path += ent->d_name;
+        struct stat st;
+        if (stat(pd->path.c_str(), &st) == 0) {
+            out.size = (uint32_t)st.st_size;
+            out.mtime = (uint32_t)st.st_mtime;
+            out.is_dir = S_ISDIR(st.st_mode);
+        }
+        return true;
+    }
+    return false;
+}
+
+static void posix_closedir(void* handle)
+{
+    PosixDir* pd = static_cast<PosixDir*>(handle);
+    closedir(pd->dir);
+    delete pd;
+}
+
+static void* posix_open(const VfsPath& p, VfsOpenMode mode)
+{
+    const char* fmode = "rb";
+    if (mode == VFS_OPEN_WRITE) {
+        fmode = "wb";
+    } else if (mode == VFS_OPEN_APPEND) {
+        fmode = "ab";
+    }
+    return fopen(p.real.c_str(), fmode);
+}
+
+static int posix_read(void* handle, void* buf, size_t len)
+{
+    FILE* f = static_cast<FILE*>(handle);
+    size_t n = fread(buf, 1, len, f);
+    if (n == 0 && ferror(f)) {
+        return -1;
+    }
+    return (int)n;
+}
+
+static int posix_write(void* handle, const void* buf, size_t len)
+{
+    FILE* f = static_cast<FILE*>(handle);
+    size_t n = fwrite(buf, 1, len, f);
+    if (n != len) {
+        return -1;
+    }
+    return (int)n;
+}
+
+static bool posix_close(void* handle)
+{
+    return fclose(static_cast<FILE*>(handle)) == 0;
+}
+
+static int32_t posix_seek(void* handle, int32_t offset, int whence)
+{
+    FILE* f = static_cast<FILE*>(handle);
+    if (fseek(f, offset, whence) != 0) {
+        return -1;
+    }
+    return (int32_t)ftell(f);
+}
+
+static bool posix_truncate(void* handle, uint32_t size)
+{
+    FILE* f = static_cast<FILE*>(handle);
+    if (fflush(f) != 0) {
+        return false;
+    }
+    if (ftruncate(fileno(f), (off_t)size) == 0) {
+        return true;
+    }
+    // vfs_fat refuse d'agrandir (f_truncate ne fait que raccourcir) ; mais
+    // f_lseek au-delà de la fin d'un fichier ouvert en écriture alloue la
+    // chaîne de clusters jusque-là et étend le fichier (contenu indéfini)
+    struct stat st;
+    long pos = ftell(f);
+    if (pos < 0 || fstat(fileno(f), &st) != 0 || (uint32_t)st.st_size >= size) {
+        return false;
+    }
+    bool ok = fseek(f, (long)size, SEEK_SET) == 0 &&
+        fstat(fileno(f), &st) == 0 && (uint32_t)st.st_size == size;
+    if (fseek(f, pos, SEEK_SET) != 0) {
+        ok = false;
+    }
+    return ok;
+}
+
+static bool posix_sync(void* handle)
+{
+    FILE* f = static_cast<FILE*>(handle);
+    if (fflush(f) != 0) {
+        return false;
+    }
+    return fsync(fileno(f)) == 0;
+}
+
+static bool posix_mkdir(const VfsPath& p)
+{
+    return mkdir(p.real.c_str(), 0777) == 0;
+}
+
+static bool posix_rmdir(const VfsPath& p)
+{
+    return rmdir(p.real.c_str()) == 0;
+}
+
+static bool posix_remove(const VfsPath& p)
+{
+    return remove(p.real.c_str()) == 0;
+}
+
+static bool posix_rename(const VfsPath& src, const VfsPath& dst)
+{
+    return rename(src.real.c_str(), dst.real.c_str()) == 0;
+}
+
+const VfsOps vfs_posix_ops = {
+    posix_stat,
+    posix_opendir,
+    posix_readdir,
+    posix_closedir,
+    posix_open,
+    posix_read,
+    posix_write,
+    posix_close,
+    posix_seek,
+    posix_truncate,
+    posix_sync,
+    posix_mkdir,
+    posix_rmdir,
+    posix_remove,
+    posix_rename
+};
+
+// ------------------------------------------------------------
+// Backend FAT : métadonnées lues directement par FatFS
+// ------------------------------------------------------------
+//
+// Un seul f_readdir() donne nom, taille, date et attributs : plus de
+// stat() + f_stat() par entrée. Les données passent toujours par FILE*.
+
+static uint32_t fat_days_from_civil(int y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (uint32_t)(era * 146097 + (int)doe - 719468);
+}
+
+static uint32_t fat_time_to_epoch(WORD fdate, WORD ftime)
+{
+    if (fdate == 0) {
+        return 0;
+    }
+    int year = 1980 + ((fdate >> 9) & 0x7F);
+    unsigned month = (fdate >> 5) & 0x0F;
+    unsigned day = fdate & 0x1F;
+    if (month < 1 || month > 12 || day < 1) {
+        return 0;
+    }
+    uint32_t days = fat_days_from_civil(year, month, day);
+    uint32_t secs = ((ftime >> 11) & 0x1F) * 3600u +
+        ((ftime >> 5) & 0x3F) * 60u + (ftime & 0x1F) * 2u;
+    return days * 86400u + secs;
+}
+
+// "0:" + chemin relatif au montage
+static void fat_path(const VfsPath& p, std::string& out)
+{
+    out = p.mount->fat_drive;
+    out.push_back('/');
+    out += p.rel_path();
+}
+
+static void fat_fill(const FILINFO& fno, VfsDirent& out)
+{
+    out.name = fno.fname;
+    out.size = (uint32_t)fno.fsize;
+    out.mtime = fat_time_to_epoch(fno.fdate, fno.ftime);
+    out.attr = fno.fattrib & (AM_RDO | AM_HID | AM_SYS | AM_ARC);
+    out.attr_valid = true;
+    out.is_dir = (fno.fattrib & AM_DIR) != 0;
+}
+
+static bool fat_stat(const VfsPath& p, FsStat& out)
+{
+    // f_stat() refuse la racine du volume
+    if (!*p.rel_path()) {
+        out.size = 0;
+        out.is_dir = true;
+        out.is_file = false;
+        return true;
+    }
+    std::string path;
+    fat_path(p, path);
+    FILINFO fno;
+    if (f_stat(path.c_str(), &fno) != FR_OK) {
+        return false;
+    }
+    out.size = (uint32_t)fno.fsize;
+    out.is_dir = (fno.fattrib & AM_DIR) != 0;
+    out.is_file = !out.is_dir;
+    out.mtime = fat_time_to_epoch(fno.fdate, fno.ftime);
+    return true;
+}
+
+static void* fat_opendir(const VfsPath& p)
+{
+    std::string path;
+    fat_path(p, path);
+    FF_DIR* dir = new FF_DIR;
+    if (f_opendir(dir, path.c_str()) != FR_OK) {
+        delete dir;
+        return nullptr;
+    }
+    return dir;
+}
+
+static bool fat_readdir(void* handle, VfsDirent& out)
+{
+    FF_DIR* dir = static_cast<FF_DIR*>(handle);
+    FILINFO fno;
+    if (f_readdir(dir, &fno) != FR_OK || fno.fname[0] == '\0') {
+        return false;
+    }
+    fat_fill(fno, out);
+    return true;
+}
+
+static void fat_closedir(void* handle)
+{
+    FF_DIR* dir = static_cast<FF_DIR*>(handle);
+    f_closedir(dir);
+    delete dir;
+}
+
+const VfsOps vfs_fat_ops = {
+    fat_stat,
+    fat_opendir,
+    fat_readdir,
+    fat_closedir,
+    posix_open,
+    posix_read,
+    posix_write,
+    posix_close,
+    posix_seek,
+    posix_truncate,
+    posix_sync,
+    posix_mkdir,
+    posix_rmdir,
+    posix_remove,
+    posix_rename
+};
@@ -0,0 +1,450 @@
+#include "vfs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+// ------------------------------------------------------------
+// tmpfs : système de fichiers en RAM
+// ------------------------------------------------------------
+//
+// Les données sont rangées dans des blocs de taille fixe pris dans un
+// pool. Les blocs libérés restent dans une free list pour être
+// réutilisés sans repasser par malloc(). Le nombre total de blocs est
+// plafonné par un budget (fixé depuis le profil Lx).
+
+static constexpr size_t kTmpBlockSize = 512;
+
+struct TmpNode {
+    std::string name;
+    TmpNode* parent;
+    std::vector<TmpNode*> children;
+    std::vector<uint8_t*> blocks;
+    uint32_t size;
+    uint32_t mtime;
+    int open_count;
+    bool is_dir;
+    bool unlinked;      // supprimé alors qu'encore ouvert
+};
+
+struct TmpHandle {
+    TmpNode* node;
+    uint32_t pos;
+};
+
+struct TmpDir {
+    TmpNode* node;
+    std::vector<std::string> names;     // instantané : la suppression
+    size_t index;                       // pendant le parcours reste sûre
+};
+
+static TmpNode root_node = { "", nullptr, {}, {}, 0, 0, 0, true, false };
+
+static std::vector<uint8_t*> free_blocks;
+static size_t blocks_allocated = 0;     // en usage + free list
+static size_t blocks_used = 0;
+static size_t budget_blocks = 0;
+
+// ------------------------------------------------------------
+// Pool de blocs
+// ------------------------------------------------------------
+
+static uint8_t* block_take()
+{
+    if (!free_blocks.empty()) {
+        uint8_t* b = free_blocks.back();
+        free_blocks.pop_back();
+        blocks_used++;
+        return b;
+    }
+    if (blocks_allocated >= budget_blocks) {
+        return nullptr;
+    }
+    uint8_t* b = static_cast<uint8_t*>(malloc(kTmpBlockSize));
+    if (!b) {
+        return nullptr;
+    }
+    blocks_allocated++;
+    blocks_used++;
+    return b;
+}
+
+static void block_release(uint8_t* b)
+{
+    blocks_used--;
+    if (blocks_allocated > budget_blocks) {
+        free(b);
+        blocks_allocated--;
+        return;
+    }
+    free_blocks.push_back(b);
+}
+
+static void trim_free_list()
+{
+    while (!free_blocks.empty() && blocks_allocated > budget_blocks) {
+        free(free_blocks.back());
+        free_blocks.pop_back();
+        blocks_allocated--;
+    }
+}
+
+void vfs_tmpfs_set_budget(size_t bytes)
+{
+    budget_blocks = bytes / kTmpBlockSize;
+    trim_free_list();
+}
+
+size_t vfs_tmpfs_budget()
+{
+    return budget_blocks * kTmpBlockSize;
+}
+
+size_t vfs_tmpfs_used()
+{
+    return blocks_used * kTmpBlockSize;
+}
+
+// ------------------------------------------------------------
+// Nœuds
+// ------------------------------------------------------------
+
+static uint32_t tmp_now()
+{
+    return (uint32_t)time(nullptr);
+}
+
+static TmpNode* node_child(TmpNode* dir, const char* name, size_t len)
+{
+    for (TmpNode* c : dir->children) {
+        if (c->name.size() == len && memcmp(c->name.data(), name, len) == 0) {
+            return c;
+        }
+    }
+    return nullptr;
+}
+
+// parcourt le chemin relatif ; si leaf est non nul, s'arrête au parent
+// et y range le nom du dernier composant
+static TmpNode* node_walk(const char* rel, std::string* leaf)
+{
+    TmpNode* cur = &root_node;
+    const char* p = rel;
+    while (*p) {
+        const char* start = p;
+        while (*p && *p != '/') {
+            p++;
+        }
+        size_t len = (size_t)(p - start);
+        if (leaf && !*p) {
+            leaf->assign(start, len);
+            return cur;
+        }
+        cur = node_child(cur, start, len);
+        if (!cur || (!cur->is_dir && *p)) {
+            return nullptr;
+        }
+        if (*p) {
+            p++;
+        }
+    }
+    return leaf ? nullptr : cur;
+}
+
+static TmpNode* node_lookup(const VfsPath& p)
+{
+    return node_walk(p.rel_path(), nullptr);
+}
+
+static void node_truncate(TmpNode* n)
+{
+    for (uint8_t* b : n->blocks) {
+        block_release(b);
+    }
+    n->blocks.clear();
+    n->size = 0;
+}
+
+static void node_detach(TmpNode* n)
+{
+    std::vector<TmpNode*>& sib = n->parent->children;
+    sib.erase(std::remove(sib.begin(), sib.end(), n), sib.end());
+    n->parent = nullptr;
+}
+
+static void node_unlink(TmpNode* n)
+{
+    node_detach(n);
+    if (n->open_count > 0) {
+        n->unlinked = true;
+        return;
+    }
+    node_truncate(n);
+    delete n;
+}
+
+static TmpNode* node_create(TmpNode* parent, const std::string& name, bool is_dir)
+{
+    TmpNode* n = new TmpNode;
+    n->name = name;
+    n->parent = parent;
+    n->size = 0;
+    n->mtime = tmp_now();
+    n->open_count = 0;
+    n->is_dir = is_dir;
+    n->unlinked = false;
+    parent->children.push_back(n);
+    parent->mtime = n->mtime;
+    return n;
+}
+
+// ------------------------------------------------------------
+// Opérations
+// ------------------------------------------------------------
+
+static bool tmp_stat(const VfsPath& p, FsStat& out)
+{
+    TmpNode* n = node_lookup(p);
+    if (!n) {
+        return false;
+    }
+    out.size = n->size;
+    out.is_dir = n->is_dir;
+    out.is_file = !n->is_dir;
+    out.mtime = n->mtime;
+    return true;
+}
+
+static void* tmp_opendir(const VfsPath& p)
+{
+    TmpNode* n = node_lookup(p);
+    if (!n || !n->is_dir) {
+        return nullptr;
+    }
+    TmpDir* d = new TmpDir;
+    d->node = n;
+    d->index = 0;
+    d->names.reserve(n->children.size());
+    for (TmpNode* c : n->children) {
+        d->names.push_back(c->name);
+    }
+    return d;
+}
+
+static bool tmp_readdir(void* handle, VfsDirent& out)
+{
+    TmpDir* d = static_cast<TmpDir*>(handle);
+    while (d->index < d->names.size()) {
+        const std::string& name = d->names[d->index++];
+        TmpNode* c = node_child(d->node, name.data(), name.size());
+        if (!c) {
+            continue;
+        }
+        out.name = c->name;
+        out.size = c->size;
+        out.mtime = c->mtime;
+        out.attr = 0;
+        out.attr_valid = false;
+        out.is_dir = c->is_dir;
+        return true;
+    }
+    return false;
+}
+
+static void tmp_closedir(void* handle)
+{
+    delete static_cast<TmpDir*>(handle);
+}
+
+static void* tmp_open(const VfsPath& p, VfsOpenMode mode)
+{
+    std::string leaf;
+    TmpNode* parent = node_walk(p.rel_path(), &leaf);
+    if (!parent || !parent->is_dir || leaf.empty()) {
+        return nullptr;
+    }
+    TmpNode* n = node_child(parent, leaf.data(), leaf.size());
+    if (n && n->is_dir) {
+        return nullptr;
+    }
+    if (!n) {
+        if (mode == VFS_OPEN_READ) {
+            return nullptr;
+        }
+        n = node_create(parent, leaf, false);
+    } else if (mode == VFS_OPEN_WRITE) {
+        node_truncate(n);
+        n->mtime = tmp_now();
+    }
+
+    TmpHandle* h = new TmpHandle;
+    h->node = n;
+    h->pos = (mode == VFS_OPEN_APPEND) ? n->size : 0;
+    n->open_count++;
+    return h;
+}
+
+static int tmp_read(void* handle, void* buf, size_t len)
+{
+    TmpHandle* h = static_cast<TmpHandle*>(handle);
+    TmpNode* n = h->node;
+    uint8_t* dst = static_cast<uint8_t*>(buf);
+    size_t done = 0;
+    while (done < len && h->pos < n->size) {
+        size_t bi = h->pos / kTmpBlockSize;
+        size_t off = h->pos % kTmpBlockSize;
+        size_t chunk = std::min(kTmpBlockSize - off, len - done);
+        chunk = std::min(chunk, (size_t)(n->size - h->pos));
+        memcpy(dst + done, n->blocks[bi] + off, chunk);
+        done += chunk;
+        h->pos += (uint32_t)chunk;
+    }
+    return (int)done;
+}
+
+static int tmp_write(void* handle, const void* buf, size_t len)
+{
+    TmpHandle* h = static_cast<TmpHandle*>(handle);
+    TmpNode* n = h->node;
+    const uint8_t* src = static_cast<const uint8_t*>(buf);
+    size_t done = 0;
+    while (done < len) {
+        size_t bi = h->pos / kTmpBlockSize;
+        size_t off = h->pos % kTmpBlockSize;
+        while (bi >= n->blocks.size()) {
+            uint8_t* b = block_take();
+            if (!b) {
+                return -1;  // budget épuisé
+            }
+            n->blocks.push_back(b);
+        }
+        size_t chunk = std::min(kTmpBlockSize - off, len - done);
+        memcpy(n->blocks[bi] + off, src + done, chunk);
+        done += chunk;
+        h->pos += (uint32_t)chunk;
+        if (h->pos > n->size) {
+            n->size = h->pos;
+        }
+    }
+    n->mtime = tmp_now();
+    return (int)done;
+}
+
+static bool tmp_close(void* handle)
+{
+    TmpHandle* h = static_cast<TmpHandle*>(handle);
+    TmpNode* n = h->node;
+    delete h;
+    if (--n->open_count == 0 && n->unlinked) {
+        node_truncate(n);
+        delete n;
+    }
+    return true;
+}
+
+static int32_t tmp_seek(void* handle, int32_t offset, int whence)
+{
+    TmpHandle* h = static_cast<TmpHandle*>(handle);
+    int64_t base = 0;
+    if (whence == SEEK_CUR) {
+        base = h->pos;
+    } else if (whence == SEEK_END) {
+        base = h->node->size;
+    }
+    int64_t pos = base + offset;
+    // pas de trous : les blocs au-delà de la fin ne seraient pas initialisés
+    if (pos < 0 || pos > (int64_t)h->node->size) {
+        return -1;
+    }
+    h->pos = (uint32_t)pos;
+    return (int32_t)pos;
+}
+
+static bool tmp_mkdir(const VfsPath& p)
+{
+    std::string leaf;
+    TmpNode* parent = node_walk(p.rel_path(), &leaf);
+    if (!parent || !parent->is_dir || leaf.empty()) {
+        return false;
+    }
+    if (node_child(parent, leaf.data(), leaf.size())) {
+        return false;
+    }
+    node_create(parent, leaf, true);
+    return true;
+}
+
+static bool tmp_rmdir(const VfsPath& p)
+{
+    TmpNode* n = node_lookup(p);
+    if (!n || n == &root_node || !n->is_dir || !n->children.empty()) {
+        return false;
+    }
+    node_unlink(n);
+    return true;
+}
+
+static bool tmp_remove(const VfsPath& p)
+{
+    TmpNode* n = node_lookup(p);
+    if (!n || n == &root_node || (n->is_dir && !n->children.empty())) {
+        return false;
+    }
+    node_unlink(n);
+    return true;
+}
+
+static bool tmp_rename(const VfsPath& src, const VfsPath& dst)
+{
+    TmpNode* n = node_lookup(src);
+    if (!n || n == &root_node) {
+        return false;
+    }
+    std::string leaf;
+    TmpNode* parent = node_walk(dst.rel_path(), &leaf);
+    if (!parent || !parent->is_dir || leaf.empty()) {
+        return false;
+    }
+    // un répertoire ne peut pas être déplacé sous lui-même
+    for (TmpNode* up = parent; up; up = up->parent) {
+        if (up == n) {
+            return false;
+        }
+    }
+    TmpNode* existing = node_child(parent, leaf.data(), leaf.size());
+    if (existing == n) {
+        return true;
+    }
+    if (existing) {
+        if (existing->is_dir || n->is_dir) {
+            return false;
+        }
+        node_unlink(existing);
+    }
+    node_detach(n);
+    n->name = leaf;
+    n->parent = parent;
+    parent->children.push_back(n);
+    parent->mtime = tmp_now();
+    return true;
+}
+
+const VfsOps vfs_tmpfs_ops = {
+    tmp_stat,
+    tmp_opendir,
+    tmp_readdir,
+    tmp_closedir,
+    tmp_open,
+    tmp_read,
+    tmp_write,
+    tmp_close,
+    tmp_seek,
+    nullptr,
+    nullptr,
+    tmp_mkdir,
+    tmp_rmdir,
+    tmp_remove,
+    tmp_rename
+};
@@ -0,0 +1,52 @@
+#include "flashfs.h"
+
+#include <LittleFS.h>
+#include "esp_log.h"
+
+static const char* TAG = "FLASHFS";
+static const char* MOUNT_POINT = "/littlefs";
+static const char* PARTITION_LABEL = "spiffs";
+
+static bool mounted = false;
+
+bool flash_mount(bool format_if_failed)
+{
+    if (mounted) {
+        return true;
+    }
+    if (!LittleFS.begin(format_if_failed, MOUNT_POINT, 5, PARTITION_LABEL)) {
+        ESP_LOGE(TAG, "littlefs mount failed");
+        return false;
+    }
+    mounted = true;
+    return true;
+}
+
+void flash_umount()
+{
+    if (!mounted) {
+        return;
+    }
+    LittleFS.end();
+    mounted = false;
+}
+
+bool flash_is_mounted()
+{
+    return mounted;
+}
+
+const char* flash_mount_point()
+{
+    return MOUNT_POINT;
+}
+
+size_t flash_total_bytes()
+{
+    return mounted ? LittleFS.totalBytes() : 0;
+}
+
+size_t flash_used_bytes()
+{
+    return mounted ? LittleFS.usedBytes() : 0;
+}
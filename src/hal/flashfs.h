@@ -0,0 +1,11 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+// LittleFS sur la partition "spiffs" de la flash interne
+bool flash_mount(bool format_if_failed);
+void flash_umount();
+bool flash_is_mounted();
+const char* flash_mount_point();
+size_t flash_total_bytes();
+size_t flash_used_bytes();
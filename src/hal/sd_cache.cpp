@@ -0,0 +1,505 @@
+#include "sd_cache.h"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <Arduino.h>
+
+#include "diskio_impl.h"
+#include "diskio_sdmmc.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// -DSD_CACHE_TRACE : chaque accès FatFS est écrit sur la console
+// ("<ms> R lba n", "<ms> W lba n", "<ms> S"), trace que rejoue
+// test/test_sd_cache pour régler la politique du cache
+#ifdef SD_CACHE_TRACE
+#include <stdio.h>
+#define CACHE_TRACE(op, lba, n) \
+    printf("SDT %lu %c %lu %u\n", (unsigned long)millis(), op, (unsigned long)(lba), (unsigned)(n))
+#else
+#define CACHE_TRACE(op, lba, n)
+#endif
+
+// ------------------------------------------------------------
+// État
+// ------------------------------------------------------------
+
+static constexpr size_t kSectorSize = 512;
+static constexpr size_t kStageSectors = 8;      // écriture groupée max
+static constexpr uint32_t kSdCacheIdleMs = 1000;
+
+struct CacheSlot {
+    uint32_t lba;
+    uint32_t stamp;     // dernier accès (LRU)
+    bool valid;
+    bool dirty;
+    bool meta;          // zone FAT / racine FAT16 : gardée en priorité
+};
+
+static sdmmc_card_t* cache_card = nullptr;
+static BYTE cache_pdrv = 0xFF;
+static CacheSlot* slots = nullptr;
+static uint8_t* slot_data = nullptr;
+static uint8_t* stage = nullptr;
+static size_t slot_count = 0;
+static size_t meta_cap = 0;
+static uint32_t clock_stamp = 0;
+static uint32_t last_write_ms = 0;
+static SemaphoreHandle_t cache_lock = nullptr;
+static SdCacheStats stats;
+
+// [meta_start, meta_end) : secteurs réservés + FAT + racine FAT12/16
+static uint32_t meta_start = 0;
+static uint32_t meta_end = 0;
+
+static uint8_t* slot_buf(size_t i)
+{
+    return slot_data + i * kSectorSize;
+}
+
+static void lock()
+{
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+}
+
+static void unlock()
+{
+    xSemaphoreGive(cache_lock);
+}
+
+// ------------------------------------------------------------
+// Géométrie FAT (lue une fois au montage)
+// ------------------------------------------------------------
+
+static uint16_t rd16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t rd32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+        ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool is_boot_sector(const uint8_t* s)
+{
+    return s[510] == 0x55 && s[511] == 0xAA &&
+        (s[0] == 0xEB || s[0] == 0xE9) && rd16(s + 11) == kSectorSize;
+}
+
+static void read_layout()
+{
+    meta_start = 0;
+    meta_end = 0;
+    if (sdmmc_read_sectors(cache_card, stage, 0, 1) != ESP_OK) {
+        return;
+    }
+    uint32_t part = 0;
+    if (!is_boot_sector(stage)) {
+        part = rd32(stage + 0x1C6);    // première partition MBR
+        if (sdmmc_read_sectors(cache_card, stage, part, 1) != ESP_OK ||
+            !is_boot_sector(stage)) {
+            return;
+        }
+    }
+    uint32_t reserved = rd16(stage + 0x0E);
+    uint32_t fats = stage[0x10];
+    uint32_t root_entries = rd16(stage + 0x11);
+    uint32_t fat_size = rd16(stage + 0x16);
+    if (fat_size == 0) {
+        fat_size = rd32(stage + 0x24);
+    }
+    uint32_t root_sectors = (root_entries * 32 + kSectorSize - 1) / kSectorSize;
+    meta_start = part;
+    meta_end = part + reserved + fats * fat_size + root_sectors;
+}
+
+static bool is_meta(uint32_t lba)
+{
+    return lba >= meta_start && lba < meta_end;
+}
+
+// ------------------------------------------------------------
+// Slots
+// ------------------------------------------------------------
+
+static int slot_find(uint32_t lba)
+{
+    for (size_t i = 0; i < slot_count; i++) {
+        if (slots[i].valid && slots[i].lba == lba) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static void touch(size_t i)
+{
+    slots[i].stamp = ++clock_stamp;
+}
+
+static bool write_run(uint32_t lba, const uint8_t* buf, size_t count)
+{
+    stats.flush_writes++;
+    return sdmmc_write_sectors(cache_card, buf, lba, count) == ESP_OK;
+}
+
+// écrit tous les secteurs sales, triés et groupés par plages contiguës
+static bool flush_locked()
+{
+    std::vector<uint16_t> dirty;
+    for (size_t i = 0; i < slot_count; i++) {
+        if (slots[i].valid && slots[i].dirty) {
+            dirty.push_back((uint16_t)i);
+        }
+    }
+    if (dirty.empty()) {
+        return true;
+    }
+    std::sort(dirty.begin(), dirty.end(),
+        [](uint16_t a, uint16_t b) {
+            return slots[a].lba < slots[b].lba;
+        });
+
+    bool ok = true;
+    size_t i = 0;
+    while (i < dirty.size()) {
+        size_t run = 1;
+        while (i + run < dirty.size() && run < kStageSectors &&
+            slots[dirty[i + run]].lba == slots[dirty[i]].lba + run) {
+            run++;
+        }
+        bool written;
+        if (run == 1) {
+            written = write_run(slots[dirty[i]].lba, slot_buf(dirty[i]), 1);
+        } else {
+            for (size_t k = 0; k < run; k++) {
+                memcpy(stage + k * kSectorSize, slot_buf(dirty[i + k]), kSectorSize);
+            }
+            written = write_run(slots[dirty[i]].lba, stage, run);
+        }
+        if (written) {
+            for (size_t k = 0; k < run; k++) {
+                slots[dirty[i + k]].dirty = false;
+            }
+            stats.flushed_sectors += (uint32_t)run;
+        } else {
+            ok = false;
+        }
+        i += run;
+    }
+    stats.flushes++;
+    return ok;
+}
+
+static size_t dirty_count()
+{
+    size_t n = 0;
+    for (size_t i = 0; i < slot_count; i++) {
+        if (slots[i].valid && slots[i].dirty) {
+            n++;
+        }
+    }
+    return n;
+}
+
+// LRU hors zone FAT d'abord ; la zone FAT garde au plus meta_cap slots
+static int pick_victim(bool for_meta)
+{
+    size_t meta_used = 0;
+    for (size_t i = 0; i < slot_count; i++) {
+        if (!slots[i].valid) {
+            return (int)i;
+        }
+        if (slots[i].meta) {
+            meta_used++;
+        }
+    }
+    const bool evict_meta = for_meta && meta_used >= meta_cap;
+    int best = -1;
+    int best_meta = -1;
+    for (size_t i = 0; i < slot_count; i++) {
+        if (slots[i].meta) {
+            if (best_meta < 0 || slots[i].stamp < slots[best_meta].stamp) {
+                best_meta = (int)i;
+            }
+        } else if (best < 0 || slots[i].stamp < slots[best].stamp) {
+            best = (int)i;
+        }
+    }
+    if (evict_meta || best < 0) {
+        return best_meta;
+    }
+    return best;
+}
+
+static int slot_alloc(uint32_t lba)
+{
+    const bool meta = is_meta(lba);
+    int v = pick_victim(meta);
+    if (v < 0) {
+        return -1;
+    }
+    if (slots[v].valid && slots[v].dirty) {
+        // l'éviction d'un secteur sale vide tout en écritures groupées
+        if (!flush_locked()) {
+            return -1;
+        }
+    }
+    slots[v].lba = lba;
+    slots[v].valid = true;
+    slots[v].dirty = false;
+    slots[v].meta = meta;
+    touch((size_t)v);
+    return v;
+}
+
+// ------------------------------------------------------------
+// diskio
+// ------------------------------------------------------------
+
+static DSTATUS cache_init(BYTE pdrv)
+{
+    (void)pdrv;
+    return cache_card ? 0 : STA_NOINIT;
+}
+
+static DSTATUS cache_status(BYTE pdrv)
+{
+    (void)pdrv;
+    return cache_card ? 0 : STA_NOINIT;
+}
+
+static DRESULT cache_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count)
+{
+    (void)pdrv;
+    CACHE_TRACE('R', sector, count);
+    lock();
+    DRESULT res = RES_OK;
+    if (count == 1) {
+        int i = slot_find(sector);
+        if (i >= 0) {
+            stats.hits++;
+            touch((size_t)i);
+            memcpy(buff, slot_buf((size_t)i), kSectorSize);
+        } else {
+            stats.misses++;
+            i = slot_alloc(sector);
+            if (i < 0) {
+                res = (sdmmc_read_sectors(cache_card, buff, sector, 1) == ESP_OK) ?
+                    RES_OK : RES_ERROR;
+            } else if (sdmmc_read_sectors(cache_card, slot_buf((size_t)i), sector, 1) == ESP_OK) {
+                memcpy(buff, slot_buf((size_t)i), kSectorSize);
+            } else {
+                slots[i].valid = false;
+                res = RES_ERROR;
+            }
+        }
+    } else {
+        stats.bypass++;
+        if (sdmmc_read_sectors(cache_card, buff, sector, count) != ESP_OK) {
+            res = RES_ERROR;
+        } else {
+            // la version en cache (éventuellement sale) fait foi
+            for (size_t i = 0; i < slot_count; i++) {
+                if (slots[i].valid && slots[i].dirty &&
+                    slots[i].lba >= sector && slots[i].lba < sector + count) {
+                    memcpy(buff + (slots[i].lba - sector) * kSectorSize,
+                        slot_buf(i), kSectorSize);
+                }
+            }
+        }
+    }
+    unlock();
+    return res;
+}
+
+static DRESULT cache_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count)
+{
+    (void)pdrv;
+    CACHE_TRACE('W', sector, count);
+    lock();
+    DRESULT res = RES_OK;
+    if (count == 1) {
+        int i = slot_find(sector);
+        if (i >= 0) {
+            stats.write_hits++;
+            touch((size_t)i);
+        } else {
+            i = slot_alloc(sector);
+        }
+        if (i < 0) {
+            res = (sdmmc_write_sectors(cache_card, buff, sector, 1) == ESP_OK) ?
+                RES_OK : RES_ERROR;
+        } else {
+            memcpy(slot_buf((size_t)i), buff, kSectorSize);
+            slots[i].dirty = true;
+            last_write_ms = millis();
+            if (dirty_count() > slot_count / 2 && !flush_locked()) {
+                res = RES_ERROR;
+            }
+        }
+    } else {
+        if (sdmmc_write_sectors(cache_card, buff, sector, count) != ESP_OK) {
+            res = RES_ERROR;
+        } else {
+            // copies en cache remplacées par les données écrites
+            for (size_t i = 0; i < slot_count; i++) {
+                if (slots[i].valid && slots[i].lba >= sector &&
+                    slots[i].lba < sector + count) {
+                    memcpy(slot_buf(i), buff + (slots[i].lba - sector) * kSectorSize,
+                        kSectorSize);
+                    slots[i].dirty = false;
+                }
+            }
+        }
+    }
+    unlock();
+    return res;
+}
+
+static DRESULT cache_ioctl(BYTE pdrv, BYTE cmd, void* buff)
+{
+    (void)pdrv;
+    switch (cmd) {
+        case CTRL_SYNC: {
+            CACHE_TRACE('S', 0, 0);
+            // f_sync / f_close : fichier, FAT et répertoire sur la carte au
+            // retour ; l'écriture différée ne vaut qu'entre deux syncs
+            lock();
+            bool ok = flush_locked();
+            unlock();
+            return ok ? RES_OK : RES_ERROR;
+        }
+        case GET_SECTOR_COUNT:
+            *static_cast<DWORD*>(buff) = (DWORD)cache_card->csd.capacity;
+            return RES_OK;
+        case GET_SECTOR_SIZE:
+            *static_cast<WORD*>(buff) = (WORD)cache_card->csd.sector_size;
+            return RES_OK;
+        case GET_BLOCK_SIZE:
+            *static_cast<DWORD*>(buff) = 1;
+            return RES_OK;
+        default:
+            return RES_ERROR;
+    }
+}
+
+static const ff_diskio_impl_t cache_impl = {
+    cache_init,
+    cache_status,
+    cache_read,
+    cache_write,
+    cache_ioctl
+};
+
+// ------------------------------------------------------------
+// API
+// ------------------------------------------------------------
+
+bool sd_cache_attach(sdmmc_card_t* card, size_t sectors)
+{
+    if (cache_card || !card || sectors == 0 || card->csd.sector_size != (int)kSectorSize) {
+        return false;
+    }
+    if (!cache_lock) {
+        cache_lock = xSemaphoreCreateMutex();
+        if (!cache_lock) {
+            return false;
+        }
+    }
+    slots = new CacheSlot[sectors];
+    slot_data = static_cast<uint8_t*>(heap_caps_malloc(sectors * kSectorSize, MALLOC_CAP_DMA));
+    stage = static_cast<uint8_t*>(heap_caps_malloc(kStageSectors * kSectorSize, MALLOC_CAP_DMA));
+    if (!slot_data || !stage) {
+        delete[] slots;
+        heap_caps_free(slot_data);
+        heap_caps_free(stage);
+        slots = nullptr;
+        slot_data = nullptr;
+        stage = nullptr;
+        return false;
+    }
+    memset(slots, 0, sectors * sizeof(CacheSlot));
+    memset(&stats, 0, sizeof(stats));
+    slot_count = sectors;
+    meta_cap = sectors * 3 / 4;
+    clock_stamp = 0;
+    cache_card = card;
+
+    read_layout();
+
+    cache_pdrv = ff_diskio_get_pdrv_card(card);
+    ff_diskio_register(cache_pdrv, &cache_impl);
+    return true;
+}
+
+void sd_cache_detach()
+{
+    if (!cache_card) {
+        return;
+    }
+    lock();
+    flush_locked();
+    // rend la main au diskio SD standard jusqu'au démontage
+    ff_diskio_register_sdmmc(cache_pdrv, cache_card);
+    cache_card = nullptr;
+    delete[] slots;
+    heap_caps_free(slot_data);
+    heap_caps_free(stage);
+    slots = nullptr;
+    slot_data = nullptr;
+    stage = nullptr;
+    slot_count = 0;
+    unlock();
+}
+
+bool sd_cache_flush()
+{
+    if (!cache_card) {
+        return true;
+    }
+    lock();
+    bool ok = flush_locked();
+    unlock();
+    return ok;
+}
+
+void sd_cache_idle()
+{
+    if (!cache_card) {
+        return;
+    }
+    lock();
+    if ((uint32_t)(millis() - last_write_ms) >= kSdCacheIdleMs && dirty_count() > 0) {
+        flush_locked();
+    }
+    unlock();
+}
+
+bool sd_cache_raw_read(uint32_t lba, void* buf, size_t count)
+{
+    if (!cache_card) {
+        return false;
+    }
+    lock();
+    bool ok = sdmmc_read_sectors(cache_card, buf, lba, count) == ESP_OK;
+    unlock();
+    return ok;
+}
+
+bool sd_cache_get_stats(SdCacheStats& out)
+{
+    if (!cache_card) {
+        return false;
+    }
+    lock();
+    out = stats;
+    out.slots = (uint32_t)slot_count;
+    out.dirty = (uint32_t)dirty_count();
+    unlock();
+    return true;
+}
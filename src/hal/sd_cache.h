@@ -0,0 +1,37 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sdmmc_cmd.h"
+
+// Cache de secteurs write-back entre FatFS et le pilote SD SPI.
+// Les lectures mono-secteur (FAT, répertoires, fin de fichier) passent
+// par le cache ; les transferts multi-secteurs vont directement à la
+// carte. Les secteurs modifiés sont réécrits groupés (multi-blocs) au
+// sync FatFS (f_sync, f_close), à la commande sync, au démontage, après
+// un délai d'inactivité ou si trop sont sales.
+
+struct SdCacheStats {
+    uint32_t slots;
+    uint32_t dirty;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t bypass;            // lectures multi-secteurs directes
+    uint32_t write_hits;        // écritures absorbées par le cache
+    uint32_t flushes;
+    uint32_t flushed_sectors;
+    uint32_t flush_writes;      // commandes d'écriture envoyées au flush
+};
+
+// remplace le diskio FatFS de la carte par le cache
+bool sd_cache_attach(sdmmc_card_t* card, size_t sectors);
+// vide le cache puis libère sa mémoire (avant le démontage)
+void sd_cache_detach();
+bool sd_cache_flush();
+// vide si des secteurs sont sales depuis plus de kSdCacheIdleMs
+void sd_cache_idle();
+bool sd_cache_get_stats(SdCacheStats& out);
+// lecture directe de la carte (mesure de débit), sous le verrou du cache
+// pour ne pas croiser un accès FatFS d'une autre tâche ; false sans cache
+bool sd_cache_raw_read(uint32_t lba, void* buf, size_t count);
@@ -5,6 +5,14 @@
 #include "driver/spi_common.h"
 #include "esp_vfs_fat.h"
 #include "sdmmc_cmd.h"
+#include "sd_cache.h"
+#include "esp_heap_caps.h"
+#include "ff.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <string.h>
 
 #define PIN_NUM_MISO GPIO_NUM_39
 #define PIN_NUM_MOSI GPIO_NUM_14
@@ -13,10 +21,234 @@
 
 static const char* TAG = "SDCARD";
 static const char* MOUNT_POINT = "/sdcard";
+static const char* FAT_DRIVE = "0:";
 
 static bool mounted = false;
 static sdmmc_card_t* card = nullptr;
 
+// ------------------------------------------------------------
+// Négociation de l'horloge SPI
+// ------------------------------------------------------------
+//
+// L'identification se fait à 400 kHz (obligatoire), puis l'horloge est
+// montée palier par palier. Chaque palier est validé en relisant des
+// secteurs de référence lus à 400 kHz. La meilleure vitesse stable est
+// mémorisée en NVS par CID de carte.
+
+static constexpr uint32_t kIdentFreqKhz = 400;
+static const uint32_t k_freq_steps_khz[] = { 10000, 20000, 40000 };
+
+static constexpr size_t kProbeSectors = 4;      // lecture multi-blocs
+static constexpr int kProbeRounds = 3;
+
+static const char* NVS_NAMESPACE = "sdclk";
+
+// taille du cache de secteurs (512 o chacun)
+static constexpr size_t kSdCacheSectors = 48;
+
+static uint32_t card_freq_khz = 0;
+static bool card_freq_cached = false;
+
+static void card_key(char* out, size_t out_sz)
+{
+    snprintf(out, out_sz, "%02x%08lx", (unsigned)(card->cid.mfg_id & 0xFF),
+        (unsigned long)card->cid.serial);
+}
+
+static uint32_t cached_freq_load()
+{
+    char key[16];
+    card_key(key, sizeof(key));
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, true)) {
+        return 0;
+    }
+    uint32_t khz = prefs.getUInt(key, 0);
+    prefs.end();
+    return khz;
+}
+
+static void cached_freq_store(uint32_t khz)
+{
+    char key[16];
+    card_key(key, sizeof(key));
+    Preferences prefs;
+    if (!prefs.begin(NVS_NAMESPACE, false)) {
+        return;
+    }
+    if (khz) {
+        prefs.putUInt(key, khz);
+    } else {
+        prefs.remove(key);
+    }
+    prefs.end();
+}
+
+static bool set_clock(uint32_t khz)
+{
+    if (sdspi_host_set_card_clk((sdspi_dev_handle_t)card->host.slot, khz) != ESP_OK) {
+        return false;
+    }
+    card_freq_khz = khz;
+    return true;
+}
+
+// relit les secteurs de référence et compare
+static bool probe_matches(const uint8_t* ref, uint8_t* buf)
+{
+    const size_t bytes = kProbeSectors * card->csd.sector_size;
+    for (int round = 0; round < kProbeRounds; round++) {
+        memset(buf, 0xA5, bytes);
+        if (sdmmc_read_sectors(card, buf, 0, kProbeSectors) != ESP_OK) {
+            return false;
+        }
+        if (memcmp(ref, buf, bytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void negotiate_clock()
+{
+    card_freq_khz = kIdentFreqKhz;
+    card_freq_cached = false;
+
+    const size_t bytes = kProbeSectors * card->csd.sector_size;
+    uint8_t* ref = static_cast<uint8_t*>(heap_caps_malloc(bytes, MALLOC_CAP_DMA));
+    uint8_t* buf = static_cast<uint8_t*>(heap_caps_malloc(bytes, MALLOC_CAP_DMA));
+    if (!ref || !buf ||
+        sdmmc_read_sectors(card, ref, 0, kProbeSectors) != ESP_OK) {
+        heap_caps_free(ref);
+        heap_caps_free(buf);
+        ESP_LOGW(TAG, "clock probe unavailable, staying at %lu kHz",
+            (unsigned long)kIdentFreqKhz);
+        return;
+    }
+
+    // vitesse déjà validée pour cette carte : un seul contrôle
+    uint32_t cached = cached_freq_load();
+    if (cached) {
+        if (set_clock(cached) && probe_matches(ref, buf)) {
+            card_freq_cached = true;
+            heap_caps_free(ref);
+            heap_caps_free(buf);
+            ESP_LOGI(TAG, "sd clock %lu kHz (cached)", (unsigned long)cached);
+            return;
+        }
+        set_clock(kIdentFreqKhz);
+        cached_freq_store(0);
+    }
+
+    uint32_t best = kIdentFreqKhz;
+    for (size_t i = 0; i < sizeof(k_freq_steps_khz) / sizeof(k_freq_steps_khz[0]); i++) {
+        uint32_t khz = k_freq_steps_khz[i];
+        if (!set_clock(khz) || !probe_matches(ref, buf)) {
+            break;
+        }
+        best = khz;
+    }
+    set_clock(best);
+    if (best != kIdentFreqKhz) {
+        cached_freq_store(best);
+    }
+
+    heap_caps_free(ref);
+    heap_caps_free(buf);
+    ESP_LOGI(TAG, "sd clock %lu kHz", (unsigned long)best);
+}
+
+// ------------------------------------------------------------
+// Espace libre
+// ------------------------------------------------------------
+//
+// Sans FSINFO valide, f_getfree parcourt toute la FAT : plusieurs
+// secondes sur une grande carte FAT32. Le premier appel est fait par
+// une tâche de fond après le montage. Ensuite FatFS tient lui-même le
+// compte (free_clst) à chaque allocation ou libération, quel que soit
+// l'appelant, et le réécrit dans FSINFO au prochain sync du volume :
+// df le lit directement.
+
+static constexpr uint32_t kSpaceTaskStack = 4096;
+static constexpr UBaseType_t kSpaceTaskPriority = 1;   // sous loop()
+static constexpr BaseType_t kSpaceTaskCore = 0;
+
+static FATFS* space_fs = nullptr;           // connu après le premier comptage
+static volatile bool space_scanning = false;
+static volatile bool space_failed = false;
+
+static void space_scan_entry(void*)
+{
+    FATFS* fs = nullptr;
+    DWORD free_clust = 0;
+    if (f_getfree(FAT_DRIVE, &free_clust, &fs) == FR_OK && fs) {
+        space_fs = fs;
+    } else {
+        space_failed = true;
+    }
+    space_scanning = false;
+    vTaskDelete(nullptr);
+}
+
+static void space_scan_start()
+{
+    if (space_scanning) {
+        return;
+    }
+    space_failed = false;
+    space_scanning = true;
+    if (xTaskCreatePinnedToCore(space_scan_entry, "sd_space", kSpaceTaskStack,
+            nullptr, kSpaceTaskPriority, nullptr, kSpaceTaskCore) != pdPASS) {
+        space_scanning = false;
+        space_failed = true;
+    }
+}
+
+// le démontage attend la fin du comptage (verrou du volume)
+static void space_scan_wait()
+{
+    while (space_scanning) {
+        delay(10);
+    }
+    space_fs = nullptr;
+    space_failed = false;
+}
+
+bool sd_get_space(SdSpace& out)
+{
+    if (!mounted || !card) {
+        return false;
+    }
+    memset(&out, 0, sizeof(out));
+    FATFS* fs = space_fs;
+    if (!fs) {
+        // taille de la carte en attendant celle du volume
+        out.total_bytes = (uint64_t)card->csd.capacity * card->csd.sector_size;
+        out.state = space_failed ? SD_SPACE_UNKNOWN : SD_SPACE_UPDATING;
+        return true;
+    }
+
+#if FF_MAX_SS != FF_MIN_SS
+    uint32_t sector_size = fs->ssize;
+#else
+    uint32_t sector_size = FF_MAX_SS;
+#endif
+    uint64_t cluster = (uint64_t)fs->csize * sector_size;
+    DWORD clusters = fs->n_fatent - 2;
+    DWORD free_clust = fs->free_clst;   // lecture 32 bits, sans verrou
+    out.total_bytes = (uint64_t)clusters * cluster;
+    if (free_clust > clusters) {
+        // compte invalidé par FatFS : on recompte
+        space_fs = nullptr;
+        space_scan_start();
+        out.state = SD_SPACE_UPDATING;
+        return true;
+    }
+    out.free_bytes = (uint64_t)free_clust * cluster;
+    out.state = SD_SPACE_READY;
+    return true;
+}
+
 bool sd_mount(bool format_if_failed)
 {
     if (mounted) {
@@ -24,7 +256,7 @@ bool sd_mount(bool format_if_failed)
     }
 
     sdmmc_host_t host = SDSPI_HOST_DEFAULT();
-    host.max_freq_khz = 400;   // OBLIGATOIRE pour init SD
+    host.max_freq_khz = kIdentFreqKhz;  // OBLIGATOIRE pour init SD, relevé ensuite
 
     spi_bus_config_t bus_cfg = {};
     bus_cfg.mosi_io_num = PIN_NUM_MOSI;
@@ -70,7 +302,12 @@ bool sd_mount(bool format_if_failed)
     }
 
     sdmmc_card_print_info(stdout, card);
+    negotiate_clock();
+    if (!sd_cache_attach(card, kSdCacheSectors)) {
+        ESP_LOGW(TAG, "sector cache disabled");
+    }
     mounted = true;
+    space_scan_start();
     return true;
 }
 
@@ -80,11 +317,14 @@ void sd_umount()
         return;
     }
 
+    space_scan_wait();
+    sd_cache_detach();
     esp_vfs_fat_sdcard_unmount(MOUNT_POINT, card);
     sdmmc_host_t host = SDSPI_HOST_DEFAULT();
     spi_bus_free((spi_host_device_t)host.slot);
 
     card = nullptr;
+    card_freq_khz = 0;
     mounted = false;
 }
 
@@ -92,3 +332,81 @@ bool sd_is_mounted()
 {
     return mounted;
 }
+
+const char* sd_mount_point()
+{
+    return MOUNT_POINT;
+}
+
+const char* sd_fat_drive()
+{
+    return FAT_DRIVE;
+}
+
+bool sd_sync()
+{
+    return sd_cache_flush();
+}
+
+void sd_idle()
+{
+    sd_cache_idle();
+}
+
+bool sd_get_info(SdInfo& out)
+{
+    if (!mounted || !card) {
+        return false;
+    }
+    memset(&out, 0, sizeof(out));
+    memcpy(out.name, card->cid.name, sizeof(card->cid.name));
+    out.name[sizeof(out.name) - 1] = '\0';
+    out.sector_size = (uint32_t)card->csd.sector_size;
+    out.capacity_bytes = (uint64_t)card->csd.capacity * card->csd.sector_size;
+    out.freq_khz = card_freq_khz;
+    out.freq_cached = card_freq_cached;
+    out.mfg_id = (uint8_t)card->cid.mfg_id;
+    out.serial = (uint32_t)card->cid.serial;
+    return true;
+}
+
+bool sd_measure_read(uint32_t total_kb, uint32_t& out_kbps)
+{
+    out_kbps = 0;
+    if (!mounted || !card || total_kb == 0) {
+        return false;
+    }
+    const size_t chunk_sectors = 16;
+    const size_t sector = (size_t)card->csd.sector_size;
+    const size_t chunk = chunk_sectors * sector;
+    uint8_t* buf = static_cast<uint8_t*>(heap_caps_malloc(chunk, MALLOC_CAP_DMA));
+    if (!buf) {
+        return false;
+    }
+
+    const uint64_t total = (uint64_t)total_kb * 1024;
+    const size_t chunks = (size_t)((total + chunk - 1) / chunk);
+    size_t max_start = (size_t)card->csd.capacity > chunk_sectors ?
+        (size_t)card->csd.capacity - chunk_sectors : 0;
+
+    bool ok = true;
+    unsigned long start_us = micros();
+    for (size_t i = 0; i < chunks; i++) {
+        size_t lba = i * chunk_sectors;
+        if (lba > max_start) {
+            lba = 0;
+        }
+        // verrou repris à chaque bloc : les autres tâches passent entre deux
+        if (!sd_cache_raw_read((uint32_t)lba, buf, chunk_sectors)) {
+            ok = false;
+            break;
+        }
+    }
+    unsigned long elapsed_us = micros() - start_us;
+    heap_caps_free(buf);
+    if (!ok || elapsed_us == 0) {
+        return false;
+    }
+    out_kbps = (uint32_t)(((uint64_t)chunks * chunk * 1000000ULL / 1024) / elapsed_us);
+    return true;
+}
@@ -1,6 +1,45 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
 
 bool sd_mount(bool format_if_failed);
 void sd_umount();
 bool sd_is_mounted();
+// écrit les secteurs en attente dans le cache
+bool sd_sync();
+// à appeler depuis la boucle principale (vidage du cache après inactivité)
+void sd_idle();
+
+// racine réelle (VFS ESP-IDF) et lecteur FatFS de la carte montée
+const char* sd_mount_point();
+const char* sd_fat_drive();
+
+struct SdInfo {
+    char name[8];
+    uint8_t mfg_id;
+    uint32_t serial;
+    uint32_t sector_size;
+    uint64_t capacity_bytes;
+    uint32_t freq_khz;          // horloge SPI négociée
+    bool freq_cached;           // vitesse reprise du cache NVS
+};
+
+bool sd_get_info(SdInfo& out);
+
+enum SdSpaceState : uint8_t {
+    SD_SPACE_READY = 0,         // compte exact, tenu à jour par FatFS
+    SD_SPACE_UPDATING,          // comptage de la FAT en cours (tâche de fond)
+    SD_SPACE_UNKNOWN            // comptage impossible
+};
+
+struct SdSpace {
+    uint64_t total_bytes;
+    uint64_t free_bytes;        // 0 tant que state != SD_SPACE_READY
+    SdSpaceState state;
+};
+
+// immédiat : ne parcourt jamais la FAT
+bool sd_get_space(SdSpace& out);
+// lecture brute séquentielle de total_kb kio, débit en kio/s ; passe
+// par le cache (sd_cache_raw_read), false s'il est désactivé
+bool sd_measure_read(uint32_t total_kb, uint32_t& out_kbps);
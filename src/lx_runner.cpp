@@ -11,6 +11,7 @@
 #include <M5Cardputer.h>
 
 #include "fs/fs.h"
+#include "fs/vfs.h"
 #include "ui/terminal.h"
 #include "ui/keyboard.h"
 #include "lxsh_fs_bridge.h"
@@ -77,22 +78,28 @@ enum LxProfile {
 
 static LxProfile g_lx_profile = LX_PROFILE_POWER;
 
-static void lx_apply_profile()
+static size_t lx_profile_reserve()
 {
-    size_t reserve = 0;
     switch (g_lx_profile) {
         case LX_PROFILE_SAFE:
-            reserve = 120 * 1024;
-            break;
+            return 120 * 1024;
         case LX_PROFILE_POWER:
-            reserve = 40 * 1024;
-            break;
+            return 40 * 1024;
         case LX_PROFILE_BALANCED:
         default:
-            reserve = 80 * 1024;
-            break;
+            return 80 * 1024;
     }
-    lx_set_mem_reserve(reserve);
+}
+
+static void lx_apply_profile()
+{
+    lx_set_mem_reserve(lx_profile_reserve());
+}
+
+// /tmp vit dans la réserve laissée au shell : la moitié lui est allouée
+static void lx_apply_tmp_budget()
+{
+    vfs_tmpfs_set_budget(lx_profile_reserve() / 2);
 }
 
 extern "C" size_t lx_platform_free_heap(void)
@@ -114,9 +121,15 @@ bool lx_set_profile(const char* name)
     } else {
         return false;
     }
+    lx_apply_tmp_budget();
     return true;
 }
 
+void lx_runner_init()
+{
+    lx_apply_tmp_budget();
+}
+
 const char* lx_get_profile_name()
 {
     switch (g_lx_profile) {
@@ -290,5 +303,7 @@ bool lx_run_script(const char* path)
     }
     bool result = args->result;
     delete args;
+    // fin ou annulation : les journaux du script sont écrits
+    fs_sync();
     return result;
 }
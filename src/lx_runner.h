@@ -1,5 +1,6 @@
 #pragma once
 
+void lx_runner_init();
 bool lx_run_script(const char* path);
 bool lx_set_profile(const char* name);
 const char* lx_get_profile_name();
@@ -52,10 +52,39 @@ static int lxsh_write_file(const char* path, const unsigned char* data, size_t l
     return fs_write_file(path, data, len) ? 1 : 0;
 }
 
+// existence, type et taille en un seul fs_stat() (cache fs), partagé
+// par les opérations de test de chemin ci-dessous
+struct LxshStat {
+    int exists;
+    int is_dir;
+    int is_file;
+    size_t size;
+};
+
+static int lxsh_stat(const char* path, LxshStat* out)
+{
+    if (!out) {
+        return 0;
+    }
+    FsStat st;
+    if (!path || !fs_stat(path, st)) {
+        out->exists = 0;
+        out->is_dir = 0;
+        out->is_file = 0;
+        out->size = 0;
+        return 0;
+    }
+    out->exists = 1;
+    out->is_dir = st.is_dir ? 1 : 0;
+    out->is_file = st.is_file ? 1 : 0;
+    out->size = st.size;
+    return 1;
+}
+
 static int lxsh_file_exists(const char* path)
 {
-    FsStat st;
-    return fs_stat(path, st) ? 1 : 0;
+    LxshStat st;
+    return lxsh_stat(path, &st);
 }
 
 static int lxsh_file_size(const char* path, size_t* out_size)
@@ -63,8 +92,8 @@ static int lxsh_file_size(const char* path, size_t* out_size)
     if (!out_size) {
         return 0;
     }
-    FsStat st;
-    if (!fs_stat(path, st)) {
+    LxshStat st;
+    if (!lxsh_stat(path, &st)) {
         return 0;
     }
     *out_size = st.size;
@@ -73,20 +102,14 @@ static int lxsh_file_size(const char* path, size_t* out_size)
 
 static int lxsh_is_dir(const char* path)
 {
-    FsStat st;
-    if (!fs_stat(path, st)) {
-        return 0;
-    }
-    return st.is_dir ? 1 : 0;
+    LxshStat st;
+    return lxsh_stat(path, &st) ? st.is_dir : 0;
 }
 
 static int lxsh_is_file(const char* path)
 {
-    FsStat st;
-    if (!fs_stat(path, st)) {
-        return 0;
-    }
-    return st.is_file ? 1 : 0;
+    LxshStat st;
+    return lxsh_stat(path, &st) ? st.is_file : 0;
 }
 
 static int lxsh_mkdir(const char* path)
@@ -159,18 +182,23 @@ static int lxsh_list_dir(const char* path, char*** out_names, size_t* out_count)
 
 static const char* lxsh_temp_dir()
 {
-    return "/media/0";
+    FsStat st;
+    if (fs_stat(FS_TMP_MOUNT_POINT, st) && st.is_dir) {
+        return FS_TMP_MOUNT_POINT;
+    }
+    return FS_SD_MOUNT_POINT;
 }
 
 static int lxsh_tempnam(const char* prefix, char* out, size_t out_sz)
 {
+    static unsigned long counter = 0;
     if (!out || out_sz == 0) {
         return 0;
     }
     const char* pfx = (prefix && *prefix) ? prefix : "lx";
+    const char* dir = lxsh_temp_dir();
     for (int i = 0; i < 16; i++) {
-        unsigned long n = (unsigned long)millis() + (unsigned long)i * 1337UL;
-        snprintf(out, out_sz, "/media/0/%s%lu.lx", pfx, n);
+        snprintf(out, out_sz, "%s/%s%lu.lx", dir, pfx, counter++);
         FsStat st;
         if (!fs_stat(out, st)) {
             if (fs_touch(out)) {
@@ -9,6 +9,7 @@
 #include "fs/fs.h"
 #include "editor/editor.h"
 #include "core/settings.h"
+#include "lx_runner.h"
 
 namespace {
 static const uint32_t kSaverFrameMs = 60;
@@ -120,15 +121,16 @@ void setup()
     Serial.begin(115200);
 
     screen_init();       // initialise LovyanGFX / écran
+    fs_init();           // monte /tmp (tmpfs) et /flash (LittleFS)
     bool mounted = fs_mount();
+    lx_runner_init();
     settings_init();
     M5.Display.setBrightness(settings_get_brightness());
     term_init();         // initialise le terminal
     keyboard_init();     // initialise le clavier
-    //fs_init();
     editor_init();
     if (mounted) {
-        term_puts("SDCard 0 mounted at /media/0\n");
+        term_puts("SDCard 0 mounted at " FS_SD_MOUNT_POINT "\n");
     }
 
     term_puts("Cardputer ADV\n");
@@ -150,6 +152,8 @@ void loop()
     M5Cardputer.update();
     keyboard_set_input_enabled(!(saver_active || screen_off));
     keyboard_poll();
+    fs_idle();
+    editor_idle();
 
     uint32_t now_ms = millis();
     uint32_t last_activity_ms = keyboard_last_activity_ms();
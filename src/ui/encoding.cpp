@@ -360,6 +360,102 @@ size_t utf8_to_cp437(const char *utf8, char *cp437, size_t cp437_size)
     return out;
 }
 
+/* Caractère UTF-8 valide en tête de s : longueur et code, 0 sinon */
+static size_t utf8_decode(const unsigned char *s, size_t len, uint32_t *cp)
+{
+    if (len >= 2 && (s[0] & 0xE0) == 0xC0 && (s[1] & 0xC0) == 0x80) {
+        *cp = ((uint32_t)(s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+        return 2;
+    }
+    if (len >= 3 && (s[0] & 0xF0) == 0xE0 &&
+        (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80) {
+        *cp = ((uint32_t)(s[0] & 0x0F) << 12) |
+            ((uint32_t)(s[1] & 0x3F) << 6) |
+            (s[2] & 0x3F);
+        return 3;
+    }
+    if (len >= 4 && (s[0] & 0xF8) == 0xF0 &&
+        (s[1] & 0xC0) == 0x80 && (s[2] & 0xC0) == 0x80 &&
+        (s[3] & 0xC0) == 0x80) {
+        *cp = ((uint32_t)(s[0] & 0x07) << 18) |
+            ((uint32_t)(s[1] & 0x3F) << 12) |
+            ((uint32_t)(s[2] & 0x3F) << 6) |
+            (s[3] & 0x3F);
+        return 4;
+    }
+    return 0;
+}
+
+/*
+ * Une cellule par caractère : les sélecteurs de variante (U+FE0E,
+ * U+FE0F) qui suivent n'ont pas de largeur et lui sont rattachés. Un
+ * caractère hors table s'affiche '?', un octet qui ne commence pas un
+ * caractère UTF-8 valide est affiché tel quel (texte déjà en CP437).
+ */
+size_t utf8_cell_cp437(const char *s, size_t len, uint8_t *cp437)
+{
+    const unsigned char *u = (const unsigned char *)s;
+    uint32_t cp = 0;
+    uint8_t glyph;
+    size_t n;
+
+    if (u[0] < 0x80) {
+        n = 1;
+        if (u[0] == 0) {
+            glyph = ' ';
+        } else if (u[0] == 0x7f) {
+            glyph = '?';
+        } else {
+            glyph = u[0];
+        }
+    } else if ((n = utf8_decode(u, len, &cp)) == 0) {
+        n = 1;
+        glyph = u[0];
+    } else {
+        glyph = (cp <= 0xFFFF) ? unicode_to_cp437((uint16_t)cp) : '?';
+    }
+
+    while (len - n >= 3 && utf8_decode(u + n, len - n, &cp) == 3 &&
+        (cp == 0xFE0E || cp == 0xFE0F)) {
+        n += 3;
+    }
+
+    if (cp437) {
+        *cp437 = glyph;
+    }
+    return n;
+}
+
+size_t cp437_to_utf8(uint8_t cp437, char *utf8)
+{
+    if (cp437 == 0 || (cp437 >= 0x20 && cp437 <= 0x7e)) {
+        utf8[0] = (char)cp437;
+        return 1;
+    }
+
+    uint16_t uc = '?';
+    for (unsigned i = 0; i < sizeof(utf8_cp437_table) / sizeof(utf8_cp437_table[0]); i++) {
+        if (utf8_cp437_table[i].cp437 == cp437) {
+            uc = utf8_cp437_table[i].unicode;
+            break;
+        }
+    }
+
+    if (uc < 0x80) {
+        utf8[0] = (char)uc;
+        return 1;
+    }
+    if (uc < 0x800) {
+        utf8[0] = (char)(0xC0 | (uc >> 6));
+        utf8[1] = (char)(0x80 | (uc & 0x3F));
+        return 2;
+    }
+    utf8[0] = (char)(0xE0 | (uc >> 12));
+    utf8[1] = (char)(0x80 | ((uc >> 6) & 0x3F));
+    utf8[2] = (char)(0x80 | (uc & 0x3F));
+    return 3;
+}
+
 /*static uint16_t utf8_next(const unsigned char **p)
 {
     const unsigned char *s = *p;
@@ -15,6 +15,21 @@ extern "C" {
 // Retourne le nombre de caractères écrits (hors '\0')
 size_t utf8_to_cp437(const char *utf8, char *cp437, size_t cp437_size);
 
+// Octets au plus d'une cellule : un caractère UTF-8 (4 octets) suivi de
+// deux sélecteurs de variante (3 octets chacun)
+#define UTF8_CELL_MAX 10
+
+// Première cellule d'affichage de s (len >= 1 octets) : un caractère
+// UTF-8 avec ses sélecteurs de variante, ou un octet isolé pris tel quel
+// comme CP437
+// - cp437 : reçoit le glyphe de la cellule (peut être NULL)
+// Retourne le nombre d'octets de la cellule
+size_t utf8_cell_cp437(const char *s, size_t len, uint8_t *cp437);
+
+// Encode un caractère CP437 en UTF-8 (3 octets au plus, sans '\0')
+// Retourne le nombre d'octets écrits
+size_t cp437_to_utf8(uint8_t cp437, char *utf8);
+
 #ifdef __cplusplus
 }
 #endif
@@ -257,6 +257,26 @@ void keyboard_poll()
         }
     }
 
+    // seules les commandes Alt de l'éditeur sont prises ici ; le reste
+    // suit le chemin habituel
+    if (st.alt && input_enabled && editor_is_active()) {
+        bool taken = false;
+        for (char c : st.word) {
+            if (!editor_takes_alt((uint8_t)c)) {
+                continue;
+            }
+            taken = true;
+            if (!key_debounce_allow((uint8_t)c)) {
+                continue;
+            }
+            debug_key_event("alt", c);
+            editor_handle_alt((uint8_t)c);
+        }
+        if (taken) {
+            return;
+        }
+    }
+
     if (!input_enabled) {
         return;
     }
@@ -40,7 +40,7 @@ static std::vector<std::string> history;
 static int history_index = -1;
 static std::string history_saved_line;
 
-static const char* history_real_path = "/sdcard/.lx_history";
+static const char* history_name = ".lx_history";
 static const size_t kHistoryMaxLines = 1000;
 
 static bool capture_active = false;
@@ -56,6 +56,12 @@ static int pager_index = 0;
 static int input_row = 0;
 static int input_rows = 1;
 
+// Sortie groupée : pendant un batch, les lignes modifiées sont seulement
+// marquées et redessinées une fois à la fin.
+static int batch_depth = 0;
+static bool batch_full = false;
+static bool batch_dirty[TERM_ROWS];
+
 // ------------------------------------------------------------
 // Affichage
 // ------------------------------------------------------------
@@ -94,6 +100,12 @@ static void redraw_row(int r)
 
 static void redraw_all()
 {
+    if (batch_depth > 0) {
+        batch_full = true;
+        prev_cur_row = cur_row;
+        prev_cur_col = cur_col;
+        return;
+    }
     screen_clear();
     for (int r = 0; r < TERM_ROWS; r++) {
         redraw_row(r);
@@ -107,6 +119,13 @@ static void refresh_cursor()
     if (pager_active) {
         return;
     }
+    if (batch_depth > 0) {
+        batch_dirty[prev_cur_row] = true;
+        batch_dirty[cur_row] = true;
+        prev_cur_row = cur_row;
+        prev_cur_col = cur_col;
+        return;
+    }
     if (prev_cur_row == cur_row && prev_cur_col == cur_col) {
         redraw_row(cur_row);
         return;
@@ -258,50 +277,73 @@ static void pager_advance()
     pager_render_page();
 }
 
+static bool history_path(std::string& out)
+{
+    const char* dir = fs_state_dir();
+    if (!dir) {
+        return false;
+    }
+    out = std::string(dir) + "/" + history_name;
+    return true;
+}
+
+static void history_rewrite()
+{
+    std::string path;
+    if (!history_path(path)) {
+        return;
+    }
+    std::string content;
+    for (const auto& entry : history) {
+        content += entry;
+        content.push_back('\n');
+    }
+    fs_write_file(path.c_str(),
+        reinterpret_cast<const unsigned char*>(content.data()), content.size());
+}
+
 static void history_load()
 {
     history.clear();
-    if (!fs_sd_mounted()) {
+    std::string path;
+    if (!history_path(path)) {
         return;
     }
 
-    FILE* f = fopen(history_real_path, "r");
-    if (!f) {
-        return;
+    std::string content;
+    bool from_sd = false;
+    if (!fs_read_file(path.c_str(), content)) {
+        // historique écrit sur la carte avant l'arrivée de /flash
+        if (!fs_sd_mounted() ||
+            !fs_read_file(FS_SD_MOUNT_POINT "/.lx_history", content)) {
+            return;
+        }
+        from_sd = true;
     }
 
     std::string line;
-    int ch = 0;
-    while ((ch = fgetc(f)) != EOF) {
+    for (char ch : content) {
         if (ch == '\n') {
             if (!line.empty()) {
                 history.push_back(line);
             }
             line.clear();
-        } else if (ch != '\r') {
-            if (ch >= 32 && ch <= 126) {
-                line.push_back((char)ch);
-            }
+        } else if (ch >= 32 && ch <= 126) {
+            line.push_back(ch);
         }
     }
     if (!line.empty()) {
         history.push_back(line);
     }
-    fclose(f);
 
+    bool trimmed = false;
     if (history.size() > kHistoryMaxLines) {
         history.erase(history.begin(),
             history.begin() + (history.size() - kHistoryMaxLines));
-        if (fs_sd_mounted()) {
-            FILE* wf = fopen(history_real_path, "w");
-            if (wf) {
-                for (const auto& entry : history) {
-                    fputs(entry.c_str(), wf);
-                    fputc('\n', wf);
-                }
-                fclose(wf);
-            }
-        }
+        trimmed = true;
+    }
+    if (trimmed || from_sd) {
+        history_rewrite();
     }
 }
 
@@ -318,29 +360,18 @@ static void history_append(const std::string& line)
         trimmed = true;
     }
 
-    if (!fs_sd_mounted()) {
+    if (trimmed) {
+        history_rewrite();
         return;
     }
 
-    if (trimmed) {
-        FILE* f = fopen(history_real_path, "w");
-        if (!f) {
-            return;
-        }
-        for (const auto& entry : history) {
-            fputs(entry.c_str(), f);
-            fputc('\n', f);
-        }
-        fclose(f);
-    } else {
-        FILE* f = fopen(history_real_path, "a");
-        if (!f) {
-            return;
-        }
-        fputs(line.c_str(), f);
-        fputc('\n', f);
-        fclose(f);
+    std::string path;
+    if (!history_path(path)) {
+        return;
     }
+    std::string entry = line + "\n";
+    fs_append_file(path.c_str(),
+        reinterpret_cast<const unsigned char*>(entry.data()), entry.size());
 }
 
 static void set_input_line(const std::string& text)
@@ -486,6 +517,30 @@ void term_write_bytes(const char* data, size_t len)
     }
 }
 
+void term_batch_begin()
+{
+    if (batch_depth++ == 0) {
+        batch_full = false;
+        memset(batch_dirty, 0, sizeof(batch_dirty));
+    }
+}
+
+void term_batch_end()
+{
+    if (batch_depth == 0 || --batch_depth > 0) {
+        return;
+    }
+    if (batch_full) {
+        redraw_all();
+        return;
+    }
+    for (int r = 0; r < TERM_ROWS; r++) {
+        if (batch_dirty[r]) {
+            redraw_row(r);
+        }
+    }
+}
+
 void term_write_bytes_error(const char* data, size_t len)
 {
     uint16_t prev = current_fg;
@@ -9,6 +9,8 @@ void term_puts(const char *s);
 void term_print(const char *utf8);
 void term_write_bytes(const char* data, size_t len);
 void term_write_bytes_error(const char* data, size_t len);
+void term_batch_begin();
+void term_batch_end();
 void term_prompt();
 void term_error(const char* msg);
 void term_enter();
@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+
+// horloge simulée, avancée par les tests
+inline uint32_t sim_now_ms = 0;
+
+inline unsigned long millis()
+{
+    return sim_now_ms;
+}
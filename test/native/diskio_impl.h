@@ -0,0 +1,12 @@
+#pragma once
+#include "ff.h"
+
+typedef struct {
+    DSTATUS (*init)(BYTE pdrv);
+    DSTATUS (*status)(BYTE pdrv);
+    DRESULT (*read)(BYTE pdrv, BYTE* buff, DWORD sector, UINT count);
+    DRESULT (*write)(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count);
+    DRESULT (*ioctl)(BYTE pdrv, BYTE cmd, void* buff);
+} ff_diskio_impl_t;
+
+void ff_diskio_register(BYTE pdrv, const ff_diskio_impl_t* impl);
@@ -0,0 +1,15 @@
+#pragma once
+#include <stdlib.h>
+
+#define MALLOC_CAP_DMA 0
+
+inline void* heap_caps_malloc(size_t size, unsigned caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+inline void heap_caps_free(void* p)
+{
+    free(p);
+}
@@ -0,0 +1,4 @@
+#pragma once
+#include <stdint.h>
+
+#define portMAX_DELAY 0xFFFFFFFFu
@@ -0,0 +1,23 @@
+#pragma once
+#include "FreeRTOS.h"
+
+// une seule tâche sur l'hôte : le mutex ne fait que compter
+typedef int* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new int(0);
+}
+
+inline int xSemaphoreTake(SemaphoreHandle_t s, uint32_t wait)
+{
+    (void)wait;
+    ++*s;
+    return 1;
+}
+
+inline int xSemaphoreGive(SemaphoreHandle_t s)
+{
+    --*s;
+    return 1;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef struct {
+    int capacity;               // secteurs
+    int sector_size;
+} sdmmc_csd_t;
+
+typedef struct {
+    sdmmc_csd_t csd;
+} sdmmc_card_t;
+
+esp_err_t sdmmc_read_sectors(sdmmc_card_t* card, void* dst, size_t start, size_t count);
+esp_err_t sdmmc_write_sectors(sdmmc_card_t* card, const void* src, size_t start, size_t count);
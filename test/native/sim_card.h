@@ -0,0 +1,101 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "diskio_impl.h"
+#include "diskio_sdmmc.h"
+#include "sdmmc_cmd.h"
+
+// ------------------------------------------------------------
+// Carte SD en mémoire : compte les commandes reçues
+// ------------------------------------------------------------
+//
+// Secteur 0 : secteur de démarrage FAT32 sans MBR, 32 secteurs réservés
+// et deux FAT de kSimFatSectors, soit la zone FAT [0, kSimMetaEnd).
+
+static constexpr uint32_t kSimSectors = 16384;          // 8 Mio
+static constexpr uint32_t kSimReserved = 32;
+static constexpr uint32_t kSimFatSectors = 64;
+static constexpr uint32_t kSimMetaEnd = kSimReserved + 2 * kSimFatSectors;
+
+struct SimCard {
+    sdmmc_card_t card;
+    std::vector<uint8_t> data;
+    uint32_t read_cmds;
+    uint32_t write_cmds;
+    uint32_t sectors_read;
+    uint32_t sectors_written;
+    const ff_diskio_impl_t* impl;   // diskio enregistré par le cache
+};
+
+inline SimCard sim;
+
+inline void sim_reset()
+{
+    sim.card.csd.capacity = (int)kSimSectors;
+    sim.card.csd.sector_size = 512;
+    sim.data.assign((size_t)kSimSectors * 512, 0);
+    uint8_t* b = sim.data.data();
+    b[0] = 0xEB;
+    b[11] = 0x00;                   // 512 octets par secteur
+    b[12] = 0x02;
+    b[0x0E] = (uint8_t)kSimReserved;
+    b[0x10] = 2;                    // deux FAT
+    b[0x24] = (uint8_t)kSimFatSectors;
+    b[510] = 0x55;
+    b[511] = 0xAA;
+    sim.read_cmds = 0;
+    sim.write_cmds = 0;
+    sim.sectors_read = 0;
+    sim.sectors_written = 0;
+    sim.impl = nullptr;
+}
+
+inline uint8_t* sim_sector(uint32_t lba)
+{
+    return sim.data.data() + (size_t)lba * 512;
+}
+
+inline esp_err_t sdmmc_read_sectors(sdmmc_card_t* card, void* dst, size_t start, size_t count)
+{
+    (void)card;
+    if (start + count > kSimSectors) {
+        return ESP_FAIL;
+    }
+    memcpy(dst, sim_sector((uint32_t)start), count * 512);
+    sim.read_cmds++;
+    sim.sectors_read += (uint32_t)count;
+    return ESP_OK;
+}
+
+inline esp_err_t sdmmc_write_sectors(sdmmc_card_t* card, const void* src, size_t start, size_t count)
+{
+    (void)card;
+    if (start + count > kSimSectors) {
+        return ESP_FAIL;
+    }
+    memcpy(sim_sector((uint32_t)start), src, count * 512);
+    sim.write_cmds++;
+    sim.sectors_written += (uint32_t)count;
+    return ESP_OK;
+}
+
+inline BYTE ff_diskio_get_pdrv_card(const sdmmc_card_t* card)
+{
+    (void)card;
+    return 0;
+}
+
+inline void ff_diskio_register(BYTE pdrv, const ff_diskio_impl_t* impl)
+{
+    (void)pdrv;
+    sim.impl = impl;
+}
+
+inline void ff_diskio_register_sdmmc(BYTE pdrv, sdmmc_card_t* card)
+{
+    (void)pdrv;
+    (void)card;
+    sim.impl = nullptr;
+}
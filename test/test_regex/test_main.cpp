@@ -0,0 +1,95 @@
+// Expressions régulières de l'éditeur (src/editor/regex.cpp) : ancres
+// et assertions vides, en particulier sur une ligne vide où ^ et $ sont
+// vrais à la même position, dans n'importe quel ordre.
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include "editor/regex.cpp"
+
+struct Case {
+    const char* pattern;
+    const char* text;
+    int start;                  // -1 : aucune occurrence
+    int end;
+};
+
+static const Case kCases[] = {
+    { "^", "", 0, 0 },
+    { "$", "", 0, 0 },
+    { "^$", "", 0, 0 },
+    { "$^", "", 0, 0 },
+    { "^$^", "", 0, 0 },
+    { "$^$", "", 0, 0 },
+    { "($)(^)", "", 0, 0 },
+    { "a*$^", "", 0, 0 },
+    { "$^|x", "", 0, 0 },
+    { "^$", "a", -1, -1 },
+    { "$^", "a", -1, -1 },
+    { "^$^", "a", -1, -1 },
+    { "a$^", "a", -1, -1 },
+    { "$", "ab", 2, 2 },
+    { "^a", "ab", 0, 1 },
+    { "b$", "ab", 1, 2 },
+    { "^ab$", "ab", 0, 2 },
+    { "a|$^", "ba", 1, 2 },
+};
+
+static void run(const Case& c)
+{
+    Regex re;
+    char msg[96];
+    snprintf(msg, sizeof(msg), "/%s/ on \"%s\"", c.pattern, c.text);
+    TEST_ASSERT_TRUE_MESSAGE(re.compile(c.pattern, false), msg);
+
+    ReMatch m;
+    bool found = re.scan(c.text, strlen(c.text)) && re.next(0, m);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(c.start >= 0, found, msg);
+    if (found) {
+        TEST_ASSERT_EQUAL_INT_MESSAGE(c.start, m.cap[0], msg);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(c.end, m.cap[1], msg);
+    }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+// ------------------------------------------------------------
+// Ancres
+// ------------------------------------------------------------
+
+static void test_anchors()
+{
+    for (const Case& c : kCases) {
+        run(c);
+    }
+}
+
+// une recherche arrière trouve aussi l'occurrence vide
+static void test_empty_line_prev()
+{
+    Regex re;
+    ReMatch m;
+    TEST_ASSERT_TRUE(re.compile("$^", false));
+    TEST_ASSERT_TRUE(re.scan("", 0));
+    TEST_ASSERT_TRUE(re.prev(1, m));
+    TEST_ASSERT_EQUAL_INT(0, m.cap[0]);
+    TEST_ASSERT_EQUAL_INT(0, m.cap[1]);
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_anchors);
+    RUN_TEST(test_empty_line_prev);
+    return UNITY_END();
+}
@@ -0,0 +1,229 @@
+// Rangs d'écran des lignes (src/editor/row_index.cpp) tenus à jour par
+// le crochet d'édition de LineStore, comparés à la somme ligne par ligne
+// que faisait l'éditeur, et mesure du curseur descendant un fichier de
+// 10 000 lignes (comme ensure_cursor_visible() à chaque touche).
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+
+#include "editor/line_store.cpp"
+#include "editor/row_index.cpp"
+
+static constexpr int kCols = 30;                // comme EDIT_COLS
+static constexpr int kTextRows = 7;             // comme TEXT_ROWS
+static constexpr int kLines = 10000;
+
+static LineStore doc;
+static RowIndex rows;
+static uint32_t rng_state = 1;
+
+static uint32_t rng()
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+// sans tabulations ni UTF-8 : un octet par colonne
+static int visual_rows(const LineView& line)
+{
+    int len = (int)line.size();
+    return (len <= 0) ? 1 : (1 + (len - 1) / kCols);
+}
+
+static void doc_edited(int row, int removed, int added, void*)
+{
+    rows.replace(row, removed, added);
+    for (int i = row; i < row + added; i++) {
+        rows.set(i, visual_rows(doc.line(i)));
+    }
+}
+
+// lignes de 0 à 119 colonnes : 1 à 4 rangs d'écran
+static void load(int lines)
+{
+    std::string s;
+    for (int i = 0; i < lines; i++) {
+        s.assign(rng() % 120, (char)('a' + i % 26));
+        TEST_ASSERT_TRUE(doc.append_line(s.data(), s.size()));
+    }
+}
+
+// ce que faisait l'éditeur avant l'index : somme depuis la ligne 0
+static int linear_prefix(int row)
+{
+    int total = 0;
+    for (int i = 0; i < row; i++) {
+        total += visual_rows(doc.line(i));
+    }
+    return total;
+}
+
+static bool linear_find(int abs, int& row, int& sub)
+{
+    for (int i = 0; i < doc.line_count(); i++) {
+        int n = visual_rows(doc.line(i));
+        if (abs < n) {
+            row = i;
+            sub = abs;
+            return true;
+        }
+        abs -= n;
+    }
+    return false;
+}
+
+static void check_all()
+{
+    int total = 0;
+    for (int r = 0; r <= doc.line_count(); r++) {
+        TEST_ASSERT_EQUAL_INT(total, rows.prefix(r));
+        if (r < doc.line_count()) {
+            total += visual_rows(doc.line(r));
+        }
+    }
+    for (int k = 0; k < 200; k++) {
+        int abs = (int)(rng() % (uint32_t)(total + 10));
+        int row = -1, sub = -1, ref_row = -1, ref_sub = -1;
+        bool found = rows.find(abs, row, sub);
+        TEST_ASSERT_EQUAL_INT(linear_find(abs, ref_row, ref_sub), found);
+        if (found) {
+            TEST_ASSERT_EQUAL_INT(ref_row, row);
+            TEST_ASSERT_EQUAL_INT(ref_sub, sub);
+        }
+    }
+}
+
+void setUp()
+{
+    rng_state = 1;
+    doc.clear();
+    rows.release();
+    doc.set_edit_hook(doc_edited, nullptr);
+}
+
+void tearDown()
+{
+    doc.set_edit_hook(nullptr, nullptr);
+    doc.release();
+    rows.release();
+}
+
+// ------------------------------------------------------------
+// Justesse
+// ------------------------------------------------------------
+
+static void test_index_follows_edits()
+{
+    load(kLines);
+    check_all();
+    std::string s;
+    for (int k = 0; k < 2000; k++) {
+        int n = doc.line_count();
+        int row = (int)(rng() % (uint32_t)n);
+        int len = doc.line_len(row);
+        int col = len ? (int)(rng() % (uint32_t)(len + 1)) : 0;
+        switch (rng() % 6) {
+        case 0:
+            s.assign(1 + rng() % 40, 'x');
+            TEST_ASSERT_TRUE(doc.insert(row, col, s.data(), s.size()));
+            break;
+        case 1:
+            if (col < len) doc.erase(row, col, 1);
+            break;
+        case 2:
+            TEST_ASSERT_TRUE(doc.split_line(row, col));
+            break;
+        case 3:
+            if (row + 1 < n) doc.join_lines(row);
+            break;
+        case 4:
+            if (n > 1) doc.delete_line(row);
+            break;
+        default:
+            s.assign(rng() % 150, 'y');
+            TEST_ASSERT_TRUE(doc.insert_line(row, s.data(), s.size()));
+            break;
+        }
+        if (k % 250 == 0) {
+            check_all();
+        }
+    }
+    check_all();
+}
+
+// ------------------------------------------------------------
+// Mesure : curseur vers le bas sur tout le fichier
+// ------------------------------------------------------------
+
+struct View {
+    int top_line = 0;
+    int top_sub = 0;
+};
+
+// ensure_cursor_visible() de l'éditeur, curseur en colonne 0
+template <typename Prefix, typename Find>
+static void follow(View& v, int cur_row, Prefix prefix, Find find)
+{
+    int cursor_abs = prefix(cur_row);
+    int view_abs = prefix(v.top_line) + v.top_sub;
+    int abs = -1;
+    if (cursor_abs < view_abs) {
+        abs = cursor_abs;
+    } else if (cursor_abs >= view_abs + kTextRows) {
+        abs = cursor_abs - kTextRows + 1;
+    }
+    if (abs >= 0 && !find(abs, v.top_line, v.top_sub)) {
+        v.top_line = doc.line_count() - 1;
+        v.top_sub = 0;
+    }
+}
+
+static double us_per_key(std::chrono::steady_clock::duration d, int keys)
+{
+    return std::chrono::duration<double, std::micro>(d).count() / keys;
+}
+
+static void test_cursor_down_benchmark()
+{
+    load(kLines);
+    const int keys = doc.line_count() - 1;
+
+    View indexed;
+    View linear;
+    std::chrono::steady_clock::duration t_indexed{};
+    std::chrono::steady_clock::duration t_linear{};
+    for (int row = 1; row <= keys; row++) {
+        auto t0 = std::chrono::steady_clock::now();
+        follow(indexed, row, [](int r) { return rows.prefix(r); },
+            [](int abs, int& r, int& sub) { return rows.find(abs, r, sub); });
+        auto t1 = std::chrono::steady_clock::now();
+        follow(linear, row, linear_prefix, linear_find);
+        auto t2 = std::chrono::steady_clock::now();
+        t_indexed += t1 - t0;
+        t_linear += t2 - t1;
+        TEST_ASSERT_EQUAL_INT(linear.top_line, indexed.top_line);
+        TEST_ASSERT_EQUAL_INT(linear.top_sub, indexed.top_sub);
+    }
+
+    char msg[120];
+    snprintf(msg, sizeof(msg),
+        "cursor down over %d lines: %.2f us/key indexed, %.1f us/key linear",
+        doc.line_count(), us_per_key(t_indexed, keys), us_per_key(t_linear, keys));
+    TEST_MESSAGE(msg);
+    // O(log n) contre O(n) : l'écart ne dépend pas de la machine
+    TEST_ASSERT_TRUE(t_indexed * 20 < t_linear);
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_index_follows_edits);
+    RUN_TEST(test_cursor_down_benchmark);
+    return UNITY_END();
+}
@@ -0,0 +1,284 @@
+// Cache de secteurs SD (src/hal/sd_cache.cpp) sur une carte simulée :
+// politique (écriture différée, regroupement, FAT gardée, sync) et rejeu
+// de traces d'accès.
+//
+// Trace : lignes "SDT <ms> <R|W|S> <lba> <n>", telles qu'écrites sur la
+// console par un firmware compilé avec -DSD_CACHE_TRACE ; les autres
+// lignes sont ignorées. SD_CACHE_TRACE=<fichier> rejoue ce fichier,
+// SD_CACHE_SECTORS=<n> change la taille du cache ; sans fichier, une
+// trace synthétique (ajouts à un journal, listages) est rejouée.
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "sim_card.h"
+#include "hal/sd_cache.cpp"
+
+static constexpr size_t kCacheSectors = 48;     // comme sdcard.cpp
+
+// contenu attendu : chaque écriture de la trace a son propre motif
+static std::vector<uint8_t> expected;
+static uint32_t write_seq = 0;
+
+static void fill(uint8_t* dst, uint32_t lba, uint32_t seq)
+{
+    for (size_t i = 0; i < 512; i++) {
+        dst[i] = (uint8_t)(lba * 31 + seq * 7 + i);
+    }
+}
+
+void setUp()
+{
+    sim_reset();
+    sim_now_ms = 0;
+    expected = sim.data;
+    write_seq = 0;
+}
+
+void tearDown()
+{
+    sd_cache_detach();
+}
+
+static void attach(size_t sectors)
+{
+    TEST_ASSERT_TRUE(sd_cache_attach(&sim.card, sectors));
+    TEST_ASSERT_NOT_NULL(sim.impl);
+    sim.read_cmds = 0;              // lecture de la géométrie
+    sim.sectors_read = 0;
+}
+
+static void write_one(uint32_t lba)
+{
+    uint8_t buf[512];
+    fill(buf, lba, ++write_seq);
+    TEST_ASSERT_EQUAL(RES_OK, sim.impl->write(0, buf, lba, 1));
+    memcpy(expected.data() + (size_t)lba * 512, buf, 512);
+}
+
+static void check_read(uint32_t lba, uint32_t n)
+{
+    std::vector<uint8_t> buf(n * 512);
+    TEST_ASSERT_EQUAL(RES_OK, sim.impl->read(0, buf.data(), lba, n));
+    TEST_ASSERT_EQUAL_MEMORY(expected.data() + (size_t)lba * 512, buf.data(), n * 512);
+}
+
+static void cache_sync()
+{
+    TEST_ASSERT_EQUAL(RES_OK, sim.impl->ioctl(0, CTRL_SYNC, nullptr));
+}
+
+// ------------------------------------------------------------
+// Politique
+// ------------------------------------------------------------
+
+static void test_write_is_deferred_until_ctrl_sync()
+{
+    attach(kCacheSectors);
+    write_one(500);
+    TEST_ASSERT_EQUAL_UINT32(0, sim.write_cmds);
+    cache_sync();
+    TEST_ASSERT_EQUAL_UINT32(1, sim.write_cmds);
+    TEST_ASSERT_EQUAL_MEMORY(expected.data() + 500 * 512, sim_sector(500), 512);
+    SdCacheStats st;
+    TEST_ASSERT_TRUE(sd_cache_get_stats(st));
+    TEST_ASSERT_EQUAL_UINT32(0, st.dirty);
+}
+
+static void test_contiguous_dirty_sectors_coalesce()
+{
+    attach(kCacheSectors);
+    for (uint32_t k = 0; k < kStageSectors; k++) {
+        write_one(1000 + k);
+    }
+    write_one(2000);
+    cache_sync();
+    TEST_ASSERT_EQUAL_UINT32(2, sim.write_cmds);
+    TEST_ASSERT_EQUAL_UINT32(kStageSectors + 1, sim.sectors_written);
+    TEST_ASSERT_TRUE(memcmp(expected.data(), sim.data.data(), expected.size()) == 0);
+}
+
+static void test_fat_sectors_survive_data_scan()
+{
+    attach(kCacheSectors);
+    check_read(kSimReserved + 3, 1);
+    for (uint32_t lba = 4000; lba < 4000 + 4 * kCacheSectors; lba++) {
+        check_read(lba, 1);
+    }
+    uint32_t before = sim.read_cmds;
+    check_read(kSimReserved + 3, 1);
+    TEST_ASSERT_EQUAL_UINT32(before, sim.read_cmds);
+}
+
+static void test_idle_flush_after_delay()
+{
+    attach(kCacheSectors);
+    sim_now_ms = 100;
+    write_one(700);
+    sim_now_ms = 600;
+    sd_cache_idle();
+    TEST_ASSERT_EQUAL_UINT32(0, sim.write_cmds);
+    sim_now_ms = 1200;
+    sd_cache_idle();
+    TEST_ASSERT_EQUAL_UINT32(1, sim.write_cmds);
+}
+
+static void test_multi_sector_read_sees_dirty_copy()
+{
+    attach(kCacheSectors);
+    write_one(3003);
+    check_read(3000, 8);
+    TEST_ASSERT_EQUAL_UINT32(0, sim.write_cmds);
+}
+
+static void test_detach_flushes()
+{
+    attach(kCacheSectors);
+    write_one(42);
+    write_one(9000);
+    sd_cache_detach();
+    TEST_ASSERT_TRUE(memcmp(expected.data(), sim.data.data(), expected.size()) == 0);
+}
+
+// ------------------------------------------------------------
+// Rejeu de trace
+// ------------------------------------------------------------
+
+struct TraceOp {
+    uint32_t ms;
+    char op;
+    uint32_t lba;
+    uint32_t n;
+};
+
+static bool load_trace(const char* path, std::vector<TraceOp>& out)
+{
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        return false;
+    }
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        const char* p = strstr(line, "SDT ");
+        TraceOp t;
+        unsigned long ms, lba;
+        unsigned n;
+        if (p && sscanf(p, "SDT %lu %c %lu %u", &ms, &t.op, &lba, &n) == 4) {
+            t.ms = (uint32_t)ms;
+            t.lba = (uint32_t)lba;
+            t.n = n;
+            out.push_back(t);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// ajouts d'une ligne à un journal (FAT, entrée de répertoire, donnée,
+// puis f_close) entrecoupés de listages d'un répertoire de 4 secteurs
+static void synth_trace(std::vector<TraceOp>& out)
+{
+    const uint32_t fat = kSimReserved;
+    const uint32_t dir = kSimMetaEnd;
+    const uint32_t data = kSimMetaEnd + 64;
+    uint32_t ms = 0;
+    for (uint32_t k = 0; k < 400; k++) {
+        ms += 50;
+        uint32_t tail = data + k / 8;
+        out.push_back({ ms, 'R', fat + (tail / 128) % kSimFatSectors, 1 });
+        out.push_back({ ms, 'R', dir, 1 });
+        out.push_back({ ms, 'R', tail, 1 });
+        out.push_back({ ms, 'W', tail, 1 });
+        out.push_back({ ms, 'W', dir, 1 });
+        if (k % 8 == 7) {
+            out.push_back({ ms, 'W', fat + (tail / 128) % kSimFatSectors, 1 });
+        }
+        out.push_back({ ms, 'S', 0, 0 });
+        if (k % 20 == 0) {
+            ms += 400;
+            for (uint32_t d = 0; d < 4; d++) {
+                out.push_back({ ms, 'R', dir + d, 1 });
+            }
+            out.push_back({ ms, 'R', data + 1000 + k, 16 });
+        }
+    }
+}
+
+static void test_replay_trace()
+{
+    std::vector<TraceOp> trace;
+    const char* path = getenv("SD_CACHE_TRACE");
+    if (path && *path) {
+        TEST_ASSERT_TRUE_MESSAGE(load_trace(path, trace), "trace illisible");
+    } else {
+        synth_trace(trace);
+    }
+    const char* env_sectors = getenv("SD_CACHE_SECTORS");
+    size_t sectors = (env_sectors && atoi(env_sectors) > 0) ?
+        (size_t)atoi(env_sectors) : kCacheSectors;
+
+    // sans cache, chaque accès est une commande et chaque sync est vide
+    uint32_t direct_cmds = 0;
+    for (const TraceOp& t : trace) {
+        if (t.op != 'S') direct_cmds++;
+    }
+
+    attach(sectors);
+    std::vector<uint8_t> buf;
+    for (const TraceOp& t : trace) {
+        if (t.lba + t.n > kSimSectors) {
+            continue;
+        }
+        sim_now_ms = t.ms;
+        sd_cache_idle();
+        if (t.op == 'R') {
+            check_read(t.lba, t.n);
+        } else if (t.op == 'W') {
+            buf.resize((size_t)t.n * 512);
+            write_seq++;
+            for (uint32_t k = 0; k < t.n; k++) {
+                fill(buf.data() + k * 512, t.lba + k, write_seq);
+            }
+            TEST_ASSERT_EQUAL(RES_OK, sim.impl->write(0, buf.data(), t.lba, t.n));
+            memcpy(expected.data() + (size_t)t.lba * 512, buf.data(), buf.size());
+        } else if (t.op == 'S') {
+            cache_sync();
+            TEST_ASSERT_TRUE(memcmp(expected.data(), sim.data.data(), expected.size()) == 0);
+        }
+    }
+
+    SdCacheStats st;
+    TEST_ASSERT_TRUE(sd_cache_get_stats(st));
+    char msg[200];
+    snprintf(msg, sizeof(msg),
+        "%u ops, %u sectors: hits %u misses %u bypass %u write_hits %u, "
+        "card cmds %u (direct %u), flushes %u",
+        (unsigned)trace.size(), (unsigned)sectors, (unsigned)st.hits,
+        (unsigned)st.misses, (unsigned)st.bypass, (unsigned)st.write_hits,
+        (unsigned)(sim.read_cmds + sim.write_cmds), (unsigned)direct_cmds,
+        (unsigned)st.flushes);
+    TEST_MESSAGE(msg);
+
+    sd_cache_detach();
+    TEST_ASSERT_TRUE(memcmp(expected.data(), sim.data.data(), expected.size()) == 0);
+}
+
+int main(int argc, char** argv)
+{
+    (void)argc;
+    (void)argv;
+    UNITY_BEGIN();
+    RUN_TEST(test_write_is_deferred_until_ctrl_sync);
+    RUN_TEST(test_contiguous_dirty_sectors_coalesce);
+    RUN_TEST(test_fat_sectors_survive_data_scan);
+    RUN_TEST(test_idle_flush_after_delay);
+    RUN_TEST(test_multi_sector_read_sees_dirty_copy);
+    RUN_TEST(test_detach_flushes);
+    RUN_TEST(test_replay_trace);
+    return UNITY_END();
+}